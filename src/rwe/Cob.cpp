@@ -1,8 +1,74 @@
 #include "Cob.h"
 #include <rwe/io_utils.h>
+#include <stdexcept>
 
 namespace rwe
 {
+    const char* getCobEntryPointName(CobEntryPoint entryPoint)
+    {
+        switch (entryPoint)
+        {
+            case CobEntryPoint::Create:
+                return "Create";
+            case CobEntryPoint::StartMoving:
+                return "StartMoving";
+            case CobEntryPoint::StopMoving:
+                return "StopMoving";
+            case CobEntryPoint::TargetCleared:
+                return "TargetCleared";
+            case CobEntryPoint::AimPrimary:
+                return "AimPrimary";
+            case CobEntryPoint::AimSecondary:
+                return "AimSecondary";
+            case CobEntryPoint::AimTertiary:
+                return "AimTertiary";
+            case CobEntryPoint::FirePrimary:
+                return "FirePrimary";
+            case CobEntryPoint::FireSecondary:
+                return "FireSecondary";
+            case CobEntryPoint::FireTertiary:
+                return "FireTertiary";
+            case CobEntryPoint::QueryPrimary:
+                return "QueryPrimary";
+            case CobEntryPoint::QuerySecondary:
+                return "QuerySecondary";
+            case CobEntryPoint::QueryTertiary:
+                return "QueryTertiary";
+            default:
+                throw std::logic_error("Invalid cob entry point");
+        }
+    }
+
+    boost::optional<unsigned int> CobScript::findFunction(CobFunctionSymbol symbol) const
+    {
+        auto it = functionIds.find(symbol);
+        if (it == functionIds.end())
+        {
+            return boost::none;
+        }
+
+        return it->second;
+    }
+
+    boost::optional<unsigned int> CobScript::getEntryPoint(CobEntryPoint entryPoint) const
+    {
+        return entryPoints[static_cast<std::size_t>(entryPoint)];
+    }
+
+    void indexCobFunctions(CobScript& script)
+    {
+        script.functionIds.clear();
+        for (unsigned int i = 0; i < script.functions.size(); ++i)
+        {
+            script.functionIds.emplace(internCobFunctionSymbol(script.functions[i].name), i);
+        }
+
+        for (std::size_t i = 0; i < CobEntryPointCount; ++i)
+        {
+            script.entryPoints[i] = script.findFunction(internCobFunctionSymbol(getCobEntryPointName(static_cast<CobEntryPoint>(i))));
+        }
+    }
+
     CobScript parseCob(std::istream& stream)
     {
         auto header = readRaw<CobHeader>(stream);
@@ -17,6 +83,7 @@ namespace rwe
         {
             script.instructions[i] = readRaw<uint32_t>(stream);
         }
+        script.code = decodeCobInstructions(script.instructions);
 
 
         // read in function addresses
@@ -50,6 +117,8 @@ namespace rwe
             stream.seekg(loc);
         }
 
+        indexCobFunctions(script);
+
         return script;
     }
 }
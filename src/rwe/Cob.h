@@ -1,7 +1,11 @@
 #ifndef RWE_COB_H
 #define RWE_COB_H
 
+#include <array>
+#include <boost/optional.hpp>
 #include <cstdint>
+#include <rwe/cob/CobFunctionSymbol.h>
+#include <rwe/cob/CobInstruction.h>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -25,6 +29,28 @@ namespace rwe
     };
 #pragma pack()
 
+    /** The functions that the engine calls in unit scripts. */
+    enum class CobEntryPoint
+    {
+        Create,
+        StartMoving,
+        StopMoving,
+        TargetCleared,
+        AimPrimary,
+        AimSecondary,
+        AimTertiary,
+        FirePrimary,
+        FireSecondary,
+        FireTertiary,
+        QueryPrimary,
+        QuerySecondary,
+        QueryTertiary,
+    };
+
+    constexpr std::size_t CobEntryPointCount = static_cast<std::size_t>(CobEntryPoint::QueryTertiary) + 1;
+
+    const char* getCobEntryPointName(CobEntryPoint entryPoint);
+
     struct CobFunctionInfo
     {
         std::string name;
@@ -34,11 +60,34 @@ namespace rwe
     struct CobScript
     {
         std::vector<uint32_t> instructions;
+
+        /** The instructions decoded ahead of time, indexed by the same addresses. */
+        std::vector<CobInstruction> code;
+
         std::vector<std::string> pieces;
         std::vector<CobFunctionInfo> functions;
         unsigned int staticVariableCount;
+
+        /** The index of each function in functions, by the symbol for its name. */
+        std::unordered_map<CobFunctionSymbol, unsigned int> functionIds;
+
+        /** The index of each entry point in functions, if the script has it. */
+        std::array<boost::optional<unsigned int>, CobEntryPointCount> entryPoints;
+
+        /**
+         * Returns the index of the function whose name has the given symbol.
+         */
+        boost::optional<unsigned int> findFunction(CobFunctionSymbol symbol) const;
+
+        boost::optional<unsigned int> getEntryPoint(CobEntryPoint entryPoint) const;
     };
 
+    /**
+     * Fills in the script's function lookups from its functions.
+     * If several functions share a name, the first is used.
+     */
+    void indexCobFunctions(CobScript& script);
+
     CobScript parseCob(std::istream& stream);
 }
 
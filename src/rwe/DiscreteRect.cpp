@@ -103,4 +103,12 @@ namespace rwe
                 static_cast<unsigned int>(maxY - py)});
         return OctileDistance(distance, 0);
     }
+
+    bool DiscreteRect::intersects(const DiscreteRect& other) const
+    {
+        return x < other.x + static_cast<int>(other.width)
+            && other.x < x + static_cast<int>(width)
+            && y < other.y + static_cast<int>(other.height)
+            && other.y < y + static_cast<int>(height);
+    }
 }
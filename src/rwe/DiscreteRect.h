@@ -41,6 +41,9 @@ namespace rwe
          * to the nearest coordinates that are adjacent to the rectangle.
          */
         OctileDistance octileDistanceToPerimeter(int px, int py) const;
+
+        /** Returns true if the rectangles share at least one cell. */
+        bool intersects(const DiscreteRect& other) const;
     };
 }
 
@@ -27,9 +27,10 @@ namespace rwe
           simulation(std::move(simulation)),
           collisionService(std::move(collisionService)),
           unitFactory(std::move(unitDatabase), std::move(meshService), &this->collisionService),
-          pathFindingService(&this->simulation, &this->collisionService),
-          unitBehaviorService(this, &pathFindingService, &this->collisionService),
+          pathFindingService(&this->simulation, &this->collisionService, PathFindingService::DefaultWorkerCount),
+          unitBehaviorService(&this->simulation, &pathFindingService, &this->collisionService),
           cobExecutionService(),
+          simulationStepper(&this->simulation, &pathFindingService, &unitBehaviorService, &cobExecutionService, WorkerPool::defaultWorkerCount()),
           localPlayerId(localPlayerId)
     {
     }
@@ -70,7 +71,7 @@ namespace rwe
 
         if (selectedUnit)
         {
-            renderService.drawSelectionRect(getUnit(*selectedUnit));
+            renderService.drawSelectionRect(getUnit(*selectedUnit), simulation.getUnitKinematics(*selectedUnit));
         }
 
         renderService.drawUnitShadows(simulation.terrain, simulation.units);
@@ -78,9 +79,9 @@ namespace rwe
         context.enableDepthBuffer();
 
         auto seaLevel = simulation.terrain.getSeaLevel();
-        for (const auto& unit : simulation.units)
+        for (std::size_t i = 0; i < simulation.units.size(); ++i)
         {
-            renderService.drawUnit(unit, seaLevel);
+            renderService.drawUnit(simulation.units.unitAt(i), simulation.units.kinematicsAt(i), seaLevel);
         }
 
         context.disableDepthWrites();
@@ -300,8 +301,6 @@ namespace rwe
 
     void GameScene::update()
     {
-        simulation.gameTime = nextGameTime(simulation.gameTime);
-
         float secondsElapsed = static_cast<float>(SceneManager::TickInterval) / 1000.0f;
         const float speed = CameraPanSpeed * secondsElapsed;
         int directionX = (right ? 1 : 0) - (left ? 1 : 0);
@@ -345,28 +344,23 @@ namespace rwe
             }
         }
 
-        pathFindingService.update();
+        simulationStepper.step(secondsElapsed);
+        playUnitBehaviorSounds();
 
-        // run unit scripts
-        for (unsigned int i = 0; i < simulation.units.size(); ++i)
+        // forget about the selected unit if it has been removed
+        if (selectedUnit && !simulation.unitExists(*selectedUnit))
         {
-            UnitId unitId(i);
-            auto& unit = simulation.units[i];
-
-            unitBehaviorService.update(unitId);
-
-            unit.mesh.update(secondsElapsed);
-
-            cobExecutionService.run(simulation, unitId);
+            selectedUnit = boost::none;
         }
     }
 
     void GameScene::spawnUnit(const std::string& unitType, PlayerId owner, const Vector3f& position)
     {
-        auto unit = unitFactory.createUnit(unitType, owner, simulation.getPlayer(owner).color, position);
+        auto unit = unitFactory.createUnit(unitType, owner, simulation.getPlayer(owner).color);
+        auto kinematics = unitFactory.createUnitKinematics(unitType, position);
 
         // TODO: if we failed to add the unit throw some warning
-        simulation.tryAddUnit(std::move(unit));
+        simulation.tryAddUnit(kinematics, std::move(unit));
     }
 
     void GameScene::setCameraPosition(const Vector3f& newPosition)
@@ -379,45 +373,24 @@ namespace rwe
         return simulation.terrain;
     }
 
-    void GameScene::showObject(UnitId unitId, const std::string& name)
-    {
-        simulation.showObject(unitId, name);
-    }
-
-    void GameScene::hideObject(UnitId unitId, const std::string& name)
-    {
-        simulation.hideObject(unitId, name);
-    }
-
-    void
-    GameScene::moveObject(UnitId unitId, const std::string& name, Axis axis, float position, float speed)
-    {
-        simulation.moveObject(unitId, name, axis, position, speed);
-    }
-
-    void GameScene::moveObjectNow(UnitId unitId, const std::string& name, Axis axis, float position)
+    void GameScene::showObject(UnitId unitId, unsigned int objectId)
     {
-        simulation.moveObjectNow(unitId, name, axis, position);
+        simulation.showObject(unitId, objectId);
     }
 
-    void GameScene::turnObject(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle, float speed)
+    void GameScene::hideObject(UnitId unitId, unsigned int objectId)
     {
-        simulation.turnObject(unitId, name, axis, angle, speed);
+        simulation.hideObject(unitId, objectId);
     }
 
-    void GameScene::turnObjectNow(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle)
+    bool GameScene::isPieceMoving(UnitId unitId, unsigned int objectId, Axis axis) const
     {
-        simulation.turnObjectNow(unitId, name, axis, angle);
+        return simulation.isPieceMoving(unitId, objectId, axis);
     }
 
-    bool GameScene::isPieceMoving(UnitId unitId, const std::string& name, Axis axis) const
+    bool GameScene::isPieceTurning(UnitId unitId, unsigned int objectId, Axis axis) const
     {
-        return simulation.isPieceMoving(unitId, name, axis);
-    }
-
-    bool GameScene::isPieceTurning(UnitId unitId, const std::string& name, Axis axis) const
-    {
-        return simulation.isPieceTurning(unitId, name, axis);
+        return simulation.isPieceTurning(unitId, objectId, axis);
     }
 
     GameTime GameScene::getGameTime() const
@@ -436,6 +409,23 @@ namespace rwe
         audioService->playSound(sound);
     }
 
+    void GameScene::playUnitBehaviorSounds()
+    {
+        const auto& effects = simulationStepper.getUnitBehaviorEffects();
+        for (std::size_t i = 0; i < effects.size(); ++i)
+        {
+            for (const auto& sound : effects[i].selectChannelSounds)
+            {
+                playSoundOnSelectChannel(sound);
+            }
+
+            for (const auto& sound : effects[i].unitSounds)
+            {
+                playUnitSound(simulation.units.idAt(i), sound);
+            }
+        }
+    }
+
     boost::optional<UnitId> GameScene::getUnitUnderCursor() const
     {
         auto ray = renderService.getCamera().screenToWorldRay(screenToClipSpace(getMousePosition()));
@@ -7,6 +7,7 @@
 #include "MeshService.h"
 #include "OccupiedGrid.h"
 #include "RenderService.h"
+#include "SimulationStepper.h"
 #include "UiRenderService.h"
 #include "UnitBehaviorService.h"
 #include "UnitDatabase.h"
@@ -66,6 +67,8 @@ namespace rwe
         UnitBehaviorService unitBehaviorService;
         CobExecutionService cobExecutionService;
 
+        SimulationStepper simulationStepper;
+
         PlayerId localPlayerId;
 
         bool left{false};
@@ -120,21 +123,13 @@ namespace rwe
 
         const MapTerrain& getTerrain() const;
 
-        void showObject(UnitId unitId, const std::string& name);
-
-        void hideObject(UnitId unitId, const std::string& name);
-
-        void moveObject(UnitId unitId, const std::string& name, Axis axis, float position, float speed);
+        void showObject(UnitId unitId, unsigned int objectId);
 
-        void moveObjectNow(UnitId unitId, const std::string& name, Axis axis, float position);
+        void hideObject(UnitId unitId, unsigned int objectId);
 
-        void turnObject(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle, float speed);
+        bool isPieceMoving(UnitId unitId, unsigned int objectId, Axis axis) const;
 
-        void turnObjectNow(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle);
-
-        bool isPieceMoving(UnitId unitId, const std::string& name, Axis axis) const;
-
-        bool isPieceTurning(UnitId unitId, const std::string& name, Axis axis) const;
+        bool isPieceTurning(UnitId unitId, unsigned int objectId, Axis axis) const;
 
         GameTime getGameTime() const;
 
@@ -151,6 +146,8 @@ namespace rwe
         GameSimulation& getSimulation();
 
     private:
+        void playUnitBehaviorSounds();
+
         boost::optional<UnitId> getUnitUnderCursor() const;
 
         Vector2f screenToClipSpace(Point p) const;
@@ -1,44 +1,48 @@
 #include "GameSimulation.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace rwe
 {
-    bool PathRequest::operator==(const PathRequest& rhs) const
+    /**
+     * Returns the distance from the unit's origin
+     * to the furthest point on its selection mesh.
+     */
+    float computeSelectionRadius(const CollisionMesh& mesh)
     {
-        return unitId == rhs.unitId;
-    }
+        float radiusSquared = 0.0f;
+        for (const auto& t : mesh.triangles)
+        {
+            radiusSquared = std::max({radiusSquared, t.a.lengthSquared(), t.b.lengthSquared(), t.c.lengthSquared()});
+        }
 
-    bool PathRequest::operator!=(const PathRequest& rhs) const
-    {
-        return !(rhs == *this);
+        return std::sqrt(radiusSquared);
     }
 
-    class IsCollisionVisitor : public boost::static_visitor<bool>
+    std::uint64_t hashKinematics(std::uint64_t seed, const UnitKinematics& kinematics)
     {
-    private:
-        UnitId unitId;
-
-    public:
-        explicit IsCollisionVisitor(const UnitId& unitId) : unitId(unitId)
-        {
-        }
-
-        bool operator()(const OccupiedNone&) const
-        {
-            return false;
-        }
-        bool operator()(const OccupiedUnit& u) const
-        {
-            return u.id != unitId;
-        }
-        bool operator()(const OccupiedFeature&) const
-        {
-            return true;
-        }
-    };
+        auto hash = hashCombine(seed, hashFloat(kinematics.position.x));
+        hash = hashCombine(hash, hashFloat(kinematics.position.y));
+        hash = hashCombine(hash, hashFloat(kinematics.position.z));
+        hash = hashCombine(hash, hashFloat(kinematics.rotation));
+        hash = hashCombine(hash, hashFloat(kinematics.currentSpeed));
+        hash = hashCombine(hash, hashFloat(kinematics.targetAngle));
+        hash = hashCombine(hash, hashFloat(kinematics.targetSpeed));
+        return hashCombine(hash, kinematics.inCollision ? 1 : 0);
+    }
 
-    GameSimulation::GameSimulation(MapTerrain&& terrain)
+    GameSimulation::GameSimulation(MapTerrain&& terrain, unsigned int randomSeed)
         : terrain(std::move(terrain)),
-          occupiedGrid(this->terrain.getHeightMap().getWidth(), this->terrain.getHeightMap().getHeight())
+          occupiedGrid(this->terrain.getHeightMap().getWidth(), this->terrain.getHeightMap().getHeight()),
+          unitIndex(
+              this->terrain.leftInWorldUnits(),
+              this->terrain.topInWorldUnits(),
+              this->terrain.getWidthInWorldUnits(),
+              this->terrain.getHeightInWorldUnits(),
+              UnitIndexCellSizeInWorldUnits),
+          scriptReadyUnits(std::make_unique<CobReadyUnits>()),
+          randomSeed(randomSeed)
     {
     }
 
@@ -51,7 +55,9 @@ namespace rwe
         if (f.isBlocking)
         {
             auto footprintRegion = computeFootprintRegion(f.position, f.footprintX, f.footprintZ);
-            occupiedGrid.grid.setArea(occupiedGrid.grid.clipRegion(footprintRegion), OccupiedFeature());
+            auto region = occupiedGrid.grid.clipRegion(footprintRegion);
+            occupiedGrid.setArea(region, OccupiedFeature());
+            blockingFeatureChanges.push_back(region);
         }
     }
 
@@ -62,12 +68,12 @@ namespace rwe
         return id;
     }
 
-    bool GameSimulation::tryAddUnit(Unit&& unit)
+    bool GameSimulation::tryAddUnit(const UnitKinematics& kinematics, Unit&& unit)
     {
-        UnitId unitId(units.size());
+        auto unitId = units.nextId();
 
         // set footprint area as occupied by the unit
-        auto footprintRect = computeFootprintRegion(unit.position, unit.footprintX, unit.footprintZ);
+        auto footprintRect = computeFootprintRegion(kinematics.position, unit.footprintX, unit.footprintZ);
         if (isCollisionAt(footprintRect, unitId))
         {
             return false;
@@ -76,13 +82,48 @@ namespace rwe
         auto footprintRegion = occupiedGrid.grid.tryToRegion(footprintRect);
         assert(!!footprintRegion);
 
-        occupiedGrid.grid.setArea(*footprintRegion, OccupiedUnit(unitId));
+        occupiedGrid.setArea(*footprintRegion, OccupiedUnit(unitId));
+
+        unit.cobEnvironment->seedRandom(static_cast<std::uint32_t>(hashCombine(randomSeed, unitId.value)));
+        unit.cobEnvironment->setReadyUnits(scriptReadyUnits.get(), unitId);
 
-        units.push_back(std::move(unit));
+        unitIndex.insert(unitId, kinematics.position, computeSelectionRadius(unit.selectionMesh.collisionMesh));
+        units.add(kinematics, std::move(unit));
+
+        auto& addedUnit = getUnit(unitId);
+        addedUnit.digestContribution = computeUnitDigest(unitId);
+        unitsDigest.toggle(addedUnit.digestContribution);
+        trackAnimation(unitId, false);
 
         return true;
     }
 
+    void GameSimulation::removeUnit(UnitId unitId)
+    {
+        const auto& unit = getUnit(unitId);
+        const auto& kinematics = getUnitKinematics(unitId);
+
+        auto footprintRect = computeFootprintRegion(kinematics.position, unit.footprintX, unit.footprintZ);
+        auto footprintRegion = occupiedGrid.grid.tryToRegion(footprintRect);
+        assert(!!footprintRegion);
+        occupiedGrid.setArea(*footprintRegion, OccupiedNone());
+
+        pathRequests.remove(unitId);
+
+        // The unit is left in the animating units
+        // until the next animation phase prunes it.
+
+        unitsDigest.toggle(unit.digestContribution);
+
+        unitIndex.remove(unitId);
+        units.remove(unitId);
+    }
+
+    bool GameSimulation::unitExists(UnitId unitId) const
+    {
+        return units.contains(unitId);
+    }
+
     DiscreteRect GameSimulation::computeFootprintRegion(const Vector3f& position, unsigned int footprintX, unsigned int footprintZ) const
     {
         auto halfFootprintX = static_cast<float>(footprintX) * MapTerrain::HeightTileWidthInWorldUnits / 2.0f;
@@ -99,93 +140,65 @@ namespace rwe
 
     bool GameSimulation::isCollisionAt(const DiscreteRect& rect, UnitId self) const
     {
-        auto region = occupiedGrid.grid.tryToRegion(rect);
-        if (!region)
-        {
-            return true;
-        }
-
-        for (unsigned int dy = 0; dy < region->height; ++dy)
-        {
-            for (unsigned int dx = 0; dx < region->width; ++dx)
-            {
-                const auto& cell = occupiedGrid.grid.get(region->x + dx, region->y + dy);
-                if (boost::apply_visitor(IsCollisionVisitor(self), cell))
-                {
-                    return true;
-                }
-            }
-        }
-        return false;
+        return occupiedGrid.isCollisionAt(rect, self);
     }
 
     bool GameSimulation::isAdjacentToObstacle(const DiscreteRect& rect, UnitId self) const
     {
-        DiscreteRect expandedRect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2);
-        return isCollisionAt(expandedRect, self);
+        return occupiedGrid.isAdjacentToObstacle(rect, self);
     }
 
-    void GameSimulation::showObject(UnitId unitId, const std::string& name)
+    void GameSimulation::showObject(UnitId unitId, unsigned int objectId)
     {
-        auto mesh = getUnit(unitId).mesh.find(name);
-        if (mesh)
+        auto piece = getUnit(unitId).findScriptPiece(objectId);
+        if (piece)
         {
-            mesh->visible = true;
+            piece->visible = true;
         }
     }
 
-    void GameSimulation::hideObject(UnitId unitId, const std::string& name)
+    void GameSimulation::hideObject(UnitId unitId, unsigned int objectId)
     {
-        auto mesh = getUnit(unitId).mesh.find(name);
-        if (mesh)
+        auto piece = getUnit(unitId).findScriptPiece(objectId);
+        if (piece)
         {
-            mesh->visible = false;
+            piece->visible = false;
         }
     }
 
     Unit& GameSimulation::getUnit(UnitId id)
     {
-        return units.at(id.value);
+        return units.get(id);
     }
 
     const Unit& GameSimulation::getUnit(UnitId id) const
     {
-        return units.at(id.value);
-    }
-
-    const GamePlayerInfo& GameSimulation::getPlayer(PlayerId player) const
-    {
-        return players.at(player.value);
-    }
-
-    void GameSimulation::moveObject(UnitId unitId, const std::string& name, Axis axis, float position, float speed)
-    {
-        getUnit(unitId).moveObject(name, axis, position, speed);
+        return units.get(id);
     }
 
-    void GameSimulation::moveObjectNow(UnitId unitId, const std::string& name, Axis axis, float position)
+    UnitKinematics& GameSimulation::getUnitKinematics(UnitId id)
     {
-        getUnit(unitId).moveObjectNow(name, axis, position);
+        return units.getKinematics(id);
     }
 
-    void GameSimulation::turnObject(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle, float speed)
+    const UnitKinematics& GameSimulation::getUnitKinematics(UnitId id) const
     {
-        getUnit(unitId).turnObject(name, axis, angle, speed);
+        return units.getKinematics(id);
     }
 
-    void GameSimulation::turnObjectNow(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle)
+    const GamePlayerInfo& GameSimulation::getPlayer(PlayerId player) const
     {
-        getUnit(unitId).turnObjectNow(name, axis, angle);
+        return players.at(player.value);
     }
 
-    bool GameSimulation::isPieceMoving(UnitId unitId, const std::string& name, Axis axis) const
+    bool GameSimulation::isPieceMoving(UnitId unitId, unsigned int objectId, Axis axis) const
     {
-        return getUnit(unitId).isMoveInProgress(name, axis);
+        return getUnit(unitId).isMoveInProgress(objectId, axis);
     }
 
-    bool GameSimulation::isPieceTurning(UnitId unitId, const std::string& name, Axis axis) const
+    bool GameSimulation::isPieceTurning(UnitId unitId, unsigned int objectId, Axis axis) const
     {
-        return getUnit(unitId).isTurnInProgress(name, axis);
+        return getUnit(unitId).isTurnInProgress(objectId, axis);
     }
 
     boost::optional<UnitId> GameSimulation::getFirstCollidingUnit(const Ray3f& ray) const
@@ -193,19 +206,31 @@ namespace rwe
         auto bestDistance = std::numeric_limits<float>::infinity();
         boost::optional<UnitId> it;
 
-        for (unsigned int i = 0; i < units.size(); ++i)
+        // Candidates come back in ID order,
+        // so ties are resolved in favour of the lowest ID.
+        for (const auto& id : unitIndex.queryRay(ray, MapTerrain::MinHeight, MapTerrain::MaxHeight))
         {
-            auto distance = units[i].selectionIntersect(ray);
+            auto distance = getUnit(id).selectionIntersect(getUnitKinematics(id).position, ray);
             if (distance && distance < bestDistance)
             {
                 bestDistance = *distance;
-                it = UnitId(i);
+                it = id;
             }
         }
 
         return it;
     }
 
+    std::vector<UnitId> GameSimulation::getUnitsInRadius(const Vector3f& center, float radius) const
+    {
+        return unitIndex.queryCircle(center, radius);
+    }
+
+    std::vector<UnitId> GameSimulation::getUnitsInRect(const Rectangle2f& rect) const
+    {
+        return unitIndex.queryRect(rect);
+    }
+
     boost::optional<Vector3f> GameSimulation::intersectLineWithTerrain(const Line3f& line) const
     {
         return terrain.intersectLine(line);
@@ -218,24 +243,97 @@ namespace rwe
         auto newRegion = occupiedGrid.grid.tryToRegion(newRect);
         assert(!!newRegion);
 
-        occupiedGrid.grid.setArea(*oldRegion, OccupiedNone());
-        occupiedGrid.grid.setArea(*newRegion, OccupiedUnit(unitId));
+        occupiedGrid.moveArea(*oldRegion, *newRegion, OccupiedUnit(unitId));
     }
 
-    void GameSimulation::requestPath(UnitId unitId)
+    void GameSimulation::setUnitPosition(UnitId unitId, const Vector3f& newPosition)
     {
-        PathRequest request{unitId};
+        getUnitKinematics(unitId).position = newPosition;
+        unitIndex.move(unitId, newPosition);
+    }
 
+    void GameSimulation::requestPath(UnitId unitId)
+    {
         // If the unit is already in the queue for a path,
         // we'll assume that they no longer care about their old request
         // and that their new request is for some new path,
         // so we'll move them to the back of the queue for fairness.
-        auto it = std::find(pathRequests.begin(), pathRequests.end(), request);
-        if (it != pathRequests.end())
+        pathRequests.push(unitId);
+    }
+
+    void GameSimulation::markUnitDigestStale(UnitId unitId)
+    {
+        auto& unit = getUnit(unitId);
+        if (!unit.digestStale)
         {
-            pathRequests.erase(it);
+            unit.digestStale = true;
+            staleDigestUnits.push_back(unitId);
+        }
+    }
+
+    void GameSimulation::updateStaleUnitDigests()
+    {
+        for (auto unitId : staleDigestUnits)
+        {
+            // Units removed since they were marked have already left the digest.
+            if (!unitExists(unitId))
+            {
+                continue;
+            }
+
+            getUnit(unitId).digestStale = false;
+            updateUnitDigest(unitId);
         }
 
-        pathRequests.push_back(PathRequest{unitId});
+        staleDigestUnits.clear();
+    }
+
+    void GameSimulation::updateUnitDigest(UnitId unitId)
+    {
+        auto& unit = getUnit(unitId);
+        auto contribution = computeUnitDigest(unitId);
+        unitsDigest.replace(unit.digestContribution, contribution);
+        unit.digestContribution = contribution;
+    }
+
+    std::uint64_t GameSimulation::getDigest() const
+    {
+        auto hash = hashCombine(unitsDigest.value(), occupiedGrid.digest.value());
+        return hashCombine(hash, gameTime.value);
+    }
+
+    void GameSimulation::pruneAnimatingUnits()
+    {
+        auto end = std::remove_if(animatingUnits.begin(), animatingUnits.end(), [this](UnitId id) {
+            return !unitExists(id) || !getUnit(id).mesh.isAnimating();
+        });
+        animatingUnits.erase(end, animatingUnits.end());
+    }
+
+    void GameSimulation::addAnimatingUnit(UnitId unitId)
+    {
+        assert(getUnit(unitId).mesh.isAnimating());
+        animatingUnits.push_back(unitId);
+    }
+
+    std::uint64_t GameSimulation::computeKinematicsDigest(UnitId unitId) const
+    {
+        return hashKinematics(unitId.value, getUnitKinematics(unitId));
+    }
+
+    std::uint64_t GameSimulation::computeUnitDigest(UnitId unitId) const
+    {
+        const auto& unit = getUnit(unitId);
+        auto hash = computeKinematicsDigest(unitId);
+        hash = hashCombine(hash, unit.cobEnvironment->digest.value());
+        return hashCombine(hash, unit.pieceDigest.value());
+    }
+
+    void GameSimulation::trackAnimation(UnitId unitId, bool wasAnimating)
+    {
+        if (!wasAnimating && getUnit(unitId).mesh.isAnimating())
+        {
+            addAnimatingUnit(unitId);
+        }
     }
 }
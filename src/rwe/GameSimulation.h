@@ -5,7 +5,13 @@
 #include "MapFeature.h"
 #include "MapTerrain.h"
 #include "OccupiedGrid.h"
+#include "PathRequestQueue.h"
+#include "StateDigest.h"
 #include "Unit.h"
+#include "UnitSpatialIndex.h"
+#include "UnitStore.h"
+#include <memory>
+#include <rwe/cob/CobReadyUnits.h>
 
 namespace rwe
 {
@@ -14,17 +20,11 @@ namespace rwe
         unsigned int color;
     };
 
-    struct PathRequest
-    {
-        UnitId unitId;
-
-        bool operator==(const PathRequest& rhs) const;
-
-        bool operator!=(const PathRequest& rhs) const;
-    };
-
     struct GameSimulation
     {
+        /** The size of each cell in the unit spatial index. */
+        static constexpr float UnitIndexCellSizeInWorldUnits = 128.0f;
+
         MapTerrain terrain;
 
         OccupiedGrid occupiedGrid;
@@ -33,13 +33,58 @@ namespace rwe
 
         std::vector<MapFeature> features;
 
-        std::vector<Unit> units;
+        UnitStore units;
+
+        UnitSpatialIndex unitIndex;
 
-        std::deque<PathRequest> pathRequests;
+        PathRequestQueue pathRequests;
+
+        /**
+         * Regions of the occupied grid where blocking features
+         * have been added, in the order it happened.
+         * The pathfinding service consumes these to keep
+         * its cached view of the map's obstacles up to date.
+         * Features are never removed at present;
+         * anything that comes to remove one must record its region here too.
+         */
+        std::vector<GridRegion> blockingFeatureChanges;
+
+        /**
+         * Units that have at least one piece moving or turning,
+         * in the order they started animating.
+         * Only these units need their meshes updated each tick.
+         * Removed units stay here until they are next pruned,
+         * so check that each unit still exists.
+         */
+        std::vector<UnitId> animatingUnits;
+
+        /**
+         * Units whose scripts have something to do in the next script phase.
+         * Each unit's cob environment adds itself here.
+         * This lives on the heap so that the environments' pointers to it
+         * survive the simulation being moved.
+         */
+        std::unique_ptr<CobReadyUnits> scriptReadyUnits;
 
         GameTime gameTime{0};
 
-        explicit GameSimulation(MapTerrain&& terrain);
+        /** Seeds the random number generator of each unit's scripts. */
+        unsigned int randomSeed;
+
+        /**
+         * Covers the state of every unit, as of the last time
+         * each unit was folded in by updateUnitDigest.
+         */
+        StateDigest unitsDigest;
+
+        /**
+         * Units that may have changed since they were last folded into unitsDigest,
+         * in the order they were marked.
+         * Only these units are folded in again at the end of the tick.
+         */
+        std::vector<UnitId> staleDigestUnits;
+
+        GameSimulation(MapTerrain&& terrain, unsigned int randomSeed);
 
         void addFeature(MapFeature&& newFeature);
 
@@ -49,7 +94,20 @@ namespace rwe
          * Returns true if the unit was really added, false otherwise.
          * A unit might not be added because it violates collision constraints.
          */
-        bool tryAddUnit(Unit&& unit);
+        bool tryAddUnit(const UnitKinematics& kinematics, Unit&& unit);
+
+        /**
+         * Removes the unit from the simulation,
+         * freeing the area it occupied and cancelling any path request.
+         * Afterwards, unitExists returns false for the unit's ID.
+         */
+        void removeUnit(UnitId unitId);
+
+        /**
+         * Returns true if the ID refers to a unit that is still in the simulation.
+         * This is the only operation that is valid on a stale ID.
+         */
+        bool unitExists(UnitId unitId) const;
 
         DiscreteRect computeFootprintRegion(const Vector3f& position, unsigned int footprintX, unsigned int footprintZ) const;
 
@@ -57,35 +115,114 @@ namespace rwe
 
         bool isAdjacentToObstacle(const DiscreteRect& rect, UnitId self) const;
 
-        void showObject(UnitId unitId, const std::string& name);
+        void showObject(UnitId unitId, unsigned int objectId);
 
-        void hideObject(UnitId unitId, const std::string& name);
+        void hideObject(UnitId unitId, unsigned int objectId);
 
         Unit& getUnit(UnitId id);
 
         const Unit& getUnit(UnitId id) const;
 
-        const GamePlayerInfo& getPlayer(PlayerId player) const;
+        UnitKinematics& getUnitKinematics(UnitId id);
 
-        void moveObject(UnitId unitId, const std::string& name, Axis axis, float position, float speed);
+        const UnitKinematics& getUnitKinematics(UnitId id) const;
 
-        void moveObjectNow(UnitId unitId, const std::string& name, Axis axis, float position);
+        const GamePlayerInfo& getPlayer(PlayerId player) const;
 
-        void turnObject(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle, float speed);
+        bool isPieceMoving(UnitId unitId, unsigned int objectId, Axis axis) const;
 
-        void turnObjectNow(UnitId unitId, const std::string& name, Axis axis, RadiansAngle angle);
+        bool isPieceTurning(UnitId unitId, unsigned int objectId, Axis axis) const;
 
-        bool isPieceMoving(UnitId unitId, const std::string& name, Axis axis) const;
+        boost::optional<UnitId> getFirstCollidingUnit(const Ray3f& ray) const;
 
-        bool isPieceTurning(UnitId unitId, const std::string& name, Axis axis) const;
+        /**
+         * Returns all units whose position is within the given radius
+         * of the center point on the XZ plane, in ascending ID order.
+         */
+        std::vector<UnitId> getUnitsInRadius(const Vector3f& center, float radius) const;
 
-        boost::optional<UnitId> getFirstCollidingUnit(const Ray3f& ray) const;
+        /**
+         * Returns all units whose position lies within the given rectangle
+         * on the XZ plane, in ascending ID order.
+         */
+        std::vector<UnitId> getUnitsInRect(const Rectangle2f& rect) const;
 
         boost::optional<Vector3f> intersectLineWithTerrain(const Line3f& line) const;
 
         void moveUnitOccupiedArea(const DiscreteRect& oldRect, const DiscreteRect& newRect, UnitId unitId);
 
+        /**
+         * Moves the unit to the new position,
+         * keeping the unit spatial index up to date.
+         * This does not perform any collision checks.
+         */
+        void setUnitPosition(UnitId unitId, const Vector3f& newPosition);
+
         void requestPath(UnitId unitId);
+
+        /**
+         * Marks the unit as needing to be folded into the simulation digest again.
+         * Anything that changes a unit's kinematics, script state or piece commands
+         * must see that this is called for it before the end of the tick.
+         * It is not safe to call for several units in parallel.
+         */
+        void markUnitDigestStale(UnitId unitId);
+
+        /**
+         * Returns the hash of the unit's kinematics
+         * that goes into the unit's part of the simulation digest.
+         * Callers can compare this before and after an update
+         * to tell whether the unit needs marking as stale.
+         */
+        std::uint64_t computeKinematicsDigest(UnitId unitId) const;
+
+        /**
+         * Refreshes the simulation digest's contribution from each unit
+         * marked since the last call.
+         * Call this once per tick, after all the units' updates for that tick.
+         */
+        void updateStaleUnitDigests();
+
+        /**
+         * Returns a digest of the simulation state,
+         * covering units (as of the last updateStaleUnitDigests),
+         * the occupied grid and the game time.
+         * Two simulations that have stayed in sync
+         * return the same value for the same tick.
+         * This is cheap enough to call every tick.
+         */
+        std::uint64_t getDigest() const;
+
+        /**
+         * Removes units whose pieces have all come to rest,
+         * and units that have been removed from the simulation,
+         * from the set of animating units.
+         * Call this after updating the meshes of the animating units.
+         */
+        void pruneAnimatingUnits();
+
+        /**
+         * Adds the unit to the set of animating units.
+         * Whoever gives a unit's pieces operations
+         * must call this when the unit starts animating.
+         * Unit scripts do it through the cob execution service's effects.
+         */
+        void addAnimatingUnit(UnitId unitId);
+
+    private:
+        std::uint64_t computeUnitDigest(UnitId unitId) const;
+
+        /**
+         * Refreshes the unit's contribution to the simulation digest
+         * from its kinematics, script state and piece commands.
+         */
+        void updateUnitDigest(UnitId unitId);
+
+        /**
+         * Adds the unit to the set of animating units
+         * if it has just started animating.
+         */
+        void trackAnimation(UnitId unitId, bool wasAnimating);
     };
 }
 
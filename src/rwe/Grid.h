@@ -3,6 +3,7 @@
 
 #include "DiscreteRect.h"
 #include "GridRegion.h"
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <cassert>
 #include <functional>
@@ -220,12 +221,11 @@ namespace rwe
         assert(x + width <= this->width);
         assert(y + height <= this->height);
 
+        // rows are contiguous, so fill each one in a single pass
         for (std::size_t dy = 0; dy < height; ++dy)
         {
-            for (std::size_t dx = 0; dx < width; ++dx)
-            {
-                set(x + dx, y + dy, value);
-            }
+            auto rowStart = data.begin() + ((y + dy) * this->width) + x;
+            std::fill(rowStart, rowStart + width, value);
         }
     }
 
@@ -1,6 +1,7 @@
 #include "LoadingScene.h"
-#include "WeaponTdf.h"
 #include <boost/interprocess/streams/bufferstream.hpp>
+#include <random>
+#include <rwe/loading_utils.h>
 #include <rwe/ota.h>
 #include <rwe/tdf.h>
 #include <rwe/tnt/TntArchive.h>
@@ -117,21 +118,9 @@ namespace rwe
 
         auto meshService = MeshService::createMeshService(vfs, graphics, palette);
 
-        auto unitDatabase = createUnitDatabase();
+        auto unitDatabase = createUnitDatabase(vfs, audioService);
 
-        MovementClassCollisionService collisionService;
-
-        // compute cached walkable grids for each movement class
-        {
-            UnitDatabase::MovementClassIterator it = unitDatabase.movementClassBegin();
-            UnitDatabase::MovementClassIterator end = unitDatabase.movementClassEnd();
-            for (; it != end; ++it)
-            {
-                const auto& name = it->first;
-                const auto& mc = it->second;
-                collisionService.registerMovementClass(name, computeWalkableGrid(simulation, mc));
-            }
-        }
+        auto collisionService = createCollisionService(simulation, unitDatabase);
 
         boost::optional<PlayerId> localPlayerId;
 
@@ -247,40 +236,15 @@ namespace rwe
             std::move(heightGrid),
             tnt.getHeader().seaLevel);
 
-        GameSimulation simulation(std::move(terrain));
-
-        auto featureTemplates = getFeatures(tnt);
-
-        for (std::size_t y = 0; y < mapAttributes.getHeight(); ++y)
-        {
-            for (std::size_t x = 0; x < mapAttributes.getWidth(); ++x)
-            {
-                const auto& e = mapAttributes.get(x, y);
-                switch (e.feature)
-                {
-                    case TntTileAttributes::FeatureNone:
-                    case TntTileAttributes::FeatureUnknown:
-                    case TntTileAttributes::FeatureVoid:
-                        break;
-                    default:
-                        const auto& featureTemplate = featureTemplates[e.feature];
-                        Vector3f pos = computeFeaturePosition(simulation.terrain, featureTemplate, x, y);
-                        auto feature = createFeature(pos, featureTemplate);
-                        simulation.addFeature(std::move(feature));
-                }
-            }
-        }
+        GameSimulation simulation(std::move(terrain), std::random_device()());
 
-        const auto& schema = ota.schemas.at(schemaIndex);
-
-        // add features from the OTA schema
-        for (const auto& f : schema.features)
-        {
-            const auto& featureTemplate = featureService->getFeatureDefinition(f.featureName);
-            Vector3f pos = computeFeaturePosition(terrain, featureTemplate, f.xPos, f.zPos);
-            auto feature = createFeature(pos, featureTemplate);
-            simulation.addFeature(std::move(feature));
-        }
+        addMapFeatures(
+            simulation,
+            tnt,
+            mapAttributes,
+            ota.schemas.at(schemaIndex),
+            *featureService,
+            [this](const Vector3f& pos, const FeatureDefinition& definition) { return createFeature(pos, definition); });
 
         return simulation;
     }
@@ -351,41 +315,9 @@ namespace rwe
         return tileTextures;
     }
 
-    Grid<std::size_t> LoadingScene::getMapData(TntArchive& tnt)
-    {
-        auto mapWidthInTiles = tnt.getHeader().width / 2;
-        auto mapHeightInTiles = tnt.getHeader().height / 2;
-        std::vector<uint16_t> mapData(mapWidthInTiles * mapHeightInTiles);
-        tnt.readMapData(mapData.data());
-        std::vector<std::size_t> dataCopy;
-        dataCopy.reserve(mapData.size());
-        std::copy(mapData.begin(), mapData.end(), std::back_inserter(dataCopy));
-        Grid<std::size_t> dataGrid(mapWidthInTiles, mapHeightInTiles, std::move(dataCopy));
-        return dataGrid;
-    }
-
-    std::vector<FeatureDefinition> LoadingScene::getFeatures(TntArchive& tnt)
-    {
-        std::vector<FeatureDefinition> features;
-
-        tnt.readFeatures([this, &features](const auto& featureName) {
-            const auto& feature = featureService->getFeatureDefinition(featureName);
-            features.push_back(feature);
-        });
-
-        return features;
-    }
-
     MapFeature LoadingScene::createFeature(const Vector3f& pos, const FeatureDefinition& definition)
     {
-        MapFeature f;
-        f.footprintX = definition.footprintX;
-        f.footprintZ = definition.footprintZ;
-        f.height = definition.height;
-        f.isBlocking = definition.blocking;
-        f.position = pos;
-        f.transparentAnimation = definition.animTrans;
-        f.transparentShadow = definition.shadTrans;
+        auto f = createMapFeature(pos, definition);
         if (!definition.fileName.empty() && !definition.seqName.empty())
         {
             f.animation = textureService->getGafEntry("anims/" + definition.fileName + ".GAF", definition.seqName);
@@ -405,50 +337,6 @@ namespace rwe
         return f;
     }
 
-    Grid<unsigned char> LoadingScene::getHeightGrid(const Grid<TntTileAttributes>& attrs) const
-    {
-        const auto& sourceData = attrs.getVector();
-
-        std::vector<unsigned char> data;
-        data.reserve(sourceData.size());
-
-        std::transform(sourceData.begin(), sourceData.end(), std::back_inserter(data), [](const TntTileAttributes& e) {
-            return e.height;
-        });
-
-        return Grid<unsigned char>(attrs.getWidth(), attrs.getHeight(), std::move(data));
-    }
-
-    Vector3f LoadingScene::computeFeaturePosition(
-        const MapTerrain& terrain,
-        const FeatureDefinition& featureDefinition,
-        std::size_t x,
-        std::size_t y) const
-    {
-        const auto& heightmap = terrain.getHeightMap();
-
-        unsigned int height = 0;
-        if (x < heightmap.getWidth() - 1 && y < heightmap.getHeight() - 1)
-        {
-            height = computeMidpointHeight(heightmap, x, y);
-        }
-
-        auto position = terrain.heightmapIndexToWorldCorner(x, y);
-        position.y = height;
-
-        position.x += (featureDefinition.footprintX * MapTerrain::HeightTileWidthInWorldUnits) / 2.0f;
-        position.z += (featureDefinition.footprintZ * MapTerrain::HeightTileHeightInWorldUnits) / 2.0f;
-
-        return position;
-    }
-
-    unsigned int LoadingScene::computeMidpointHeight(const Grid<unsigned char>& heightmap, std::size_t x, std::size_t y)
-    {
-        assert(x < heightmap.getWidth() - 1);
-        assert(y < heightmap.getHeight() - 1);
-        return (heightmap.get(x, y) + heightmap.get(x + 1, y) + heightmap.get(x, y + 1) + heightmap.get(x + 1, y + 1)) / 4u;
-    }
-
     const SideData& LoadingScene::getSideData(const std::string& side) const
     {
         auto it = sideData->find(side);
@@ -459,143 +347,4 @@ namespace rwe
 
         return it->second;
     }
-
-    UnitDatabase LoadingScene::createUnitDatabase()
-    {
-        UnitDatabase db;
-
-        // read sound categories
-        {
-            auto bytes = vfs->readFile("gamedata/SOUND.TDF");
-            if (!bytes)
-            {
-                throw std::runtime_error("Failed to read gamedata/SOUND.TDF");
-            }
-
-            std::string soundString(bytes->data(), bytes->size());
-            auto sounds = parseSoundTdf(parseTdfFromString(soundString));
-            for (auto& s : sounds)
-            {
-                const auto& c = s.second;
-                preloadSound(db, c.select1);
-                preloadSound(db, c.ok1);
-                preloadSound(db, c.arrived1);
-                preloadSound(db, c.cant1);
-                preloadSound(db, c.underAttack);
-                preloadSound(db, c.count5);
-                preloadSound(db, c.count4);
-                preloadSound(db, c.count3);
-                preloadSound(db, c.count2);
-                preloadSound(db, c.count1);
-                preloadSound(db, c.count0);
-                preloadSound(db, c.cancelDestruct);
-                db.addSoundClass(s.first, std::move(s.second));
-            }
-        }
-
-        // read movement classes
-        {
-            auto bytes = vfs->readFile("gamedata/MOVEINFO.TDF");
-            if (!bytes)
-            {
-                throw std::runtime_error("Failed to read gamedata/MOVEINFO.TDF");
-            }
-
-            std::string movementString(bytes->data(), bytes->size());
-            auto classes = parseMovementTdf(parseTdfFromString(movementString));
-            for (auto& c : classes)
-            {
-                auto name = c.second.name;
-                db.addMovementClass(name, std::move(c.second));
-            }
-        }
-
-        // read weapons
-        {
-            auto weaponFiles = vfs->getFileNames("weapons", ".tdf");
-
-            for (const auto& fileName : weaponFiles)
-            {
-                auto bytes = vfs->readFile("weapons/" + fileName);
-                if (!bytes)
-                {
-                    throw std::runtime_error("File in listing could not be read: " + fileName);
-                }
-
-                std::string tdfString(bytes->data(), bytes->size());
-                auto entries = parseWeaponTdf(parseTdfFromString(tdfString));
-
-                for (auto& pair : entries)
-                {
-                    preloadSound(db, pair.second.soundStart);
-                    preloadSound(db, pair.second.soundHit);
-                    preloadSound(db, pair.second.soundWater);
-                    db.addWeapon(pair.first, std::move(pair.second));
-                }
-            }
-        }
-
-        // read unit FBIs
-        {
-            auto fbis = vfs->getFileNames("units", ".fbi");
-
-            for (const auto& fbiName : fbis)
-            {
-                auto bytes = vfs->readFile("units/" + fbiName);
-                if (!bytes)
-                {
-                    throw std::runtime_error("File in listing could not be read: " + fbiName);
-                }
-
-                std::string fbiString(bytes->data(), bytes->size());
-                auto fbi = parseUnitFbi(parseTdfFromString(fbiString));
-
-                db.addUnitInfo(fbi.unitName, fbi);
-            }
-        }
-
-        // read unit scripts
-        {
-            auto scripts = vfs->getFileNames("scripts", ".cob");
-
-            for (const auto& scriptName : scripts)
-            {
-                auto bytes = vfs->readFile("scripts/" + scriptName);
-                if (!bytes)
-                {
-                    throw std::runtime_error("File in listing could not be read: " + scriptName);
-                }
-
-                boost::interprocess::bufferstream s(bytes->data(), bytes->size());
-                auto cob = parseCob(s);
-
-                auto scriptNameWithoutExtension = scriptName.substr(0, scriptName.size() - 4);
-
-                db.addUnitScript(scriptNameWithoutExtension, std::move(cob));
-            }
-        }
-
-        return db;
-    }
-
-    void LoadingScene::preloadSound(UnitDatabase& db, const boost::optional<std::string>& soundName)
-    {
-        if (!soundName)
-        {
-            return;
-        }
-
-        preloadSound(db, *soundName);
-    }
-
-    void LoadingScene::preloadSound(UnitDatabase& db, const std::string& soundName)
-    {
-        auto sound = audioService->loadSound(soundName);
-        if (!sound)
-        {
-            return; // sometimes sound categories name invalid sounds
-        }
-
-        db.addSound(soundName, *sound);
-    }
 }
@@ -89,31 +89,15 @@ namespace rwe
         void render(GraphicsContext& context) override;
 
     private:
-        static unsigned int computeMidpointHeight(const Grid<unsigned char>& heightmap, std::size_t x, std::size_t y);
-
         std::unique_ptr<GameScene> createGameScene(const std::string& mapName, unsigned int schemaIndex);
 
         GameSimulation createInitialSimulation(const std::string& mapName, const rwe::OtaRecord& ota, unsigned int schemaIndex);
 
         std::vector<TextureRegion> getTileTextures(TntArchive& tnt);
 
-        Grid<std::size_t> getMapData(TntArchive& tnt);
-
-        Grid<unsigned char> getHeightGrid(const Grid<TntTileAttributes>& attrs) const;
-
-        std::vector<FeatureDefinition> getFeatures(TntArchive& tnt);
-
         MapFeature createFeature(const Vector3f& pos, const FeatureDefinition& definition);
 
-        Vector3f computeFeaturePosition(const MapTerrain& terrain, const FeatureDefinition& featureDefinition, std::size_t x, std::size_t y) const;
-
         const SideData& getSideData(const std::string& side) const;
-
-        UnitDatabase createUnitDatabase();
-
-        void preloadSound(UnitDatabase& db, const std::string& soundName);
-
-        void preloadSound(UnitDatabase& db, const boost::optional<std::string>& soundName);
     };
 }
 
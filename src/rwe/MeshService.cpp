@@ -153,16 +153,23 @@ namespace rwe
 
         SharedTextureHandle atlasTexture(graphics->createTexture(atlas));
 
-        return MeshService(vfs, palette, std::move(atlasTexture), std::move(atlasMap), std::move(attribs));
+        return MeshService(vfs, graphics, palette, std::move(atlasTexture), std::move(atlasMap), std::move(attribs));
+    }
+
+    MeshService MeshService::createHeadlessMeshService(AbstractVirtualFileSystem* vfs, const ColorPalette* palette)
+    {
+        return MeshService(vfs, nullptr, palette, SharedTextureHandle(), {}, {});
     }
 
     MeshService::MeshService(
         AbstractVirtualFileSystem* vfs,
+        GraphicsContext* graphics,
         const ColorPalette* palette,
         SharedTextureHandle&& atlas,
         std::unordered_map<FrameId, Rectangle2f>&& atlasMap,
         std::unordered_map<std::string, TextureAttributes> textureAttributesMap)
         : vfs(vfs),
+          graphics(graphics),
           palette(palette),
           atlas(std::move(atlas)),
           atlasMap(std::move(atlasMap)),
@@ -226,19 +233,35 @@ namespace rwe
     UnitMesh MeshService::unitMeshFrom3do(const _3do::Object& o, unsigned int teamColor)
     {
         UnitMesh m;
-        m.origin = Vector3f(
+        appendUnitMeshPieces(o, teamColor, boost::none, m.pieces);
+        return m;
+    }
+
+    void MeshService::appendUnitMeshPieces(
+        const _3do::Object& o,
+        unsigned int teamColor,
+        boost::optional<unsigned int> parent,
+        std::vector<UnitMesh::Piece>& pieces)
+    {
+        auto index = static_cast<unsigned int>(pieces.size());
+
+        UnitMesh::Piece p;
+        p.origin = Vector3f(
             convertFixedPoint(-o.x), // flip the x axis
             convertFixedPoint(o.y),
             convertFixedPoint(o.z));
-        m.name = o.name;
-        m.mesh = std::make_shared<ShaderMesh>(convertMesh(meshFrom3do(o, teamColor)));
+        p.name = o.name;
+        p.parent = parent;
+        if (graphics != nullptr)
+        {
+            p.mesh = std::make_shared<ShaderMesh>(convertMesh(meshFrom3do(o, teamColor)));
+        }
+        pieces.push_back(std::move(p));
 
         for (const auto& c : o.children)
         {
-            m.children.push_back(unitMeshFrom3do(c, teamColor));
+            appendUnitMeshPieces(c, teamColor, index, pieces);
         }
-
-        return m;
     }
 
     MeshService::UnitMeshInfo MeshService::loadUnitMesh(const std::string& name, unsigned int teamColor)
@@ -309,6 +332,11 @@ namespace rwe
 
     GlMesh MeshService::createSelectionMesh(const Vector3f& a, const Vector3f& b, const Vector3f& c, const Vector3f& d)
     {
+        if (graphics == nullptr)
+        {
+            return GlMesh(VaoHandle(), VboHandle(), 0);
+        }
+
         const Vector3f color(0.325f, 0.875f, 0.310f);
 
         std::vector<GlColoredVertex> buffer{
@@ -49,8 +49,23 @@ namespace rwe
             GraphicsContext* graphics,
             const ColorPalette* palette);
 
+        /**
+         * Creates a mesh service that does not touch the graphics card.
+         * Meshes loaded by it have the correct piece hierarchy
+         * and collision geometry, but nothing that can be drawn,
+         * so it is only suitable for running the simulation without a display.
+         */
+        static MeshService createHeadlessMeshService(
+            AbstractVirtualFileSystem* vfs,
+            const ColorPalette* palette);
+
+        /**
+         * If graphics is null, the service runs headless
+         * (see createHeadlessMeshService).
+         */
         MeshService(
             AbstractVirtualFileSystem* vfs,
+            GraphicsContext* graphics,
             const ColorPalette* palette,
             SharedTextureHandle&& atlas,
             std::unordered_map<FrameId, Rectangle2f>&& atlasMap,
@@ -72,6 +87,12 @@ namespace rwe
 
         UnitMesh unitMeshFrom3do(const _3do::Object& o, unsigned int teamColor);
 
+        void appendUnitMeshPieces(
+            const _3do::Object& o,
+            unsigned int teamColor,
+            boost::optional<unsigned int> parent,
+            std::vector<UnitMesh::Piece>& pieces);
+
         SelectionMesh selectionMeshFrom3do(const _3do::Object& o);
 
         GlMesh createSelectionMesh(const Vector3f& a, const Vector3f& b, const Vector3f& c, const Vector3f& d);
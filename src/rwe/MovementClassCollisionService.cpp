@@ -1,5 +1,7 @@
 #include "MovementClassCollisionService.h"
 
+#include <rwe/SlidingWindow.h>
+
 namespace rwe
 {
     MovementClassId
@@ -58,23 +60,83 @@ namespace rwe
         return it->second;
     }
 
+    WalkabilityPlanes computeWalkabilityPlanes(const Grid<unsigned char>& heights, unsigned int waterLevel)
+    {
+        WalkabilityPlanes planes;
+
+        if (heights.getWidth() > 0 && heights.getHeight() > 0)
+        {
+            planes.slopes = Grid<unsigned char>(heights.getWidth() - 1, heights.getHeight() - 1);
+            for (std::size_t y = 0; y < planes.slopes.getHeight(); ++y)
+            {
+                for (std::size_t x = 0; x < planes.slopes.getWidth(); ++x)
+                {
+                    planes.slopes.set(x, y, static_cast<unsigned char>(getSlope(heights, x, y)));
+                }
+            }
+        }
+
+        planes.waterDepths = Grid<unsigned int>(heights.getWidth(), heights.getHeight());
+        for (std::size_t y = 0; y < heights.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < heights.getWidth(); ++x)
+            {
+                planes.waterDepths.set(x, y, getWaterDepth(heights, waterLevel, x, y));
+            }
+        }
+
+        return planes;
+    }
+
     Grid<char> computeWalkableGrid(const GameSimulation& sim, const MovementClass& movementClass)
     {
         const auto& terrain = sim.terrain;
+        auto planes = computeWalkabilityPlanes(terrain.getHeightMap(), terrain.getSeaLevel());
+        return computeWalkableGrid(planes, movementClass);
+    }
 
-        const auto width = terrain.getHeightMap().getWidth();
-        const auto height = terrain.getHeightMap().getHeight();
+    Grid<char> computeWalkableGrid(const WalkabilityPlanes& planes, const MovementClass& movementClass)
+    {
+        const auto width = planes.waterDepths.getWidth();
+        const auto height = planes.waterDepths.getHeight();
 
         Grid<char> walkableGrid(width, height, false);
 
         const auto footprintX = movementClass.footprintX;
         const auto footprintY = movementClass.footprintZ;
 
-        for (unsigned int y = 0; y < height - footprintY - 1; ++y)
+        if (width < footprintX + 2 || height < footprintY + 2)
+        {
+            return walkableGrid;
+        }
+
+        const auto endX = width - footprintX - 1;
+        const auto endY = height - footprintY - 1;
+
+        // An empty footprint has nothing to test, so everywhere is walkable.
+        if (footprintX == 0 || footprintY == 0)
+        {
+            walkableGrid.setArea(0, 0, endX, endY, true);
+            return walkableGrid;
+        }
+
+        // The water test for the slope limit covers the corners of the footprint cells,
+        // which is one more point in each direction than the depth test.
+        auto maxSlopes = slidingWindowMax(planes.slopes, footprintX, footprintY);
+        auto cornerMaxDepths = slidingWindowMax(planes.waterDepths, footprintX + 1, footprintY + 1);
+        auto minDepths = slidingWindowMin(planes.waterDepths, footprintX, footprintY);
+        auto maxDepths = slidingWindowMax(planes.waterDepths, footprintX, footprintY);
+
+        for (unsigned int y = 0; y < endY; ++y)
         {
-            for (unsigned int x = 0; x < width - footprintX - 1; ++x)
+            for (unsigned int x = 0; x < endX; ++x)
             {
-                walkableGrid.set(x, y, isGridPointWalkable(terrain, movementClass, x, y));
+                auto isUnderWater = cornerMaxDepths.get(x, y) > 0;
+                auto effectiveMaxSlope = isUnderWater ? movementClass.maxWaterSlope : movementClass.maxSlope;
+                auto walkable = maxSlopes.get(x, y) <= effectiveMaxSlope
+                    && minDepths.get(x, y) >= movementClass.minWaterDepth
+                    && maxDepths.get(x, y) <= movementClass.maxWaterDepth;
+                walkableGrid.set(x, y, walkable);
             }
         }
 
@@ -28,8 +28,34 @@ namespace rwe
         const Grid<char>& getGrid(MovementClassId movementClass) const;
     };
 
+    /**
+     * Per-point terrain properties that walkability depends on.
+     * These don't depend on the movement class,
+     * so they are computed once and shared between all classes.
+     */
+    struct WalkabilityPlanes
+    {
+        /**
+         * The slope of each heightmap cell, as given by getSlope.
+         * This is one smaller than the heightmap in each dimension.
+         */
+        Grid<unsigned char> slopes;
+
+        /** The water depth at each heightmap point, as given by getWaterDepth. */
+        Grid<unsigned int> waterDepths;
+    };
+
+    WalkabilityPlanes computeWalkabilityPlanes(const Grid<unsigned char>& heights, unsigned int waterLevel);
+
     Grid<char> computeWalkableGrid(const GameSimulation& sim, const MovementClass& movementClass);
 
+    /**
+     * Computes the same grid as calling isGridPointWalkable on every point,
+     * but tests each footprint using sliding window minimums and maximums
+     * over the precomputed planes instead of scanning it cell by cell.
+     */
+    Grid<char> computeWalkableGrid(const WalkabilityPlanes& planes, const MovementClass& movementClass);
+
     bool isGridPointWalkable(const MapTerrain& terrain, const MovementClass& movementClass, unsigned int x, unsigned int y);
 
     bool isMaxSlopeGreaterThan(const Grid<unsigned char>& heights, unsigned int waterLevel, unsigned int x, unsigned int y, unsigned int width, unsigned int height, unsigned int maxSlope, unsigned int maxWaterSlope);
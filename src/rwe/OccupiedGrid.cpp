@@ -1,7 +1,15 @@
 #include "OccupiedGrid.h"
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace rwe
 {
+    static_assert(sizeof(OccupiedType) == sizeof(OccupiedType::ValueType), "OccupiedType must be a plain 32-bit value");
+
     OccupiedUnit::OccupiedUnit(const UnitId& id) : id(id)
     {
     }
@@ -16,5 +24,383 @@ namespace rwe
         return !(rhs == *this);
     }
 
-    OccupiedGrid::OccupiedGrid(std::size_t width, std::size_t height) : grid(width, height, OccupiedType(OccupiedNone())) {}
+    OccupiedType::OccupiedType() : value(TagNone)
+    {
+    }
+
+    OccupiedType::OccupiedType(const OccupiedNone&) : value(TagNone)
+    {
+    }
+
+    OccupiedType::OccupiedType(const OccupiedFeature&) : value(TagFeature)
+    {
+    }
+
+    OccupiedType::OccupiedType(const OccupiedUnit& unit) : value(TagUnit | unit.id.value)
+    {
+        assert((unit.id.value & TagMask) == 0);
+    }
+
+    bool OccupiedType::isNone() const
+    {
+        return value == TagNone;
+    }
+
+    bool OccupiedType::isFeature() const
+    {
+        return (value & TagMask) == TagFeature;
+    }
+
+    boost::optional<UnitId> OccupiedType::getUnit() const
+    {
+        if ((value & TagMask) != TagUnit)
+        {
+            return boost::none;
+        }
+
+        return UnitId(value & UnitMask);
+    }
+
+    OccupiedType::ValueType OccupiedType::getValue() const
+    {
+        return value;
+    }
+
+    bool OccupiedType::operator==(const OccupiedType& rhs) const
+    {
+        return value == rhs.value;
+    }
+
+    bool OccupiedType::operator!=(const OccupiedType& rhs) const
+    {
+        return !(rhs == *this);
+    }
+
+    /**
+     * Returns true if any of the given cells
+     * is neither empty nor equal to the self cell.
+     */
+    bool isCollisionInRow(const OccupiedType* row, std::size_t width, OccupiedType::ValueType self)
+    {
+        std::size_t i = 0;
+
+#ifdef __SSE2__
+        const auto none = _mm_setzero_si128();
+        const auto selfVector = _mm_set1_epi32(static_cast<int>(self));
+        for (; i + 4 <= width; i += 4)
+        {
+            auto cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+            auto passable = _mm_or_si128(_mm_cmpeq_epi32(cells, none), _mm_cmpeq_epi32(cells, selfVector));
+            if (_mm_movemask_epi8(passable) != 0xFFFF)
+            {
+                return true;
+            }
+        }
+#endif
+
+        for (; i < width; ++i)
+        {
+            auto cell = row[i].getValue();
+            if (cell != OccupiedType::TagNone && cell != self)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    OccupiedGrid::OccupiedGrid(std::size_t width, std::size_t height)
+        : grid(width, height, OccupiedType(OccupiedNone())),
+          clearance(width, height),
+          epochs((width + EpochRegionSize - 1) / EpochRegionSize, (height + EpochRegionSize - 1) / EpochRegionSize, 0),
+          fixedEpochs(epochs.getWidth(), epochs.getHeight(), 0)
+    {
+        updateClearance(GridRegion(0, 0, static_cast<unsigned int>(width), static_cast<unsigned int>(height)));
+    }
+
+    /**
+     * Empty cells hash to zero,
+     * so that an empty grid has the same digest as a fresh StateDigest.
+     */
+    std::uint64_t hashOccupiedCell(std::size_t index, OccupiedType value)
+    {
+        if (value.isNone())
+        {
+            return 0;
+        }
+
+        return hashCombine(index, value.getValue());
+    }
+
+    void OccupiedGrid::setArea(const GridRegion& region, OccupiedType value)
+    {
+        setArea(region, value, true);
+    }
+
+    void OccupiedGrid::moveArea(const GridRegion& oldRegion, const GridRegion& newRegion, OccupiedType value)
+    {
+        setArea(oldRegion, OccupiedNone(), false);
+        setArea(newRegion, value, false);
+    }
+
+    void OccupiedGrid::setArea(const GridRegion& region, OccupiedType value, bool fixed)
+    {
+        auto changed = false;
+        for (std::size_t dy = 0; dy < region.height; ++dy)
+        {
+            auto y = region.y + dy;
+            for (std::size_t dx = 0; dx < region.width; ++dx)
+            {
+                auto x = region.x + dx;
+                auto index = (y * grid.getWidth()) + x;
+                const auto& oldValue = grid.get(x, y);
+                changed = changed || oldValue != value;
+                digest.replace(hashOccupiedCell(index, oldValue), hashOccupiedCell(index, value));
+            }
+        }
+
+        if (!changed)
+        {
+            return;
+        }
+
+        grid.setArea(region, value);
+        updateClearance(region);
+
+        auto epochRegions = getEpochRegions(DiscreteRect(region.x, region.y, region.width, region.height));
+        for (std::size_t y = epochRegions.y; y < epochRegions.y + epochRegions.height; ++y)
+        {
+            for (std::size_t x = epochRegions.x; x < epochRegions.x + epochRegions.width; ++x)
+            {
+                epochs.get(x, y) += 1;
+                if (fixed)
+                {
+                    fixedEpochs.get(x, y) += 1;
+                }
+            }
+        }
+    }
+
+    void OccupiedGrid::copyChangedRegions(const OccupiedGrid& source)
+    {
+        if (grid.getWidth() != source.grid.getWidth() || grid.getHeight() != source.grid.getHeight())
+        {
+            throw std::logic_error("Source grid is a different size");
+        }
+
+        auto width = grid.getWidth();
+        auto height = grid.getHeight();
+        auto reach = MaxClearance - 1;
+
+        for (std::size_t regionY = 0; regionY < epochs.getHeight(); ++regionY)
+        {
+            for (std::size_t regionX = 0; regionX < epochs.getWidth(); ++regionX)
+            {
+                auto epoch = source.epochs.get(regionX, regionY);
+                if (epochs.get(regionX, regionY) == epoch)
+                {
+                    continue;
+                }
+
+                epochs.set(regionX, regionY, epoch);
+                fixedEpochs.set(regionX, regionY, source.fixedEpochs.get(regionX, regionY));
+
+                auto x = regionX * EpochRegionSize;
+                auto y = regionY * EpochRegionSize;
+                auto right = std::min<std::size_t>(x + EpochRegionSize, width);
+                auto bottom = std::min<std::size_t>(y + EpochRegionSize, height);
+                for (auto row = y; row < bottom; ++row)
+                {
+                    const auto* cells = &source.grid.get(x, row);
+                    std::copy(cells, cells + (right - x), &grid.get(x, row));
+                }
+
+                // Changes to the region's cells reach the clearance
+                // of the cells above and to the left of it.
+                auto left = x > reach ? x - reach : 0;
+                auto top = y > reach ? y - reach : 0;
+                for (auto row = top; row < bottom; ++row)
+                {
+                    const auto* cells = &source.clearance.get(left, row);
+                    std::copy(cells, cells + (right - left), &clearance.get(left, row));
+                }
+            }
+        }
+
+        digest = source.digest;
+    }
+
+    GridRegion OccupiedGrid::getEpochRegions(const DiscreteRect& rect) const
+    {
+        auto left = std::max(0, rect.x);
+        auto top = std::max(0, rect.y);
+        auto right = std::min(static_cast<int>(grid.getWidth()), rect.x + static_cast<int>(rect.width));
+        auto bottom = std::min(static_cast<int>(grid.getHeight()), rect.y + static_cast<int>(rect.height));
+        if (right <= left || bottom <= top)
+        {
+            return GridRegion(0, 0, 0, 0);
+        }
+
+        auto regionLeft = static_cast<unsigned int>(left) / EpochRegionSize;
+        auto regionTop = static_cast<unsigned int>(top) / EpochRegionSize;
+        auto regionRight = static_cast<unsigned int>(right - 1) / EpochRegionSize;
+        auto regionBottom = static_cast<unsigned int>(bottom - 1) / EpochRegionSize;
+        return GridRegion(regionLeft, regionTop, regionRight - regionLeft + 1, regionBottom - regionTop + 1);
+    }
+
+    std::vector<unsigned int> OccupiedGrid::getEpochs(const GridRegion& regions) const
+    {
+        std::vector<unsigned int> result;
+        result.reserve(regions.width * regions.height);
+        for (std::size_t y = regions.y; y < regions.y + regions.height; ++y)
+        {
+            for (std::size_t x = regions.x; x < regions.x + regions.width; ++x)
+            {
+                result.push_back(epochs.get(x, y));
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<unsigned int> OccupiedGrid::getFixedEpochs(const GridRegion& regions) const
+    {
+        std::vector<unsigned int> result;
+        result.reserve(regions.width * regions.height);
+        for (std::size_t y = regions.y; y < regions.y + regions.height; ++y)
+        {
+            for (std::size_t x = regions.x; x < regions.x + regions.width; ++x)
+            {
+                result.push_back(fixedEpochs.get(x, y));
+            }
+        }
+
+        return result;
+    }
+
+    bool OccupiedGrid::isCollisionAt(const GridRegion& region, UnitId self) const
+    {
+        if (region.width == 0)
+        {
+            return false;
+        }
+
+        auto selfValue = OccupiedType(OccupiedUnit(self)).getValue();
+        for (std::size_t dy = 0; dy < region.height; ++dy)
+        {
+            const auto* row = &grid.get(region.x, region.y + dy);
+            if (isCollisionInRow(row, region.width, selfValue))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool OccupiedGrid::isCollisionAt(const DiscreteRect& rect, UnitId self) const
+    {
+        auto region = grid.tryToRegion(rect);
+        if (!region)
+        {
+            return true;
+        }
+
+        return isCollisionAt(*region, self);
+    }
+
+    bool OccupiedGrid::isAdjacentToObstacle(const DiscreteRect& rect, UnitId self) const
+    {
+        DiscreteRect expandedRect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2);
+        return isCollisionAt(expandedRect, self);
+    }
+
+    bool OccupiedGrid::isCollisionAt(const DiscreteRect& rect, UnitId self, const DiscreteRect& selfArea) const
+    {
+        auto region = grid.tryToRegion(rect);
+        if (!region)
+        {
+            return true;
+        }
+
+        if (region->width == 0 || region->height == 0)
+        {
+            return false;
+        }
+
+        if (rect.intersects(selfArea) || std::max(region->width, region->height) > MaxClearance)
+        {
+            return isCollisionAt(*region, self);
+        }
+
+        return !isClear(*region);
+    }
+
+    bool OccupiedGrid::isAdjacentToObstacle(const DiscreteRect& rect, UnitId self, const DiscreteRect& selfArea) const
+    {
+        DiscreteRect expandedRect(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2);
+        return isCollisionAt(expandedRect, self, selfArea);
+    }
+
+    void OccupiedGrid::updateClearance(const GridRegion& region)
+    {
+        if (region.width == 0 || region.height == 0)
+        {
+            return;
+        }
+
+        // A cell's clearance depends only on the cells below and to the right of it,
+        // up to MaxClearance away, so work backwards from the bottom-right of the region.
+        auto reach = MaxClearance - 1;
+        auto left = region.x > reach ? region.x - reach : 0;
+        auto top = region.y > reach ? region.y - reach : 0;
+        auto right = region.x + region.width;
+        auto bottom = region.y + region.height;
+
+        auto width = grid.getWidth();
+        auto height = grid.getHeight();
+
+        for (auto y = bottom; y-- > top;)
+        {
+            for (auto x = right; x-- > left;)
+            {
+                if (!grid.get(x, y).isNone())
+                {
+                    clearance.set(x, y, 0);
+                    continue;
+                }
+
+                unsigned int rightClearance = x + 1 < width ? clearance.get(x + 1, y) : 0;
+                unsigned int belowClearance = y + 1 < height ? clearance.get(x, y + 1) : 0;
+                unsigned int diagonalClearance = (x + 1 < width && y + 1 < height) ? clearance.get(x + 1, y + 1) : 0;
+                auto value = 1 + std::min({rightClearance, belowClearance, diagonalClearance});
+                clearance.set(x, y, static_cast<unsigned char>(std::min(value, MaxClearance)));
+            }
+        }
+    }
+
+    bool OccupiedGrid::isClear(const GridRegion& region) const
+    {
+        // Cover the region with squares as big as its shorter side,
+        // overlapping the last one with its neighbour if they don't fit exactly.
+        auto side = std::min(region.width, region.height);
+        auto length = std::max(region.width, region.height);
+        auto horizontal = region.width >= region.height;
+        for (unsigned int offset = 0;; offset += side)
+        {
+            auto squareOffset = std::min(offset, length - side);
+            auto x = horizontal ? region.x + squareOffset : region.x;
+            auto y = horizontal ? region.y : region.y + squareOffset;
+            if (clearance.get(x, y) < side)
+            {
+                return false;
+            }
+
+            if (squareOffset == length - side)
+            {
+                return true;
+            }
+        }
+    }
 }
@@ -2,8 +2,11 @@
 #define RWE_OCCUPIEDGRID_H
 
 #include "Grid.h"
+#include "StateDigest.h"
 #include "UnitId.h"
-#include <boost/variant.hpp>
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <vector>
 
 namespace rwe
 {
@@ -32,13 +35,175 @@ namespace rwe
         bool operator!=(const OccupiedNone&) const { return true; }
     };
 
-    using OccupiedType = boost::variant<OccupiedUnit, OccupiedFeature, OccupiedNone>;
+    /**
+     * A single cell of the occupied grid, packed into 32 bits.
+     * The top two bits hold a tag saying what occupies the cell,
+     * the remaining bits hold the ID of the occupying unit (if any).
+     * An empty cell is always represented by zero.
+     *
+     * Keeping cells this small (and free of indirection)
+     * lets collision checks compare whole rows of cells at once.
+     */
+    class OccupiedType
+    {
+    public:
+        using ValueType = std::uint32_t;
+
+        static constexpr ValueType TagNone = 0x00000000u;
+        static constexpr ValueType TagFeature = 0x40000000u;
+        static constexpr ValueType TagUnit = 0x80000000u;
+        static constexpr ValueType TagMask = 0xC0000000u;
+        static constexpr ValueType UnitMask = ~TagMask;
+
+        static_assert(UnitMask == (1u << UnitIdBits) - 1, "Unit IDs don't fit beside the tag");
+
+    private:
+        ValueType value;
+
+    public:
+        OccupiedType();
+        OccupiedType(const OccupiedNone&);
+        OccupiedType(const OccupiedFeature&);
+        OccupiedType(const OccupiedUnit& unit);
+
+        bool isNone() const;
+
+        bool isFeature() const;
+
+        boost::optional<UnitId> getUnit() const;
+
+        ValueType getValue() const;
+
+        bool operator==(const OccupiedType& rhs) const;
+
+        bool operator!=(const OccupiedType& rhs) const;
+    };
 
     struct OccupiedGrid
     {
+        /**
+         * The largest clearance recorded in the clearance field.
+         * Each change to the grid has to be propagated this far
+         * up and to the left through the field,
+         * so this is kept no larger than the biggest footprints need.
+         */
+        static constexpr unsigned int MaxClearance = 16;
+
+        /** The side of the square regions that epochs are counted over. */
+        static constexpr unsigned int EpochRegionSize = 8;
+
         Grid<OccupiedType> grid;
 
+        /**
+         * For each cell, the side of the largest empty square
+         * with its top-left corner on that cell, up to MaxClearance.
+         * Cells outside the grid count as occupied.
+         * Only kept up to date by writes made through setArea.
+         */
+        Grid<unsigned char> clearance;
+
+        /**
+         * Covers the contents of every occupied cell.
+         * Only kept up to date by writes made through setArea.
+         */
+        StateDigest digest;
+
+        /**
+         * A counter for each square region of the grid,
+         * bumped whenever setArea changes what occupies a cell in it.
+         * Anything worked out from the cells of some regions
+         * holds for as long as their epochs are unchanged.
+         */
+        Grid<unsigned int> epochs;
+
+        /**
+         * Like epochs, but not bumped by units walking from cell to cell,
+         * only by things arriving or leaving for good.
+         * Cells that units walk through are soon free again,
+         * so things worked out from them can be kept for longer than the epochs say.
+         */
+        Grid<unsigned int> fixedEpochs;
+
         OccupiedGrid(std::size_t width, std::size_t height);
+
+        /**
+         * Sets every cell in the region to the given value,
+         * keeping the digest, the clearance field and the epochs up to date.
+         */
+        void setArea(const GridRegion& region, OccupiedType value);
+
+        /**
+         * Empties the old region and fills the new one with the value,
+         * as for a unit walking from one to the other.
+         * The same as two calls to setArea, except that the fixed epochs are left alone.
+         */
+        void moveArea(const GridRegion& oldRegion, const GridRegion& newRegion, OccupiedType value);
+
+        /**
+         * Brings this grid up to date with a later version of itself,
+         * copying only the epoch regions whose epochs differ,
+         * along with the part of the clearance field they affect.
+         * The source must be the grid this one was copied from,
+         * with nothing but setArea having changed it since.
+         */
+        void copyChangedRegions(const OccupiedGrid& source);
+
+        /** Returns the epoch regions that overlap the rect, clipped to the grid. */
+        GridRegion getEpochRegions(const DiscreteRect& rect) const;
+
+        /** Returns the epochs of the given epoch regions, row by row. */
+        std::vector<unsigned int> getEpochs(const GridRegion& regions) const;
+
+        /** Returns the fixed epochs of the given epoch regions, row by row. */
+        std::vector<unsigned int> getFixedEpochs(const GridRegion& regions) const;
+
+        /**
+         * Returns true if any cell in the region is occupied
+         * by something other than the given unit.
+         */
+        bool isCollisionAt(const GridRegion& region, UnitId self) const;
+
+        /**
+         * Returns true if any cell in the rect is occupied
+         * by something other than the given unit,
+         * or if the rect extends outside the grid.
+         */
+        bool isCollisionAt(const DiscreteRect& rect, UnitId self) const;
+
+        /**
+         * Returns true if any cell in or immediately around the rect
+         * is occupied by something other than the given unit,
+         * or if that area extends outside the grid.
+         */
+        bool isAdjacentToObstacle(const DiscreteRect& rect, UnitId self) const;
+
+        /**
+         * Same as isCollisionAt, but answered from the clearance field
+         * with one lookup for a square rect, or a few for an oblong one.
+         * selfArea must cover every cell occupied by self.
+         * The cells themselves are only scanned if the rect overlaps selfArea,
+         * since the field does not know which unit occupies what.
+         */
+        bool isCollisionAt(const DiscreteRect& rect, UnitId self, const DiscreteRect& selfArea) const;
+
+        /**
+         * Same as isAdjacentToObstacle, but answered from the clearance field.
+         * selfArea must cover every cell occupied by self.
+         */
+        bool isAdjacentToObstacle(const DiscreteRect& rect, UnitId self, const DiscreteRect& selfArea) const;
+
+    private:
+        /** Does the work of setArea, bumping the fixed epochs too if asked. */
+        void setArea(const GridRegion& region, OccupiedType value, bool fixed);
+
+        /**
+         * Recomputes the clearance of every cell
+         * that could have been affected by a change to the region.
+         */
+        void updateClearance(const GridRegion& region);
+
+        /** Returns true if the clearance field says the region is empty. */
+        bool isClear(const GridRegion& region) const;
     };
 }
 
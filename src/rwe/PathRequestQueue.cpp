@@ -0,0 +1,78 @@
+#include "PathRequestQueue.h"
+#include <cassert>
+
+namespace rwe
+{
+    bool PathRequest::operator==(const PathRequest& rhs) const
+    {
+        return unitId == rhs.unitId;
+    }
+
+    bool PathRequest::operator!=(const PathRequest& rhs) const
+    {
+        return !(rhs == *this);
+    }
+
+    void PathRequestQueue::push(UnitId unitId)
+    {
+        auto it = index.find(unitId);
+        if (it != index.end())
+        {
+            requests.splice(requests.end(), requests, it->second);
+            return;
+        }
+
+        requests.push_back(PathRequest{unitId});
+        index.emplace(unitId, --requests.end());
+    }
+
+    void PathRequestQueue::remove(UnitId unitId)
+    {
+        auto it = index.find(unitId);
+        if (it == index.end())
+        {
+            return;
+        }
+
+        requests.erase(it->second);
+        index.erase(it);
+    }
+
+    bool PathRequestQueue::contains(UnitId unitId) const
+    {
+        return index.find(unitId) != index.end();
+    }
+
+    const PathRequest& PathRequestQueue::front() const
+    {
+        assert(!requests.empty());
+        return requests.front();
+    }
+
+    void PathRequestQueue::pop_front()
+    {
+        assert(!requests.empty());
+        index.erase(requests.front().unitId);
+        requests.pop_front();
+    }
+
+    bool PathRequestQueue::empty() const
+    {
+        return requests.empty();
+    }
+
+    std::size_t PathRequestQueue::size() const
+    {
+        return requests.size();
+    }
+
+    PathRequestQueue::const_iterator PathRequestQueue::begin() const
+    {
+        return requests.begin();
+    }
+
+    PathRequestQueue::const_iterator PathRequestQueue::end() const
+    {
+        return requests.end();
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef RWE_PATHREQUESTQUEUE_H
+#define RWE_PATHREQUESTQUEUE_H
+
+#include <list>
+#include <rwe/UnitId.h>
+#include <unordered_map>
+
+namespace rwe
+{
+    struct PathRequest
+    {
+        UnitId unitId;
+
+        bool operator==(const PathRequest& rhs) const;
+
+        bool operator!=(const PathRequest& rhs) const;
+    };
+
+    /**
+     * Units waiting for a path, in the order they will be served.
+     * Each unit has at most one request in the queue,
+     * and an index from unit to request lets a unit's request
+     * be found, moved or removed in constant time.
+     */
+    class PathRequestQueue
+    {
+    private:
+        std::list<PathRequest> requests;
+        std::unordered_map<UnitId, std::list<PathRequest>::iterator> index;
+
+    public:
+        using const_iterator = std::list<PathRequest>::const_iterator;
+
+        /**
+         * Adds a request for the unit to the back of the queue.
+         * If the unit already has a request in the queue,
+         * it is moved to the back instead.
+         */
+        void push(UnitId unitId);
+
+        /** Removes the unit's request from the queue, if it has one. */
+        void remove(UnitId unitId);
+
+        bool contains(UnitId unitId) const;
+
+        const PathRequest& front() const;
+
+        void pop_front();
+
+        bool empty() const;
+
+        std::size_t size() const;
+
+        const_iterator begin() const;
+
+        const_iterator end() const;
+    };
+}
+
+#endif
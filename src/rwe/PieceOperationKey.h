@@ -0,0 +1,41 @@
+#ifndef RWE_PIECEOPERATIONKEY_H
+#define RWE_PIECEOPERATIONKEY_H
+
+#include <rwe/util.h>
+
+namespace rwe
+{
+    /**
+     * Identifies one of the moves or turns that a piece can have in progress.
+     * A piece has at most one move and one turn per axis.
+     */
+    struct PieceOperationKey
+    {
+        enum class Kind
+        {
+            Move,
+            Turn
+        };
+
+        /** The index of the piece in the unit's mesh. */
+        unsigned int piece;
+        Axis axis;
+        Kind kind;
+
+        PieceOperationKey(unsigned int piece, Axis axis, Kind kind) : piece(piece), axis(axis), kind(kind)
+        {
+        }
+
+        bool operator==(const PieceOperationKey& rhs) const
+        {
+            return piece == rhs.piece && axis == rhs.axis && kind == rhs.kind;
+        }
+
+        bool operator!=(const PieceOperationKey& rhs) const
+        {
+            return !(rhs == *this);
+        }
+    };
+}
+
+#endif
@@ -3,25 +3,6 @@
 
 namespace rwe
 {
-    class IsOccupiedVisitor : public boost::static_visitor<bool>
-    {
-    public:
-        bool operator()(const OccupiedNone&) const
-        {
-            return false;
-        }
-
-        bool operator()(const OccupiedUnit&) const
-        {
-            return true;
-        }
-
-        bool operator()(const OccupiedFeature&) const
-        {
-            return true;
-        }
-    };
-
     RenderService::RenderService(
         GraphicsContext* graphics,
         ShaderService* shaders,
@@ -33,17 +14,17 @@ namespace rwe
     }
 
     void
-    RenderService::drawSelectionRect(const Unit& unit)
+    RenderService::drawSelectionRect(const Unit& unit, const UnitKinematics& kinematics)
     {
         // try to ensure that the selection rectangle vertices
         // are aligned with the middle of pixels,
         // to prevent discontinuities in the drawn lines.
         Vector3f snappedPosition(
-            snapToInterval(unit.position.x, 1.0f) + 0.5f,
-            snapToInterval(unit.position.y, 2.0f),
-            snapToInterval(unit.position.z, 1.0f) + 0.5f);
+            snapToInterval(kinematics.position.x, 1.0f) + 0.5f,
+            snapToInterval(kinematics.position.y, 2.0f),
+            snapToInterval(kinematics.position.z, 1.0f) + 0.5f);
 
-        auto matrix = Matrix4f::translation(snappedPosition) * Matrix4f::rotationY(unit.rotation);
+        auto matrix = Matrix4f::translation(snappedPosition) * Matrix4f::rotationY(kinematics.rotation);
 
         const auto& shader = shaders->basicColor;
         graphics->bindShader(shader.handle.get());
@@ -52,19 +33,29 @@ namespace rwe
         graphics->drawLineLoop(unit.selectionMesh.visualMesh);
     }
 
-    void RenderService::drawUnit(const Unit& unit, float seaLevel)
+    void RenderService::drawUnit(const Unit& unit, const UnitKinematics& kinematics, float seaLevel)
     {
-        auto matrix = Matrix4f::translation(unit.position) * Matrix4f::rotationY(unit.rotation);
+        auto matrix = Matrix4f::translation(kinematics.position) * Matrix4f::rotationY(kinematics.rotation);
         drawUnitMesh(unit.mesh, matrix, seaLevel);
     }
 
     void RenderService::drawUnitMesh(const UnitMesh& mesh, const Matrix4f& modelMatrix, float seaLevel)
     {
-        Vector3f testRotation(-mesh.rotation.x, mesh.rotation.y, mesh.rotation.z);
-        auto matrix = modelMatrix * Matrix4f::translation(mesh.origin) * Matrix4f::rotationXYZ(testRotation) * Matrix4f::translation(mesh.offset);
-
-        if (mesh.visible)
+        // Parents always precede their children,
+        // so each piece's parent matrix is ready by the time we reach it.
+        pieceMatrices.clear();
+        for (const auto& piece : mesh.pieces)
         {
+            const auto& parentMatrix = piece.parent ? pieceMatrices[*piece.parent] : modelMatrix;
+            Vector3f testRotation(-piece.rotation.x, piece.rotation.y, piece.rotation.z);
+            pieceMatrices.push_back(parentMatrix * Matrix4f::translation(piece.origin) * Matrix4f::rotationXYZ(testRotation) * Matrix4f::translation(piece.offset));
+            const auto& matrix = pieceMatrices.back();
+
+            if (!piece.visible)
+            {
+                continue;
+            }
+
             auto mvpMatrix = camera.getViewProjectionMatrix() * matrix;
 
             {
@@ -73,24 +64,19 @@ namespace rwe
                 graphics->setUniformMatrix(colorShader.mvpMatrix, mvpMatrix);
                 graphics->setUniformMatrix(colorShader.modelMatrix, matrix);
                 graphics->setUniformFloat(colorShader.seaLevel, seaLevel);
-                graphics->drawTriangles(mesh.mesh->coloredVertices);
+                graphics->drawTriangles(piece.mesh->coloredVertices);
             }
 
             {
                 const auto& textureShader = shaders->unitTexture;
                 graphics->bindShader(textureShader.handle.get());
-                graphics->bindTexture(mesh.mesh->texture.get());
+                graphics->bindTexture(piece.mesh->texture.get());
                 graphics->setUniformMatrix(textureShader.mvpMatrix, mvpMatrix);
                 graphics->setUniformMatrix(textureShader.modelMatrix, matrix);
                 graphics->setUniformFloat(textureShader.seaLevel, seaLevel);
-                graphics->drawTriangles(mesh.mesh->texturedVertices);
+                graphics->drawTriangles(piece.mesh->texturedVertices);
             }
         }
-
-        for (const auto& c : mesh.children)
-        {
-            drawUnitMesh(c, matrix, seaLevel);
-        }
     }
 
     void RenderService::drawOccupiedGrid(const MapTerrain& terrain, const OccupiedGrid& occupiedGrid)
@@ -140,7 +126,7 @@ namespace rwe
                 lines.emplace_back(pos, rightPos);
                 lines.emplace_back(pos, downPos);
 
-                if (boost::apply_visitor(IsOccupiedVisitor(), occupiedGrid.grid.get(x, y)))
+                if (!occupiedGrid.grid.get(x, y).isNone())
                 {
                     auto downRightPos = terrain.heightmapIndexToWorldCorner(x + 1, y + 1);
                     downRightPos.y = terrain.getHeightMap().get(x + 1, y + 1);
@@ -245,13 +231,13 @@ namespace rwe
 
         for (const auto& item : pathInfo.closedVertices)
         {
-            if (!item.second.predecessor)
+            if (!item.predecessor)
             {
                 continue;
             }
 
-            auto start = (*item.second.predecessor)->vertex;
-            auto end = item.second.vertex;
+            auto start = *item.predecessor;
+            auto end = item.vertex;
             drawTerrainArrow(terrain, start, end, Color(255, 0, 0));
         }
 
@@ -387,14 +373,14 @@ namespace rwe
         drawStandingFeatureShadowsInternal(features.begin(), features.end());
     }
 
-    void RenderService::drawUnitShadow(const Unit& unit, float groundHeight)
+    void RenderService::drawUnitShadow(const Unit& unit, const UnitKinematics& kinematics, float groundHeight)
     {
         auto shadowProjection = Matrix4f::translation(Vector3f(0.0f, groundHeight, 0.0f))
             * Matrix4f::scale(Vector3f(1.0f, 0.0f, 1.0f))
             * Matrix4f::shearXZ(0.25f, -0.25f)
             * Matrix4f::translation(Vector3f(0.0f, -groundHeight, 0.0f));
 
-        auto matrix = Matrix4f::translation(unit.position) * Matrix4f::rotationY(unit.rotation);
+        auto matrix = Matrix4f::translation(kinematics.position) * Matrix4f::rotationY(kinematics.rotation);
 
         drawUnitMesh(unit.mesh, shadowProjection * matrix, 0.0f);
     }
@@ -409,17 +395,18 @@ namespace rwe
         return camera;
     }
 
-    void RenderService::drawUnitShadows(const MapTerrain& terrain, const std::vector<Unit>& units)
+    void RenderService::drawUnitShadows(const MapTerrain& terrain, const UnitStore& units)
     {
         graphics->enableStencilBuffer();
         graphics->clearStencilBuffer();
         graphics->useStencilBufferForWrites();
         graphics->disableColorBuffer();
 
-        for (const auto& unit : units)
+        for (std::size_t i = 0; i < units.size(); ++i)
         {
-            auto groundHeight = terrain.getHeightAt(unit.position.x, unit.position.z);
-            drawUnitShadow(unit, groundHeight);
+            const auto& kinematics = units.kinematicsAt(i);
+            auto groundHeight = terrain.getHeightAt(kinematics.position.x, kinematics.position.z);
+            drawUnitShadow(units.unitAt(i), kinematics, groundHeight);
         }
 
         graphics->useStencilBufferAsMask();
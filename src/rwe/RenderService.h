@@ -5,6 +5,7 @@
 #include "OccupiedGrid.h"
 #include "ShaderService.h"
 #include "Unit.h"
+#include "UnitStore.h"
 #include <boost/iterator/filter_iterator.hpp>
 #include <rwe/pathfinding/AStarPathFinder.h>
 #include <rwe/pathfinding/OctileDistance.h>
@@ -37,6 +38,9 @@ namespace rwe
 
         CabinetCamera camera;
 
+        /** Scratch space for the world matrix of each piece of the unit being drawn. */
+        std::vector<Matrix4f> pieceMatrices;
+
     public:
         RenderService(
             GraphicsContext* graphics,
@@ -46,10 +50,10 @@ namespace rwe
         CabinetCamera& getCamera();
         const CabinetCamera& getCamera() const;
 
-        void drawUnit(const Unit& unit, float seaLevel);
-        void drawUnitShadow(const Unit& unit, float groundHeight);
+        void drawUnit(const Unit& unit, const UnitKinematics& kinematics, float seaLevel);
+        void drawUnitShadow(const Unit& unit, const UnitKinematics& kinematics, float groundHeight);
         void drawUnitMesh(const UnitMesh& mesh, const Matrix4f& modelMatrix, float seaLevel);
-        void drawSelectionRect(const Unit& unit);
+        void drawSelectionRect(const Unit& unit, const UnitKinematics& kinematics);
         void drawOccupiedGrid(const MapTerrain& terrain, const OccupiedGrid& occupiedGrid);
         void drawMovementClassCollisionGrid(const MapTerrain& terrain, const Grid<char>& movementClassGrid);
         void drawPathfindingVisualisation(const MapTerrain& terrain, const AStarPathInfo<Point, PathCost>& pathInfo);
@@ -62,7 +66,7 @@ namespace rwe
 
         void drawMapTerrain(const MapTerrain& terrain, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
 
-        void drawUnitShadows(const MapTerrain& terrain, const std::vector<Unit>& units);
+        void drawUnitShadows(const MapTerrain& terrain, const UnitStore& units);
 
         void fillScreen(float r, float g, float b, float a);
 
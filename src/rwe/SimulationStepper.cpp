@@ -0,0 +1,122 @@
+#include "SimulationStepper.h"
+
+namespace rwe
+{
+    std::chrono::steady_clock::duration SimulationPhaseTimings::total() const
+    {
+        return pathFinding + intent + commit + animation + scripts;
+    }
+
+    SimulationPhaseTimings& SimulationPhaseTimings::operator+=(const SimulationPhaseTimings& rhs)
+    {
+        pathFinding += rhs.pathFinding;
+        intent += rhs.intent;
+        commit += rhs.commit;
+        animation += rhs.animation;
+        scripts += rhs.scripts;
+        return *this;
+    }
+
+    SimulationStepper::SimulationStepper(
+        GameSimulation* simulation,
+        PathFindingService* pathFindingService,
+        UnitBehaviorService* unitBehaviorService,
+        CobExecutionService* cobExecutionService,
+        unsigned int workerCount)
+        : simulation(simulation),
+          pathFindingService(pathFindingService),
+          unitBehaviorService(unitBehaviorService),
+          cobExecutionService(cobExecutionService),
+          workerPool(workerCount)
+    {
+    }
+
+    void SimulationStepper::step(float secondsElapsed)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        simulation->gameTime = nextGameTime(simulation->gameTime);
+
+        auto phaseStart = Clock::now();
+        pathFindingService->update();
+        auto phaseEnd = Clock::now();
+        lastTimings.pathFinding = phaseEnd - phaseStart;
+
+        auto unitCount = simulation->units.size();
+        unitBehaviorEffects.resize(unitCount);
+
+        // Intent phase: units process their orders and steer.
+        // Each unit only writes to its own state,
+        // so units can be processed in parallel.
+        phaseStart = phaseEnd;
+        workerPool.parallelFor(unitCount, [this](std::size_t i) {
+            unitBehaviorService->updateIntent(simulation->units.idAt(i), unitBehaviorEffects[i]);
+        });
+        phaseEnd = Clock::now();
+        lastTimings.intent = phaseEnd - phaseStart;
+
+        // Commit phase: units move and claim their new occupied area.
+        // Units interact with each other here, so this is done serially
+        // in unit order to keep the simulation deterministic.
+        phaseStart = phaseEnd;
+        for (std::size_t i = 0; i < unitCount; ++i)
+        {
+            unitBehaviorService->commit(simulation->units.idAt(i), unitBehaviorEffects[i]);
+        }
+        phaseEnd = Clock::now();
+        lastTimings.commit = phaseEnd - phaseStart;
+
+        // Animation phase: advance piece movements.
+        // Only units with pieces in motion are visited.
+        phaseStart = phaseEnd;
+        const auto& animatingUnits = simulation->animatingUnits;
+        workerPool.parallelFor(animatingUnits.size(), [this, &animatingUnits, secondsElapsed](std::size_t i) {
+            auto unitId = animatingUnits[i];
+            if (!simulation->unitExists(unitId))
+            {
+                return;
+            }
+            simulation->getUnit(unitId).mesh.update(secondsElapsed);
+            cobExecutionService->notifyPieceOperationsEnded(*simulation, unitId);
+        });
+        simulation->pruneAnimatingUnits();
+        phaseEnd = Clock::now();
+        lastTimings.animation = phaseEnd - phaseStart;
+
+        // Script phase: run unit scripts.
+        // Only units that something has marked as ready are visited.
+        // Scripts only modify their own unit,
+        // so units can be processed in parallel.
+        // Anything else they do is applied afterwards in unit ID order.
+        phaseStart = phaseEnd;
+        cobExecutionService->wakeSleepingThreads(*simulation);
+        scriptUnits.clear();
+        cobExecutionService->takeReadyUnits(*simulation, scriptUnits);
+        cobEffects.resize(scriptUnits.size());
+        workerPool.parallelFor(scriptUnits.size(), [this](std::size_t i) {
+            cobExecutionService->run(*simulation, scriptUnits[i], cobEffects[i]);
+        });
+        for (std::size_t i = 0; i < scriptUnits.size(); ++i)
+        {
+            auto unitId = scriptUnits[i];
+            cobExecutionService->applyEffects(*simulation, unitId, cobEffects[i]);
+            simulation->markUnitDigestStale(unitId);
+        }
+
+        // Every unit is finished for the tick after this,
+        // so the ones that changed are folded into the simulation digest here too.
+        simulation->updateStaleUnitDigests();
+        phaseEnd = Clock::now();
+        lastTimings.scripts = phaseEnd - phaseStart;
+    }
+
+    const std::vector<UnitBehaviorEffects>& SimulationStepper::getUnitBehaviorEffects() const
+    {
+        return unitBehaviorEffects;
+    }
+
+    const SimulationPhaseTimings& SimulationStepper::getLastTimings() const
+    {
+        return lastTimings;
+    }
+}
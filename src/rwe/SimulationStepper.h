@@ -0,0 +1,88 @@
+#ifndef RWE_SIMULATIONSTEPPER_H
+#define RWE_SIMULATIONSTEPPER_H
+
+#include <chrono>
+#include <rwe/GameSimulation.h>
+#include <rwe/UnitBehaviorService.h>
+#include <rwe/WorkerPool.h>
+#include <rwe/cob/CobExecutionService.h>
+#include <rwe/pathfinding/PathFindingService.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Wall clock time spent in each phase of a simulation tick.
+     */
+    struct SimulationPhaseTimings
+    {
+        std::chrono::steady_clock::duration pathFinding{0};
+        std::chrono::steady_clock::duration intent{0};
+        std::chrono::steady_clock::duration commit{0};
+        std::chrono::steady_clock::duration animation{0};
+        std::chrono::steady_clock::duration scripts{0};
+
+        std::chrono::steady_clock::duration total() const;
+
+        SimulationPhaseTimings& operator+=(const SimulationPhaseTimings& rhs);
+    };
+
+    /**
+     * Advances the game simulation one tick at a time.
+     *
+     * This knows nothing about rendering, input or audio,
+     * so it is shared by the game scene and by the headless runner.
+     * Sounds that units want to play during a tick are left
+     * in the unit behaviour effects for the caller to deal with.
+     */
+    class SimulationStepper
+    {
+    private:
+        GameSimulation* simulation;
+        PathFindingService* pathFindingService;
+        UnitBehaviorService* unitBehaviorService;
+        CobExecutionService* cobExecutionService;
+
+        WorkerPool workerPool;
+
+        /**
+         * Per-unit buffers for the behaviour effects recorded in each tick,
+         * indexed the same way as the unit store.
+         */
+        std::vector<UnitBehaviorEffects> unitBehaviorEffects;
+
+        /** The units whose scripts need to run this tick. */
+        std::vector<UnitId> scriptUnits;
+
+        /**
+         * Buffers for the effects of unit scripts,
+         * indexed the same way as scriptUnits.
+         */
+        std::vector<CobEffects> cobEffects;
+
+        SimulationPhaseTimings lastTimings;
+
+    public:
+        SimulationStepper(
+            GameSimulation* simulation,
+            PathFindingService* pathFindingService,
+            UnitBehaviorService* unitBehaviorService,
+            CobExecutionService* cobExecutionService,
+            unsigned int workerCount);
+
+        /**
+         * Advances the game time and runs every phase of one tick.
+         */
+        void step(float secondsElapsed);
+
+        /**
+         * Returns the effects recorded by each unit in the last tick,
+         * indexed the same way as the unit store.
+         */
+        const std::vector<UnitBehaviorEffects>& getUnitBehaviorEffects() const;
+
+        const SimulationPhaseTimings& getLastTimings() const;
+    };
+}
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef RWE_SLIDINGWINDOW_H
+#define RWE_SLIDINGWINDOW_H
+
+#include <functional>
+#include <rwe/Grid.h>
+#include <stdexcept>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Computes the extreme value of every window of the given length
+     * along a strided line of values, using a monotonic queue.
+     * Element i of the output is the extreme of input elements [i, i + window).
+     * The output must have room for (length - window + 1) elements.
+     *
+     * A value is preferred over another if compare(a, b) is true.
+     * The queue is passed in so that its storage can be reused.
+     */
+    template <typename T, typename Compare>
+    void slidingWindowExtreme1d(
+        const T* input,
+        std::size_t inputStride,
+        std::size_t length,
+        std::size_t window,
+        T* output,
+        std::size_t outputStride,
+        Compare compare,
+        std::vector<std::size_t>& queue)
+    {
+        // queue[head..] holds indices of candidate extremes,
+        // with their values in preferred order
+        queue.clear();
+        std::size_t head = 0;
+
+        for (std::size_t i = 0; i < length; ++i)
+        {
+            const auto& value = input[i * inputStride];
+            while (queue.size() > head && !compare(input[queue.back() * inputStride], value))
+            {
+                queue.pop_back();
+            }
+            queue.push_back(i);
+
+            if (queue[head] + window <= i)
+            {
+                ++head;
+            }
+
+            if (i + 1 >= window)
+            {
+                output[(i + 1 - window) * outputStride] = input[queue[head] * inputStride];
+            }
+        }
+    }
+
+    /**
+     * Returns a grid where each cell holds the extreme value
+     * of the window of the input with that cell as its top-left corner.
+     * The result is (width - windowWidth + 1) by (height - windowHeight + 1),
+     * or empty if the window does not fit inside the grid.
+     *
+     * This runs in time proportional to the size of the grid,
+     * regardless of the size of the window.
+     */
+    template <typename T, typename Compare>
+    Grid<T> slidingWindowExtreme(const Grid<T>& grid, std::size_t windowWidth, std::size_t windowHeight, Compare compare)
+    {
+        if (windowWidth == 0 || windowHeight == 0)
+        {
+            throw std::logic_error("Sliding window must not be empty");
+        }
+
+        if (windowWidth > grid.getWidth() || windowHeight > grid.getHeight())
+        {
+            return Grid<T>();
+        }
+
+        auto outWidth = grid.getWidth() - windowWidth + 1;
+        auto outHeight = grid.getHeight() - windowHeight + 1;
+
+        std::vector<std::size_t> queue;
+
+        // The extreme of a rectangle is the extreme of the extremes of its rows,
+        // so do the rows first, then the columns of the row results.
+        Grid<T> rows(outWidth, grid.getHeight());
+        for (std::size_t y = 0; y < grid.getHeight(); ++y)
+        {
+            slidingWindowExtreme1d(
+                &grid.get(0, y), 1, grid.getWidth(), windowWidth, &rows.get(0, y), 1, compare, queue);
+        }
+
+        Grid<T> result(outWidth, outHeight);
+        for (std::size_t x = 0; x < outWidth; ++x)
+        {
+            slidingWindowExtreme1d(
+                &rows.get(x, 0), outWidth, grid.getHeight(), windowHeight, &result.get(x, 0), outWidth, compare, queue);
+        }
+
+        return result;
+    }
+
+    template <typename T>
+    Grid<T> slidingWindowMin(const Grid<T>& grid, std::size_t windowWidth, std::size_t windowHeight)
+    {
+        return slidingWindowExtreme(grid, windowWidth, windowHeight, std::less<T>());
+    }
+
+    template <typename T>
+    Grid<T> slidingWindowMax(const Grid<T>& grid, std::size_t windowWidth, std::size_t windowHeight)
+    {
+        return slidingWindowExtreme(grid, windowWidth, windowHeight, std::greater<T>());
+    }
+}
+
+#endif
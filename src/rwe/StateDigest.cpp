@@ -0,0 +1,55 @@
+#include "StateDigest.h"
+
+#include <cstring>
+
+namespace rwe
+{
+    std::uint64_t hashCombine(std::uint64_t seed, std::uint64_t value)
+    {
+        // splitmix64 finalizer applied to the combined value
+        auto x = seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    std::uint64_t hashFloat(float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    std::uint64_t hashString(const std::string& value)
+    {
+        // 64-bit FNV-1a
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (auto c : value)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    void StateDigest::toggle(std::uint64_t itemHash)
+    {
+        stateHash ^= itemHash;
+    }
+
+    void StateDigest::replace(std::uint64_t oldItemHash, std::uint64_t newItemHash)
+    {
+        stateHash ^= oldItemHash ^ newItemHash;
+    }
+
+    void StateDigest::recordEvent(std::uint64_t event)
+    {
+        eventHash = hashCombine(eventHash, event);
+    }
+
+    std::uint64_t StateDigest::value() const
+    {
+        return hashCombine(stateHash, eventHash);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef RWE_STATEDIGEST_H
+#define RWE_STATEDIGEST_H
+
+#include <cstdint>
+#include <string>
+
+namespace rwe
+{
+    /**
+     * Mixes a value into a running hash.
+     * The result depends on the order in which values are mixed in.
+     * This is deterministic across platforms and builds,
+     * unlike std::hash, so it is safe to compare between machines.
+     */
+    std::uint64_t hashCombine(std::uint64_t seed, std::uint64_t value);
+
+    /** Hashes the exact bit pattern of the float. */
+    std::uint64_t hashFloat(float value);
+
+    std::uint64_t hashString(const std::string& value);
+
+    /**
+     * A cheap, incrementally maintained digest of some piece of state,
+     * used to detect simulations that have diverged.
+     *
+     * The digest is made of two parts:
+     *
+     * - The state part covers a set of items, each represented by a hash
+     *   (typically of the item's key and current value).
+     *   Items are combined with XOR, so the order in which they were added
+     *   does not matter and changing an item only requires XORing out
+     *   its old hash and XORing in its new one.
+     *
+     * - The event part covers things that happened rather than things
+     *   that are, such as a script thread being created.
+     *   Events are chained, so their order does matter.
+     */
+    class StateDigest
+    {
+    private:
+        std::uint64_t stateHash{0};
+        std::uint64_t eventHash{0};
+
+    public:
+        /**
+         * Adds the item to the state part of the digest,
+         * or removes it if it is already present.
+         */
+        void toggle(std::uint64_t itemHash);
+
+        /**
+         * Replaces an item already in the state part of the digest.
+         * Equivalent to toggling the old hash and then the new one.
+         */
+        void replace(std::uint64_t oldItemHash, std::uint64_t newItemHash);
+
+        void recordEvent(std::uint64_t event);
+
+        std::uint64_t value() const;
+    };
+}
+
+#endif
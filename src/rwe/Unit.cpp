@@ -24,152 +24,236 @@ namespace rwe
         return AttackGroundOrder(target);
     }
 
-    Unit::Unit(const UnitMesh& mesh, std::unique_ptr<CobEnvironment>&& cobEnvironment, SelectionMesh&& selectionMesh)
-        : mesh(mesh), cobEnvironment(std::move(cobEnvironment)), selectionMesh(std::move(selectionMesh))
+    ScriptPieceMap createScriptPieceMap(const std::vector<std::string>& scriptPieces, const UnitMesh& mesh)
+    {
+        ScriptPieceMap pieceMap;
+        pieceMap.reserve(scriptPieces.size());
+        for (const auto& pieceName : scriptPieces)
+        {
+            pieceMap.push_back(mesh.findPieceIndex(pieceName));
+        }
+
+        return pieceMap;
+    }
+
+    namespace
+    {
+        enum class PieceCommand
+        {
+            Move,
+            MoveNow,
+            Turn,
+            TurnNow,
+        };
+
+        static std::uint64_t hashPieceCommand(PieceCommand command, unsigned int objectId, Axis axis, float target, float speed)
+        {
+            auto hash = hashCombine(static_cast<std::uint64_t>(command), objectId);
+            hash = hashCombine(hash, static_cast<std::uint64_t>(axis));
+            hash = hashCombine(hash, hashFloat(target));
+            return hashCombine(hash, hashFloat(speed));
+        }
+    }
+
+    Unit::Unit(
+        const UnitMesh& mesh,
+        std::shared_ptr<const ScriptPieceMap> scriptPieces,
+        std::unique_ptr<CobEnvironment>&& cobEnvironment,
+        SelectionMesh&& selectionMesh)
+        : mesh(mesh),
+          scriptPieces(std::move(scriptPieces)),
+          cobEnvironment(std::move(cobEnvironment)),
+          selectionMesh(std::move(selectionMesh))
     {
     }
 
-    void Unit::moveObject(const std::string& pieceName, Axis axis, float targetPosition, float speed)
+    boost::optional<UnitMesh::Piece&> Unit::findScriptPiece(unsigned int objectId)
     {
-        auto piece = mesh.find(pieceName);
-        if (!piece)
+        auto index = scriptPieces->at(objectId);
+        if (!index)
         {
-            throw std::runtime_error("Invalid piece name: " + pieceName);
+            return boost::none;
         }
 
+        return mesh.pieces[*index];
+    }
+
+    boost::optional<const UnitMesh::Piece&> Unit::findScriptPiece(unsigned int objectId) const
+    {
+        auto index = scriptPieces->at(objectId);
+        if (!index)
+        {
+            return boost::none;
+        }
+
+        return mesh.pieces[*index];
+    }
+
+    unsigned int Unit::getScriptPieceIndex(unsigned int objectId) const
+    {
+        auto index = scriptPieces->at(objectId);
+        if (!index)
+        {
+            throw std::runtime_error("Invalid piece name: " + cobEnvironment->_script->pieces.at(objectId));
+        }
+
+        return *index;
+    }
+
+    UnitMesh::Piece& Unit::getScriptPiece(unsigned int objectId)
+    {
+        return mesh.pieces[getScriptPieceIndex(objectId)];
+    }
+
+    const UnitMesh::Piece& Unit::getScriptPiece(unsigned int objectId) const
+    {
+        return mesh.pieces[getScriptPieceIndex(objectId)];
+    }
+
+    void Unit::moveObject(unsigned int objectId, Axis axis, float targetPosition, float speed)
+    {
+        auto pieceIndex = getScriptPieceIndex(objectId);
+        auto& piece = mesh.pieces[pieceIndex];
+
+        pieceDigest.recordEvent(hashPieceCommand(PieceCommand::Move, objectId, axis, targetPosition, speed));
+
         UnitMesh::MoveOperation op(targetPosition, speed);
 
         switch (axis)
         {
             case Axis::X:
-                piece->xMoveOperation = op;
+                piece.xMoveOperation = op;
                 break;
             case Axis::Y:
-                piece->yMoveOperation = op;
+                piece.yMoveOperation = op;
                 break;
             case Axis::Z:
-                piece->zMoveOperation = op;
+                piece.zMoveOperation = op;
                 break;
         }
+
+        mesh.markAnimating(pieceIndex);
     }
 
-    void Unit::moveObjectNow(const std::string& pieceName, Axis axis, float targetPosition)
+    void Unit::moveObjectNow(unsigned int objectId, Axis axis, float targetPosition)
     {
-        auto piece = mesh.find(pieceName);
-        if (!piece)
+        auto pieceIndex = getScriptPieceIndex(objectId);
+        auto& piece = mesh.pieces[pieceIndex];
+
+        pieceDigest.recordEvent(hashPieceCommand(PieceCommand::MoveNow, objectId, axis, targetPosition, 0.0f));
+
+        if (isMoveInProgress(objectId, axis))
         {
-            throw std::runtime_error("Invalid piece name: " + pieceName);
+            // Cutting the move short ends it as far as waiting scripts are concerned.
+            mesh.endedOperations.emplace_back(pieceIndex, axis, PieceOperationKey::Kind::Move);
         }
 
         switch (axis)
         {
             case Axis::X:
-                piece->offset.x = targetPosition;
-                piece->xMoveOperation = boost::none;
+                piece.offset.x = targetPosition;
+                piece.xMoveOperation = boost::none;
                 break;
             case Axis::Y:
-                piece->offset.y = targetPosition;
-                piece->yMoveOperation = boost::none;
+                piece.offset.y = targetPosition;
+                piece.yMoveOperation = boost::none;
                 break;
             case Axis::Z:
-                piece->offset.z = targetPosition;
-                piece->zMoveOperation = boost::none;
+                piece.offset.z = targetPosition;
+                piece.zMoveOperation = boost::none;
                 break;
         }
     }
 
-    void Unit::turnObject(const std::string& pieceName, Axis axis, RadiansAngle targetAngle, float speed)
+    void Unit::turnObject(unsigned int objectId, Axis axis, RadiansAngle targetAngle, float speed)
     {
-        auto piece = mesh.find(pieceName);
-        if (!piece)
-        {
-            throw std::runtime_error("Invalid piece name: " + pieceName);
-        }
+        auto pieceIndex = getScriptPieceIndex(objectId);
+        auto& piece = mesh.pieces[pieceIndex];
+
+        pieceDigest.recordEvent(hashPieceCommand(PieceCommand::Turn, objectId, axis, targetAngle.value, speed));
 
         UnitMesh::TurnOperation op(targetAngle, toRadians(speed));
 
         switch (axis)
         {
             case Axis::X:
-                piece->xTurnOperation = op;
+                piece.xTurnOperation = op;
                 break;
             case Axis::Y:
-                piece->yTurnOperation = op;
+                piece.yTurnOperation = op;
                 break;
             case Axis::Z:
-                piece->zTurnOperation = op;
+                piece.zTurnOperation = op;
                 break;
         }
+
+        mesh.markAnimating(pieceIndex);
     }
 
-    void Unit::turnObjectNow(const std::string& pieceName, Axis axis, RadiansAngle targetAngle)
+    void Unit::turnObjectNow(unsigned int objectId, Axis axis, RadiansAngle targetAngle)
     {
-        auto piece = mesh.find(pieceName);
-        if (!piece)
+        auto pieceIndex = getScriptPieceIndex(objectId);
+        auto& piece = mesh.pieces[pieceIndex];
+
+        pieceDigest.recordEvent(hashPieceCommand(PieceCommand::TurnNow, objectId, axis, targetAngle.value, 0.0f));
+
+        if (isTurnInProgress(objectId, axis))
         {
-            throw std::runtime_error("Invalid piece name: " + pieceName);
+            mesh.endedOperations.emplace_back(pieceIndex, axis, PieceOperationKey::Kind::Turn);
         }
 
         switch (axis)
         {
             case Axis::X:
-                piece->rotation.x = targetAngle.value;
-                piece->xTurnOperation = boost::none;
+                piece.rotation.x = targetAngle.value;
+                piece.xTurnOperation = boost::none;
                 break;
             case Axis::Y:
-                piece->rotation.y = targetAngle.value;
-                piece->yTurnOperation = boost::none;
+                piece.rotation.y = targetAngle.value;
+                piece.yTurnOperation = boost::none;
                 break;
             case Axis::Z:
-                piece->rotation.z = targetAngle.value;
-                piece->zTurnOperation = boost::none;
+                piece.rotation.z = targetAngle.value;
+                piece.zTurnOperation = boost::none;
                 break;
         }
     }
 
-    bool Unit::isMoveInProgress(const std::string& pieceName, Axis axis) const
+    bool Unit::isMoveInProgress(unsigned int objectId, Axis axis) const
     {
-        auto piece = mesh.find(pieceName);
-        if (!piece)
-        {
-            throw std::runtime_error("Invalid piece name " + pieceName);
-        }
+        auto& piece = getScriptPiece(objectId);
 
         switch (axis)
         {
             case Axis::X:
-                return !!(piece->xMoveOperation);
+                return !!(piece.xMoveOperation);
             case Axis::Y:
-                return !!(piece->yMoveOperation);
+                return !!(piece.yMoveOperation);
             case Axis::Z:
-                return !!(piece->zMoveOperation);
+                return !!(piece.zMoveOperation);
         }
 
         throw std::logic_error("Invalid axis");
     }
 
-    bool Unit::isTurnInProgress(const std::string& pieceName, Axis axis) const
+    bool Unit::isTurnInProgress(unsigned int objectId, Axis axis) const
     {
-        auto piece = mesh.find(pieceName);
-        if (!piece)
-        {
-            throw std::runtime_error("Invalid piece name " + pieceName);
-        }
+        auto& piece = getScriptPiece(objectId);
 
         switch (axis)
         {
             case Axis::X:
-                return !!(piece->xTurnOperation);
+                return !!(piece.xTurnOperation);
             case Axis::Y:
-                return !!(piece->yTurnOperation);
+                return !!(piece.yTurnOperation);
             case Axis::Z:
-                return !!(piece->zTurnOperation);
+                return !!(piece.zTurnOperation);
         }
 
         throw std::logic_error("Invalid axis");
     }
 
-    boost::optional<float> Unit::selectionIntersect(const Ray3f& ray) const
+    boost::optional<float> Unit::selectionIntersect(const Vector3f& position, const Ray3f& ray) const
     {
         auto line = ray.toLine();
         Line3f modelSpaceLine(line.start - position, line.end - position);
@@ -270,7 +354,7 @@ namespace rwe
     {
         auto& weapon = weapons[weaponIndex];
         weapon.state = UnitWeaponStateIdle();
-        cobEnvironment->createThread("TargetCleared", {weaponIndex});
+        cobEnvironment->createThread(CobEntryPoint::TargetCleared, {static_cast<int>(weaponIndex)});
     }
 
     void Unit::clearWeaponTargets()
@@ -11,6 +11,7 @@
 #include <rwe/DiscreteRect.h>
 #include <rwe/PlayerId.h>
 #include <rwe/SelectionMesh.h>
+#include <rwe/StateDigest.h>
 #include <rwe/UnitMesh.h>
 #include <rwe/cob/CobEnvironment.h>
 #include <rwe/geometry/BoundingBox3f.h>
@@ -69,11 +70,25 @@ namespace rwe
 
     UnitOrder createAttackGroundOrder(const Vector3f& target);
 
+    /**
+     * Maps each piece index used by a unit script
+     * to the index of the same piece in the unit's mesh,
+     * or none if the model has no piece by that name.
+     */
+    using ScriptPieceMap = std::vector<boost::optional<unsigned int>>;
+
+    /**
+     * Builds the map for a script with the given piece names.
+     * Where the model has several pieces with the same name,
+     * the first in depth-first order is used.
+     */
+    ScriptPieceMap createScriptPieceMap(const std::vector<std::string>& scriptPieces, const UnitMesh& mesh);
+
     class Unit
     {
     public:
         UnitMesh mesh;
-        Vector3f position;
+        std::shared_ptr<const ScriptPieceMap> scriptPieces;
         std::unique_ptr<CobEnvironment> cobEnvironment;
         SelectionMesh selectionMesh;
         boost::optional<AudioService::SoundHandle> selectionSound;
@@ -81,45 +96,6 @@ namespace rwe
         boost::optional<AudioService::SoundHandle> arrivedSound;
         PlayerId owner;
 
-        /**
-         * Anticlockwise rotation of the unit around the Y axis in radians.
-         * The other two axes of rotation are normally determined
-         * by the normal of the terrain the unit is standing on.
-         */
-        float rotation{0.0f};
-
-
-        /**
-         * Rate at which the unit turns in rads/tick.
-         */
-        float turnRate;
-
-        /**
-         * Rate at which the unit is travelling forwards in game units/tick.
-         */
-        float currentSpeed{0.0f};
-
-        /**
-         * Maximum speed the unit can travel forwards in game units/tick.
-         */
-        float maxSpeed;
-
-        /**
-         * Speed at which the unit accelerates in game units/tick.
-         */
-        float acceleration;
-
-        /**
-         * Speed at which the unit brakes in game units/tick.
-         */
-        float brakeRate;
-
-        /** The angle we are trying to steer towards. */
-        float targetAngle{0.0f};
-
-        /** The speed we are trying to accelerate/decelerate to */
-        float targetSpeed{0.0f};
-
         boost::optional<MovementClassId> movementClass;
 
         unsigned int footprintX;
@@ -132,37 +108,71 @@ namespace rwe
         std::deque<UnitOrder> orders;
         UnitState behaviourState;
 
+        std::vector<UnitWeapon> weapons;
+
+        bool canAttack;
+
+        /** Covers the piece movement commands issued to the unit. */
+        StateDigest pieceDigest;
+
         /**
-         * True if the unit attempted to move last frame
-         * and its movement was limited (or prevented entirely) by a collision.
+         * The unit's contribution to the simulation digest
+         * as of the last time it was folded in.
          */
-        bool inCollision{false};
+        std::uint64_t digestContribution{0};
 
-        std::vector<UnitWeapon> weapons;
+        /** True while the unit is waiting in the simulation's staleDigestUnits. */
+        bool digestStale{false};
 
-        bool canAttack;
+        Unit(
+            const UnitMesh& mesh,
+            std::shared_ptr<const ScriptPieceMap> scriptPieces,
+            std::unique_ptr<CobEnvironment>&& cobEnvironment,
+            SelectionMesh&& selectionMesh);
+
+        /**
+         * Returns the mesh piece that the unit's script
+         * refers to by the given piece index,
+         * or none if the model doesn't have that piece.
+         */
+        boost::optional<UnitMesh::Piece&> findScriptPiece(unsigned int objectId);
+
+        boost::optional<const UnitMesh::Piece&> findScriptPiece(unsigned int objectId) const;
+
+        /**
+         * Returns the index in the mesh of the piece that the unit's script
+         * refers to by the given piece index.
+         * Throws if the model doesn't have the piece.
+         */
+        unsigned int getScriptPieceIndex(unsigned int objectId) const;
+
+        /**
+         * As findScriptPiece, but throws if the model doesn't have the piece.
+         */
+        UnitMesh::Piece& getScriptPiece(unsigned int objectId);
 
-        Unit(const UnitMesh& mesh, std::unique_ptr<CobEnvironment>&& cobEnvironment, SelectionMesh&& selectionMesh);
+        const UnitMesh::Piece& getScriptPiece(unsigned int objectId) const;
 
-        void moveObject(const std::string& pieceName, Axis axis, float targetPosition, float speed);
+        void moveObject(unsigned int objectId, Axis axis, float targetPosition, float speed);
 
-        void moveObjectNow(const std::string& pieceName, Axis axis, float targetPosition);
+        void moveObjectNow(unsigned int objectId, Axis axis, float targetPosition);
 
-        void turnObject(const std::string& pieceName, Axis axis, RadiansAngle targetAngle, float speed);
+        void turnObject(unsigned int objectId, Axis axis, RadiansAngle targetAngle, float speed);
 
-        void turnObjectNow(const std::string& pieceName, Axis axis, RadiansAngle targetAngle);
+        void turnObjectNow(unsigned int objectId, Axis axis, RadiansAngle targetAngle);
 
-        bool isMoveInProgress(const std::string& pieceName, Axis axis) const;
+        bool isMoveInProgress(unsigned int objectId, Axis axis) const;
 
-        bool isTurnInProgress(const std::string& pieceName, Axis axis) const;
+        bool isTurnInProgress(unsigned int objectId, Axis axis) const;
 
         /**
          * Returns a value if the given ray intersects this unit
          * for the purposes of unit selection.
          * The value returned is the distance along the ray
          * where the intersection occurred.
+         * The position is the unit's current world position.
          */
-        boost::optional<float> selectionIntersect(const Ray3f& ray) const;
+        boost::optional<float> selectionIntersect(const Vector3f& position, const Ray3f& ray) const;
 
         bool isOwnedBy(PlayerId playerId) const;
 
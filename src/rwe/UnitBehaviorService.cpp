@@ -1,11 +1,20 @@
 #include "UnitBehaviorService.h"
-#include <rwe/GameScene.h>
 #include <rwe/cob/CobExecutionContext.h>
 #include <rwe/geometry/Circle2f.h>
 #include <rwe/math/rwe_math.h>
 
 namespace rwe
 {
+    /** How many cells ahead along a flow field units aim for. */
+    static const unsigned int FlowFieldLookAhead = 4;
+
+    /**
+     * How long a unit held up by others keeps to its path before asking for a new one.
+     * Units with a path have it repaired around the blockage
+     * rather than searching all over again, so this needn't be long.
+     */
+    static const GameTimeDelta PathRetryDelay(15);
+
     Vector2f Vector2fFromLengthAndAngle(float length, float angle)
     {
         auto v = Matrix4f::rotationY(angle) * Vector3f(0.0f, 0.0f, -length);
@@ -24,20 +33,55 @@ namespace rwe
         return anticlockwiseCircle.contains(dest) || clockwiseCircle.contains(dest);
     }
 
-    UnitBehaviorService::UnitBehaviorService(GameScene* scene, PathFindingService* pathFindingService, MovementClassCollisionService* collisionService)
-        : scene(scene), pathFindingService(pathFindingService), collisionService(collisionService)
+    void steerTowards(UnitKinematics& kinematics, const Vector2f& xzDestination, bool isFinalDestination)
+    {
+        Vector2f xzPosition(kinematics.position.x, kinematics.position.z);
+        auto distanceSquared = xzPosition.distanceSquared(xzDestination);
+
+        auto xzDirection = xzDestination - xzPosition;
+        auto destAngle = Vector2f(0.0f, -1.0f).angleTo(xzDirection);
+        kinematics.targetAngle = (2.0f * Pif) - destAngle; // convert to anticlockwise in our coordinate system
+
+        // drive at full speed until we need to brake
+        // to turn or to arrive at the goal
+        auto brakingDistance = (kinematics.currentSpeed * kinematics.currentSpeed) / (2.0f * kinematics.brakeRate);
+
+        if (isWithinTurningCircle(xzDirection, kinematics.currentSpeed, kinematics.turnRate, kinematics.rotation))
+        {
+            kinematics.targetSpeed = 0.0f;
+        }
+        else if (isFinalDestination && distanceSquared <= (brakingDistance * brakingDistance))
+        {
+            kinematics.targetSpeed = 0.0f;
+        }
+        else
+        {
+            kinematics.targetSpeed = kinematics.maxSpeed;
+        }
+    }
+
+    UnitBehaviorService::UnitBehaviorService(GameSimulation* simulation, PathFindingService* pathFindingService, MovementClassCollisionService* collisionService)
+        : simulation(simulation), pathFindingService(pathFindingService), collisionService(collisionService)
     {
     }
 
-    void UnitBehaviorService::update(UnitId unitId)
+    void UnitBehaviorService::updateIntent(UnitId unitId, UnitBehaviorEffects& effects)
     {
-        auto& unit = scene->getSimulation().getUnit(unitId);
+        auto& unit = simulation->getUnit(unitId);
+        auto& kinematics = simulation->getUnitKinematics(unitId);
 
-        float previousSpeed = unit.currentSpeed;
+        effects.selectChannelSounds.clear();
+        effects.unitSounds.clear();
+
+        effects.previousKinematicsDigest = simulation->computeKinematicsDigest(unitId);
+        effects.previousScriptDigest = unit.cobEnvironment->digest.value();
+        effects.previousPieceDigest = unit.pieceDigest.value();
+
+        float previousSpeed = kinematics.currentSpeed;
 
         // Clear steering targets.
-        unit.targetAngle = unit.rotation;
-        unit.targetSpeed = 0.0f;
+        kinematics.targetAngle = kinematics.rotation;
+        kinematics.targetSpeed = 0.0f;
 
         // check our orders
         if (!unit.orders.empty())
@@ -50,22 +94,22 @@ namespace rwe
                 if (auto idleState = boost::get<IdleState>(&unit.behaviourState); idleState != nullptr)
                 {
                     // request a path to follow
-                    scene->getSimulation().requestPath(unitId);
+                    effects.pathRequested = true;
                     const auto& destination = moveOrder->destination;
                     unit.behaviourState = MovingState{destination, boost::none, true};
                 }
                 else if (auto movingState = boost::get<MovingState>(&unit.behaviourState); movingState != nullptr)
                 {
                     // if we are colliding, request a new path
-                    if (unit.inCollision && !movingState->pathRequested)
+                    if (kinematics.inCollision && !movingState->pathRequested)
                     {
-                        auto& sim = scene->getSimulation();
+                        const auto& sim = *simulation;
 
                         // only request a new path if we don't have one yet,
                         // or we've already had our current one for a bit
-                        if (!movingState->path || (sim.gameTime - movingState->path->pathCreationTime) >= GameTimeDelta(60))
+                        if (!movingState->path || (sim.gameTime - movingState->path->pathCreationTime) >= PathRetryDelay)
                         {
-                            sim.requestPath(unitId);
+                            effects.pathRequested = true;
                             movingState->pathRequested = true;
                         }
                     }
@@ -74,7 +118,7 @@ namespace rwe
                     auto& pathToFollow = movingState->path;
                     if (pathToFollow)
                     {
-                        if (followPath(unit, *pathToFollow))
+                        if (followPath(kinematics, *pathToFollow))
                         {
                             // we finished following the path,
                             // order complete
@@ -83,7 +127,7 @@ namespace rwe
 
                             if (unit.arrivedSound)
                             {
-                                scene->playSoundOnSelectChannel(*unit.arrivedSound);
+                                effects.selectChannelSounds.push_back(*unit.arrivedSound);
                             }
                         }
                     }
@@ -101,10 +145,10 @@ namespace rwe
                     if (auto idleState = boost::get<IdleState>(&unit.behaviourState); idleState != nullptr)
                     {
                         // if we're out of range, drive into range
-                        if (unit.position.distanceSquared(attackGroundOrder->target) > maxRangeSquared)
+                        if (kinematics.position.distanceSquared(attackGroundOrder->target) > maxRangeSquared)
                         {
                             // request a path to follow
-                            scene->getSimulation().requestPath(unitId);
+                            effects.pathRequested = true;
                             const auto& destination = attackGroundOrder->target;
                             unit.behaviourState = MovingState{destination, boost::none, true};
                         }
@@ -119,22 +163,22 @@ namespace rwe
                     }
                     else if (auto movingState = boost::get<MovingState>(&unit.behaviourState); movingState != nullptr)
                     {
-                        if (unit.position.distanceSquared(attackGroundOrder->target) <= maxRangeSquared)
+                        if (kinematics.position.distanceSquared(attackGroundOrder->target) <= maxRangeSquared)
                         {
                             unit.behaviourState = IdleState();
                         }
                         else
                         {
                             // if we are colliding, request a new path
-                            if (unit.inCollision && !movingState->pathRequested)
+                            if (kinematics.inCollision && !movingState->pathRequested)
                             {
-                                auto& sim = scene->getSimulation();
+                                const auto& sim = *simulation;
 
                                 // only request a new path if we don't have one yet,
                                 // or we've already had our current one for a bit
-                                if (!movingState->path || (sim.gameTime - movingState->path->pathCreationTime) >= GameTimeDelta(60))
+                                if (!movingState->path || (sim.gameTime - movingState->path->pathCreationTime) >= PathRetryDelay)
                                 {
-                                    sim.requestPath(unitId);
+                                    effects.pathRequested = true;
                                     movingState->pathRequested = true;
                                 }
                             }
@@ -143,7 +187,7 @@ namespace rwe
                             auto& pathToFollow = movingState->path;
                             if (pathToFollow)
                             {
-                                if (followPath(unit, *pathToFollow))
+                                if (followPath(kinematics, *pathToFollow))
                                 {
                                     // we finished following the path,
                                     // go back to idle
@@ -160,21 +204,26 @@ namespace rwe
                 {
                     unit.orders.pop_front();
                 }
+                else if (!simulation->unitExists(attackOrder->target))
+                {
+                    // the target no longer exists (e.g. it died), so the order is complete
+                    unit.orders.pop_front();
+                    unit.behaviourState = IdleState();
+                }
                 else
                 {
-                    // FIXME: this is unsafe, the target unit could already be dead
-                    const auto& targetUnit = scene->getSimulation().getUnit(attackOrder->target);
-                    const auto& targetPosition = targetUnit.position;
+                    const auto& targetUnit = simulation->getUnit(attackOrder->target);
+                    const auto& targetPosition = simulation->getUnitKinematics(attackOrder->target).position;
 
                     auto maxRangeSquared = unit.weapons[0].maxRange * unit.weapons[0].maxRange;
                     if (auto idleState = boost::get<IdleState>(&unit.behaviourState); idleState != nullptr)
                     {
                         // if we're out of range, drive into range
-                        if (unit.position.distanceSquared(targetPosition) > maxRangeSquared)
+                        if (kinematics.position.distanceSquared(targetPosition) > maxRangeSquared)
                         {
                             // request a path to follow
-                            scene->getSimulation().requestPath(unitId);
-                            auto destination = scene->computeFootprintRegion(targetUnit.position, targetUnit.footprintX, targetUnit.footprintZ);
+                            effects.pathRequested = true;
+                            auto destination = simulation->computeFootprintRegion(targetPosition, targetUnit.footprintX, targetUnit.footprintZ);
                             unit.behaviourState = MovingState{destination, boost::none, true};
                         }
                         else
@@ -188,7 +237,7 @@ namespace rwe
                     }
                     else if (auto movingState = boost::get<MovingState>(&unit.behaviourState); movingState != nullptr)
                     {
-                        if (unit.position.distanceSquared(targetPosition) <= maxRangeSquared)
+                        if (kinematics.position.distanceSquared(targetPosition) <= maxRangeSquared)
                         {
                             unit.behaviourState = IdleState();
                         }
@@ -197,15 +246,15 @@ namespace rwe
                             // TODO: consider requesting a new path if the target unit has moved significantly
 
                             // if we are colliding, request a new path
-                            if (unit.inCollision && !movingState->pathRequested)
+                            if (kinematics.inCollision && !movingState->pathRequested)
                             {
-                                auto& sim = scene->getSimulation();
+                                const auto& sim = *simulation;
 
                                 // only request a new path if we don't have one yet,
                                 // or we've already had our current one for a bit
-                                if (!movingState->path || (sim.gameTime - movingState->path->pathCreationTime) >= GameTimeDelta(60))
+                                if (!movingState->path || (sim.gameTime - movingState->path->pathCreationTime) >= PathRetryDelay)
                                 {
-                                    sim.requestPath(unitId);
+                                    effects.pathRequested = true;
                                     movingState->pathRequested = true;
                                 }
                             }
@@ -214,7 +263,7 @@ namespace rwe
                             auto& pathToFollow = movingState->path;
                             if (pathToFollow)
                             {
-                                if (followPath(unit, *pathToFollow))
+                                if (followPath(kinematics, *pathToFollow))
                                 {
                                     // we finished following the path,
                                     // go back to idle
@@ -229,27 +278,57 @@ namespace rwe
 
         for (unsigned int i = 0; i < unit.weapons.size(); ++i)
         {
-            updateWeapon(unitId, i);
+            updateWeapon(unitId, i, effects);
         }
 
         applyUnitSteering(unitId);
 
-        if (unit.currentSpeed > 0.0f && previousSpeed == 0.0f)
+        if (kinematics.currentSpeed > 0.0f && previousSpeed == 0.0f)
+        {
+            unit.cobEnvironment->createThread(CobEntryPoint::StartMoving);
+        }
+        else if (kinematics.currentSpeed == 0.0f && previousSpeed > 0.0f)
         {
-            unit.cobEnvironment->createThread("StartMoving");
+            unit.cobEnvironment->createThread(CobEntryPoint::StopMoving);
         }
-        else if (unit.currentSpeed == 0.0f && previousSpeed > 0.0f)
+    }
+
+    void UnitBehaviorService::commit(UnitId unitId, UnitBehaviorEffects& effects)
+    {
+        if (effects.pathRequested)
         {
-            unit.cobEnvironment->createThread("StopMoving");
+            simulation->requestPath(unitId);
+            effects.pathRequested = false;
         }
 
         updateUnitPosition(unitId);
+
+        // Most units are at rest, and don't need folding into the digest again.
+        const auto& unit = simulation->getUnit(unitId);
+        if (simulation->computeKinematicsDigest(unitId) != effects.previousKinematicsDigest
+            || unit.cobEnvironment->digest.value() != effects.previousScriptDigest
+            || unit.pieceDigest.value() != effects.previousPieceDigest)
+        {
+            simulation->markUnitDigestStale(unitId);
+        }
     }
 
-    bool UnitBehaviorService::followPath(Unit& unit, PathFollowingInfo& path)
+    bool UnitBehaviorService::followPath(UnitKinematics& kinematics, PathFollowingInfo& path)
     {
+        if (path.path.flowField)
+        {
+            if (auto target = getFlowFieldTarget(kinematics, *path.path.flowField); target)
+            {
+                steerTowards(kinematics, *target, false);
+                return false;
+            }
+
+            // We're at the goal cell, or the field has nowhere else for us to go,
+            // so head straight for the final waypoint.
+        }
+
         const auto& destination = *path.currentWaypoint;
-        Vector2f xzPosition(unit.position.x, unit.position.z);
+        Vector2f xzPosition(kinematics.position.x, kinematics.position.z);
         Vector2f xzDestination(destination.x, destination.z);
         auto distanceSquared = xzPosition.distanceSquared(xzDestination);
 
@@ -269,46 +348,58 @@ namespace rwe
         else
         {
             // steer towards the goal
-            auto xzDirection = xzDestination - xzPosition;
-            auto destAngle = Vector2f(0.0f, -1.0f).angleTo(xzDirection);
-            unit.targetAngle = (2.0f * Pif) - destAngle; // convert to anticlockwise in our coordinate system
+            steerTowards(kinematics, xzDestination, isFinalDestination);
+        }
 
-            // drive at full speed until we need to brake
-            // to turn or to arrive at the goal
-            auto brakingDistance = (unit.currentSpeed * unit.currentSpeed) / (2.0f * unit.brakeRate);
+        return false;
+    }
 
-            if (isWithinTurningCircle(xzDirection, unit.currentSpeed, unit.turnRate, unit.rotation))
-            {
-                unit.targetSpeed = 0.0f;
-            }
-            else if (isFinalDestination && distanceSquared <= (brakingDistance * brakingDistance))
-            {
-                unit.targetSpeed = 0.0f;
-            }
-            else
-            {
-                unit.targetSpeed = unit.maxSpeed;
-            }
+    boost::optional<Vector2f> UnitBehaviorService::getFlowFieldTarget(const UnitKinematics& kinematics, const FlowField& flowField) const
+    {
+        auto footprint = simulation->computeFootprintRegion(kinematics.position, flowField.getFootprintX(), flowField.getFootprintZ());
+        Point cell(footprint.x, footprint.y);
+        if (cell == flowField.getGoal())
+        {
+            return boost::none;
         }
 
-        return false;
+        // Aiming a few cells ahead smooths out the field's eight directions.
+        auto target = flowField.lookAhead(cell, FlowFieldLookAhead);
+        if (target == cell)
+        {
+            return boost::none;
+        }
+
+        auto corner = simulation->terrain.heightmapIndexToWorldCorner(target);
+        return Vector2f(
+            corner.x + (flowField.getFootprintX() * MapTerrain::HeightTileWidthInWorldUnits) / 2.0f,
+            corner.z + (flowField.getFootprintZ() * MapTerrain::HeightTileHeightInWorldUnits) / 2.0f);
     }
 
-    class GetTargetPosVisitor : public boost::static_visitor<Vector3f>
+    class GetTargetPosVisitor : public boost::static_visitor<boost::optional<Vector3f>>
     {
     private:
         const GameSimulation* sim;
 
     public:
         explicit GetTargetPosVisitor(const GameSimulation* sim) : sim(sim) {}
-        Vector3f operator()(const Vector3f& pos) const { return pos; }
-        // FIXME: unit could no longer exist (e.g. it died), currently this is UB.
-        Vector3f operator()(UnitId id) const { return sim->getUnit(id).position; }
+        boost::optional<Vector3f> operator()(const Vector3f& pos) const { return pos; }
+        boost::optional<Vector3f> operator()(UnitId id) const
+        {
+            if (!sim->unitExists(id))
+            {
+                // the unit no longer exists (e.g. it died)
+                return boost::none;
+            }
+
+            return sim->getUnitKinematics(id).position;
+        }
     };
 
-    void UnitBehaviorService::updateWeapon(UnitId id, unsigned int weaponIndex)
+    void UnitBehaviorService::updateWeapon(UnitId id, unsigned int weaponIndex, UnitBehaviorEffects& effects)
     {
-        auto& unit = scene->getSimulation().getUnit(id);
+        auto& unit = simulation->getUnit(id);
+        const auto& kinematics = simulation->getUnitKinematics(id);
         auto& weapon = unit.weapons[weaponIndex];
 
         // FIXME: all this logic really needs to come out.
@@ -321,32 +412,38 @@ namespace rwe
         if (auto idleState = boost::get<UnitWeaponStateIdle>(&weapon.state); idleState != nullptr)
         {
             // TODO: attempt to acquire a target
+            //  (GameSimulation::getUnitsInRadius can supply the candidates)
         }
         else if (auto aimingState = boost::get<UnitWeaponStateAttacking>(&weapon.state); aimingState != nullptr)
         {
             if (!aimingState->aimingThread)
             {
-                Vector3f targetPosition = boost::apply_visitor(GetTargetPosVisitor(&scene->getSimulation()), aimingState->target);
+                auto targetPosition = boost::apply_visitor(GetTargetPosVisitor(simulation), aimingState->target);
+                if (!targetPosition)
+                {
+                    unit.clearWeaponTarget(weaponIndex);
+                    return;
+                }
 
                 // FIXME: this calculation needs to take into account
                 // what the unit's AimFromPrimary (Secondary... etc) is.
-                auto aimVector = targetPosition - unit.position;
+                auto aimVector = *targetPosition - kinematics.position;
                 auto heading = Vector2f(0.0f, -1.0f).angleTo(Vector2f(aimVector.x, aimVector.z));
                 heading = -heading;
-                heading = wrap(-Pif, Pif, heading - unit.rotation);
+                heading = wrap(-Pif, Pif, heading - kinematics.rotation);
 
                 auto pitch = (Pif / 2.0f) - std::acos(aimVector.dot(Vector3f(0.0f, 1.0f, 0.0f)) / aimVector.length());
 
-                auto threadId = unit.cobEnvironment->createThread(getAimScriptName(weaponIndex), {toTaAngle(RadiansAngle(heading)).value, toTaAngle(RadiansAngle(pitch)).value});
+                auto threadId = unit.cobEnvironment->createThread(getAimEntryPoint(weaponIndex), {toTaAngle(RadiansAngle(heading)).value, toTaAngle(RadiansAngle(pitch)).value});
 
                 if (threadId)
                 {
-                    aimingState->aimingThread = *threadId;
+                    aimingState->aimingThread = CobThreadHandle(*threadId);
                 }
                 else
                 {
                     // We couldn't launch an aiming script (there isn't one)
-                    tryFireWeapon(id, weaponIndex);
+                    tryFireWeapon(id, weaponIndex, effects);
                 }
             }
             else
@@ -360,20 +457,20 @@ namespace rwe
                     if (*returnValue)
                     {
                         // aiming was successful, attempt to fire
-                        tryFireWeapon(id, weaponIndex);
+                        tryFireWeapon(id, weaponIndex, effects);
                     }
                 }
             }
         }
     }
 
-    void UnitBehaviorService::tryFireWeapon(UnitId id, unsigned int weaponIndex)
+    void UnitBehaviorService::tryFireWeapon(UnitId id, unsigned int weaponIndex, UnitBehaviorEffects& effects)
     {
-        auto& unit = scene->getSimulation().getUnit(id);
+        auto& unit = simulation->getUnit(id);
         auto& weapon = unit.weapons[weaponIndex];
 
         // wait for the weapon to reload
-        auto gameTime = scene->getGameTime();
+        auto gameTime = simulation->gameTime;
         if (gameTime < weapon.readyTime)
         {
             return;
@@ -384,9 +481,9 @@ namespace rwe
         // TODO: should actually spawn a projectile from the firing point
         if (weapon.soundStart)
         {
-            scene->playUnitSound(id, *weapon.soundStart);
+            effects.unitSounds.push_back(*weapon.soundStart);
         }
-        unit.cobEnvironment->createThread(getFireScriptName(weaponIndex));
+        unit.cobEnvironment->createThread(getFireEntryPoint(weaponIndex));
 
         // we are reloading now
         weapon.readyTime = gameTime + deltaSecondsToTicks(weapon.reloadTime);
@@ -400,74 +497,74 @@ namespace rwe
 
     void UnitBehaviorService::updateUnitRotation(UnitId id)
     {
-        auto& unit = scene->getSimulation().getUnit(id);
+        auto& kinematics = simulation->getUnitKinematics(id);
 
-        auto angleDelta = wrap(-Pif, Pif, unit.targetAngle - unit.rotation);
+        auto angleDelta = wrap(-Pif, Pif, kinematics.targetAngle - kinematics.rotation);
 
-        auto turnRateThisFrame = unit.turnRate;
+        auto turnRateThisFrame = kinematics.turnRate;
         if (std::abs(angleDelta) <= turnRateThisFrame)
         {
-            unit.rotation = unit.targetAngle;
+            kinematics.rotation = kinematics.targetAngle;
         }
         else
         {
-            unit.rotation = wrap(-Pif, Pif, unit.rotation + (turnRateThisFrame * (angleDelta > 0.0f ? 1.0f : -1.0f)));
+            kinematics.rotation = wrap(-Pif, Pif, kinematics.rotation + (turnRateThisFrame * (angleDelta > 0.0f ? 1.0f : -1.0f)));
         }
     }
 
     void UnitBehaviorService::updateUnitSpeed(UnitId id)
     {
-        auto& unit = scene->getSimulation().getUnit(id);
+        auto& kinematics = simulation->getUnitKinematics(id);
 
-        if (unit.targetSpeed > unit.currentSpeed)
+        if (kinematics.targetSpeed > kinematics.currentSpeed)
         {
             // accelerate to target speed
-            if (unit.targetSpeed - unit.currentSpeed <= unit.acceleration)
+            if (kinematics.targetSpeed - kinematics.currentSpeed <= kinematics.acceleration)
             {
-                unit.currentSpeed = unit.targetSpeed;
+                kinematics.currentSpeed = kinematics.targetSpeed;
             }
             else
             {
-                unit.currentSpeed += unit.acceleration;
+                kinematics.currentSpeed += kinematics.acceleration;
             }
         }
         else
         {
             // brake to target speed
-            if (unit.currentSpeed - unit.targetSpeed <= unit.brakeRate)
+            if (kinematics.currentSpeed - kinematics.targetSpeed <= kinematics.brakeRate)
             {
-                unit.currentSpeed = unit.targetSpeed;
+                kinematics.currentSpeed = kinematics.targetSpeed;
             }
             else
             {
-                unit.currentSpeed -= unit.brakeRate;
+                kinematics.currentSpeed -= kinematics.brakeRate;
             }
         }
 
-        auto effectiveMaxSpeed = unit.maxSpeed;
-        if (unit.position.y < scene->getTerrain().getSeaLevel())
+        auto effectiveMaxSpeed = kinematics.maxSpeed;
+        if (kinematics.position.y < simulation->terrain.getSeaLevel())
         {
             effectiveMaxSpeed /= 2.0f;
         }
-        unit.currentSpeed = std::clamp(unit.currentSpeed, 0.0f, effectiveMaxSpeed);
+        kinematics.currentSpeed = std::clamp(kinematics.currentSpeed, 0.0f, effectiveMaxSpeed);
     }
 
     void UnitBehaviorService::updateUnitPosition(UnitId unitId)
     {
-        auto& unit = scene->getSimulation().getUnit(unitId);
+        auto& kinematics = simulation->getUnitKinematics(unitId);
 
-        auto direction = Matrix4f::rotationY(unit.rotation) * Vector3f(0.0f, 0.0f, -1.0f);
+        auto direction = Matrix4f::rotationY(kinematics.rotation) * Vector3f(0.0f, 0.0f, -1.0f);
 
-        unit.inCollision = false;
+        kinematics.inCollision = false;
 
-        if (unit.currentSpeed > 0.0f)
+        if (kinematics.currentSpeed > 0.0f)
         {
-            auto newPosition = unit.position + (direction * unit.currentSpeed);
-            newPosition.y = scene->getTerrain().getHeightAt(newPosition.x, newPosition.z);
+            auto newPosition = kinematics.position + (direction * kinematics.currentSpeed);
+            newPosition.y = simulation->terrain.getHeightAt(newPosition.x, newPosition.z);
 
             if (!tryApplyMovementToPosition(unitId, newPosition))
             {
-                unit.inCollision = true;
+                kinematics.inCollision = true;
 
                 // if we failed to move, try in each axis separately
                 // to see if we can complete a "partial" movement
@@ -478,16 +575,16 @@ namespace rwe
                 Vector3f newPos2;
                 if (direction.x > direction.z)
                 {
-                    newPos1 = unit.position + (direction * maskZ * unit.currentSpeed);
-                    newPos2 = unit.position + (direction * maskX * unit.currentSpeed);
+                    newPos1 = kinematics.position + (direction * maskZ * kinematics.currentSpeed);
+                    newPos2 = kinematics.position + (direction * maskX * kinematics.currentSpeed);
                 }
                 else
                 {
-                    newPos1 = unit.position + (direction * maskX * unit.currentSpeed);
-                    newPos2 = unit.position + (direction * maskZ * unit.currentSpeed);
+                    newPos1 = kinematics.position + (direction * maskX * kinematics.currentSpeed);
+                    newPos2 = kinematics.position + (direction * maskZ * kinematics.currentSpeed);
                 }
-                newPos1.y = scene->getTerrain().getHeightAt(newPos1.x, newPos1.z);
-                newPos2.y = scene->getTerrain().getHeightAt(newPos2.x, newPos2.z);
+                newPos1.y = simulation->terrain.getHeightAt(newPos1.x, newPos1.z);
+                newPos2.y = simulation->terrain.getHeightAt(newPos2.x, newPos2.z);
 
                 if (!tryApplyMovementToPosition(unitId, newPos1))
                 {
@@ -499,11 +596,12 @@ namespace rwe
 
     bool UnitBehaviorService::tryApplyMovementToPosition(UnitId id, const Vector3f& newPosition)
     {
-        auto& sim = scene->getSimulation();
-        auto& unit = sim.getUnit(id);
+        auto& sim = *simulation;
+        const auto& unit = sim.getUnit(id);
+        const auto& kinematics = sim.getUnitKinematics(id);
 
         // check for collision at the new position
-        auto newFootprintRegion = scene->computeFootprintRegion(newPosition, unit.footprintX, unit.footprintZ);
+        auto newFootprintRegion = simulation->computeFootprintRegion(newPosition, unit.footprintX, unit.footprintZ);
 
         // Unlike for pathfinding, TA doesn't care about the unit's actual movement class for collision checks,
         // it only cares about the attributes defined directly on the unit.
@@ -521,58 +619,65 @@ namespace rwe
             return false;
         }
 
-        if (scene->isCollisionAt(newFootprintRegion, id))
+        if (simulation->isCollisionAt(newFootprintRegion, id))
         {
             return false;
         }
 
         // we passed all collision checks, update accordingly
-        auto footprintRegion = scene->computeFootprintRegion(unit.position, unit.footprintX, unit.footprintZ);
-        scene->moveUnitOccupiedArea(footprintRegion, newFootprintRegion, id);
-        unit.position = newPosition;
+        auto footprintRegion = simulation->computeFootprintRegion(kinematics.position, unit.footprintX, unit.footprintZ);
+        simulation->moveUnitOccupiedArea(footprintRegion, newFootprintRegion, id);
+        sim.setUnitPosition(id, newPosition);
         return true;
     }
 
-    std::string UnitBehaviorService::getAimScriptName(unsigned int weaponIndex) const
+    CobEntryPoint UnitBehaviorService::getAimEntryPoint(unsigned int weaponIndex) const
     {
         switch (weaponIndex)
         {
             case 0:
-                return "AimPrimary";
+                return CobEntryPoint::AimPrimary;
             case 1:
-                return "AimSecondary";
+                return CobEntryPoint::AimSecondary;
             case 2:
-                return "AimTertiary";
+                return CobEntryPoint::AimTertiary;
             default:
                 throw std::logic_error("Invalid wepaon index: " + std::to_string(weaponIndex));
         }
     }
 
-    std::string UnitBehaviorService::getFireScriptName(unsigned int weaponIndex) const
+    CobEntryPoint UnitBehaviorService::getFireEntryPoint(unsigned int weaponIndex) const
     {
         switch (weaponIndex)
         {
             case 0:
-                return "FirePrimary";
+                return CobEntryPoint::FirePrimary;
             case 1:
-                return "FireSecondary";
+                return CobEntryPoint::FireSecondary;
             case 2:
-                return "FireTertiary";
+                return CobEntryPoint::FireTertiary;
             default:
                 throw std::logic_error("Invalid wepaon index: " + std::to_string(weaponIndex));
         }
     }
 
-    boost::optional<int> UnitBehaviorService::runCobQuery(UnitId id, std::string& name)
+    boost::optional<int> UnitBehaviorService::runCobQuery(UnitId id, CobEntryPoint entryPoint)
     {
-        auto& unit = scene->getSimulation().getUnit(id);
-        auto thread = unit.cobEnvironment->createNonScheduledThread(name, {0});
+        auto& unit = simulation->getUnit(id);
+        auto thread = unit.cobEnvironment->createNonScheduledThread(entryPoint, {0});
         if (!thread)
         {
             return boost::none;
         }
-        CobExecutionContext context(&scene->getSimulation(), unit.cobEnvironment.get(), &*thread, id);
+        CobExecutionContext context(simulation, unit.cobEnvironment.get(), &*thread, id);
         auto status = context.execute();
+        while (auto signalStatus = boost::get<CobEnvironment::SignalStatus>(&status))
+        {
+            // The query thread isn't scheduled, so signals can't kill it.
+            unit.cobEnvironment->sendSignal(signalStatus->signal);
+            status = context.execute();
+        }
+
         if (boost::get<CobEnvironment::FinishedStatus>(&status) == nullptr)
         {
             throw std::runtime_error("Synchronous cob query thread blocked before completion");
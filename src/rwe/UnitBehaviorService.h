@@ -2,30 +2,78 @@
 #define RWE_UNITBEHAVIORSERVICE_H
 
 #include "UnitId.h"
+#include <rwe/AudioService.h>
+#include <rwe/GameSimulation.h>
 #include <rwe/math/Vector3f.h>
 #include <rwe/pathfinding/PathFindingService.h>
+#include <vector>
 
 namespace rwe
 {
-    class GameScene;
+    /**
+     * Side effects of a unit's behaviour update
+     * that touch state shared with other units.
+     * These are recorded during the intent phase
+     * and applied during the commit phase.
+     * Sounds are not part of the simulation,
+     * they are left for the owner of the simulation to play (or ignore).
+     */
+    struct UnitBehaviorEffects
+    {
+        bool pathRequested{false};
+        std::vector<AudioService::SoundHandle> selectChannelSounds;
+        std::vector<AudioService::SoundHandle> unitSounds;
+
+        /**
+         * Hashes of the unit's state before the intent phase,
+         * as the simulation digest sees it,
+         * so that the commit phase can tell whether the unit
+         * needs folding into the simulation digest again.
+         */
+        std::uint64_t previousKinematicsDigest{0};
+        std::uint64_t previousScriptDigest{0};
+        std::uint64_t previousPieceDigest{0};
+    };
 
     class UnitBehaviorService
     {
     private:
-        GameScene* scene;
+        GameSimulation* simulation;
         PathFindingService* pathFindingService;
         MovementClassCollisionService* collisionService;
 
     public:
-        UnitBehaviorService(GameScene* scene, PathFindingService* pathFindingService, MovementClassCollisionService* collisionService);
+        UnitBehaviorService(GameSimulation* simulation, PathFindingService* pathFindingService, MovementClassCollisionService* collisionService);
 
-        void update(UnitId unitId);
+        /**
+         * Processes the unit's orders, weapons and steering.
+         * The unit may only modify its own state here,
+         * anything that affects other units is recorded in effects instead.
+         * This makes it safe to run for different units in parallel.
+         * Any sounds left in effects from the previous tick are discarded.
+         */
+        void updateIntent(UnitId unitId, UnitBehaviorEffects& effects);
+
+        /**
+         * Applies the path request recorded for the unit by updateIntent
+         * and moves the unit according to its current speed and heading,
+         * claiming its new area of the occupied grid.
+         * Units must be committed one at a time, in a consistent order,
+         * for the simulation to be deterministic.
+         */
+        void commit(UnitId unitId, UnitBehaviorEffects& effects);
 
     private:
-        bool followPath(Unit& unit, PathFollowingInfo& path);
+        bool followPath(UnitKinematics& kinematics, PathFollowingInfo& path);
+
+        /**
+         * Returns where a unit following the field should steer towards,
+         * or none once it has reached the goal cell or can get no closer.
+         */
+        boost::optional<Vector2f> getFlowFieldTarget(const UnitKinematics& kinematics, const FlowField& flowField) const;
 
-        void updateWeapon(UnitId id, unsigned int weaponIndex);
-        void tryFireWeapon(UnitId id, unsigned int weaponIndex);
+        void updateWeapon(UnitId id, unsigned int weaponIndex, UnitBehaviorEffects& effects);
+        void tryFireWeapon(UnitId id, unsigned int weaponIndex, UnitBehaviorEffects& effects);
 
         void applyUnitSteering(UnitId id);
         void updateUnitRotation(UnitId id);
@@ -35,10 +83,10 @@ namespace rwe
 
         bool tryApplyMovementToPosition(UnitId id, const Vector3f& newPosition);
 
-        std::string getAimScriptName(unsigned int weaponIndex) const;
-        std::string getFireScriptName(unsigned int weaponIndex) const;
+        CobEntryPoint getAimEntryPoint(unsigned int weaponIndex) const;
+        CobEntryPoint getFireEntryPoint(unsigned int weaponIndex) const;
 
-        boost::optional<int> runCobQuery(UnitId id, std::string& name);
+        boost::optional<int> runCobQuery(UnitId id, CobEntryPoint entryPoint);
     };
 }
 
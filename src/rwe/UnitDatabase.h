@@ -51,6 +51,13 @@ namespace rwe
 
         const AudioService::SoundHandle& getSoundHandle(const std::string sound) const;
 
+        /**
+         * Returns the sound with the given name,
+         * or none if it was never loaded (e.g. it does not exist,
+         * or the database was created without an audio service).
+         */
+        boost::optional<AudioService::SoundHandle> tryGetSoundHandle(const std::string& sound) const;
+
         void addSound(const std::string& soundName, const AudioService::SoundHandle& sound);
 
         MovementClassIterator movementClassBegin() const;
@@ -13,8 +13,7 @@ namespace rwe
     Unit UnitFactory::createUnit(
         const std::string& unitType,
         PlayerId owner,
-        unsigned int colorIndex,
-        const Vector3f& position)
+        unsigned int colorIndex)
     {
         const auto& fbi = unitDatabase.getUnitInfo(unitType);
         const auto& soundClass = unitDatabase.getSoundClass(fbi.soundCategory);
@@ -28,18 +27,10 @@ namespace rwe
 
         const auto& script = unitDatabase.getUnitScript(fbi.unitName);
         auto cobEnv = std::make_unique<CobEnvironment>(&script);
-        cobEnv->createThread("Create", std::vector<int>());
-        Unit unit(meshInfo.mesh, std::move(cobEnv), std::move(meshInfo.selectionMesh));
+        cobEnv->createThread(CobEntryPoint::Create);
+        auto scriptPieces = getScriptPieceMap(unitType, script, meshInfo.mesh);
+        Unit unit(meshInfo.mesh, std::move(scriptPieces), std::move(cobEnv), std::move(meshInfo.selectionMesh));
         unit.owner = owner;
-        unit.position = position;
-
-        // These units are per-tick.
-        // We divide by two here because TA ticks are 1/30 of a second,
-        // where as ours are 1/60 of a second.
-        unit.turnRate = (fbi.turnRate / 2.0f) * (Pif / 32768.0f); // also convert to rads
-        unit.maxSpeed = fbi.maxVelocity / 2.0f;
-        unit.acceleration = fbi.acceleration / 2.0f;
-        unit.brakeRate = fbi.brakeRate / 2.0f;
 
         unit.canAttack = fbi.canAttack;
 
@@ -78,20 +69,38 @@ namespace rwe
 
         if (soundClass.select1)
         {
-            unit.selectionSound = unitDatabase.getSoundHandle(*(soundClass.select1));
+            unit.selectionSound = unitDatabase.tryGetSoundHandle(*(soundClass.select1));
         }
         if (soundClass.ok1)
         {
-            unit.okSound = unitDatabase.getSoundHandle(*(soundClass.ok1));
+            unit.okSound = unitDatabase.tryGetSoundHandle(*(soundClass.ok1));
         }
         if (soundClass.arrived1)
         {
-            unit.arrivedSound = unitDatabase.getSoundHandle(*(soundClass.arrived1));
+            unit.arrivedSound = unitDatabase.tryGetSoundHandle(*(soundClass.arrived1));
         }
 
         return unit;
     }
 
+    UnitKinematics UnitFactory::createUnitKinematics(const std::string& unitType, const Vector3f& position)
+    {
+        const auto& fbi = unitDatabase.getUnitInfo(unitType);
+
+        UnitKinematics kinematics;
+        kinematics.position = position;
+
+        // These units are per-tick.
+        // We divide by two here because TA ticks are 1/30 of a second,
+        // where as ours are 1/60 of a second.
+        kinematics.turnRate = (fbi.turnRate / 2.0f) * (Pif / 32768.0f); // also convert to rads
+        kinematics.maxSpeed = fbi.maxVelocity / 2.0f;
+        kinematics.acceleration = fbi.acceleration / 2.0f;
+        kinematics.brakeRate = fbi.brakeRate / 2.0f;
+
+        return kinematics;
+    }
+
     UnitWeapon UnitFactory::createWeapon(const std::string& weaponType)
     {
         const auto& tdf = unitDatabase.getWeapon(weaponType);
@@ -100,16 +109,32 @@ namespace rwe
         weapon.reloadTime = tdf.reloadTime;
         if (!tdf.soundStart.empty())
         {
-            weapon.soundStart = unitDatabase.getSoundHandle(tdf.soundStart);
+            weapon.soundStart = unitDatabase.tryGetSoundHandle(tdf.soundStart);
         }
         if (!tdf.soundHit.empty())
         {
-            weapon.soundHit = unitDatabase.getSoundHandle(tdf.soundHit);
+            weapon.soundHit = unitDatabase.tryGetSoundHandle(tdf.soundHit);
         }
         if (!tdf.soundWater.empty())
         {
-            weapon.soundWater = unitDatabase.getSoundHandle(tdf.soundWater);
+            weapon.soundWater = unitDatabase.tryGetSoundHandle(tdf.soundWater);
         }
         return weapon;
     }
+
+    std::shared_ptr<const ScriptPieceMap> UnitFactory::getScriptPieceMap(
+        const std::string& unitType,
+        const CobScript& script,
+        const UnitMesh& mesh)
+    {
+        auto it = scriptPieceMaps.find(unitType);
+        if (it != scriptPieceMaps.end())
+        {
+            return it->second;
+        }
+
+        auto result = std::make_shared<const ScriptPieceMap>(createScriptPieceMap(script.pieces, mesh));
+        scriptPieceMaps.emplace(unitType, result);
+        return result;
+    }
 }
@@ -6,7 +6,10 @@
 #include <rwe/MovementClassCollisionService.h>
 #include <rwe/Unit.h>
 #include <rwe/UnitDatabase.h>
+#include <rwe/UnitKinematics.h>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace rwe
 {
@@ -17,14 +20,25 @@ namespace rwe
         MeshService meshService;
         MovementClassCollisionService* const collisionService;
 
+        /**
+         * Script piece maps for each unit type created so far.
+         * A unit type always pairs the same script with the same model,
+         * so the map is shared between all units of that type.
+         */
+        std::unordered_map<std::string, std::shared_ptr<const ScriptPieceMap>> scriptPieceMaps;
+
     public:
         UnitFactory(UnitDatabase&& unitDatabase, MeshService&& meshService, MovementClassCollisionService* collisionService);
 
     public:
-        Unit createUnit(const std::string& unitType, PlayerId owner, unsigned int colorIndex, const Vector3f& position);
+        Unit createUnit(const std::string& unitType, PlayerId owner, unsigned int colorIndex);
+
+        UnitKinematics createUnitKinematics(const std::string& unitType, const Vector3f& position);
 
     private:
         UnitWeapon createWeapon(const std::string& weaponType);
+
+        std::shared_ptr<const ScriptPieceMap> getScriptPieceMap(const std::string& unitType, const CobScript& script, const UnitMesh& mesh);
     };
 }
 
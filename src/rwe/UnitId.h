@@ -6,7 +6,46 @@
 namespace rwe
 {
     struct UnitIdTag;
+
+    /**
+     * A handle to a unit in the simulation.
+     *
+     * The low bits of the value hold the index of the slot
+     * that the unit occupies in the UnitStore,
+     * the high bits hold the slot's generation at the time the unit was added.
+     * Slots are reused once their unit is removed,
+     * but the generation is bumped each time,
+     * so handles to removed units can be recognised as stale.
+     * A slot whose generation would wrap around is retired instead,
+     * so a stale handle can never become valid again.
+     */
     using UnitId = OpaqueId<unsigned int, UnitIdTag>;
+
+    static constexpr unsigned int UnitIdSlotBits = 20;
+    static constexpr unsigned int UnitIdGenerationBits = 10;
+
+    static constexpr unsigned int UnitIdMaxSlots = 1u << UnitIdSlotBits;
+    static constexpr unsigned int UnitIdGenerationMask = (1u << UnitIdGenerationBits) - 1;
+
+    /** The occupied grid keeps the top two bits of each cell for its tag. */
+    static constexpr unsigned int UnitIdBits = 30;
+
+    static_assert(UnitIdSlotBits + UnitIdGenerationBits <= UnitIdBits, "UnitId doesn't have room for its slot and generation");
+
+    inline UnitId makeUnitId(unsigned int slot, unsigned int generation)
+    {
+        return UnitId(((generation & UnitIdGenerationMask) << UnitIdSlotBits) | slot);
+    }
+
+    inline unsigned int getUnitIdSlot(UnitId id)
+    {
+        return id.value & (UnitIdMaxSlots - 1);
+    }
+
+    inline unsigned int getUnitIdGeneration(UnitId id)
+    {
+        return id.value >> UnitIdSlotBits;
+    }
 }
 
 #endif
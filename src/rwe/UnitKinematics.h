@@ -0,0 +1,67 @@
+#ifndef RWE_UNITKINEMATICS_H
+#define RWE_UNITKINEMATICS_H
+
+#include <rwe/math/Vector3f.h>
+
+namespace rwe
+{
+    /**
+     * The "hot" part of a unit's state,
+     * i.e. the fields that are read and written every tick
+     * by steering, movement and rendering.
+     *
+     * These are kept separate from the rest of the unit
+     * so that they can be stored contiguously
+     * and iterated over without pulling in meshes, scripts, orders, etc.
+     */
+    struct UnitKinematics
+    {
+        Vector3f position{0.0f, 0.0f, 0.0f};
+
+        /**
+         * Anticlockwise rotation of the unit around the Y axis in radians.
+         * The other two axes of rotation are normally determined
+         * by the normal of the terrain the unit is standing on.
+         */
+        float rotation{0.0f};
+
+        /**
+         * Rate at which the unit turns in rads/tick.
+         */
+        float turnRate{0.0f};
+
+        /**
+         * Rate at which the unit is travelling forwards in game units/tick.
+         */
+        float currentSpeed{0.0f};
+
+        /**
+         * Maximum speed the unit can travel forwards in game units/tick.
+         */
+        float maxSpeed{0.0f};
+
+        /**
+         * Speed at which the unit accelerates in game units/tick.
+         */
+        float acceleration{0.0f};
+
+        /**
+         * Speed at which the unit brakes in game units/tick.
+         */
+        float brakeRate{0.0f};
+
+        /** The angle we are trying to steer towards. */
+        float targetAngle{0.0f};
+
+        /** The speed we are trying to accelerate/decelerate to */
+        float targetSpeed{0.0f};
+
+        /**
+         * True if the unit attempted to move last frame
+         * and its movement was limited (or prevented entirely) by a collision.
+         */
+        bool inCollision{false};
+    };
+}
+
+#endif
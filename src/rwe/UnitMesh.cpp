@@ -1,10 +1,11 @@
 #include "UnitMesh.h"
 #include "util.h"
 #include <rwe/math/rwe_math.h>
+#include <stdexcept>
 
 namespace rwe
 {
-    void applyMoveOperation(boost::optional<UnitMesh::MoveOperation>& op, float& currentPos, float dt)
+    bool applyMoveOperation(boost::optional<UnitMesh::MoveOperation>& op, float& currentPos, float dt)
     {
         if (op)
         {
@@ -14,15 +15,18 @@ namespace rwe
             {
                 currentPos = op->targetPosition;
                 op = boost::none;
+                return true;
             }
             else
             {
                 currentPos += frameSpeed * (remaining > 0.0f ? 1.0f : -1.0f);
             }
         }
+
+        return false;
     }
 
-    void applyTurnOperation(boost::optional<UnitMesh::TurnOperation>& op, float& currentAngle, float dt)
+    bool applyTurnOperation(boost::optional<UnitMesh::TurnOperation>& op, float& currentAngle, float dt)
     {
         if (op)
         {
@@ -33,6 +37,7 @@ namespace rwe
             {
                 currentAngle = op->targetAngle.value;
                 op = boost::none;
+                return true;
             }
             else
             {
@@ -40,52 +45,109 @@ namespace rwe
                 currentAngle = wrap(-Pif, Pif, currentAngle + angleDelta);
             }
         }
+
+        return false;
     }
 
-    boost::optional<const UnitMesh&> UnitMesh::find(const std::string& pieceName) const
+    boost::optional<unsigned int> UnitMesh::findPieceIndex(const std::string& pieceName) const
     {
-        if (pieceName == name)
-        {
-            return *this;
-        }
-
-        for (auto& c : children)
+        for (unsigned int i = 0; i < pieces.size(); ++i)
         {
-            auto piece = c.find(pieceName);
-            if (piece)
+            if (pieces[i].name == pieceName)
             {
-                return piece;
+                return i;
             }
         }
 
         return boost::none;
     }
 
-    boost::optional<UnitMesh&> UnitMesh::find(const std::string& pieceName)
+    void UnitMesh::markAnimating(unsigned int pieceIndex)
     {
-        auto value = static_cast<const UnitMesh&>(*this).find(pieceName);
-        if (!value)
+        auto& piece = pieces.at(pieceIndex);
+        if (!piece.animating)
         {
-            return boost::none;
+            piece.animating = true;
+            animatingPieces.push_back(pieceIndex);
         }
+    }
 
-        return const_cast<UnitMesh&>(*value);
+    bool UnitMesh::isAnimating() const
+    {
+        return !animatingPieces.empty();
     }
 
     void UnitMesh::update(float dt)
     {
-        applyMoveOperation(xMoveOperation, offset.x, dt);
-        applyMoveOperation(yMoveOperation, offset.y, dt);
-        applyMoveOperation(zMoveOperation, offset.z, dt);
+        for (std::size_t i = 0; i < animatingPieces.size();)
+        {
+            auto pieceIndex = animatingPieces[i];
+            auto& piece = pieces[pieceIndex];
+
+            auto recordEnd = [&](bool ended, Axis axis, PieceOperationKey::Kind kind) {
+                if (ended)
+                {
+                    endedOperations.emplace_back(pieceIndex, axis, kind);
+                }
+            };
 
-        applyTurnOperation(xTurnOperation, rotation.x, dt);
-        applyTurnOperation(yTurnOperation, rotation.y, dt);
-        applyTurnOperation(zTurnOperation, rotation.z, dt);
+            recordEnd(applyMoveOperation(piece.xMoveOperation, piece.offset.x, dt), Axis::X, PieceOperationKey::Kind::Move);
+            recordEnd(applyMoveOperation(piece.yMoveOperation, piece.offset.y, dt), Axis::Y, PieceOperationKey::Kind::Move);
+            recordEnd(applyMoveOperation(piece.zMoveOperation, piece.offset.z, dt), Axis::Z, PieceOperationKey::Kind::Move);
 
-        for (auto& c : children)
+            recordEnd(applyTurnOperation(piece.xTurnOperation, piece.rotation.x, dt), Axis::X, PieceOperationKey::Kind::Turn);
+            recordEnd(applyTurnOperation(piece.yTurnOperation, piece.rotation.y, dt), Axis::Y, PieceOperationKey::Kind::Turn);
+            recordEnd(applyTurnOperation(piece.zTurnOperation, piece.rotation.z, dt), Axis::Z, PieceOperationKey::Kind::Turn);
+
+            if (piece.hasOperations())
+            {
+                ++i;
+                continue;
+            }
+
+            // Pieces animate independently of each other,
+            // so the order of the list doesn't matter.
+            piece.animating = false;
+            animatingPieces[i] = animatingPieces.back();
+            animatingPieces.pop_back();
+        }
+    }
+
+    bool UnitMesh::Piece::hasOperations() const
+    {
+        return xMoveOperation || yMoveOperation || zMoveOperation
+            || xTurnOperation || yTurnOperation || zTurnOperation;
+    }
+
+    bool UnitMesh::Piece::hasOperation(Axis axis, PieceOperationKey::Kind kind) const
+    {
+        switch (kind)
         {
-            c.update(dt);
+            case PieceOperationKey::Kind::Move:
+                switch (axis)
+                {
+                    case Axis::X:
+                        return !!xMoveOperation;
+                    case Axis::Y:
+                        return !!yMoveOperation;
+                    case Axis::Z:
+                        return !!zMoveOperation;
+                }
+                break;
+            case PieceOperationKey::Kind::Turn:
+                switch (axis)
+                {
+                    case Axis::X:
+                        return !!xTurnOperation;
+                    case Axis::Y:
+                        return !!yTurnOperation;
+                    case Axis::Z:
+                        return !!zTurnOperation;
+                }
+                break;
         }
+
+        throw std::logic_error("Invalid piece operation");
     }
 
     UnitMesh::MoveOperation::MoveOperation(float targetPosition, float speed)
@@ -3,10 +3,12 @@
 
 #include <boost/optional.hpp>
 #include <memory>
+#include <rwe/PieceOperationKey.h>
 #include <rwe/RadiansAngle.h>
 #include <rwe/ShaderMesh.h>
 #include <rwe/math/Vector3f.h>
 #include <string>
+#include <vector>
 
 
 namespace rwe
@@ -29,25 +31,66 @@ namespace rwe
             TurnOperation(RadiansAngle targetAngle, float speed);
         };
 
-        std::string name;
-        Vector3f origin;
-        std::shared_ptr<ShaderMesh> mesh;
-        std::vector<UnitMesh> children;
-        bool visible{true};
-        Vector3f offset{0.0f, 0.0f, 0.0f};
-        Vector3f rotation{0.0f, 0.0f, 0.0f};
+        struct Piece
+        {
+            std::string name;
+            Vector3f origin;
+            std::shared_ptr<ShaderMesh> mesh;
+
+            /** The index of the parent piece, or none for the root. */
+            boost::optional<unsigned int> parent;
+
+            bool visible{true};
+            Vector3f offset{0.0f, 0.0f, 0.0f};
+            Vector3f rotation{0.0f, 0.0f, 0.0f};
+
+            boost::optional<MoveOperation> xMoveOperation;
+            boost::optional<MoveOperation> yMoveOperation;
+            boost::optional<MoveOperation> zMoveOperation;
+
+            boost::optional<TurnOperation> xTurnOperation;
+            boost::optional<TurnOperation> yTurnOperation;
+            boost::optional<TurnOperation> zTurnOperation;
+
+            /** True if the piece is in the mesh's list of animating pieces. */
+            bool animating{false};
+
+            bool hasOperations() const;
+
+            bool hasOperation(Axis axis, PieceOperationKey::Kind kind) const;
+        };
+
+        /**
+         * The pieces of the model in depth-first order,
+         * so a piece always comes after its parent.
+         */
+        std::vector<Piece> pieces;
+
+        /**
+         * Indices of the pieces that may have a move or turn in progress.
+         * Only these pieces are visited by update.
+         */
+        std::vector<unsigned int> animatingPieces;
 
-        boost::optional<MoveOperation> xMoveOperation;
-        boost::optional<MoveOperation> yMoveOperation;
-        boost::optional<MoveOperation> zMoveOperation;
+        /**
+         * Every move or turn that has come to an end,
+         * whether it finished or was cut short,
+         * since scripts last took them.
+         * Scripts use these to wake only the threads
+         * waiting on the operations that ended.
+         */
+        std::vector<PieceOperationKey> endedOperations;
 
-        boost::optional<TurnOperation> xTurnOperation;
-        boost::optional<TurnOperation> yTurnOperation;
-        boost::optional<TurnOperation> zTurnOperation;
+        boost::optional<unsigned int> findPieceIndex(const std::string& pieceName) const;
 
-        boost::optional<const UnitMesh&> find(const std::string& pieceName) const;
+        /**
+         * Registers the piece with update.
+         * Must be called whenever an operation is given to a piece.
+         * The piece is dropped again once its operations complete.
+         */
+        void markAnimating(unsigned int pieceIndex);
 
-        boost::optional<UnitMesh&> find(const std::string& pieceName);
+        bool isAnimating() const;
 
         void update(float dt);
     };
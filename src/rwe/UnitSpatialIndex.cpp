@@ -0,0 +1,291 @@
+#include "UnitSpatialIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <rwe/math/Vector2f.h>
+#include <stdexcept>
+
+namespace rwe
+{
+    /**
+     * Narrows the interval [tMin, tMax] to the part of a ray
+     * that lies between min and max along a single axis.
+     * Returns false if the resulting interval is empty.
+     */
+    bool clipRayToSlab(float origin, float direction, float min, float max, float& tMin, float& tMax)
+    {
+        if (direction == 0.0f)
+        {
+            return origin >= min && origin <= max;
+        }
+
+        auto t1 = (min - origin) / direction;
+        auto t2 = (max - origin) / direction;
+        if (t1 > t2)
+        {
+            std::swap(t1, t2);
+        }
+
+        tMin = std::max(tMin, t1);
+        tMax = std::min(tMax, t2);
+        return tMin <= tMax;
+    }
+
+    float distanceSquaredToSegment(const Vector2f& p, const Vector2f& a, const Vector2f& b)
+    {
+        auto ab = b - a;
+        auto lengthSquared = ab.lengthSquared();
+        if (lengthSquared == 0.0f)
+        {
+            return p.distanceSquared(a);
+        }
+
+        auto t = std::clamp((p - a).dot(ab) / lengthSquared, 0.0f, 1.0f);
+        return p.distanceSquared(a + (ab * t));
+    }
+
+    UnitSpatialIndex::UnitSpatialIndex(float left, float top, float width, float height, float cellSize)
+        : left(left),
+          top(top),
+          cellSize(cellSize),
+          cells(
+              std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(width / cellSize))),
+              std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(height / cellSize))))
+    {
+    }
+
+    void UnitSpatialIndex::insert(UnitId id, const Vector3f& position, float radius)
+    {
+        auto slot = getUnitIdSlot(id);
+        if (slot >= entries.size())
+        {
+            entries.resize(slot + 1);
+        }
+
+        auto& entry = entries[slot];
+        if (entry.present)
+        {
+            throw std::logic_error("Unit is already in the spatial index");
+        }
+
+        entry.x = position.x;
+        entry.z = position.z;
+        entry.radius = radius;
+        entry.cellX = toCellX(position.x);
+        entry.cellY = toCellY(position.z);
+        entry.present = true;
+
+        cells.get(entry.cellX, entry.cellY).push_back(id);
+        maxRadius = std::max(maxRadius, radius);
+    }
+
+    void UnitSpatialIndex::move(UnitId id, const Vector3f& newPosition)
+    {
+        auto& entry = entries.at(getUnitIdSlot(id));
+        assert(entry.present);
+
+        entry.x = newPosition.x;
+        entry.z = newPosition.z;
+
+        auto newCellX = toCellX(newPosition.x);
+        auto newCellY = toCellY(newPosition.z);
+        if (newCellX == entry.cellX && newCellY == entry.cellY)
+        {
+            return;
+        }
+
+        removeFromCell(id, entry.cellX, entry.cellY);
+        entry.cellX = newCellX;
+        entry.cellY = newCellY;
+        cells.get(newCellX, newCellY).push_back(id);
+    }
+
+    void UnitSpatialIndex::remove(UnitId id)
+    {
+        auto& entry = entries.at(getUnitIdSlot(id));
+        assert(entry.present);
+
+        removeFromCell(id, entry.cellX, entry.cellY);
+        entry.present = false;
+    }
+
+    std::vector<UnitId> UnitSpatialIndex::queryCircle(const Vector3f& center, float radius) const
+    {
+        std::vector<UnitId> candidates;
+        collectCells(
+            toCellX(center.x - radius),
+            toCellY(center.z - radius),
+            toCellX(center.x + radius),
+            toCellY(center.z + radius),
+            candidates);
+
+        Vector2f center2d(center.x, center.z);
+        auto radiusSquared = radius * radius;
+
+        std::vector<UnitId> result;
+        for (const auto& id : candidates)
+        {
+            const auto& entry = entries[getUnitIdSlot(id)];
+            if (center2d.distanceSquared(Vector2f(entry.x, entry.z)) <= radiusSquared)
+            {
+                result.push_back(id);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const UnitId& a, const UnitId& b) { return a.value < b.value; });
+        return result;
+    }
+
+    std::vector<UnitId> UnitSpatialIndex::queryRect(const Rectangle2f& rect) const
+    {
+        std::vector<UnitId> candidates;
+        collectCells(
+            toCellX(rect.left()),
+            toCellY(rect.top()),
+            toCellX(rect.right()),
+            toCellY(rect.bottom()),
+            candidates);
+
+        std::vector<UnitId> result;
+        for (const auto& id : candidates)
+        {
+            const auto& entry = entries[getUnitIdSlot(id)];
+            if (rect.contains(entry.x, entry.z))
+            {
+                result.push_back(id);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const UnitId& a, const UnitId& b) { return a.value < b.value; });
+        return result;
+    }
+
+    std::vector<UnitId> UnitSpatialIndex::queryRay(const Ray3f& ray, float minY, float maxY) const
+    {
+        std::vector<UnitId> result;
+
+        // Work out the section of the ray that could possibly
+        // pass within maxRadius of a unit.
+        auto tMin = 0.0f;
+        auto tMax = std::numeric_limits<float>::infinity();
+        if (!clipRayToSlab(ray.origin.y, ray.direction.y, minY - maxRadius, maxY + maxRadius, tMin, tMax))
+        {
+            return result;
+        }
+
+        // A horizontal ray is not bounded by the height limits,
+        // so bound it by the area covered by the index instead.
+        if (std::isinf(tMax))
+        {
+            auto right = left + (static_cast<float>(cells.getWidth()) * cellSize);
+            auto bottom = top + (static_cast<float>(cells.getHeight()) * cellSize);
+            if (!clipRayToSlab(ray.origin.x, ray.direction.x, left - maxRadius, right + maxRadius, tMin, tMax)
+                || !clipRayToSlab(ray.origin.z, ray.direction.z, top - maxRadius, bottom + maxRadius, tMin, tMax))
+            {
+                return result;
+            }
+        }
+
+        auto start = ray.pointAt(tMin);
+        auto end = ray.pointAt(tMax);
+        Vector2f start2d(start.x, start.z);
+        Vector2f end2d(end.x, end.z);
+
+        // Walk the rows of cells that the segment passes over,
+        // visiting only the cells in each row that the segment could touch.
+        std::vector<UnitId> candidates;
+        auto minCellY = toCellY(std::min(start.z, end.z) - maxRadius);
+        auto maxCellY = toCellY(std::max(start.z, end.z) + maxRadius);
+        for (auto cellY = minCellY; cellY <= maxCellY; ++cellY)
+        {
+            // edge rows also hold everything beyond the edge of the index
+            auto rowTop = cellY == 0
+                ? -std::numeric_limits<float>::infinity()
+                : top + (static_cast<float>(cellY) * cellSize) - maxRadius;
+            auto rowBottom = cellY == cells.getHeight() - 1
+                ? std::numeric_limits<float>::infinity()
+                : top + (static_cast<float>(cellY + 1) * cellSize) + maxRadius;
+
+            auto rowTMin = tMin;
+            auto rowTMax = tMax;
+            if (!clipRayToSlab(ray.origin.z, ray.direction.z, rowTop, rowBottom, rowTMin, rowTMax))
+            {
+                continue;
+            }
+
+            auto rowStartX = ray.origin.x + (ray.direction.x * rowTMin);
+            auto rowEndX = ray.origin.x + (ray.direction.x * rowTMax);
+            collectCells(
+                toCellX(std::min(rowStartX, rowEndX) - maxRadius),
+                cellY,
+                toCellX(std::max(rowStartX, rowEndX) + maxRadius),
+                cellY,
+                candidates);
+        }
+
+        for (const auto& id : candidates)
+        {
+            const auto& entry = entries[getUnitIdSlot(id)];
+            auto distanceSquared = distanceSquaredToSegment(Vector2f(entry.x, entry.z), start2d, end2d);
+            if (distanceSquared <= entry.radius * entry.radius)
+            {
+                result.push_back(id);
+            }
+        }
+
+        std::sort(result.begin(), result.end(), [](const UnitId& a, const UnitId& b) { return a.value < b.value; });
+        return result;
+    }
+
+    std::size_t UnitSpatialIndex::toCellX(float x) const
+    {
+        auto cell = std::floor((x - left) / cellSize);
+        if (!(cell > 0.0f))
+        {
+            return 0;
+        }
+
+        return std::min(static_cast<std::size_t>(cell), cells.getWidth() - 1);
+    }
+
+    std::size_t UnitSpatialIndex::toCellY(float z) const
+    {
+        auto cell = std::floor((z - top) / cellSize);
+        if (!(cell > 0.0f))
+        {
+            return 0;
+        }
+
+        return std::min(static_cast<std::size_t>(cell), cells.getHeight() - 1);
+    }
+
+    void UnitSpatialIndex::removeFromCell(UnitId id, std::size_t cellX, std::size_t cellY)
+    {
+        auto& cell = cells.get(cellX, cellY);
+        auto it = std::find(cell.begin(), cell.end(), id);
+        assert(it != cell.end());
+
+        // order within a cell doesn't matter, so swap-and-pop
+        *it = cell.back();
+        cell.pop_back();
+    }
+
+    void UnitSpatialIndex::collectCells(
+        std::size_t minCellX,
+        std::size_t minCellY,
+        std::size_t maxCellX,
+        std::size_t maxCellY,
+        std::vector<UnitId>& out) const
+    {
+        for (auto y = minCellY; y <= maxCellY; ++y)
+        {
+            for (auto x = minCellX; x <= maxCellX; ++x)
+            {
+                const auto& cell = cells.get(x, y);
+                out.insert(out.end(), cell.begin(), cell.end());
+            }
+        }
+    }
+}
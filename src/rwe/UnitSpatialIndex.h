@@ -0,0 +1,98 @@
+#ifndef RWE_UNITSPATIALINDEX_H
+#define RWE_UNITSPATIALINDEX_H
+
+#include <rwe/Grid.h>
+#include <rwe/UnitId.h>
+#include <rwe/geometry/Ray3f.h>
+#include <rwe/geometry/Rectangle2f.h>
+#include <rwe/math/Vector3f.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * A uniform grid over the XZ plane of the map
+     * that records which units are near which parts of the world.
+     *
+     * Each unit is tracked as a point (its position)
+     * plus a radius that bounds the unit's selection mesh.
+     * The index is updated incrementally as units move,
+     * so that queries only need to examine units in nearby cells
+     * rather than every unit in the simulation.
+     *
+     * All query results are returned in ascending UnitId order.
+     */
+    class UnitSpatialIndex
+    {
+    private:
+        struct Entry
+        {
+            float x;
+            float z;
+            float radius;
+            std::size_t cellX;
+            std::size_t cellY;
+            bool present{false};
+        };
+
+        float left;
+        float top;
+        float cellSize;
+
+        Grid<std::vector<UnitId>> cells;
+
+        std::vector<Entry> entries;
+
+        /** The largest radius of any unit that has been inserted. */
+        float maxRadius{0.0f};
+
+    public:
+        /**
+         * Creates an index covering the given region of the XZ plane.
+         * Positions outside the region are still accepted,
+         * they are simply filed under the nearest edge cell.
+         */
+        UnitSpatialIndex(float left, float top, float width, float height, float cellSize);
+
+        void insert(UnitId id, const Vector3f& position, float radius);
+
+        void move(UnitId id, const Vector3f& newPosition);
+
+        void remove(UnitId id);
+
+        /**
+         * Returns all units whose position lies within the given
+         * distance of the center point, measured on the XZ plane.
+         */
+        std::vector<UnitId> queryCircle(const Vector3f& center, float radius) const;
+
+        /**
+         * Returns all units whose position lies inside the given rectangle.
+         * The rectangle's x and y axes correspond to the world's x and z axes.
+         */
+        std::vector<UnitId> queryRect(const Rectangle2f& rect) const;
+
+        /**
+         * Returns all units that could possibly intersect the given ray,
+         * assuming all unit positions lie between minY and maxY.
+         * This is a conservative test against each unit's bounding radius,
+         * callers are expected to perform a precise test on the results.
+         */
+        std::vector<UnitId> queryRay(const Ray3f& ray, float minY, float maxY) const;
+
+    private:
+        std::size_t toCellX(float x) const;
+        std::size_t toCellY(float z) const;
+
+        void removeFromCell(UnitId id, std::size_t cellX, std::size_t cellY);
+
+        void collectCells(
+            std::size_t minCellX,
+            std::size_t minCellY,
+            std::size_t maxCellX,
+            std::size_t maxCellY,
+            std::vector<UnitId>& out) const;
+    };
+}
+
+#endif
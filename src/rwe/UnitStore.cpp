@@ -0,0 +1,151 @@
+#include "UnitStore.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace rwe
+{
+    UnitId UnitStore::nextId() const
+    {
+        if (!freeSlots.empty())
+        {
+            auto slot = freeSlots.front();
+            return makeUnitId(slot, slots[slot].generation);
+        }
+
+        return makeUnitId(slots.size(), 0);
+    }
+
+    UnitId UnitStore::add(const UnitKinematics& unitKinematics, Unit&& unit)
+    {
+        unsigned int slot;
+        if (!freeSlots.empty())
+        {
+            slot = freeSlots.front();
+            freeSlots.pop_front();
+        }
+        else
+        {
+            if (slots.size() >= UnitIdMaxSlots)
+            {
+                throw std::runtime_error("Too many units");
+            }
+
+            slot = slots.size();
+            slots.emplace_back();
+        }
+
+        auto id = makeUnitId(slot, slots[slot].generation);
+        slots[slot].index = ids.size();
+        ids.push_back(id);
+        kinematics.push_back(unitKinematics);
+        units.push_back(std::move(unit));
+        return id;
+    }
+
+    void UnitStore::remove(UnitId id)
+    {
+        auto index = indexOf(id);
+        auto lastIndex = ids.size() - 1;
+
+        if (index != lastIndex)
+        {
+            ids[index] = ids[lastIndex];
+            kinematics[index] = kinematics[lastIndex];
+            units[index] = std::move(units[lastIndex]);
+            slots[getUnitIdSlot(ids[index])].index = index;
+        }
+
+        ids.pop_back();
+        kinematics.pop_back();
+        units.pop_back();
+
+        auto& slot = slots[getUnitIdSlot(id)];
+        slot.index = NoIndex;
+
+        // Once a slot has been through every generation
+        // it is never used again, since its next unit
+        // would have the same ID as its first.
+        if (slot.generation == UnitIdGenerationMask)
+        {
+            return;
+        }
+
+        ++slot.generation;
+        freeSlots.push_back(getUnitIdSlot(id));
+    }
+
+    bool UnitStore::contains(UnitId id) const
+    {
+        auto slot = getUnitIdSlot(id);
+        return slot < slots.size()
+            && slots[slot].index != NoIndex
+            && slots[slot].generation == getUnitIdGeneration(id);
+    }
+
+    std::size_t UnitStore::size() const
+    {
+        return units.size();
+    }
+
+    bool UnitStore::empty() const
+    {
+        return units.empty();
+    }
+
+    UnitId UnitStore::idAt(std::size_t index) const
+    {
+        assert(index < ids.size());
+        return ids[index];
+    }
+
+    Unit& UnitStore::get(UnitId id)
+    {
+        return units[indexOf(id)];
+    }
+
+    const Unit& UnitStore::get(UnitId id) const
+    {
+        return units[indexOf(id)];
+    }
+
+    UnitKinematics& UnitStore::getKinematics(UnitId id)
+    {
+        return kinematics[indexOf(id)];
+    }
+
+    const UnitKinematics& UnitStore::getKinematics(UnitId id) const
+    {
+        return kinematics[indexOf(id)];
+    }
+
+    Unit& UnitStore::unitAt(std::size_t index)
+    {
+        return units[index];
+    }
+
+    const Unit& UnitStore::unitAt(std::size_t index) const
+    {
+        return units[index];
+    }
+
+    UnitKinematics& UnitStore::kinematicsAt(std::size_t index)
+    {
+        return kinematics[index];
+    }
+
+    const UnitKinematics& UnitStore::kinematicsAt(std::size_t index) const
+    {
+        return kinematics[index];
+    }
+
+    std::size_t UnitStore::indexOf(UnitId id) const
+    {
+        if (!contains(id))
+        {
+            throw std::logic_error("Unit does not exist: " + std::to_string(id.value));
+        }
+
+        return slots[getUnitIdSlot(id)].index;
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef RWE_UNITSTORE_H
+#define RWE_UNITSTORE_H
+
+#include <deque>
+#include <rwe/Unit.h>
+#include <rwe/UnitId.h>
+#include <rwe/UnitKinematics.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Storage for all the units in the simulation.
+     *
+     * Each unit is split into two parts that share the same UnitId:
+     * the hot kinematic state (UnitKinematics), which is stored
+     * in its own contiguous array, and the cold remainder (Unit).
+     * Per-tick loops that only care about movement
+     * should iterate over the kinematics array.
+     *
+     * The store is a slot map. Units live in packed arrays
+     * and a UnitId refers to a slot, which records where its unit
+     * currently is in the arrays. Removing a unit moves the last unit
+     * into the gap, so adding, removing and looking up units are all O(1),
+     * but removal changes the positions of other units in the arrays.
+     * UnitIds remain valid until their own unit is removed,
+     * after which they are never valid again.
+     */
+    class UnitStore
+    {
+    private:
+        static constexpr unsigned int NoIndex = ~0u;
+
+        struct Slot
+        {
+            unsigned int generation{0};
+
+            /** Position of the slot's unit in the packed arrays, or NoIndex if the slot is free. */
+            unsigned int index{NoIndex};
+        };
+
+        std::vector<Slot> slots;
+
+        /**
+         * Free slots, reused in first-in first-out order,
+         * so that each slot's generations are used up as slowly as possible.
+         */
+        std::deque<unsigned int> freeSlots;
+
+        std::vector<UnitId> ids;
+        std::vector<UnitKinematics> kinematics;
+        std::vector<Unit> units;
+
+    public:
+        /**
+         * Returns the ID that will be given to the next unit added to the store.
+         */
+        UnitId nextId() const;
+
+        UnitId add(const UnitKinematics& unitKinematics, Unit&& unit);
+
+        /**
+         * Removes the unit from the store.
+         * The last unit in the store takes its place in the packed arrays.
+         * Throws if the ID does not refer to a unit in the store.
+         */
+        void remove(UnitId id);
+
+        /**
+         * Returns true if the ID refers to a unit currently in the store,
+         * false if the unit has been removed (or never existed).
+         */
+        bool contains(UnitId id) const;
+
+        std::size_t size() const;
+
+        bool empty() const;
+
+        /**
+         * Returns the ID of the unit stored at the given position
+         * in the store's arrays. Positions range from 0 to size() - 1.
+         */
+        UnitId idAt(std::size_t index) const;
+
+        Unit& get(UnitId id);
+        const Unit& get(UnitId id) const;
+
+        UnitKinematics& getKinematics(UnitId id);
+        const UnitKinematics& getKinematics(UnitId id) const;
+
+        Unit& unitAt(std::size_t index);
+        const Unit& unitAt(std::size_t index) const;
+
+        UnitKinematics& kinematicsAt(std::size_t index);
+        const UnitKinematics& kinematicsAt(std::size_t index) const;
+
+    private:
+        /**
+         * Returns the position of the unit in the packed arrays.
+         * Throws if the ID does not refer to a unit in the store.
+         */
+        std::size_t indexOf(UnitId id) const;
+    };
+}
+
+#endif
@@ -22,7 +22,7 @@ namespace rwe
         UnitWeaponAttackTarget target;
 
         /** The unit's aiming thread. */
-        boost::optional<const CobThread*> aimingThread;
+        boost::optional<CobThreadHandle> aimingThread;
 
         UnitWeaponStateAttacking(const UnitWeaponAttackTarget& target) : target(target)
         {
@@ -0,0 +1,142 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+namespace rwe
+{
+    unsigned int WorkerPool::defaultWorkerCount()
+    {
+        auto hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    WorkerPool::WorkerPool(unsigned int workerCount)
+    {
+        workers.reserve(workerCount);
+        for (unsigned int i = 0; i < workerCount; ++i)
+        {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shuttingDown = true;
+        }
+        workAvailable.notify_all();
+
+        for (auto& t : workers)
+        {
+            t.join();
+        }
+    }
+
+    void WorkerPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& f, std::size_t grainSize)
+    {
+        grainSize = std::max<std::size_t>(grainSize, 1);
+
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (workers.empty() || count <= grainSize)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                f(i);
+            }
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        jobFunction = &f;
+        jobCount = count;
+        jobGrainSize = grainSize;
+        nextIndex = 0;
+        remaining = count;
+        jobException = nullptr;
+        ++jobGeneration;
+        workAvailable.notify_all();
+
+        runJob(lock);
+
+        workFinished.wait(lock, [this]() { return remaining == 0; });
+        jobFunction = nullptr;
+
+        if (jobException)
+        {
+            auto e = jobException;
+            jobException = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    void WorkerPool::workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // Start from the generation at construction time rather than reading
+        // jobGeneration here, otherwise a worker that is slow to start
+        // would sleep through a job posted before it got the lock.
+        unsigned int seenGeneration = 0;
+        while (true)
+        {
+            workAvailable.wait(lock, [&]() { return shuttingDown || jobGeneration != seenGeneration; });
+            if (shuttingDown)
+            {
+                return;
+            }
+
+            seenGeneration = jobGeneration;
+            runJob(lock);
+        }
+    }
+
+    void WorkerPool::runJob(std::unique_lock<std::mutex>& lock)
+    {
+        while (nextIndex < jobCount)
+        {
+            auto begin = nextIndex;
+            auto end = std::min(jobCount, begin + jobGrainSize);
+            nextIndex = end;
+
+            const auto& f = *jobFunction;
+            lock.unlock();
+
+            std::exception_ptr exception;
+            try
+            {
+                for (auto i = begin; i < end; ++i)
+                {
+                    f(i);
+                }
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            lock.lock();
+            if (exception)
+            {
+                if (!jobException)
+                {
+                    jobException = exception;
+                }
+
+                // abandon any indices that haven't been claimed yet
+                remaining -= jobCount - nextIndex;
+                nextIndex = jobCount;
+            }
+
+            remaining -= end - begin;
+            if (remaining == 0)
+            {
+                workFinished.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef RWE_WORKERPOOL_H
+#define RWE_WORKERPOOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * A fixed set of worker threads for running data-parallel loops.
+     *
+     * The pool only supports one kind of job: parallelFor,
+     * which blocks the calling thread until every index has been processed.
+     * The calling thread takes part in the work,
+     * so a pool with zero workers simply runs the loop serially.
+     */
+    class WorkerPool
+    {
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable workFinished;
+
+        /** Incremented each time a new job is posted. */
+        unsigned int jobGeneration{0};
+
+        bool shuttingDown{false};
+
+        const std::function<void(std::size_t)>* jobFunction{nullptr};
+        std::size_t jobCount{0};
+        std::size_t jobGrainSize{1};
+        std::size_t nextIndex{0};
+        std::size_t remaining{0};
+        std::exception_ptr jobException;
+
+    public:
+        /**
+         * Default number of indices claimed by a thread in one go.
+         * Claiming indices in batches keeps lock traffic low
+         * when each index represents only a small amount of work.
+         */
+        static constexpr std::size_t DefaultGrainSize = 16;
+
+        /**
+         * Returns a sensible number of workers for this machine,
+         * leaving one hardware thread for the caller.
+         */
+        static unsigned int defaultWorkerCount();
+
+        explicit WorkerPool(unsigned int workerCount);
+
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        /**
+         * Invokes f(i) for every i in [0, count), spread across the pool.
+         * There are no guarantees about which thread handles which index
+         * or about the order in which indices are processed.
+         *
+         * Threads claim grainSize indices at a time.
+         * A job with no more than grainSize indices runs serially
+         * on the calling thread, so coarse jobs with only a handful
+         * of expensive indices should pass a grain size of 1.
+         *
+         * If any invocation throws, the remaining indices are abandoned
+         * and the first exception is rethrown on the calling thread.
+         */
+        void parallelFor(std::size_t count, const std::function<void(std::size_t)>& f, std::size_t grainSize = DefaultGrainSize);
+
+    private:
+        void workerLoop();
+
+        /**
+         * Processes indices from the current job until none remain.
+         * Must be called with the lock held; the lock is released while running f.
+         */
+        void runJob(std::unique_lock<std::mutex>& lock);
+    };
+}
+
+#endif
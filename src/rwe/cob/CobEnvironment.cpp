@@ -1,10 +1,74 @@
 #include "CobEnvironment.h"
+#include <algorithm>
+#include <rwe/cob/CobReadyUnits.h>
 
 namespace rwe
 {
+    enum class CobDigestEvent
+    {
+        CreateThread,
+        DeleteThread,
+        Signal,
+        Blocked,
+        Finished,
+    };
+
+    std::uint64_t hashStatic(unsigned int id, int value)
+    {
+        return hashCombine(id, static_cast<std::uint32_t>(value));
+    }
+
+    std::uint64_t hashEvent(CobDigestEvent event, std::uint64_t value)
+    {
+        return hashCombine(static_cast<std::uint64_t>(event), value);
+    }
+
+    class StatusHashVisitor : public boost::static_visitor<std::uint64_t>
+    {
+    private:
+        const CobThread* thread;
+
+    public:
+        explicit StatusHashVisitor(const CobThread* thread) : thread(thread) {}
+
+        std::uint64_t operator()(const CobEnvironment::BlockedStatus& status) const
+        {
+            return hashEvent(CobDigestEvent::Blocked, boost::apply_visitor(*this, status.condition));
+        }
+        std::uint64_t operator()(const CobEnvironment::BlockedStatus::Move& condition) const
+        {
+            return hashCombine(hashCombine(0, condition.object), static_cast<std::uint64_t>(condition.axis));
+        }
+        std::uint64_t operator()(const CobEnvironment::BlockedStatus::Turn& condition) const
+        {
+            return hashCombine(hashCombine(1, condition.object), static_cast<std::uint64_t>(condition.axis));
+        }
+        std::uint64_t operator()(const CobEnvironment::BlockedStatus::Sleep& condition) const
+        {
+            return hashCombine(2, condition.wakeUpTime.value);
+        }
+        std::uint64_t operator()(const CobEnvironment::FinishedStatus&) const
+        {
+            return hashEvent(CobDigestEvent::Finished, static_cast<std::uint32_t>(thread->returnValue));
+        }
+        std::uint64_t operator()(const CobEnvironment::SignalStatus& status) const
+        {
+            return hashEvent(CobDigestEvent::Signal, status.signal);
+        }
+    };
+
+    std::size_t getPieceWaitIndex(const PieceOperationKey& key)
+    {
+        return ((key.piece * 3) + static_cast<std::size_t>(key.axis)) * 2 + static_cast<std::size_t>(key.kind);
+    }
+
     CobEnvironment::CobEnvironment(const CobScript* script)
         : _script(script), _statics(script->staticVariableCount)
     {
+        for (unsigned int i = 0; i < _statics.size(); ++i)
+        {
+            digest.toggle(hashStatic(i, _statics[i]));
+        }
     }
 
     int CobEnvironment::getStatic(unsigned int id)
@@ -14,7 +78,21 @@ namespace rwe
 
     void CobEnvironment::setStatic(unsigned int id, int value)
     {
-        _statics.at(id) = value;
+        auto& staticValue = _statics.at(id);
+        digest.replace(hashStatic(id, staticValue), hashStatic(id, value));
+        staticValue = value;
+    }
+
+    void CobEnvironment::seedRandom(std::uint32_t seed)
+    {
+        rng.seed(seed);
+    }
+
+    std::uint32_t CobEnvironment::nextRandom()
+    {
+        auto value = static_cast<std::uint32_t>(rng());
+        digest.recordEvent(value);
+        return value;
     }
 
     const CobScript* CobEnvironment::script()
@@ -22,137 +100,254 @@ namespace rwe
         return _script;
     }
 
-    boost::optional<CobThread> CobEnvironment::createNonScheduledThread(const std::string& functionName, const std::vector<int>& params)
+    void CobEnvironment::setReadyUnits(CobReadyUnits* newReadyUnits, UnitId newUnitId)
+    {
+        readyUnits = newReadyUnits;
+        unitId = newUnitId;
+        ready = false;
+
+        // threads may have been created before the unit was added
+        if (!readyQueue.empty())
+        {
+            markReady();
+        }
+    }
+
+    void CobEnvironment::markReady()
+    {
+        if (ready || readyUnits == nullptr)
+        {
+            return;
+        }
+
+        ready = true;
+        readyUnits->add(unitId);
+    }
+
+    void CobEnvironment::clearReady()
+    {
+        ready = false;
+    }
+
+    boost::optional<CobThread> CobEnvironment::createNonScheduledThread(CobEntryPoint entryPoint, const CobThread::Params& params)
+    {
+        auto functionId = _script->getEntryPoint(entryPoint);
+        if (!functionId)
+        {
+            // silently ignore
+            return boost::none;
+        }
+
+        return createNonScheduledThread(*functionId, params);
+    }
+
+    boost::optional<CobThread> CobEnvironment::createNonScheduledThread(CobFunctionSymbol function, const CobThread::Params& params)
     {
-        auto it = std::find_if(_script->functions.begin(), _script->functions.end(), [&functionName](const auto& i) { return i.name == functionName; });
-        if (it == _script->functions.end())
+        auto functionId = _script->findFunction(function);
+        if (!functionId)
         {
             // silently ignore
             return boost::none;
         }
 
-        auto index = it - _script->functions.begin();
-        return createNonScheduledThread(index, params);
+        return createNonScheduledThread(*functionId, params);
     }
 
-    CobThread CobEnvironment::createNonScheduledThread(unsigned int functionId, const std::vector<int>& params)
+    CobThread CobEnvironment::createNonScheduledThread(unsigned int functionId, const CobThread::Params& params)
     {
         const auto& functionInfo = _script->functions.at(functionId);
-        CobThread thread(functionInfo.name);
-        thread.callStack.emplace(functionInfo.address, params);
+        CobThread thread(functionId);
+        thread.pushFunction(functionInfo.address, params);
         return thread;
     }
 
-    const CobThread* CobEnvironment::createThread(unsigned int functionId, const std::vector<int>& params, unsigned int signalMask)
+    const CobThread* CobEnvironment::createThread(unsigned int functionId, const CobThread::Params& params, unsigned int signalMask)
     {
         const auto& functionInfo = _script->functions.at(functionId);
-        auto& thread = threads.emplace_back(std::make_unique<CobThread>(functionInfo.name, signalMask));
-        thread->callStack.emplace(functionInfo.address, params);
-        readyQueue.push_back(thread.get());
-        return thread.get();
+
+        CobThread* thread;
+        if (freeThreads.empty())
+        {
+            thread = threads.emplace_back(std::make_unique<CobThread>(functionId, signalMask)).get();
+        }
+        else
+        {
+            thread = freeThreads.back();
+            freeThreads.pop_back();
+            thread->reset(functionId, signalMask);
+        }
+
+        thread->pushFunction(functionInfo.address, params);
+        readyQueue.push_back(thread);
+        markReady();
+
+        auto event = hashCombine(functionId, signalMask);
+        for (auto p : params)
+        {
+            event = hashCombine(event, static_cast<std::uint32_t>(p));
+        }
+        digest.recordEvent(hashEvent(CobDigestEvent::CreateThread, event));
+
+        return thread;
     }
 
-    const CobThread* CobEnvironment::createThread(unsigned int functionId, const std::vector<int>& params)
+    const CobThread* CobEnvironment::createThread(unsigned int functionId, const CobThread::Params& params)
     {
         return createThread(functionId, params, 0);
     }
 
-    boost::optional<const CobThread*> CobEnvironment::createThread(const std::string& functionName, const std::vector<int>& params)
+    boost::optional<const CobThread*> CobEnvironment::createThread(CobEntryPoint entryPoint, const CobThread::Params& params)
     {
-        auto it = std::find_if(_script->functions.begin(), _script->functions.end(), [&functionName](const auto& i) { return i.name == functionName; });
-        if (it == _script->functions.end())
+        auto functionId = _script->getEntryPoint(entryPoint);
+        if (!functionId)
         {
             // silently ignore
             return boost::none;
         }
 
-        auto index = it - _script->functions.begin();
-        return createThread(index, params);
+        return createThread(*functionId, params);
     }
 
-    boost::optional<const CobThread*> CobEnvironment::createThread(const std::string& functionName)
+    boost::optional<const CobThread*> CobEnvironment::createThread(CobEntryPoint entryPoint)
     {
-        return createThread(functionName, std::vector<int>());
+        return createThread(entryPoint, CobThread::Params());
     }
 
-    void CobEnvironment::deleteThread(const CobThread* thread)
+    boost::optional<const CobThread*> CobEnvironment::createThread(CobFunctionSymbol function, const CobThread::Params& params)
     {
-        auto it = std::find_if(threads.begin(), threads.end(), [thread](const auto& t) { return t.get() == thread; });
-        if (it != threads.end())
+        auto functionId = _script->findFunction(function);
+        if (!functionId)
         {
-            threads.erase(it);
+            // silently ignore
+            return boost::none;
         }
+
+        return createThread(*functionId, params);
     }
 
-    void CobEnvironment::sendSignal(unsigned int signal)
+    boost::optional<const CobThread*> CobEnvironment::createThread(CobFunctionSymbol function)
     {
-        for (auto it = threads.begin(); it != threads.end();)
-        {
-            if ((*it)->signalMask & signal)
-            {
-                // remove references to the thread
-                removeThreadFromQueues(it->get());
+        return createThread(function, CobThread::Params());
+    }
 
-                // delete the thread
-                it = threads.erase(it);
-            }
-            else
-            {
-                ++it;
-            }
+    void CobEnvironment::deleteThread(CobThread* thread)
+    {
+        if (!thread->dead)
+        {
+            digest.recordEvent(hashEvent(CobDigestEvent::DeleteThread, thread->functionId));
         }
+
+        ++thread->generation;
+        freeThreads.push_back(thread);
     }
 
-    boost::optional<int> CobEnvironment::tryReapThread(const CobThread* thread)
+    void CobEnvironment::addPieceWait(const PieceOperationKey& key, CobThread* thread)
     {
-        auto it = std::find(finishedQueue.begin(), finishedQueue.end(), thread);
-        if (it == finishedQueue.end())
+        auto index = getPieceWaitIndex(key);
+        if (index >= pieceWaits.size())
         {
-            return boost::none;
+            pieceWaits.resize(index + 1);
         }
 
-        auto val = (*it)->returnValue;
-        return val;
+        pieceWaits[index].push_back(thread);
     }
 
-    void CobEnvironment::removeThreadFromQueues(const CobThread* thread)
+    std::vector<CobThread*>* CobEnvironment::findPieceWaiters(const PieceOperationKey& key)
     {
+        auto index = getPieceWaitIndex(key);
+        if (index >= pieceWaits.size())
         {
-            auto it = std::find(readyQueue.begin(), readyQueue.end(), thread);
-            if (it != readyQueue.end())
+            return nullptr;
+        }
+
+        return &pieceWaits[index];
+    }
+
+    void CobEnvironment::sendSignal(unsigned int signal)
+    {
+        digest.recordEvent(hashEvent(CobDigestEvent::Signal, signal));
+
+        auto killIfMasked = [signal](CobThread* thread) {
+            if (thread->signalMask & signal)
             {
-                readyQueue.erase(it);
+                thread->dead = true;
             }
+        };
+
+        for (auto thread : readyQueue)
+        {
+            killIfMasked(thread);
         }
 
+        for (auto thread : finishedQueue)
         {
-            auto it = std::find_if(blockedQueue.begin(), blockedQueue.end(), [thread](const auto& pair) { return pair.second == thread; });
-            if (it != blockedQueue.end())
+            killIfMasked(thread);
+        }
+
+        auto killBlockedIfMasked = [this, signal](CobThread* thread) {
+            if (!(thread->signalMask & signal))
             {
-                blockedQueue.erase(it);
+                return false;
             }
+
+            thread->dead = true;
+            finishedQueue.push_back(thread);
+            markReady();
+            return true;
+        };
+
+        auto sleepersEnd = std::remove_if(sleepingThreads.begin(), sleepingThreads.end(), [&](const auto& pair) {
+            return killBlockedIfMasked(pair.second);
+        });
+        sleepingThreads.erase(sleepersEnd, sleepingThreads.end());
+
+        for (auto& waiters : pieceWaits)
+        {
+            waiters.erase(std::remove_if(waiters.begin(), waiters.end(), killBlockedIfMasked), waiters.end());
+        }
+    }
+
+    boost::optional<int> CobEnvironment::tryReapThread(const CobThreadHandle& handle)
+    {
+        // A stale handle's thread may have been reused,
+        // and may even have finished again, as some other run.
+        if (!handle.isCurrent())
+        {
+            return boost::none;
         }
 
+        auto it = std::find(finishedQueue.begin(), finishedQueue.end(), handle.thread);
+        if (it == finishedQueue.end() || (*it)->dead)
         {
-            auto it = std::find(finishedQueue.begin(), finishedQueue.end(), thread);
-            if (it != finishedQueue.end())
-            {
-                finishedQueue.erase(it);
-            }
+            return boost::none;
         }
+
+        auto val = (*it)->returnValue;
+        return val;
+    }
+
+    void CobEnvironment::recordThreadStatus(const CobThread& thread, const Status& status)
+    {
+        digest.recordEvent(boost::apply_visitor(StatusHashVisitor(&thread), status));
     }
 
     bool CobEnvironment::isNotCorrupt() const
     {
-        auto sizes = readyQueue.size() + blockedQueue.size() + finishedQueue.size();
-        if (sizes != threads.size())
+        auto sizes = readyQueue.size() + finishedQueue.size() + sleepingThreads.size();
+        for (const auto& waiters : pieceWaits)
+        {
+            sizes += waiters.size();
+        }
+
+        if (sizes + freeThreads.size() != threads.size())
         {
             return false;
         }
 
         for (const auto& ptr : threads)
         {
-            if (!isPresentInAQueue(ptr.get()))
+            auto isFree = std::find(freeThreads.begin(), freeThreads.end(), ptr.get()) != freeThreads.end();
+            if (isFree == isPresentInAQueue(ptr.get()))
             {
                 return false;
             }
@@ -172,8 +367,17 @@ namespace rwe
         }
 
         {
-            auto it = std::find_if(blockedQueue.begin(), blockedQueue.end(), [thread](const auto& pair) { return pair.second == thread; });
-            if (it != blockedQueue.end())
+            auto it = std::find_if(sleepingThreads.begin(), sleepingThreads.end(), [thread](const auto& pair) { return pair.second == thread; });
+            if (it != sleepingThreads.end())
+            {
+                return true;
+            }
+        }
+
+        for (const auto& waiters : pieceWaits)
+        {
+            auto it = std::find(waiters.begin(), waiters.end(), thread);
+            if (it != waiters.end())
             {
                 return true;
             }
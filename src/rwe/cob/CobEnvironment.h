@@ -2,9 +2,13 @@
 #define RWE_COBENVIRONMENT_H
 
 #include <boost/variant.hpp>
+#include <deque>
 #include <memory>
+#include <random>
 #include <rwe/Cob.h>
 #include <rwe/GameTime.h>
+#include <rwe/PieceOperationKey.h>
+#include <rwe/StateDigest.h>
 #include <rwe/UnitId.h>
 #include <rwe/cob/CobThread.h>
 #include <vector>
@@ -12,6 +16,7 @@
 
 namespace rwe
 {
+    class CobReadyUnits;
     class GameScene;
 
     class CobEnvironment
@@ -76,12 +81,72 @@ namespace rwe
 
         std::vector<int> _statics;
 
+        /**
+         * Every thread the environment has made,
+         * including those in freeThreads waiting to be reused.
+         */
         std::vector<std::unique_ptr<CobThread>> threads;
 
+        std::vector<CobThread*> freeThreads;
+
         std::deque<CobThread*> readyQueue;
-        std::deque<std::pair<BlockedStatus, CobThread*>> blockedQueue;
         std::deque<CobThread*> finishedQueue;
 
+        /** Threads blocked in a sleep, with the time they are due to wake up. */
+        std::deque<std::pair<GameTime, CobThread*>> sleepingThreads;
+
+        /**
+         * Set by the cob execution service when one of the sleeping threads
+         * is due to wake up, so they need to be checked
+         * the next time the environment is run.
+         */
+        bool sleepersDue{false};
+
+        /**
+         * Piece operations that may have ended without the mesh recording it,
+         * because they were already over when a thread started waiting on them.
+         * The threads waiting on these are checked the next time the environment is run.
+         */
+        std::vector<PieceOperationKey> pieceWaitChecks;
+
+        /** The block sequence to give the next thread that blocks. */
+        std::uint64_t nextBlockSequence{0};
+
+        /**
+         * Scratch space for the blocked threads woken during a run,
+         * gathered so that they can be put back into the order they blocked in.
+         */
+        std::vector<CobThread*> wokenThreads;
+
+    private:
+        /**
+         * Threads blocked until a piece's move or turn ends,
+         * in the order they started waiting,
+         * with a list for each operation of each piece.
+         * Lists are made the first time anything waits on their operation.
+         */
+        std::vector<std::vector<CobThread*>> pieceWaits;
+
+    public:
+
+        /**
+         * Covers the values of the statics
+         * and the lifecycle of every scheduled thread:
+         * creation, the status it reported each time it ran,
+         * signals and deletion.
+         */
+        StateDigest digest;
+
+    private:
+        std::minstd_rand rng;
+
+        /** Where the environment reports that its unit has work to do. */
+        CobReadyUnits* readyUnits{nullptr};
+        UnitId unitId{0};
+
+        /** True from when the unit is added to readyUnits until its scripts have run. */
+        bool ready{false};
+
     public:
         explicit CobEnvironment(const CobScript* _script);
 
@@ -95,26 +160,83 @@ namespace rwe
 
         void setStatic(unsigned int id, int value);
 
+        void seedRandom(std::uint32_t seed);
+
+        /**
+         * Returns the next value from the environment's random number generator.
+         * The sequence is fully determined by the seed.
+         */
+        std::uint32_t nextRandom();
+
         const CobScript* script();
 
-        boost::optional<CobThread> createNonScheduledThread(const std::string& functionName, const std::vector<int>& params);
+        /**
+         * Tells the environment which unit it belongs to
+         * and where to report that the unit's scripts have work to do.
+         * Called when the unit is added to the simulation.
+         */
+        void setReadyUnits(CobReadyUnits* newReadyUnits, UnitId newUnitId);
+
+        /**
+         * Adds the unit to the ready units, unless it is already there,
+         * so that its scripts are run the next time scripts are run.
+         * This is done automatically when a thread is created or killed.
+         * Different environments may be marked ready from different threads at once.
+         */
+        void markReady();
+
+        /**
+         * Notes that the unit's scripts have been run,
+         * so it may be marked ready again.
+         */
+        void clearReady();
+
+        boost::optional<CobThread> createNonScheduledThread(CobEntryPoint entryPoint, const CobThread::Params& params);
+
+        boost::optional<CobThread> createNonScheduledThread(CobFunctionSymbol function, const CobThread::Params& params);
+
+        CobThread createNonScheduledThread(unsigned int functionId, const CobThread::Params& params);
 
-        CobThread createNonScheduledThread(unsigned int functionId, const std::vector<int>& params);
+        /** Creates a thread, reusing a deleted one if there is one. */
+        const CobThread* createThread(unsigned int functionId, const CobThread::Params& params, unsigned int signalMask);
 
-        const CobThread* createThread(unsigned int functionId, const std::vector<int>& params, unsigned int signalMask);
+        const CobThread* createThread(unsigned int functionId, const CobThread::Params& params);
 
-        const CobThread* createThread(unsigned int functionId, const std::vector<int>& params);
+        boost::optional<const CobThread*> createThread(CobEntryPoint entryPoint, const CobThread::Params& params);
 
-        boost::optional<const CobThread*> createThread(const std::string& functionName, const std::vector<int>& params);
+        boost::optional<const CobThread*> createThread(CobEntryPoint entryPoint);
 
-        boost::optional<const CobThread*> createThread(const std::string& functionName);
+        boost::optional<const CobThread*> createThread(CobFunctionSymbol function, const CobThread::Params& params);
 
-        void deleteThread(const CobThread* thread);
+        boost::optional<const CobThread*> createThread(CobFunctionSymbol function);
+
+        /**
+         * Returns a thread that has been taken out of its queue
+         * to be reused by a later thread.
+         * Threads that weren't killed are recorded in the digest as deleted.
+         */
+        void deleteThread(CobThread* thread);
+
+        /**
+         * Blocks the thread until the operation ends.
+         */
+        void addPieceWait(const PieceOperationKey& key, CobThread* thread);
+
+        /**
+         * Returns the threads waiting on the operation,
+         * or null if nothing has ever waited on it.
+         */
+        std::vector<CobThread*>* findPieceWaiters(const PieceOperationKey& key);
 
         /**
          * Sends a signal to all threads.
+         * The unit is marked ready if a blocked thread is killed.
          * If the signal is non-zero after being ANDed
          * with the thread's signal mask, the thread is killed.
+         * Killed threads are marked dead, and deleted
+         * when their queue is next worked through.
+         * Blocked threads that are killed are moved to the finished queue,
+         * so they are deleted without waiting to be woken.
          */
         void sendSignal(unsigned int signal);
 
@@ -125,14 +247,19 @@ namespace rwe
          * If the return value is not collected,
          * the cob execution service will clean up the thread
          * next frame.
+         * Nothing is reaped through a handle
+         * to a thread that has since been deleted.
+         */
+        boost::optional<int> tryReapThread(const CobThreadHandle& handle);
+
+        /**
+         * Records the status a thread reported after running in the digest.
          */
-        boost::optional<int> tryReapThread(const CobThread* thread);
+        void recordThreadStatus(const CobThread& thread, const Status& status);
 
         bool isNotCorrupt() const;
 
     private:
-        void removeThreadFromQueues(const CobThread* thread);
-
         bool isPresentInAQueue(const CobThread* thread) const;
     };
 }
@@ -1,6 +1,6 @@
 #include "CobConstants.h"
 #include "CobExecutionContext.h"
-#include "CobOpCode.h"
+#include "CobInstruction.h"
 #include <rwe/SceneManager.h>
 
 namespace rwe
@@ -13,200 +13,237 @@ namespace rwe
     {
     }
 
+    static float toPosition(int value)
+    {
+        return static_cast<float>(value) / 163840.0f;
+    }
+
+    static float toSpeed(int value)
+    {
+        return static_cast<float>(static_cast<unsigned int>(value)) / 163840.0f;
+    }
+
+    static float toAngularSpeed(int value)
+    {
+        return static_cast<float>(static_cast<unsigned int>(value)) / 182.0f;
+    }
+
     CobEnvironment::Status CobExecutionContext::execute()
     {
+        const auto& code = env->script()->code;
+
         while (!thread->callStack.empty())
         {
-            auto instruction = nextInstruction();
-            switch (static_cast<OpCode>(instruction))
+            auto& instructionIndex = thread->callStack.top().instructionIndex;
+            if (instructionIndex >= code.size())
+            {
+                throw std::out_of_range("Cob thread ran past the end of the script");
+            }
+
+            // Step past the instruction before running it,
+            // so that jumps and calls can set where to go next.
+            const auto& instruction = code[instructionIndex];
+            instructionIndex += instruction.length;
+
+            const auto& operands = instruction.operands;
+            switch (instruction.op)
             {
-                case OpCode::RAND:
+                case CobOp::UnsupportedOpCode:
+                    throw std::runtime_error("Unsupported opcode " + std::to_string(operands[0]));
+                case CobOp::InvalidAxis:
+                    throw std::runtime_error("Invalid axis: " + std::to_string(operands[0]));
+                case CobOp::Truncated:
+                    throw std::out_of_range("Cob instruction runs past the end of the script");
+
+                case CobOp::Rand:
                     randomNumber();
                     break;
 
-                case OpCode::ADD:
+                case CobOp::Add:
                     add();
                     break;
-                case OpCode::SUB:
+                case CobOp::Subtract:
                     subtract();
                     break;
-                case OpCode::MUL:
+                case CobOp::Multiply:
                     multiply();
                     break;
-                case OpCode::DIV:
+                case CobOp::Divide:
                     divide();
                     break;
 
-                case OpCode::SET_LESS:
+                case CobOp::SetLess:
                     compareLessThan();
                     break;
-                case OpCode::SET_LESS_OR_EQUAL:
+                case CobOp::SetLessOrEqual:
                     compareLessThanOrEqual();
                     break;
-                case OpCode::SET_EQUAL:
+                case CobOp::SetEqual:
                     compareEqual();
                     break;
-                case OpCode::SET_NOT_EQUAL:
+                case CobOp::SetNotEqual:
                     compareNotEqual();
                     break;
-                case OpCode::SET_GREATER:
+                case CobOp::SetGreater:
                     compareGreaterThan();
                     break;
-                case OpCode::SET_GREATER_OR_EQUAL:
+                case CobOp::SetGreaterOrEqual:
                     compareGreaterThanOrEqual();
                     break;
 
-                case OpCode::JUMP:
-                    jump();
+                case CobOp::Jump:
+                    jump(operands[0]);
                     break;
-                case OpCode::JUMP_NOT_EQUAL:
-                    jumpIfZero();
+                case CobOp::JumpIfZero:
+                    jumpIfZero(operands[0]);
                     break;
 
-                case OpCode::LOGICAL_AND:
+                case CobOp::LogicalAnd:
                     logicalAnd();
                     break;
-                case OpCode::LOGICAL_OR:
+                case CobOp::LogicalOr:
                     logicalOr();
                     break;
-                case OpCode::LOGICAL_XOR:
+                case CobOp::LogicalXor:
                     logicalXor();
                     break;
-                case OpCode::LOGICAL_NOT:
+                case CobOp::LogicalNot:
                     logicalNot();
                     break;
 
-                case OpCode::BITWISE_AND:
+                case CobOp::BitwiseAnd:
                     bitwiseAnd();
                     break;
-                case OpCode::BITWISE_OR:
+                case CobOp::BitwiseOr:
                     bitwiseOr();
                     break;
-                case OpCode::BITWISE_XOR:
+                case CobOp::BitwiseXor:
                     bitwiseXor();
                     break;
-                case OpCode::BITWISE_NOT:
+                case CobOp::BitwiseNot:
                     bitwiseNot();
                     break;
 
-                case OpCode::MOVE:
-                    moveObject();
+                case CobOp::Move:
+                {
+                    auto position = pop();
+                    auto speed = pop();
+                    moveObject(operands[0], static_cast<Axis>(operands[1]), position, speed);
                     break;
-                case OpCode::MOVE_NOW:
-                    moveObjectNow();
+                }
+                case CobOp::MoveNow:
+                    moveObjectNow(operands[0], static_cast<Axis>(operands[1]), pop());
                     break;
-                case OpCode::TURN:
-                    turnObject();
+                case CobOp::Turn:
+                {
+                    auto angle = pop();
+                    auto speed = pop();
+                    turnObject(operands[0], static_cast<Axis>(operands[1]), angle, speed);
                     break;
-                case OpCode::TURN_NOW:
-                    turnObjectNow();
+                }
+                case CobOp::TurnNow:
+                    turnObjectNow(operands[0], static_cast<Axis>(operands[1]), pop());
                     break;
-                case OpCode::SPIN:
-                    spinObject();
+                case CobOp::Spin:
+                    spinObject(operands[0], operands[1]);
                     break;
-                case OpCode::STOP_SPIN:
-                    stopSpinObject();
+                case CobOp::StopSpin:
+                    stopSpinObject(operands[0], operands[1]);
                     break;
-                case OpCode::EXPLODE:
-                    explode();
+                case CobOp::Explode:
+                    explode(operands[0]);
                     break;
-                case OpCode::EMIT_SFX:
-                    emitSmoke();
+                case CobOp::EmitSfx:
+                    emitSmoke(operands[0]);
                     break;
-                case OpCode::SHOW:
-                    showObject();
+                case CobOp::Show:
+                    showObject(operands[0]);
                     break;
-                case OpCode::HIDE:
-                    hideObject();
+                case CobOp::Hide:
+                    hideObject(operands[0]);
                     break;
-                case OpCode::SHADE:
-                    enableShading();
+                case CobOp::Shade:
+                    enableShading(operands[0]);
                     break;
-                case OpCode::DONT_SHADE:
-                    disableShading();
+                case CobOp::DontShade:
+                    disableShading(operands[0]);
                     break;
-                case OpCode::CACHE:
-                    enableCaching();
+                case CobOp::Cache:
+                    enableCaching(operands[0]);
                     break;
-                case OpCode::DONT_CACHE:
-                    disableCaching();
+                case CobOp::DontCache:
+                    disableCaching(operands[0]);
                     break;
-                case OpCode::ATTACH_UNIT:
+                case CobOp::AttachUnit:
                     attachUnit();
                     break;
-                case OpCode::DROP_UNIT:
+                case CobOp::DropUnit:
                     detachUnit();
                     break;
 
-                case OpCode::WAIT_FOR_MOVE:
-                {
-                    auto object = nextInstruction();
-                    auto axis = nextInstructionAsAxis();
-
-                    return CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Move(object, axis));
-                }
-                case OpCode::WAIT_FOR_TURN:
-                {
-                    auto object = nextInstruction();
-                    auto axis = nextInstructionAsAxis();
-
-                    return CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Turn(object, axis));
-                }
-                case OpCode::SLEEP:
-                {
-                    auto duration = pop();
-
-                    auto ticksToWait = GameTimeDelta(duration / SceneManager::TickInterval);
-                    auto currentTime = sim->gameTime;
+                case CobOp::WaitForMove:
+                    return CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Move(operands[0], static_cast<Axis>(operands[1])));
+                case CobOp::WaitForTurn:
+                    return CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Turn(operands[0], static_cast<Axis>(operands[1])));
+                case CobOp::Sleep:
+                    return sleep(pop());
 
-                    return CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Sleep(currentTime + ticksToWait));
-                }
-
-                case OpCode::CALL_SCRIPT:
-                    callScript();
+                case CobOp::CallScript:
+                    callScript(operands[0], operands[1]);
                     break;
-                case OpCode::RETURN:
+                case CobOp::Return:
                     returnFromScript();
                     break;
-                case OpCode::START_SCRIPT:
-                    startScript();
+                case CobOp::StartScript:
+                    startScript(operands[0], operands[1]);
                     break;
 
-                case OpCode::SIGNAL:
-                    sendSignal();
-                    break;
-                case OpCode::SET_SIGNAL_MASK:
+                case CobOp::Signal:
+                    return sendSignal();
+                case CobOp::SetSignalMask:
                     setSignalMask();
                     break;
 
-                case OpCode::CREATE_LOCAL_VAR:
+                case CobOp::CreateLocalVar:
                     createLocalVariable();
                     break;
-                case OpCode::PUSH_CONSTANT:
-                    pushConstant();
+                case CobOp::PushConstant:
+                    push(static_cast<int>(operands[0]));
                     break;
-                case OpCode::PUSH_LOCAL_VAR:
-                    pushLocalVariable();
+                case CobOp::PushLocalVar:
+                    pushLocalVariable(operands[0]);
                     break;
-                case OpCode::POP_LOCAL_VAR:
-                    popLocalVariable();
+                case CobOp::PopLocalVar:
+                    popLocalVariable(operands[0]);
                     break;
-                case OpCode::PUSH_STATIC:
-                    pushStaticVariable();
+                case CobOp::PushStatic:
+                    pushStaticVariable(operands[0]);
                     break;
-                case OpCode::POP_STATIC:
-                    popStaticVariable();
+                case CobOp::PopStatic:
+                    popStaticVariable(operands[0]);
                     break;
-                case OpCode::POP_STACK:
+                case CobOp::PopStack:
                     popStackOperation();
                     break;
 
-                case OpCode::GET_UNIT_VALUE:
+                case CobOp::GetUnitValue:
                     getUnitValue();
                     break;
 
-                default:
-                    throw std::runtime_error("Unsupported opcode " + std::to_string(instruction));
+                case CobOp::MoveConstant:
+                    moveObject(operands[0], static_cast<Axis>(operands[1]), static_cast<int>(operands[2]), static_cast<int>(operands[3]));
+                    break;
+                case CobOp::MoveNowConstant:
+                    moveObjectNow(operands[0], static_cast<Axis>(operands[1]), static_cast<int>(operands[2]));
+                    break;
+                case CobOp::TurnConstant:
+                    turnObject(operands[0], static_cast<Axis>(operands[1]), static_cast<int>(operands[2]), static_cast<int>(operands[3]));
+                    break;
+                case CobOp::TurnNowConstant:
+                    turnObjectNow(operands[0], static_cast<Axis>(operands[1]), static_cast<int>(operands[2]));
+                    break;
+                case CobOp::SleepConstant:
+                    return sleep(static_cast<int>(operands[0]));
             }
         }
 
@@ -218,9 +255,13 @@ namespace rwe
         auto high = pop();
         auto low = pop();
         auto range = high - low;
+        if (range <= 0)
+        {
+            push(low);
+            return;
+        }
 
-        // FIXME: replace with deterministic RNG source
-        auto value = (std::rand() % range) + low;
+        auto value = static_cast<int>(env->nextRandom() % static_cast<unsigned int>(range)) + low;
         push(value);
     }
 
@@ -294,19 +335,17 @@ namespace rwe
         push(a >= b ? CobTrue : CobFalse);
     }
 
-    void CobExecutionContext::jump()
+    void CobExecutionContext::jump(unsigned int target)
     {
-        auto jumpOffset = nextInstruction();
-        thread->callStack.top().instructionIndex = jumpOffset;
+        thread->callStack.top().instructionIndex = target;
     }
 
-    void CobExecutionContext::jumpIfZero()
+    void CobExecutionContext::jumpIfZero(unsigned int target)
     {
-        auto jumpOffset = nextInstruction();
         auto value = pop();
         if (value == 0)
         {
-            thread->callStack.top().instructionIndex = jumpOffset;
+            thread->callStack.top().instructionIndex = target;
         }
     }
 
@@ -364,112 +403,93 @@ namespace rwe
         push(~v);
     }
 
-    void CobExecutionContext::moveObject()
+    void CobExecutionContext::moveObject(unsigned int object, Axis axis, int position, int speed)
     {
-        auto object = nextInstruction();
-        auto axis = nextInstructionAsAxis();
-        auto position = popPosition();
+        auto worldPosition = toPosition(position);
 
         // For some reason this seems to be flipped,
         // unsure why.
         if (axis == Axis::Z)
         {
-            position = -position;
+            worldPosition = -worldPosition;
         }
 
-        auto speed = popSpeed();
-        sim->moveObject(unitId, getObjectName(object), axis, position, speed);
+        // This goes straight to the unit, rather than through the simulation,
+        // so that scripts of different units can run at the same time.
+        // The cob execution service notices if the unit starts animating.
+        sim->getUnit(unitId).moveObject(object, axis, worldPosition, toSpeed(speed));
     }
 
-    void CobExecutionContext::moveObjectNow()
+    void CobExecutionContext::moveObjectNow(unsigned int object, Axis axis, int position)
     {
-        auto object = nextInstruction();
-        auto axis = nextInstructionAsAxis();
-        auto position = popPosition();
-        sim->moveObjectNow(unitId, getObjectName(object), axis, position);
+        // See moveObject.
+        sim->getUnit(unitId).moveObjectNow(object, axis, toPosition(position));
     }
 
-    void CobExecutionContext::turnObject()
+    void CobExecutionContext::turnObject(unsigned int object, Axis axis, int angle, int speed)
     {
-        auto object = nextInstruction();
-        auto axis = nextInstructionAsAxis();
-        auto angle = popAngle();
-        auto speed = popAngularSpeed();
-        sim->turnObject(unitId, getObjectName(object), axis, toRadians(angle), speed);
+        // See moveObject.
+        sim->getUnit(unitId).turnObject(object, axis, toRadians(TaAngle(angle)), toAngularSpeed(speed));
     }
 
-    void CobExecutionContext::turnObjectNow()
+    void CobExecutionContext::turnObjectNow(unsigned int object, Axis axis, int angle)
     {
-        auto object = nextInstruction();
-        auto axis = nextInstructionAsAxis();
-        auto angle = popAngle();
-        sim->turnObjectNow(unitId, getObjectName(object), axis, toRadians(angle));
+        // See moveObject.
+        sim->getUnit(unitId).turnObjectNow(object, axis, toRadians(TaAngle(angle)));
     }
 
-    void CobExecutionContext::spinObject()
+    void CobExecutionContext::spinObject(unsigned int object, unsigned int axis)
     {
-        auto object = nextInstruction();
-        auto axis = nextInstruction();
         auto targetSpeed = pop();
         auto acceleration = pop();
         // TODO: this
     }
 
-    void CobExecutionContext::stopSpinObject()
+    void CobExecutionContext::stopSpinObject(unsigned int object, unsigned int axis)
     {
-        auto object = nextInstruction();
-        auto axis = nextInstruction();
         auto deceleration = pop();
         // TODO: this
     }
 
-    void CobExecutionContext::explode()
+    void CobExecutionContext::explode(unsigned int object)
     {
-        auto object = nextInstruction();
         auto explosionType = pop();
         // TODO: this
     }
 
-    void CobExecutionContext::emitSmoke()
+    void CobExecutionContext::emitSmoke(unsigned int piece)
     {
-        auto piece = nextInstruction();
         auto smokeType = pop();
         // TODO: this
     }
 
-    void CobExecutionContext::showObject()
+    void CobExecutionContext::showObject(unsigned int object)
     {
-        auto object = nextInstruction();
-        sim->showObject(unitId, getObjectName(object));
+        sim->showObject(unitId, object);
     }
 
-    void CobExecutionContext::hideObject()
+    void CobExecutionContext::hideObject(unsigned int object)
     {
-        auto object = nextInstruction();
-        sim->hideObject(unitId, getObjectName(object));
+        sim->hideObject(unitId, object);
     }
 
-    void CobExecutionContext::enableShading()
+    void CobExecutionContext::enableShading(unsigned int object)
     {
-        auto object = nextInstruction();
         // TODO: this
     }
 
-    void CobExecutionContext::disableShading()
+    void CobExecutionContext::disableShading(unsigned int object)
     {
-        auto object = nextInstruction();
         // TODO: this
     }
 
-    void CobExecutionContext::enableCaching()
+    void CobExecutionContext::enableCaching(unsigned int object)
     {
-        auto object = nextInstruction();
         // TODO: this
     }
 
-    void CobExecutionContext::disableCaching()
+    void CobExecutionContext::disableCaching(unsigned int object)
     {
-        auto object = nextInstruction();
         // TODO: this
     }
 
@@ -486,92 +506,87 @@ namespace rwe
         // TODO: this
     }
 
+    CobEnvironment::Status CobExecutionContext::sleep(int duration)
+    {
+        auto ticksToWait = GameTimeDelta(duration / SceneManager::TickInterval);
+        auto currentTime = sim->gameTime;
+
+        return CobEnvironment::BlockedStatus(CobEnvironment::BlockedStatus::Sleep(currentTime + ticksToWait));
+    }
+
     void CobExecutionContext::returnFromScript()
     {
         thread->returnValue = pop();
-        thread->returnLocals = thread->callStack.top().locals;
-        thread->callStack.pop();
+        thread->popFunction();
     }
 
-    void CobExecutionContext::callScript()
+    void CobExecutionContext::callScript(unsigned int functionId, unsigned int paramCount)
     {
-        auto functionId = nextInstruction();
-        auto paramCount = nextInstruction();
-
         // collect up the parameters
-        std::vector<int> params(paramCount);
+        CobThread::Params params;
         for (unsigned int i = 0; i < paramCount; ++i)
         {
-            params[i] = pop();
+            params.push(pop());
         }
 
         const auto& functionInfo = env->script()->functions.at(functionId);
-        thread->callStack.emplace(functionInfo.address, params);
+        thread->pushFunction(functionInfo.address, params);
     }
 
-    void CobExecutionContext::startScript()
+    void CobExecutionContext::startScript(unsigned int functionId, unsigned int paramCount)
     {
-        auto functionId = nextInstruction();
-        auto paramCount = nextInstruction();
-
-        std::vector<int> params(paramCount);
+        CobThread::Params params;
         for (unsigned int i = 0; i < paramCount; ++i)
         {
-            params[i] = pop();
+            params.push(pop());
         }
 
         env->createThread(functionId, params, thread->signalMask);
     }
 
-    void CobExecutionContext::sendSignal()
+    CobEnvironment::Status CobExecutionContext::sendSignal()
     {
-        auto signal = popSignal();
-        env->sendSignal(signal);
+        // The signal may kill this thread,
+        // so it stops running before the signal is sent.
+        auto signal = static_cast<unsigned int>(pop());
+        return CobEnvironment::SignalStatus{signal};
     }
 
     void CobExecutionContext::setSignalMask()
     {
-        auto mask = popSignalMask();
+        auto mask = static_cast<unsigned int>(pop());
         thread->signalMask = mask;
     }
 
     void CobExecutionContext::createLocalVariable()
     {
-        if (thread->callStack.top().localCount == thread->callStack.top().locals.size())
+        auto& function = thread->callStack.top();
+        if (function.localCount == function.localsSize)
         {
-            thread->callStack.top().locals.emplace_back();
+            thread->locals.push(0);
+            function.localsSize += 1;
         }
-        thread->callStack.top().localCount += 1;
+        function.localCount += 1;
     }
 
-    void CobExecutionContext::pushConstant()
+    void CobExecutionContext::pushLocalVariable(unsigned int variableId)
     {
-        auto constant = nextInstruction();
-        push(constant);
+        push(getLocal(variableId));
     }
 
-    void CobExecutionContext::pushLocalVariable()
+    void CobExecutionContext::popLocalVariable(unsigned int variableId)
     {
-        auto variableId = nextInstruction();
-        push(thread->callStack.top().locals.at(variableId));
-    }
-
-    void CobExecutionContext::popLocalVariable()
-    {
-        auto variableId = nextInstruction();
         auto value = pop();
-        thread->callStack.top().locals.at(variableId) = value;
+        getLocal(variableId) = value;
     }
 
-    void CobExecutionContext::pushStaticVariable()
+    void CobExecutionContext::pushStaticVariable(unsigned int variableId)
     {
-        auto variableId = nextInstruction();
         push(env->getStatic(variableId));
     }
 
-    void CobExecutionContext::popStaticVariable()
+    void CobExecutionContext::popStaticVariable(unsigned int variableId)
     {
-        auto variableId = nextInstruction();
         auto value = pop();
         env->setStatic(variableId, value);
     }
@@ -597,42 +612,7 @@ namespace rwe
 
     int CobExecutionContext::pop()
     {
-        auto v = thread->stack.top();
-        thread->stack.pop();
-        return v;
-    }
-
-    float CobExecutionContext::popPosition()
-    {
-        auto val = pop();
-        return static_cast<float>(val) / 163840.0f;
-    }
-
-    float CobExecutionContext::popSpeed()
-    {
-        auto val = static_cast<unsigned int>(pop());
-        return static_cast<float>(val) / 163840.0f;
-    }
-
-    TaAngle CobExecutionContext::popAngle()
-    {
-        return TaAngle(pop());
-    }
-
-    float CobExecutionContext::popAngularSpeed()
-    {
-        auto val = static_cast<unsigned int>(pop());
-        return static_cast<float>(val) / 182.0f;
-    }
-
-    unsigned int CobExecutionContext::popSignal()
-    {
-        return static_cast<unsigned int>(pop());
-    }
-
-    unsigned int CobExecutionContext::popSignalMask()
-    {
-        return static_cast<unsigned int>(pop());
+        return thread->stack.pop();
     }
 
     void CobExecutionContext::push(int val)
@@ -640,29 +620,14 @@ namespace rwe
         thread->stack.push(val);
     }
 
-    Axis CobExecutionContext::nextInstructionAsAxis()
+    int& CobExecutionContext::getLocal(unsigned int variableId)
     {
-        auto val = nextInstruction();
-        switch (val)
+        const auto& function = thread->callStack.top();
+        if (variableId >= function.localsSize)
         {
-            case 0:
-                return Axis::X;
-            case 1:
-                return Axis::Y;
-            case 2:
-                return Axis::Z;
-            default:
-                throw std::runtime_error("Invalid axis: " + std::to_string(val));
+            throw std::out_of_range("Invalid local variable: " + std::to_string(variableId));
         }
-    }
 
-    unsigned int CobExecutionContext::nextInstruction()
-    {
-        return env->script()->instructions.at(thread->callStack.top().instructionIndex++);
-    }
-
-    const std::string& CobExecutionContext::getObjectName(unsigned int objectId)
-    {
-        return env->_script->pieces.at(objectId);
+        return thread->locals[function.localsBase + variableId];
     }
 }
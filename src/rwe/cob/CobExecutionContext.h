@@ -46,9 +46,9 @@ namespace rwe
         void compareGreaterThanOrEqual();
 
         // control flow
-        void jump();
+        void jump(unsigned int target);
 
-        void jumpIfZero();
+        void jumpIfZero(unsigned int target);
 
         // boolean logic
         void logicalAnd();
@@ -69,62 +69,63 @@ namespace rwe
         void bitwiseNot();
 
         // control object pieces
-        void moveObject();
+        void moveObject(unsigned int object, Axis axis, int position, int speed);
 
-        void moveObjectNow();
+        void moveObjectNow(unsigned int object, Axis axis, int position);
 
-        void turnObject();
+        void turnObject(unsigned int object, Axis axis, int angle, int speed);
 
-        void turnObjectNow();
+        void turnObjectNow(unsigned int object, Axis axis, int angle);
 
-        void spinObject();
+        void spinObject(unsigned int object, unsigned int axis);
 
-        void stopSpinObject();
+        void stopSpinObject(unsigned int object, unsigned int axis);
 
-        void explode();
+        void explode(unsigned int object);
 
-        void emitSmoke();
+        void emitSmoke(unsigned int piece);
 
-        void showObject();
+        void showObject(unsigned int object);
 
-        void hideObject();
+        void hideObject(unsigned int object);
 
-        void enableShading();
+        void enableShading(unsigned int object);
 
-        void disableShading();
+        void disableShading(unsigned int object);
 
-        void enableCaching();
+        void enableCaching(unsigned int object);
 
-        void disableCaching();
+        void disableCaching(unsigned int object);
 
         void attachUnit();
 
         void detachUnit();
 
+        // blocking
+        CobEnvironment::Status sleep(int duration);
+
         // script dispatch and return
         void returnFromScript();
 
-        void callScript();
+        void callScript(unsigned int functionId, unsigned int paramCount);
 
-        void startScript();
+        void startScript(unsigned int functionId, unsigned int paramCount);
 
         // signalling
-        void sendSignal();
+        CobEnvironment::Status sendSignal();
 
         void setSignalMask();
 
         // variables
         void createLocalVariable();
 
-        void pushConstant();
-
-        void pushLocalVariable();
+        void pushLocalVariable(unsigned int variableId);
 
-        void popLocalVariable();
+        void popLocalVariable(unsigned int variableId);
 
-        void pushStaticVariable();
+        void pushStaticVariable(unsigned int variableId);
 
-        void popStaticVariable();
+        void popStaticVariable(unsigned int variableId);
 
         void popStackOperation();
 
@@ -135,18 +136,9 @@ namespace rwe
         // non-commands
         int pop();
 
-        float popPosition();
-        float popSpeed();
-        TaAngle popAngle();
-        float popAngularSpeed();
-        unsigned int popSignal();
-        unsigned int popSignalMask();
         void push(int val);
 
-        unsigned int nextInstruction();
-        Axis nextInstructionAsAxis();
-
-        const std::string& getObjectName(unsigned int objectId);
+        int& getLocal(unsigned int variableId);
     };
 }
 
@@ -1,53 +1,76 @@
 #include "CobExecutionContext.h"
 #include "CobExecutionService.h"
+#include <algorithm>
 
 namespace rwe
 {
-    class BlockCheckVisitor : public boost::static_visitor<bool>
+    /**
+     * Parks a newly blocked thread where it will be found again
+     * once its condition might have been met.
+     */
+    class BlockScheduleVisitor : public boost::static_visitor<>
     {
     private:
-        GameSimulation* simulation;
-        CobEnvironment* env;
-        UnitId unitId;
+        const Unit* const unit;
+        CobEnvironment* const env;
+        CobThread* const thread;
+        CobEffects* const effects;
 
     public:
-        BlockCheckVisitor(GameSimulation* simulation, CobEnvironment* env, UnitId unitId)
-            : simulation(simulation), env(env), unitId(unitId)
+        BlockScheduleVisitor(const Unit* unit, CobEnvironment* env, CobThread* thread, CobEffects* effects)
+            : unit(unit), env(env), thread(thread), effects(effects)
         {
         }
 
-        bool operator()(const CobEnvironment::BlockedStatus::Move& condition) const
+        void operator()(const CobEnvironment::BlockedStatus::Move& condition) const
         {
-            const auto& pieceName = env->_script->pieces.at(condition.object);
-            return !simulation->isPieceMoving(unitId, pieceName, condition.axis);
+            waitForPiece(condition.object, condition.axis, PieceOperationKey::Kind::Move);
         }
 
-        bool operator()(const CobEnvironment::BlockedStatus::Turn& condition) const
+        void operator()(const CobEnvironment::BlockedStatus::Turn& condition) const
         {
-            const auto& pieceName = env->_script->pieces.at(condition.object);
-            return !simulation->isPieceTurning(unitId, pieceName, condition.axis);
+            waitForPiece(condition.object, condition.axis, PieceOperationKey::Kind::Turn);
         }
 
-        bool operator()(const CobEnvironment::BlockedStatus::Sleep& condition) const
+        void operator()(const CobEnvironment::BlockedStatus::Sleep& condition) const
         {
-            return simulation->gameTime >= condition.wakeUpTime;
+            env->sleepingThreads.emplace_back(condition.wakeUpTime, thread);
+            effects->sleepWakeUps.push_back(condition.wakeUpTime);
+        }
+
+    private:
+        void waitForPiece(unsigned int objectId, Axis axis, PieceOperationKey::Kind kind) const
+        {
+            PieceOperationKey key(unit->getScriptPieceIndex(objectId), axis, kind);
+            env->addPieceWait(key, thread);
+
+            // A piece already at rest will never report the operation ending,
+            // so the wait is checked on the next run instead.
+            if (!unit->mesh.pieces[key.piece].hasOperation(axis, kind))
+            {
+                env->pieceWaitChecks.push_back(key);
+            }
         }
     };
 
     class ThreadRescheduleVisitor : public boost::static_visitor<>
     {
     private:
+        const Unit* const unit;
         CobEnvironment* const env;
         CobThread* const thread;
+        CobEffects* const effects;
 
     public:
-        ThreadRescheduleVisitor(CobEnvironment* env, CobThread* thread) : env(env), thread(thread)
+        ThreadRescheduleVisitor(const Unit* unit, CobEnvironment* env, CobThread* thread, CobEffects* effects)
+            : unit(unit), env(env), thread(thread), effects(effects)
         {
         }
 
         void operator()(const CobEnvironment::BlockedStatus& status) const
         {
-            env->blockedQueue.emplace_back(status, thread);
+            thread->blockSequence = env->nextBlockSequence++;
+            boost::apply_visitor(BlockScheduleVisitor(unit, env, thread, effects), status.condition);
         }
         void operator()(const CobEnvironment::FinishedStatus&) const
         {
@@ -60,14 +83,84 @@ namespace rwe
         }
     };
 
-    void CobExecutionService::run(GameSimulation& simulation, UnitId unitId)
+    /**
+     * Moves the threads waiting on the operation to the environment's woken threads,
+     * unless the operation has been started again since it ended.
+     */
+    void wakePieceWaiters(const Unit& unit, CobEnvironment& env, const PieceOperationKey& key)
+    {
+        auto waiters = env.findPieceWaiters(key);
+        if (waiters == nullptr || waiters->empty())
+        {
+            return;
+        }
+
+        if (unit.mesh.pieces[key.piece].hasOperation(key.axis, key.kind))
+        {
+            return;
+        }
+
+        env.wokenThreads.insert(env.wokenThreads.end(), waiters->begin(), waiters->end());
+        waiters->clear();
+    }
+
+    CobExecutionService::CobExecutionService() : sleepTimers(GameTime(0))
+    {
+    }
+
+    void CobExecutionService::wakeSleepingThreads(GameSimulation& simulation)
+    {
+        sleepTimers.advance(simulation.gameTime, wokenUnits);
+
+        for (auto unitId : wokenUnits)
+        {
+            // The unit may have been removed while its threads slept.
+            if (simulation.unitExists(unitId))
+            {
+                auto& env = *simulation.getUnit(unitId).cobEnvironment;
+                env.sleepersDue = true;
+                env.markReady();
+            }
+        }
+
+        wokenUnits.clear();
+    }
+
+    void CobExecutionService::notifyPieceOperationsEnded(GameSimulation& simulation, UnitId unitId)
+    {
+        auto& unit = simulation.getUnit(unitId);
+        if (!unit.mesh.endedOperations.empty())
+        {
+            unit.cobEnvironment->markReady();
+        }
+    }
+
+    void CobExecutionService::takeReadyUnits(GameSimulation& simulation, std::vector<UnitId>& out)
+    {
+        auto begin = out.size();
+        simulation.scriptReadyUnits->takeAll(out);
+
+        // Units may have been removed since they were marked.
+        auto end = std::remove_if(out.begin() + begin, out.end(), [&simulation](UnitId id) {
+            return !simulation.unitExists(id);
+        });
+        out.erase(end, out.end());
+
+        // Units are marked from several threads,
+        // so put them back into a deterministic order.
+        std::sort(out.begin() + begin, out.end(), [](UnitId a, UnitId b) { return a.value < b.value; });
+    }
+
+    void CobExecutionService::run(GameSimulation& simulation, UnitId unitId, CobEffects& effects)
     {
         auto& unit = simulation.getUnit(unitId);
         auto& env = *unit.cobEnvironment;
+        auto wasAnimating = unit.mesh.isAnimating();
 
         assert(env.isNotCorrupt());
 
-        // clean up any finished threads that were not reaped last frame
+        // clean up any finished threads that were not reaped last frame,
+        // along with any killed since
         for (const auto& thread : env.finishedQueue)
         {
             env.deleteThread(thread);
@@ -76,25 +169,48 @@ namespace rwe
 
         assert(env.isNotCorrupt());
 
-        // check if any blocked threads can be unblocked
-        // and move them back into the ready queue
-        for (auto it = env.blockedQueue.begin(); it != env.blockedQueue.end();)
+        // Move blocked threads whose condition has been met back into the ready queue.
+        // Sleeping threads are only checked when the timer wheel says one is due,
+        // and threads waiting on a piece only when the operation they wait on ends,
+        // so threads that are still blocked are mostly left alone.
+        if (env.sleepersDue)
         {
-            const auto& pair = *it;
-            const auto& status = pair.first;
-
-            auto isUnblocked = boost::apply_visitor(BlockCheckVisitor(&simulation, &env, unitId), status.condition);
-            if (isUnblocked)
+            env.sleepersDue = false;
+            for (auto it = env.sleepingThreads.begin(); it != env.sleepingThreads.end();)
             {
-                env.readyQueue.push_back(pair.second);
-                it = env.blockedQueue.erase(it);
-            }
-            else
-            {
-                ++it;
+                if (simulation.gameTime >= it->first)
+                {
+                    env.wokenThreads.push_back(it->second);
+                    it = env.sleepingThreads.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
             }
         }
 
+        for (const auto& key : env.pieceWaitChecks)
+        {
+            wakePieceWaiters(unit, env, key);
+        }
+        env.pieceWaitChecks.clear();
+
+        for (const auto& key : unit.mesh.endedOperations)
+        {
+            wakePieceWaiters(unit, env, key);
+        }
+        unit.mesh.endedOperations.clear();
+
+        // Threads are found by what they were waiting for,
+        // but they resume in the order they blocked in,
+        // as they would if every blocked thread were checked in turn.
+        std::sort(env.wokenThreads.begin(), env.wokenThreads.end(), [](const CobThread* a, const CobThread* b) {
+            return a->blockSequence < b->blockSequence;
+        });
+        env.readyQueue.insert(env.readyQueue.end(), env.wokenThreads.begin(), env.wokenThreads.end());
+        env.wokenThreads.clear();
+
         assert(env.isNotCorrupt());
 
         // execute ready threads
@@ -103,13 +219,52 @@ namespace rwe
             auto thread = env.readyQueue.front();
             env.readyQueue.pop_front();
 
+            if (thread->dead)
+            {
+                env.deleteThread(thread);
+                continue;
+            }
+
             CobExecutionContext context(&simulation, &env, thread, unitId);
 
             auto status = context.execute();
+            env.recordThreadStatus(*thread, status);
 
-            boost::apply_visitor(ThreadRescheduleVisitor(&env, thread), status);
+            boost::apply_visitor(ThreadRescheduleVisitor(&unit, &env, thread, &effects), status);
         }
 
         assert(env.isNotCorrupt());
+
+        // The unit counts as ready until here,
+        // so threads started by its scripts don't mark it again.
+        // Finished threads are cleaned up on the next run,
+        // and waits on pieces that were at rest, or on operations
+        // that were cut short, are checked then too.
+        env.clearReady();
+        if (!env.finishedQueue.empty() || !env.pieceWaitChecks.empty() || !unit.mesh.endedOperations.empty())
+        {
+            env.markReady();
+        }
+
+        // Pieces only come to rest in the animation phase,
+        // so a unit that was already animating is already
+        // in the simulation's list of animating units.
+        effects.startedAnimating = !wasAnimating && unit.mesh.isAnimating();
+    }
+
+    void CobExecutionService::applyEffects(GameSimulation& simulation, UnitId unitId, CobEffects& effects)
+    {
+        if (effects.startedAnimating)
+        {
+            simulation.addAnimatingUnit(unitId);
+        }
+
+        for (auto wakeUpTime : effects.sleepWakeUps)
+        {
+            sleepTimers.schedule(wakeUpTime, unitId);
+        }
+
+        effects.startedAnimating = false;
+        effects.sleepWakeUps.clear();
     }
 }
@@ -2,13 +2,93 @@
 #define RWE_COBEXECUTIONSERVICE_H
 
 #include <rwe/GameSimulation.h>
+#include <rwe/cob/CobTimerWheel.h>
+#include <vector>
 
 namespace rwe
 {
+    /**
+     * Things a unit's scripts did in a tick
+     * that reach beyond the unit itself.
+     * These are recorded while units' scripts run in parallel
+     * and applied afterwards, one unit at a time in unit order,
+     * so the outcome doesn't depend on how the work was split up.
+     */
+    struct CobEffects
+    {
+        /** True if the unit's pieces were set in motion from rest. */
+        bool startedAnimating{false};
+
+        /** The wake-up time of each thread that went to sleep. */
+        std::vector<GameTime> sleepWakeUps;
+    };
+
+    /**
+     * Runs unit scripts.
+     *
+     * Blocked threads are not polled every tick.
+     * Sleeping threads have their wake-up time kept in a timer wheel
+     * and threads waiting on pieces are filed by the operation they wait on,
+     * so only the waiters of a move or turn that has ended are checked.
+     * Units only get run when one of these, or something else,
+     * has put them in the simulation's ready units,
+     * so units whose scripts are all idle are never visited.
+     */
     class CobExecutionService
     {
+    private:
+        CobTimerWheel sleepTimers;
+
+        /** Scratch space for the units woken by sleepTimers. */
+        std::vector<UnitId> wokenUnits;
+
     public:
-        void run(GameSimulation& simulation, UnitId unitId);
+        CobExecutionService();
+
+        /**
+         * Marks units with sleeping threads due to wake up
+         * at the simulation's current time as ready.
+         * Call this once per tick, before taking the ready units.
+         */
+        void wakeSleepingThreads(GameSimulation& simulation);
+
+        /**
+         * Marks the unit as ready if any of its pieces' operations
+         * have ended since its scripts last ran,
+         * so that threads waiting on them are checked.
+         * Only touches the unit itself, so it is safe
+         * to call for different units in parallel.
+         */
+        void notifyPieceOperationsEnded(GameSimulation& simulation, UnitId unitId);
+
+        /**
+         * Appends the units that need their scripts run to out,
+         * in ascending ID order, and empties the simulation's ready units.
+         * Each of these units must then be passed to run,
+         * which is what takes it off the ready list.
+         * Skipping any other unit has no effect on the simulation.
+         */
+        void takeReadyUnits(GameSimulation& simulation, std::vector<UnitId>& out);
+
+        /**
+         * Runs the unit's ready scripts.
+         * If there will still be something to do afterwards,
+         * such as cleaning up finished threads,
+         * the unit is marked ready again for the next tick.
+         * The unit's scripts may only modify the unit itself here,
+         * anything else is recorded in effects instead.
+         * This makes it safe to run for different units in parallel,
+         * as long as wakeSleepingThreads isn't running at the same time.
+         */
+        void run(GameSimulation& simulation, UnitId unitId, CobEffects& effects);
+
+        /**
+         * Applies the effects recorded for the unit by run
+         * and clears them.
+         * Units must have their effects applied one at a time,
+         * in a consistent order.
+         */
+        void applyEffects(GameSimulation& simulation, UnitId unitId, CobEffects& effects);
     };
 }
 
@@ -1,21 +1,25 @@
 #ifndef RWE_COBFUNCTION_H
 #define RWE_COBFUNCTION_H
 
-#include <vector>
-
 namespace rwe
 {
     class CobFunction
     {
     public:
-        unsigned int instructionIndex;
-        std::vector<int> locals;
+        unsigned int instructionIndex{0};
+
+        /** Where the function's locals start in its thread's locals. */
+        unsigned int localsBase{0};
+
+        /** The number of locals the function has, starting with its parameters. */
+        unsigned int localsSize{0};
+
         unsigned int localCount{0};
 
     public:
-        CobFunction(unsigned int instructionIndex, const std::vector<int>& locals);
+        CobFunction() = default;
 
-        explicit CobFunction(unsigned int instructionIndex);
+        CobFunction(unsigned int instructionIndex, unsigned int localsBase, unsigned int localsSize);
     };
 }
 
@@ -0,0 +1,21 @@
+#include "CobFunctionSymbol.h"
+#include <mutex>
+#include <unordered_map>
+
+namespace rwe
+{
+    CobFunctionSymbol internCobFunctionSymbol(const std::string& name)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, CobFunctionSymbol> symbols;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = symbols.find(name);
+        if (it == symbols.end())
+        {
+            it = symbols.emplace(name, CobFunctionSymbol(static_cast<unsigned int>(symbols.size()))).first;
+        }
+
+        return it->second;
+    }
+}
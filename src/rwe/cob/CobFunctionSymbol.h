@@ -0,0 +1,27 @@
+#ifndef RWE_COBFUNCTIONSYMBOL_H
+#define RWE_COBFUNCTIONSYMBOL_H
+
+#include <rwe/OpaqueId.h>
+#include <string>
+
+namespace rwe
+{
+    struct CobFunctionSymbolTag;
+
+    /**
+     * A script function name, interned so that it can be looked up
+     * in any script by number rather than by string.
+     * The same name always gets the same symbol.
+     */
+    using CobFunctionSymbol = OpaqueId<unsigned int, CobFunctionSymbolTag>;
+
+    /**
+     * Returns the symbol for the given function name.
+     * Callers that start the function often should intern its name once
+     * and keep the symbol.
+     * Safe to call from any thread.
+     */
+    CobFunctionSymbol internCobFunctionSymbol(const std::string& name);
+}
+
+#endif
@@ -0,0 +1,261 @@
+#include "CobInstruction.h"
+#include "CobOpCode.h"
+#include <boost/optional.hpp>
+#include <rwe/util.h>
+
+namespace rwe
+{
+    struct CobOpInfo
+    {
+        CobOp op;
+        unsigned int operandCount;
+
+        /** True if the second operand is an axis, which must be checked. */
+        bool hasAxis;
+    };
+
+    static const std::array<Axis, 3> CobAxes{Axis::X, Axis::Y, Axis::Z};
+
+    static boost::optional<CobOpInfo> getOpInfo(std::uint32_t word)
+    {
+        switch (static_cast<OpCode>(word))
+        {
+            case OpCode::RAND:
+                return CobOpInfo{CobOp::Rand, 0, false};
+
+            case OpCode::ADD:
+                return CobOpInfo{CobOp::Add, 0, false};
+            case OpCode::SUB:
+                return CobOpInfo{CobOp::Subtract, 0, false};
+            case OpCode::MUL:
+                return CobOpInfo{CobOp::Multiply, 0, false};
+            case OpCode::DIV:
+                return CobOpInfo{CobOp::Divide, 0, false};
+
+            case OpCode::SET_LESS:
+                return CobOpInfo{CobOp::SetLess, 0, false};
+            case OpCode::SET_LESS_OR_EQUAL:
+                return CobOpInfo{CobOp::SetLessOrEqual, 0, false};
+            case OpCode::SET_EQUAL:
+                return CobOpInfo{CobOp::SetEqual, 0, false};
+            case OpCode::SET_NOT_EQUAL:
+                return CobOpInfo{CobOp::SetNotEqual, 0, false};
+            case OpCode::SET_GREATER:
+                return CobOpInfo{CobOp::SetGreater, 0, false};
+            case OpCode::SET_GREATER_OR_EQUAL:
+                return CobOpInfo{CobOp::SetGreaterOrEqual, 0, false};
+
+            case OpCode::JUMP:
+                return CobOpInfo{CobOp::Jump, 1, false};
+            case OpCode::JUMP_NOT_EQUAL:
+                return CobOpInfo{CobOp::JumpIfZero, 1, false};
+
+            case OpCode::LOGICAL_AND:
+                return CobOpInfo{CobOp::LogicalAnd, 0, false};
+            case OpCode::LOGICAL_OR:
+                return CobOpInfo{CobOp::LogicalOr, 0, false};
+            case OpCode::LOGICAL_XOR:
+                return CobOpInfo{CobOp::LogicalXor, 0, false};
+            case OpCode::LOGICAL_NOT:
+                return CobOpInfo{CobOp::LogicalNot, 0, false};
+
+            case OpCode::BITWISE_AND:
+                return CobOpInfo{CobOp::BitwiseAnd, 0, false};
+            case OpCode::BITWISE_OR:
+                return CobOpInfo{CobOp::BitwiseOr, 0, false};
+            case OpCode::BITWISE_XOR:
+                return CobOpInfo{CobOp::BitwiseXor, 0, false};
+            case OpCode::BITWISE_NOT:
+                return CobOpInfo{CobOp::BitwiseNot, 0, false};
+
+            case OpCode::MOVE:
+                return CobOpInfo{CobOp::Move, 2, true};
+            case OpCode::MOVE_NOW:
+                return CobOpInfo{CobOp::MoveNow, 2, true};
+            case OpCode::TURN:
+                return CobOpInfo{CobOp::Turn, 2, true};
+            case OpCode::TURN_NOW:
+                return CobOpInfo{CobOp::TurnNow, 2, true};
+            case OpCode::SPIN:
+                return CobOpInfo{CobOp::Spin, 2, false};
+            case OpCode::STOP_SPIN:
+                return CobOpInfo{CobOp::StopSpin, 2, false};
+            case OpCode::EXPLODE:
+                return CobOpInfo{CobOp::Explode, 1, false};
+            case OpCode::EMIT_SFX:
+                return CobOpInfo{CobOp::EmitSfx, 1, false};
+            case OpCode::SHOW:
+                return CobOpInfo{CobOp::Show, 1, false};
+            case OpCode::HIDE:
+                return CobOpInfo{CobOp::Hide, 1, false};
+            case OpCode::SHADE:
+                return CobOpInfo{CobOp::Shade, 1, false};
+            case OpCode::DONT_SHADE:
+                return CobOpInfo{CobOp::DontShade, 1, false};
+            case OpCode::CACHE:
+                return CobOpInfo{CobOp::Cache, 1, false};
+            case OpCode::DONT_CACHE:
+                return CobOpInfo{CobOp::DontCache, 1, false};
+            case OpCode::ATTACH_UNIT:
+                return CobOpInfo{CobOp::AttachUnit, 0, false};
+            case OpCode::DROP_UNIT:
+                return CobOpInfo{CobOp::DropUnit, 0, false};
+
+            case OpCode::WAIT_FOR_MOVE:
+                return CobOpInfo{CobOp::WaitForMove, 2, true};
+            case OpCode::WAIT_FOR_TURN:
+                return CobOpInfo{CobOp::WaitForTurn, 2, true};
+            case OpCode::SLEEP:
+                return CobOpInfo{CobOp::Sleep, 0, false};
+
+            case OpCode::CALL_SCRIPT:
+                return CobOpInfo{CobOp::CallScript, 2, false};
+            case OpCode::RETURN:
+                return CobOpInfo{CobOp::Return, 0, false};
+            case OpCode::START_SCRIPT:
+                return CobOpInfo{CobOp::StartScript, 2, false};
+
+            case OpCode::SIGNAL:
+                return CobOpInfo{CobOp::Signal, 0, false};
+            case OpCode::SET_SIGNAL_MASK:
+                return CobOpInfo{CobOp::SetSignalMask, 0, false};
+
+            case OpCode::CREATE_LOCAL_VAR:
+                return CobOpInfo{CobOp::CreateLocalVar, 0, false};
+            case OpCode::PUSH_CONSTANT:
+                return CobOpInfo{CobOp::PushConstant, 1, false};
+            case OpCode::PUSH_LOCAL_VAR:
+                return CobOpInfo{CobOp::PushLocalVar, 1, false};
+            case OpCode::POP_LOCAL_VAR:
+                return CobOpInfo{CobOp::PopLocalVar, 1, false};
+            case OpCode::PUSH_STATIC:
+                return CobOpInfo{CobOp::PushStatic, 1, false};
+            case OpCode::POP_STATIC:
+                return CobOpInfo{CobOp::PopStatic, 1, false};
+            case OpCode::POP_STACK:
+                return CobOpInfo{CobOp::PopStack, 0, false};
+
+            case OpCode::GET_UNIT_VALUE:
+                return CobOpInfo{CobOp::GetUnitValue, 0, false};
+
+            default:
+                return boost::none;
+        }
+    }
+
+    static CobInstruction decodeInstruction(const std::vector<std::uint32_t>& code, std::size_t address)
+    {
+        auto info = getOpInfo(code[address]);
+        if (!info)
+        {
+            return CobInstruction{CobOp::UnsupportedOpCode, 1, {code[address], 0, 0, 0}};
+        }
+
+        if (address + info->operandCount >= code.size())
+        {
+            return CobInstruction{CobOp::Truncated, 1, {0, 0, 0, 0}};
+        }
+
+        CobInstruction instruction{info->op, 1 + info->operandCount, {0, 0, 0, 0}};
+        for (unsigned int i = 0; i < info->operandCount; ++i)
+        {
+            instruction.operands[i] = code[address + 1 + i];
+        }
+
+        if (info->hasAxis)
+        {
+            auto axis = instruction.operands[1];
+            if (axis >= CobAxes.size())
+            {
+                return CobInstruction{CobOp::InvalidAxis, 1, {axis, 0, 0, 0}};
+            }
+
+            instruction.operands[1] = static_cast<std::uint32_t>(CobAxes[axis]);
+        }
+
+        return instruction;
+    }
+
+    /**
+     * Returns the superinstruction for the run of instructions
+     * starting at the given address, if there is one.
+     * Only the instructions after the address are looked at,
+     * and they must not have been fused yet.
+     */
+    static boost::optional<CobInstruction> fuseInstructions(const std::vector<CobInstruction>& instructions, std::size_t address)
+    {
+        const auto& first = instructions[address];
+        if (first.op != CobOp::PushConstant)
+        {
+            return boost::none;
+        }
+
+        auto secondAddress = address + first.length;
+        if (secondAddress >= instructions.size())
+        {
+            return boost::none;
+        }
+
+        const auto& second = instructions[secondAddress];
+        auto length = first.length + second.length;
+        switch (second.op)
+        {
+            case CobOp::MoveNow:
+                return CobInstruction{CobOp::MoveNowConstant, length, {second.operands[0], second.operands[1], first.operands[0], 0}};
+            case CobOp::TurnNow:
+                return CobInstruction{CobOp::TurnNowConstant, length, {second.operands[0], second.operands[1], first.operands[0], 0}};
+            case CobOp::Sleep:
+                return CobInstruction{CobOp::SleepConstant, length, {first.operands[0], 0, 0, 0}};
+            case CobOp::JumpIfZero:
+            {
+                // A constant condition, such as that of while (TRUE),
+                // always goes the same way.
+                auto target = first.operands[0] == 0 ? second.operands[0] : static_cast<std::uint32_t>(address + length);
+                return CobInstruction{CobOp::Jump, length, {target, 0, 0, 0}};
+            }
+            case CobOp::PushConstant:
+                break;
+            default:
+                return boost::none;
+        }
+
+        auto thirdAddress = secondAddress + second.length;
+        if (thirdAddress >= instructions.size())
+        {
+            return boost::none;
+        }
+
+        const auto& third = instructions[thirdAddress];
+        length += third.length;
+        switch (third.op)
+        {
+            case CobOp::Move:
+                return CobInstruction{CobOp::MoveConstant, length, {third.operands[0], third.operands[1], second.operands[0], first.operands[0]}};
+            case CobOp::Turn:
+                return CobInstruction{CobOp::TurnConstant, length, {third.operands[0], third.operands[1], second.operands[0], first.operands[0]}};
+            default:
+                return boost::none;
+        }
+    }
+
+    std::vector<CobInstruction> decodeCobInstructions(const std::vector<std::uint32_t>& code)
+    {
+        std::vector<CobInstruction> instructions;
+        instructions.reserve(code.size());
+        for (std::size_t i = 0; i < code.size(); ++i)
+        {
+            instructions.push_back(decodeInstruction(code, i));
+        }
+
+        // Going forwards, the instructions after each address are still unfused.
+        for (std::size_t i = 0; i < instructions.size(); ++i)
+        {
+            if (auto fused = fuseInstructions(instructions, i); fused)
+            {
+                instructions[i] = *fused;
+            }
+        }
+
+        return instructions;
+    }
+}
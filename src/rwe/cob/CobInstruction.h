@@ -0,0 +1,139 @@
+#ifndef RWE_COBINSTRUCTION_H
+#define RWE_COBINSTRUCTION_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * The operations of decoded cob instructions.
+     * These are numbered densely, unlike OpCode,
+     * so the interpreter can dispatch on them through a single jump table.
+     */
+    enum class CobOp : std::uint8_t
+    {
+        // errors, raised when the instruction is run
+        UnsupportedOpCode,
+        InvalidAxis,
+        Truncated,
+
+        Rand,
+
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+
+        SetLess,
+        SetLessOrEqual,
+        SetEqual,
+        SetNotEqual,
+        SetGreater,
+        SetGreaterOrEqual,
+
+        Jump,
+        JumpIfZero,
+
+        LogicalAnd,
+        LogicalOr,
+        LogicalXor,
+        LogicalNot,
+
+        BitwiseAnd,
+        BitwiseOr,
+        BitwiseXor,
+        BitwiseNot,
+
+        Move,
+        MoveNow,
+        Turn,
+        TurnNow,
+        Spin,
+        StopSpin,
+        Explode,
+        EmitSfx,
+        Show,
+        Hide,
+        Shade,
+        DontShade,
+        Cache,
+        DontCache,
+        AttachUnit,
+        DropUnit,
+
+        WaitForMove,
+        WaitForTurn,
+        Sleep,
+
+        CallScript,
+        Return,
+        StartScript,
+
+        Signal,
+        SetSignalMask,
+
+        CreateLocalVar,
+        PushConstant,
+        PushLocalVar,
+        PopLocalVar,
+        PushStatic,
+        PopStatic,
+        PopStack,
+
+        GetUnitValue,
+
+        // superinstructions, standing in for a run of instructions
+        // whose stack arguments are all constants
+
+        /** PUSH_CONSTANT speed, PUSH_CONSTANT position, MOVE object axis */
+        MoveConstant,
+
+        /** PUSH_CONSTANT position, MOVE_NOW object axis */
+        MoveNowConstant,
+
+        /** PUSH_CONSTANT speed, PUSH_CONSTANT angle, TURN object axis */
+        TurnConstant,
+
+        /** PUSH_CONSTANT angle, TURN_NOW object axis */
+        TurnNowConstant,
+
+        /** PUSH_CONSTANT duration, SLEEP */
+        SleepConstant,
+    };
+
+    /**
+     * A cob instruction decoded ahead of time, with its operands inline.
+     *
+     * Operands appear in the order they would be read from the code,
+     * followed by the values a superinstruction would have popped from the stack,
+     * in the order they would have been popped.
+     * Axis operands hold the value of an Axis.
+     */
+    struct CobInstruction
+    {
+        CobOp op;
+
+        /** The number of words of the original code the instruction covers, including operands. */
+        unsigned int length;
+
+        std::array<std::uint32_t, 4> operands;
+    };
+
+    /**
+     * Decodes the instruction starting at every word of a script's code,
+     * so the result can be indexed by the same addresses as the code.
+     * Jumps and function addresses land on words that begin instructions,
+     * but decoding every word means a jump anywhere finds an instruction waiting,
+     * and runs of instructions can be fused into a superinstruction at their first word
+     * while still being runnable from any word inside them.
+     *
+     * Nothing is rejected up front.
+     * Words that can't be decoded become instructions that raise the error when run,
+     * as reading the raw code would.
+     */
+    std::vector<CobInstruction> decodeCobInstructions(const std::vector<std::uint32_t>& code);
+}
+
+#endif
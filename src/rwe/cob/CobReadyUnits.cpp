@@ -0,0 +1,17 @@
+#include "CobReadyUnits.h"
+
+namespace rwe
+{
+    void CobReadyUnits::add(UnitId unitId)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        units.push_back(unitId);
+    }
+
+    void CobReadyUnits::takeAll(std::vector<UnitId>& out)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        out.insert(out.end(), units.begin(), units.end());
+        units.clear();
+    }
+}
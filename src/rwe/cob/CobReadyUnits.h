@@ -0,0 +1,38 @@
+#ifndef RWE_COBREADYUNITS_H
+#define RWE_COBREADYUNITS_H
+
+#include <mutex>
+#include <rwe/UnitId.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * The units whose scripts have something to do
+     * the next time scripts are run.
+     *
+     * Units are added by their cob environments,
+     * which make sure they are only added once,
+     * so that the script phase only has to visit these units
+     * rather than every unit in the simulation.
+     * Units can be added from several threads at once,
+     * so the order of the list is not deterministic.
+     */
+    class CobReadyUnits
+    {
+    private:
+        std::mutex mutex;
+        std::vector<UnitId> units;
+
+    public:
+        void add(UnitId unitId);
+
+        /**
+         * Appends every unit added since the last call to out
+         * and empties the list.
+         */
+        void takeAll(std::vector<UnitId>& out);
+    };
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef RWE_COBSTACK_H
+#define RWE_COBSTACK_H
+
+#include <array>
+#include <cassert>
+#include <initializer_list>
+#include <stdexcept>
+
+namespace rwe
+{
+    /**
+     * A stack with a fixed capacity, stored inline, so it never allocates.
+     * Scripts that push more than it can hold, or pop more than they pushed,
+     * get an error rather than undefined behaviour.
+     */
+    template <typename T, std::size_t Capacity>
+    class CobStack
+    {
+    private:
+        std::array<T, Capacity> items;
+        std::size_t count{0};
+
+    public:
+        CobStack() = default;
+
+        CobStack(std::initializer_list<T> values)
+        {
+            for (const auto& value : values)
+            {
+                push(value);
+            }
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        void push(const T& value)
+        {
+            if (count == Capacity)
+            {
+                throw std::runtime_error("Cob stack overflow");
+            }
+
+            items[count++] = value;
+        }
+
+        T pop()
+        {
+            if (count == 0)
+            {
+                throw std::runtime_error("Cob stack underflow");
+            }
+
+            return items[--count];
+        }
+
+        T& top()
+        {
+            assert(count > 0);
+            return items[count - 1];
+        }
+
+        const T& top() const
+        {
+            assert(count > 0);
+            return items[count - 1];
+        }
+
+        T& operator[](std::size_t index)
+        {
+            assert(index < count);
+            return items[index];
+        }
+
+        const T& operator[](std::size_t index) const
+        {
+            assert(index < count);
+            return items[index];
+        }
+
+        /** Drops everything above the given size. */
+        void truncate(std::size_t newSize)
+        {
+            assert(newSize <= count);
+            count = newSize;
+        }
+
+        void clear()
+        {
+            count = 0;
+        }
+
+        const T* begin() const
+        {
+            return items.data();
+        }
+
+        const T* end() const
+        {
+            return items.data() + count;
+        }
+    };
+}
+
+#endif
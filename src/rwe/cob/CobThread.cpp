@@ -2,11 +2,47 @@
 
 namespace rwe
 {
-    CobThread::CobThread(const std::string& name, unsigned int signalMask) : name(name), signalMask(signalMask)
+    CobThread::CobThread(unsigned int functionId, unsigned int signalMask) : functionId(functionId), signalMask(signalMask)
     {
     }
 
-    CobThread::CobThread(const std::string& name) : name(name)
+    CobThread::CobThread(unsigned int functionId) : functionId(functionId)
     {
     }
+
+    void CobThread::reset(unsigned int newFunctionId, unsigned int newSignalMask)
+    {
+        functionId = newFunctionId;
+        stack.clear();
+        signalMask = newSignalMask;
+        callStack.clear();
+        locals.clear();
+        returnValue = 0;
+        returnLocals.clear();
+        dead = false;
+    }
+
+    void CobThread::pushFunction(unsigned int address, const Params& params)
+    {
+        auto localsBase = static_cast<unsigned int>(locals.size());
+        for (auto param : params)
+        {
+            locals.push(param);
+        }
+
+        callStack.push(CobFunction(address, localsBase, static_cast<unsigned int>(params.size())));
+    }
+
+    void CobThread::popFunction()
+    {
+        const auto& function = callStack.top();
+        returnLocals.clear();
+        for (unsigned int i = 0; i < function.localsSize; ++i)
+        {
+            returnLocals.push(locals[function.localsBase + i]);
+        }
+
+        locals.truncate(function.localsBase);
+        callStack.pop();
+    }
 }
@@ -2,36 +2,104 @@
 #define RWE_COBTHREAD_H
 
 #include "CobFunction.h"
+#include "CobStack.h"
 #include <boost/variant.hpp>
+#include <cstdint>
 #include <rwe/util.h>
-#include <stack>
-#include <vector>
 
 namespace rwe
 {
+    /**
+     * A thread of cob script execution.
+     * Everything a thread needs is stored inline,
+     * so threads can be reused without allocating.
+     */
     class CobThread
     {
     public:
-        std::string name;
+        static constexpr std::size_t MaxStackSize = 128;
+        static constexpr std::size_t MaxCallDepth = 16;
+        static constexpr std::size_t MaxLocals = 128;
+        static constexpr std::size_t MaxParams = 16;
 
-        std::stack<int> stack;
+        using Params = CobStack<int, MaxParams>;
+
+    public:
+        /** The function the thread was started in. */
+        unsigned int functionId;
+
+        CobStack<int, MaxStackSize> stack;
 
         unsigned int signalMask{0};
 
-        std::stack<CobFunction> callStack;
+        CobStack<CobFunction, MaxCallDepth> callStack;
 
-        int returnValue;
+        /** The locals of every function on the call stack, each after its caller's. */
+        CobStack<int, MaxLocals> locals;
+
+        int returnValue{0};
 
         /**
          * Required for query functions, which communicate back to the engine
          * not by a return value but by changing the values of their input parameters.
          */
-        std::vector<int> returnLocals;
+        CobStack<int, MaxLocals> returnLocals;
+
+        /**
+         * Set when the thread is killed by a signal.
+         * The thread stays in its queue until the queue is next worked through,
+         * at which point it is dropped and the thread can be reused.
+         */
+        bool dead{false};
+
+        /**
+         * When the thread last blocked, counted among the blocks of its environment's threads.
+         * Threads woken on the same run are resumed in this order,
+         * which is the order they blocked in.
+         */
+        std::uint64_t blockSequence{0};
+
+        /**
+         * Bumped each time the thread is freed for reuse,
+         * so that handles to the thread's previous runs can be told apart.
+         */
+        unsigned int generation{0};
 
     public:
-        CobThread(const std::string& name, unsigned int signalMask);
+        CobThread(unsigned int functionId, unsigned int signalMask);
+
+        explicit CobThread(unsigned int functionId);
+
+        /** Clears the thread so it can be started again in the given function. */
+        void reset(unsigned int functionId, unsigned int signalMask);
+
+        /** Enters the function at the given address, with the given parameters as its first locals. */
+        void pushFunction(unsigned int address, const Params& params);
+
+        /** Leaves the current function, keeping its locals in returnLocals. */
+        void popFunction();
+    };
+
+    /**
+     * Refers to one run of a thread.
+     * Threads are reused once they are deleted,
+     * and a handle stops referring to the thread when that happens,
+     * even if the same thread object is handed out again.
+     */
+    struct CobThreadHandle
+    {
+        const CobThread* thread;
+        unsigned int generation;
+
+        explicit CobThreadHandle(const CobThread* thread) : thread(thread), generation(thread->generation)
+        {
+        }
 
-        explicit CobThread(const std::string& name);
+        /** Returns true if the handle still refers to the thread's current run. */
+        bool isCurrent() const
+        {
+            return thread->generation == generation;
+        }
     };
 }
 
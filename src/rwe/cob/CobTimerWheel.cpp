@@ -0,0 +1,57 @@
+#include "CobTimerWheel.h"
+
+#include <algorithm>
+
+namespace rwe
+{
+    CobTimerWheel::CobTimerWheel(GameTime currentTime) : currentTime(currentTime)
+    {
+    }
+
+    GameTime CobTimerWheel::getCurrentTime() const
+    {
+        return currentTime;
+    }
+
+    void CobTimerWheel::schedule(GameTime time, UnitId unitId)
+    {
+        time = std::max(time, nextGameTime(currentTime));
+        slots[time.value % SlotCount].push_back(Entry{time, unitId});
+    }
+
+    void CobTimerWheel::advance(GameTime time, std::vector<UnitId>& dueUnits)
+    {
+        if (time <= currentTime)
+        {
+            return;
+        }
+
+        // Each slot only needs to be visited once,
+        // however far the wheel is moving.
+        auto ticks = std::min((time - currentTime).value, SlotCount);
+        for (unsigned int i = 1; i <= ticks; ++i)
+        {
+            auto& slot = slots[(currentTime.value + i) % SlotCount];
+            std::size_t kept = 0;
+            for (const auto& entry : slot)
+            {
+                if (entry.time <= time)
+                {
+                    dueUnits.push_back(entry.unitId);
+                }
+                else
+                {
+                    slot[kept++] = entry;
+                }
+            }
+            slot.erase(slot.begin() + kept, slot.end());
+        }
+
+        currentTime = time;
+    }
+
+    bool CobTimerWheel::empty() const
+    {
+        return std::all_of(slots.begin(), slots.end(), [](const auto& slot) { return slot.empty(); });
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef RWE_COBTIMERWHEEL_H
+#define RWE_COBTIMERWHEEL_H
+
+#include <array>
+#include <rwe/GameTime.h>
+#include <rwe/UnitId.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * Remembers when units have sleeping script threads due to wake up,
+     * so that units with nothing due don't need to be looked at.
+     *
+     * Wake-ups are hashed into a ring of slots by game time.
+     * Advancing one tick only looks at the slot for that tick,
+     * where wake-ups a whole turn of the ring or more away are left in place.
+     */
+    class CobTimerWheel
+    {
+    public:
+        static constexpr unsigned int SlotCount = 256;
+
+    private:
+        struct Entry
+        {
+            GameTime time;
+            UnitId unitId;
+        };
+
+        std::array<std::vector<Entry>, SlotCount> slots;
+
+        GameTime currentTime;
+
+    public:
+        explicit CobTimerWheel(GameTime currentTime);
+
+        GameTime getCurrentTime() const;
+
+        /**
+         * Schedules a wake-up for the unit at the given time.
+         * Times that are not after the current time
+         * are moved to the next tick.
+         */
+        void schedule(GameTime time, UnitId unitId);
+
+        /**
+         * Moves the wheel on to the given time,
+         * appending the unit of every wake-up that has become due
+         * to dueUnits in the order the wake-ups are due.
+         * A unit appears once for each of its wake-ups.
+         */
+        void advance(GameTime time, std::vector<UnitId>& dueUnits);
+
+        bool empty() const;
+    };
+}
+
+#endif
@@ -0,0 +1,301 @@
+#include "loading_utils.h"
+#include "WeaponTdf.h"
+#include <boost/interprocess/streams/bufferstream.hpp>
+#include <rwe/WorkerPool.h>
+#include <rwe/tdf.h>
+
+namespace rwe
+{
+    void preloadSound(AudioService* audioService, UnitDatabase& db, const std::string& soundName)
+    {
+        if (audioService == nullptr)
+        {
+            return;
+        }
+
+        auto sound = audioService->loadSound(soundName);
+        if (!sound)
+        {
+            return; // sometimes sound categories name invalid sounds
+        }
+
+        db.addSound(soundName, *sound);
+    }
+
+    void preloadSound(AudioService* audioService, UnitDatabase& db, const boost::optional<std::string>& soundName)
+    {
+        if (!soundName)
+        {
+            return;
+        }
+
+        preloadSound(audioService, db, *soundName);
+    }
+
+    Grid<std::size_t> getMapData(TntArchive& tnt)
+    {
+        auto mapWidthInTiles = tnt.getHeader().width / 2;
+        auto mapHeightInTiles = tnt.getHeader().height / 2;
+        std::vector<uint16_t> mapData(mapWidthInTiles * mapHeightInTiles);
+        tnt.readMapData(mapData.data());
+        std::vector<std::size_t> dataCopy;
+        dataCopy.reserve(mapData.size());
+        std::copy(mapData.begin(), mapData.end(), std::back_inserter(dataCopy));
+        Grid<std::size_t> dataGrid(mapWidthInTiles, mapHeightInTiles, std::move(dataCopy));
+        return dataGrid;
+    }
+
+    Grid<unsigned char> getHeightGrid(const Grid<TntTileAttributes>& attrs)
+    {
+        const auto& sourceData = attrs.getVector();
+
+        std::vector<unsigned char> data;
+        data.reserve(sourceData.size());
+
+        std::transform(sourceData.begin(), sourceData.end(), std::back_inserter(data), [](const TntTileAttributes& e) {
+            return e.height;
+        });
+
+        return Grid<unsigned char>(attrs.getWidth(), attrs.getHeight(), std::move(data));
+    }
+
+    Vector3f computeFeaturePosition(
+        const MapTerrain& terrain,
+        const FeatureDefinition& featureDefinition,
+        std::size_t x,
+        std::size_t y)
+    {
+        const auto& heightmap = terrain.getHeightMap();
+
+        unsigned int height = 0;
+        if (x < heightmap.getWidth() - 1 && y < heightmap.getHeight() - 1)
+        {
+            height = computeMidpointHeight(heightmap, x, y);
+        }
+
+        auto position = terrain.heightmapIndexToWorldCorner(x, y);
+        position.y = height;
+
+        position.x += (featureDefinition.footprintX * MapTerrain::HeightTileWidthInWorldUnits) / 2.0f;
+        position.z += (featureDefinition.footprintZ * MapTerrain::HeightTileHeightInWorldUnits) / 2.0f;
+
+        return position;
+    }
+
+    MapFeature createMapFeature(const Vector3f& position, const FeatureDefinition& definition)
+    {
+        MapFeature f;
+        f.footprintX = definition.footprintX;
+        f.footprintZ = definition.footprintZ;
+        f.height = definition.height;
+        f.isBlocking = definition.blocking;
+        f.position = position;
+        f.transparentAnimation = definition.animTrans;
+        f.transparentShadow = definition.shadTrans;
+        return f;
+    }
+
+    void addMapFeatures(
+        GameSimulation& simulation,
+        TntArchive& tnt,
+        const Grid<TntTileAttributes>& mapAttributes,
+        boost::optional<const OtaSchema&> schema,
+        MapFeatureService& featureService,
+        const std::function<MapFeature(const Vector3f&, const FeatureDefinition&)>& createFeature)
+    {
+        std::vector<FeatureDefinition> featureTemplates;
+        tnt.readFeatures([&featureService, &featureTemplates](const auto& featureName) {
+            featureTemplates.push_back(featureService.getFeatureDefinition(featureName));
+        });
+
+        for (std::size_t y = 0; y < mapAttributes.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < mapAttributes.getWidth(); ++x)
+            {
+                const auto& e = mapAttributes.get(x, y);
+                switch (e.feature)
+                {
+                    case TntTileAttributes::FeatureNone:
+                    case TntTileAttributes::FeatureUnknown:
+                    case TntTileAttributes::FeatureVoid:
+                        break;
+                    default:
+                        const auto& featureTemplate = featureTemplates[e.feature];
+                        Vector3f pos = computeFeaturePosition(simulation.terrain, featureTemplate, x, y);
+                        simulation.addFeature(createFeature(pos, featureTemplate));
+                }
+            }
+        }
+
+        if (schema)
+        {
+            for (const auto& f : schema->features)
+            {
+                const auto& featureTemplate = featureService.getFeatureDefinition(f.featureName);
+                Vector3f pos = computeFeaturePosition(simulation.terrain, featureTemplate, f.xPos, f.zPos);
+                simulation.addFeature(createFeature(pos, featureTemplate));
+            }
+        }
+    }
+
+    unsigned int computeMidpointHeight(const Grid<unsigned char>& heightmap, std::size_t x, std::size_t y)
+    {
+        assert(x < heightmap.getWidth() - 1);
+        assert(y < heightmap.getHeight() - 1);
+        return (heightmap.get(x, y) + heightmap.get(x + 1, y) + heightmap.get(x, y + 1) + heightmap.get(x + 1, y + 1)) / 4u;
+    }
+
+    UnitDatabase createUnitDatabase(AbstractVirtualFileSystem* vfs, AudioService* audioService)
+    {
+        UnitDatabase db;
+
+        // read sound categories
+        {
+            auto bytes = vfs->readFile("gamedata/SOUND.TDF");
+            if (!bytes)
+            {
+                throw std::runtime_error("Failed to read gamedata/SOUND.TDF");
+            }
+
+            std::string soundString(bytes->data(), bytes->size());
+            auto sounds = parseSoundTdf(parseTdfFromString(soundString));
+            for (auto& s : sounds)
+            {
+                const auto& c = s.second;
+                preloadSound(audioService, db, c.select1);
+                preloadSound(audioService, db, c.ok1);
+                preloadSound(audioService, db, c.arrived1);
+                preloadSound(audioService, db, c.cant1);
+                preloadSound(audioService, db, c.underAttack);
+                preloadSound(audioService, db, c.count5);
+                preloadSound(audioService, db, c.count4);
+                preloadSound(audioService, db, c.count3);
+                preloadSound(audioService, db, c.count2);
+                preloadSound(audioService, db, c.count1);
+                preloadSound(audioService, db, c.count0);
+                preloadSound(audioService, db, c.cancelDestruct);
+                db.addSoundClass(s.first, std::move(s.second));
+            }
+        }
+
+        // read movement classes
+        {
+            auto bytes = vfs->readFile("gamedata/MOVEINFO.TDF");
+            if (!bytes)
+            {
+                throw std::runtime_error("Failed to read gamedata/MOVEINFO.TDF");
+            }
+
+            std::string movementString(bytes->data(), bytes->size());
+            auto classes = parseMovementTdf(parseTdfFromString(movementString));
+            for (auto& c : classes)
+            {
+                auto name = c.second.name;
+                db.addMovementClass(name, std::move(c.second));
+            }
+        }
+
+        // read weapons
+        {
+            auto weaponFiles = vfs->getFileNames("weapons", ".tdf");
+
+            for (const auto& fileName : weaponFiles)
+            {
+                auto bytes = vfs->readFile("weapons/" + fileName);
+                if (!bytes)
+                {
+                    throw std::runtime_error("File in listing could not be read: " + fileName);
+                }
+
+                std::string tdfString(bytes->data(), bytes->size());
+                auto entries = parseWeaponTdf(parseTdfFromString(tdfString));
+
+                for (auto& pair : entries)
+                {
+                    preloadSound(audioService, db, pair.second.soundStart);
+                    preloadSound(audioService, db, pair.second.soundHit);
+                    preloadSound(audioService, db, pair.second.soundWater);
+                    db.addWeapon(pair.first, std::move(pair.second));
+                }
+            }
+        }
+
+        // read unit FBIs
+        {
+            auto fbis = vfs->getFileNames("units", ".fbi");
+
+            for (const auto& fbiName : fbis)
+            {
+                auto bytes = vfs->readFile("units/" + fbiName);
+                if (!bytes)
+                {
+                    throw std::runtime_error("File in listing could not be read: " + fbiName);
+                }
+
+                std::string fbiString(bytes->data(), bytes->size());
+                auto fbi = parseUnitFbi(parseTdfFromString(fbiString));
+
+                db.addUnitInfo(fbi.unitName, fbi);
+            }
+        }
+
+        // read unit scripts
+        {
+            auto scripts = vfs->getFileNames("scripts", ".cob");
+
+            for (const auto& scriptName : scripts)
+            {
+                auto bytes = vfs->readFile("scripts/" + scriptName);
+                if (!bytes)
+                {
+                    throw std::runtime_error("File in listing could not be read: " + scriptName);
+                }
+
+                boost::interprocess::bufferstream s(bytes->data(), bytes->size());
+                auto cob = parseCob(s);
+
+                auto scriptNameWithoutExtension = scriptName.substr(0, scriptName.size() - 4);
+
+                db.addUnitScript(scriptNameWithoutExtension, std::move(cob));
+            }
+        }
+
+        return db;
+    }
+
+    MovementClassCollisionService createCollisionService(const GameSimulation& simulation, const UnitDatabase& unitDatabase)
+    {
+        MovementClassCollisionService collisionService;
+
+        const auto& terrain = simulation.terrain;
+        auto planes = computeWalkabilityPlanes(terrain.getHeightMap(), terrain.getSeaLevel());
+
+        std::vector<std::pair<const std::string*, const MovementClass*>> movementClasses;
+        UnitDatabase::MovementClassIterator it = unitDatabase.movementClassBegin();
+        UnitDatabase::MovementClassIterator end = unitDatabase.movementClassEnd();
+        for (; it != end; ++it)
+        {
+            movementClasses.emplace_back(&it->first, &it->second);
+        }
+
+        // Compute the walkable grid for each movement class in parallel.
+        // There are only a handful of classes and each one is expensive,
+        // so hand them out one at a time rather than in batches.
+        // Registration happens afterwards, in the original order,
+        // so that each class gets the same ID as it would serially.
+        std::vector<Grid<char>> walkableGrids(movementClasses.size());
+        {
+            WorkerPool workerPool(WorkerPool::defaultWorkerCount());
+            workerPool.parallelFor(movementClasses.size(), [&](std::size_t i) {
+                walkableGrids[i] = computeWalkableGrid(planes, *movementClasses[i].second);
+            }, 1);
+        }
+
+        for (std::size_t i = 0; i < movementClasses.size(); ++i)
+        {
+            collisionService.registerMovementClass(*movementClasses[i].first, std::move(walkableGrids[i]));
+        }
+
+        return collisionService;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef RWE_LOADING_UTILS_H
+#define RWE_LOADING_UTILS_H
+
+#include <boost/optional.hpp>
+#include <functional>
+#include <rwe/AudioService.h>
+#include <rwe/FeatureDefinition.h>
+#include <rwe/GameSimulation.h>
+#include <rwe/Grid.h>
+#include <rwe/MapFeatureService.h>
+#include <rwe/MapTerrain.h>
+#include <rwe/MovementClassCollisionService.h>
+#include <rwe/UnitDatabase.h>
+#include <rwe/math/Vector3f.h>
+#include <rwe/ota.h>
+#include <rwe/tnt/TntArchive.h>
+#include <rwe/vfs/AbstractVirtualFileSystem.h>
+
+/**
+ * Functions for loading game data that do not depend on
+ * the graphics card, so they can be shared between
+ * the game's loading screen and the headless simulation runner.
+ */
+namespace rwe
+{
+    Grid<std::size_t> getMapData(TntArchive& tnt);
+
+    Grid<unsigned char> getHeightGrid(const Grid<TntTileAttributes>& attrs);
+
+    unsigned int computeMidpointHeight(const Grid<unsigned char>& heightmap, std::size_t x, std::size_t y);
+
+    Vector3f computeFeaturePosition(const MapTerrain& terrain, const FeatureDefinition& featureDefinition, std::size_t x, std::size_t y);
+
+    /**
+     * Creates a feature with only the parts that matter to the simulation.
+     * The sprites are left empty, for callers that draw features to fill in.
+     */
+    MapFeature createMapFeature(const Vector3f& position, const FeatureDefinition& definition);
+
+    /**
+     * Adds the features placed on the map's tiles to the simulation,
+     * followed by those in the schema, if there is one.
+     * createFeature makes the feature to add from its definition and position.
+     */
+    void addMapFeatures(
+        GameSimulation& simulation,
+        TntArchive& tnt,
+        const Grid<TntTileAttributes>& mapAttributes,
+        boost::optional<const OtaSchema&> schema,
+        MapFeatureService& featureService,
+        const std::function<MapFeature(const Vector3f&, const FeatureDefinition&)>& createFeature);
+
+    /**
+     * Reads sound classes, movement classes, weapons,
+     * unit FBIs and unit scripts from the file system.
+     * Sounds are preloaded via the audio service,
+     * unless it is null, in which case the database has no sounds.
+     */
+    UnitDatabase createUnitDatabase(AbstractVirtualFileSystem* vfs, AudioService* audioService);
+
+    /**
+     * Computes the walkable grid for each movement class in the database.
+     */
+    MovementClassCollisionService createCollisionService(const GameSimulation& simulation, const UnitDatabase& unitDatabase);
+}
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef RWE_ASTAROPENLIST_H
+#define RWE_ASTAROPENLIST_H
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+namespace rwe
+{
+    /** The open list position of a node that isn't in the open list. */
+    constexpr std::size_t AStarNotInOpenList = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * An open list for A* searches, as a binary heap
+     * ordered by the nodes' estimated total cost.
+     *
+     * The list holds pointers to nodes owned elsewhere,
+     * and each node records its own position in the list
+     * in its openListIndex, so no lookup is needed to find it.
+     * Ties are ordered exactly as MinHeap orders them.
+     */
+    template <typename Node>
+    class BinaryOpenList
+    {
+    private:
+        std::vector<Node*> heap;
+
+    public:
+        void clear()
+        {
+            heap.clear();
+        }
+
+        bool empty() const
+        {
+            return heap.empty();
+        }
+
+        std::size_t size() const
+        {
+            return heap.size();
+        }
+
+        /** Adds a node that isn't in the list. */
+        void push(Node& node)
+        {
+            heap.push_back(&node);
+            siftUp(heap.size() - 1, &node);
+        }
+
+        /** Lowers the estimated total cost of a node in the list. */
+        template <typename Cost>
+        void decrease(Node& node, const Cost& estimatedTotalCost)
+        {
+            assert(node.openListIndex < heap.size() && heap[node.openListIndex] == &node);
+            node.estimatedTotalCost = estimatedTotalCost;
+            siftUp(node.openListIndex, &node);
+        }
+
+        /** Removes and returns the node with the lowest estimated total cost. */
+        Node& pop()
+        {
+            auto* first = heap.front();
+            auto* last = heap.back();
+            heap.pop_back();
+
+            if (!heap.empty())
+            {
+                siftDown(0, last);
+            }
+
+            first->openListIndex = AStarNotInOpenList;
+            return *first;
+        }
+
+        /** Removes a node from anywhere in the list. */
+        void remove(Node& node)
+        {
+            auto position = node.openListIndex;
+            assert(position < heap.size() && heap[position] == &node);
+            auto* last = heap.back();
+            heap.pop_back();
+            node.openListIndex = AStarNotInOpenList;
+
+            if (last == &node)
+            {
+                return;
+            }
+
+            if (position > 0 && last->estimatedTotalCost < heap[(position - 1) / 2]->estimatedTotalCost)
+            {
+                siftUp(position, last);
+            }
+            else
+            {
+                siftDown(position, last);
+            }
+        }
+
+    private:
+        void siftUp(std::size_t position, Node* node)
+        {
+            while (position > 0)
+            {
+                auto parentPosition = (position - 1) / 2;
+                auto* parent = heap[parentPosition];
+                if (!(node->estimatedTotalCost < parent->estimatedTotalCost))
+                {
+                    break;
+                }
+
+                heap[position] = parent;
+                parent->openListIndex = position;
+                position = parentPosition;
+            }
+
+            heap[position] = node;
+            node->openListIndex = position;
+        }
+
+        void siftDown(std::size_t position, Node* node)
+        {
+            auto firstLeafPosition = heap.size() / 2;
+            while (position < firstLeafPosition) // while non-leaf
+            {
+                auto smallestChildPosition = (position * 2) + 1;
+                auto rightChildPosition = (position * 2) + 2;
+                if (rightChildPosition < heap.size()
+                    && heap[rightChildPosition]->estimatedTotalCost < heap[smallestChildPosition]->estimatedTotalCost)
+                {
+                    smallestChildPosition = rightChildPosition;
+                }
+
+                auto* smallestChild = heap[smallestChildPosition];
+                if (node->estimatedTotalCost < smallestChild->estimatedTotalCost)
+                {
+                    break;
+                }
+
+                heap[position] = smallestChild;
+                smallestChild->openListIndex = position;
+                position = smallestChildPosition;
+            }
+
+            heap[position] = node;
+            node->openListIndex = position;
+        }
+    };
+
+    /**
+     * An open list for A* searches whose costs round down to small integers,
+     * such as distances across a grid.
+     *
+     * Nodes are kept in a bucket for each whole number of their estimated total cost,
+     * given by BucketKey, which must never put a cheaper node in a later bucket.
+     * Each bucket is a small binary heap, so nodes still come out in exact cost order,
+     * but each push and pop only has to reorder the few nodes that share a bucket.
+     * The cheapest non-empty bucket is found by scanning forward,
+     * which is cheap because A* rarely adds a node cheaper than the last one it took.
+     *
+     * A node's openListIndex is its position within its bucket,
+     * whose number is worked out again from its cost when needed.
+     */
+    template <typename Node, typename BucketKey>
+    class BucketOpenList
+    {
+    private:
+        std::vector<BinaryOpenList<Node>> buckets;
+
+        /** No bucket before this one holds any nodes. */
+        std::size_t lowestBucket{0};
+
+        std::size_t count{0};
+
+        BucketKey bucketKey;
+
+    public:
+        void clear()
+        {
+            for (auto i = lowestBucket; i < buckets.size(); ++i)
+            {
+                buckets[i].clear();
+            }
+
+            lowestBucket = 0;
+            count = 0;
+        }
+
+        bool empty() const
+        {
+            return count == 0;
+        }
+
+        std::size_t size() const
+        {
+            return count;
+        }
+
+        /** Adds a node that isn't in the list. */
+        void push(Node& node)
+        {
+            auto bucket = bucketKey(node.estimatedTotalCost);
+            if (bucket >= buckets.size())
+            {
+                buckets.resize(bucket + 1);
+            }
+
+            buckets[bucket].push(node);
+            lowestBucket = std::min(lowestBucket, bucket);
+            count += 1;
+        }
+
+        /** Lowers the estimated total cost of a node in the list. */
+        template <typename Cost>
+        void decrease(Node& node, const Cost& estimatedTotalCost)
+        {
+            auto oldBucket = bucketKey(node.estimatedTotalCost);
+            auto newBucket = bucketKey(estimatedTotalCost);
+            assert(newBucket <= oldBucket);
+            if (newBucket == oldBucket)
+            {
+                buckets[oldBucket].decrease(node, estimatedTotalCost);
+                return;
+            }
+
+            buckets[oldBucket].remove(node);
+            node.estimatedTotalCost = estimatedTotalCost;
+            buckets[newBucket].push(node);
+            lowestBucket = std::min(lowestBucket, newBucket);
+        }
+
+        /** Removes and returns the node with the lowest estimated total cost. */
+        Node& pop()
+        {
+            assert(count > 0);
+            while (buckets[lowestBucket].empty())
+            {
+                ++lowestBucket;
+            }
+
+            count -= 1;
+            return buckets[lowestBucket].pop();
+        }
+    };
+}
+
+#endif
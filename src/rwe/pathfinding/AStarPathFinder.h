@@ -1,11 +1,12 @@
 #ifndef RWE_ASTARPATHFINDER_H
 #define RWE_ASTARPATHFINDER_H
 
+#include <algorithm>
 #include <boost/optional.hpp>
-#include <deque>
-#include <rwe/MinHeap.h>
+#include <cassert>
+#include <rwe/pathfinding/AStarOpenList.h>
+#include <rwe/pathfinding/SearchProgress.h>
 #include <spdlog/spdlog.h>
-#include <unordered_map>
 #include <vector>
 
 namespace rwe
@@ -30,45 +31,163 @@ namespace rwe
         Partial
     };
 
+    /** A vertex closed by a search, and the vertex it was reached from. */
+    template <typename T>
+    struct AStarClosedVertex
+    {
+        T vertex;
+        boost::optional<T> predecessor;
+    };
+
     template <typename T, typename Cost>
     struct AStarPathInfo
     {
         AStarPathType type;
         std::vector<T> path;
-        std::unordered_map<T, AStarVertexInfo<T, Cost>> closedVertices;
+        std::vector<AStarClosedVertex<T>> closedVertices;
     };
 
-    template <typename T, typename Cost = float>
+    /**
+     * Dense storage for the vertices visited by A* searches.
+     * Each vertex maps to a fixed slot, chosen by the pathfinder.
+     *
+     * The pool is sized once and reused by every search that uses it.
+     * Rather than clearing every node between searches,
+     * each node is stamped with the search that last touched it.
+     * Nodes with an old stamp count as unvisited.
+     *
+     * OpenList chooses how the open list is ordered.
+     * The default suits any cost type,
+     * while BucketOpenList is quicker for costs that round to small integers.
+     */
+    template <typename T, typename Cost = float, template <typename> class OpenList = BinaryOpenList>
+    class AStarNodePool
+    {
+    public:
+        using VertexInfo = AStarVertexInfo<T, Cost>;
+
+        static constexpr std::size_t NotInOpenList = AStarNotInOpenList;
+
+        struct Node
+        {
+            VertexInfo info;
+            Cost estimatedTotalCost;
+            unsigned int generation{0};
+            std::size_t openListIndex{NotInOpenList};
+            bool closed{false};
+        };
+
+    private:
+        std::vector<Node> nodes;
+        unsigned int generation{0};
+
+    public:
+        /** The open list of the current search. */
+        OpenList<Node> openList;
+
+        /** The nodes closed by the current search, in the order they were closed. */
+        std::vector<const Node*> closedList;
+
+        /** Scratch space for the successors of the vertex being expanded. */
+        std::vector<VertexInfo> successors;
+
+        /** If set, told about every vertex expanded by searches using the pool. */
+        SearchProgress* progress{nullptr};
+
+        explicit AStarNodePool(std::size_t size) : nodes(size)
+        {
+        }
+
+        std::size_t size() const
+        {
+            return nodes.size();
+        }
+
+        /**
+         * Forgets every node from the previous search.
+         * This takes constant time, except once every few billion searches
+         * when the generation counter wraps around.
+         */
+        void beginSearch()
+        {
+            ++generation;
+            if (generation == 0)
+            {
+                for (auto& node : nodes)
+                {
+                    node.generation = 0;
+                }
+                generation = 1;
+            }
+
+            openList.clear();
+            closedList.clear();
+            successors.clear();
+        }
+
+        /**
+         * Returns the node at the given index.
+         * If the current search has not touched the node yet,
+         * it is reset to be neither open nor closed.
+         */
+        Node& get(std::size_t index)
+        {
+            assert(index < nodes.size());
+            auto& node = nodes[index];
+            if (node.generation != generation)
+            {
+                node.generation = generation;
+                node.openListIndex = NotInOpenList;
+                node.closed = false;
+            }
+
+            return node;
+        }
+    };
+
+    template <typename T, typename Cost = float, template <typename> class OpenList = BinaryOpenList>
     class AStarPathFinder
     {
     public:
         using VertexInfo = AStarVertexInfo<T, Cost>;
+        using NodePool = AStarNodePool<T, Cost, OpenList>;
+        using Node = typename NodePool::Node;
+
+    private:
+        NodePool* const nodePool;
 
     public:
+        explicit AStarPathFinder(NodePool* nodePool) : nodePool(nodePool)
+        {
+        }
+
         AStarPathInfo<T, Cost> findPath(const T& start)
         {
-            auto openVertices = createMinHeap<T, std::pair<Cost, VertexInfo>>(
-                [](const auto& p) { return p.second.vertex; },
-                [](const auto& a, const auto& b) { return a.first < b.first; });
-            openVertices.pushOrDecrease({estimateCostToGoal(start), VertexInfo{Cost(), start, boost::none}});
+            auto& pool = *nodePool;
+            pool.beginSearch();
 
-            std::unordered_map<T, VertexInfo> closedVertices;
+            pushOrDecrease(pool.get(getNodeIndex(start)), VertexInfo{Cost(), start, boost::none}, estimateCostToGoal(start));
 
             boost::optional<std::pair<Cost, const VertexInfo*>> closestVertex;
 
             unsigned int openListPopsPerformed = 0;
 
-            while (!openVertices.empty() && openListPopsPerformed < MaxOpenListQueries)
+            while (!pool.openList.empty() && openListPopsPerformed < MaxOpenListQueries)
             {
-                const std::pair<Cost, VertexInfo>& openFront = openVertices.top();
-                const VertexInfo& current = closedVertices[openFront.second.vertex] = openFront.second;
-                openVertices.pop();
+                auto& currentNode = pool.openList.pop();
+                currentNode.closed = true;
+                pool.closedList.push_back(&currentNode);
+                const VertexInfo& current = currentNode.info;
                 openListPopsPerformed += 1;
+                if (pool.progress != nullptr)
+                {
+                    pool.progress->addExpansion();
+                }
 
                 if (isGoal(current.vertex))
                 {
                     spdlog::get("rwe")->debug("Found goal after visiting {0} vertices", openListPopsPerformed);
-                    return AStarPathInfo<T, Cost>{AStarPathType::Complete, walkPath(current), std::move(closedVertices)};
+                    return AStarPathInfo<T, Cost>{AStarPathType::Complete, walkPath(current), getClosedVertices()};
                 }
 
                 auto estimatedCostToGoal = estimateCostToGoal(current.vertex);
@@ -77,20 +196,23 @@ namespace rwe
                     closestVertex = std::pair<Cost, const VertexInfo*>(estimatedCostToGoal, &current);
                 }
 
-                for (const VertexInfo& s : getSuccessors(current))
+                pool.successors.clear();
+                getSuccessors(current, pool.successors);
+                for (const VertexInfo& s : pool.successors)
                 {
-                    if (closedVertices.find(s.vertex) != closedVertices.end())
+                    auto& node = pool.get(getNodeIndex(s.vertex));
+                    if (node.closed)
                     {
                         continue;
                     }
 
                     auto estimatedTotalCost = s.costToReach + estimateCostToGoal(s.vertex);
-                    openVertices.pushOrDecrease({estimatedTotalCost, s});
+                    pushOrDecrease(node, s, estimatedTotalCost);
                 }
             }
 
             spdlog::get("rwe")->debug("Failed to find goal, visited {0} vertices", openListPopsPerformed);
-            return AStarPathInfo<T, Cost>{AStarPathType::Partial, walkPath(*(closestVertex->second)), std::move(closedVertices)};
+            return AStarPathInfo<T, Cost>{AStarPathType::Partial, walkPath(*(closestVertex->second)), getClosedVertices()};
         }
 
     protected:
@@ -98,7 +220,18 @@ namespace rwe
 
         virtual Cost estimateCostToGoal(const T& vertex) = 0;
 
-        virtual std::vector<VertexInfo> getSuccessors(const VertexInfo& vertex) = 0;
+        /**
+         * Appends the successors of the given vertex to the output vector.
+         * The vector's storage is reused between calls,
+         * so this should not need to allocate.
+         */
+        virtual void getSuccessors(const VertexInfo& vertex, std::vector<VertexInfo>& successors) = 0;
+
+        /**
+         * Returns the slot in the node pool that holds the given vertex.
+         * Distinct vertices must map to distinct slots.
+         */
+        virtual std::size_t getNodeIndex(const T& vertex) const = 0;
 
     private:
         std::vector<T> walkPath(const VertexInfo& info)
@@ -114,6 +247,43 @@ namespace rwe
             std::reverse(items.begin(), items.end());
             return items;
         }
+
+        std::vector<AStarClosedVertex<T>> getClosedVertices() const
+        {
+            std::vector<AStarClosedVertex<T>> vertices;
+            vertices.reserve(nodePool->closedList.size());
+            for (const auto* node : nodePool->closedList)
+            {
+                boost::optional<T> predecessor;
+                if (node->info.predecessor)
+                {
+                    predecessor = (*node->info.predecessor)->vertex;
+                }
+                vertices.push_back(AStarClosedVertex<T>{node->info.vertex, predecessor});
+            }
+
+            return vertices;
+        }
+
+        void pushOrDecrease(Node& node, const VertexInfo& info, const Cost& estimatedTotalCost)
+        {
+            auto& openList = nodePool->openList;
+            if (node.openListIndex == NodePool::NotInOpenList)
+            {
+                node.info = info;
+                node.estimatedTotalCost = estimatedTotalCost;
+                openList.push(node);
+                return;
+            }
+
+            if (!(estimatedTotalCost < node.estimatedTotalCost))
+            {
+                return;
+            }
+
+            node.info = info;
+            openList.decrease(node, estimatedTotalCost);
+        }
     };
 }
 
@@ -3,23 +3,31 @@
 namespace rwe
 {
     AbstractUnitPathFinder::AbstractUnitPathFinder(
-        GameSimulation* simulation,
-        MovementClassCollisionService* collisionService,
+        NodePool* nodePool,
+        const OccupiedGrid* occupiedGrid,
+        const MovementClassCollisionService* collisionService,
         UnitId self,
+        const DiscreteRect& selfArea,
         boost::optional<MovementClassId> movementClass,
         unsigned int footprintX,
         unsigned int footprintZ)
-        : simulation(simulation),
+        : AStarPathFinder(nodePool),
+          occupiedGrid(occupiedGrid),
           collisionService(collisionService),
           self(self),
+          selfArea(selfArea),
           movementClass(movementClass),
           footprintX(footprintX),
           footprintZ(footprintZ)
     {
     }
 
-    std::vector<AbstractUnitPathFinder::VertexInfo>
-    AbstractUnitPathFinder::getSuccessors(const VertexInfo& info)
+    void AbstractUnitPathFinder::setSearchArea(const DiscreteRect& area)
+    {
+        searchArea = area;
+    }
+
+    void AbstractUnitPathFinder::getSuccessors(const VertexInfo& info, std::vector<VertexInfo>& successors)
     {
         boost::optional<Direction> prevDirection;
         if (info.predecessor)
@@ -27,12 +35,14 @@ namespace rwe
             prevDirection = pointToDirection(info.vertex - (*info.predecessor)->vertex);
         }
 
-        auto neighbours = getNeighbours(info.vertex);
-
-        std::vector<VertexInfo> vs;
-        for (const auto& neighbour : neighbours)
+        for (auto direction : Directions)
         {
-            auto direction = pointToDirection(neighbour - info.vertex);
+            auto neighbour = step(info.vertex, direction);
+            if (!isWalkable(neighbour))
+            {
+                continue;
+            }
+
             auto distance = octileDistance(info.vertex, neighbour);
             assert(distance.diagonal == 0 || distance.straight == 0);
             if (isRoughTerrain(neighbour))
@@ -42,16 +52,31 @@ namespace rwe
             }
             unsigned int turns = (!prevDirection || direction == *prevDirection) ? 0 : 1;
             PathCost cost(distance, turns);
-            vs.push_back(VertexInfo{info.costToReach + cost, neighbour, &info});
+            successors.push_back(VertexInfo{info.costToReach + cost, neighbour, &info});
         }
+    }
 
-        return vs;
+    std::size_t AbstractUnitPathFinder::getNodeIndex(const Point& vertex) const
+    {
+        // Unwalkable points are never expanded,
+        // and everything outside the grid is unwalkable,
+        // so the vertex is always inside the grid.
+        return occupiedGrid->grid.toIndex(vertex.x, vertex.y);
     }
 
     bool AbstractUnitPathFinder::isWalkable(const Point& p) const
     {
+        if (searchArea
+            && (p.x < searchArea->x
+                || p.y < searchArea->y
+                || p.x >= searchArea->x + static_cast<int>(searchArea->width)
+                || p.y >= searchArea->y + static_cast<int>(searchArea->height)))
+        {
+            return false;
+        }
+
         DiscreteRect rect(p.x, p.y, footprintX, footprintZ);
-        return (movementClass ? collisionService->isWalkable(*movementClass, p) : true) && !simulation->isCollisionAt(rect, self);
+        return (movementClass ? collisionService->isWalkable(*movementClass, p) : true) && !occupiedGrid->isCollisionAt(rect, self, selfArea);
     }
 
     bool AbstractUnitPathFinder::isWalkable(int x, int y) const
@@ -62,7 +87,7 @@ namespace rwe
     bool AbstractUnitPathFinder::isRoughTerrain(const Point& p) const
     {
         DiscreteRect rect(p.x, p.y, footprintX, footprintZ);
-        return simulation->isAdjacentToObstacle(rect, self);
+        return occupiedGrid->isAdjacentToObstacle(rect, self, selfArea);
     }
 
     Point AbstractUnitPathFinder::step(const Point& p, Direction d) const
@@ -70,24 +95,4 @@ namespace rwe
         auto directionVector = directionToPoint(d);
         return p + directionVector;
     }
-
-    std::vector<Point> AbstractUnitPathFinder::getNeighbours(const Point& p)
-    {
-        std::vector<Point> neighbours;
-        neighbours.reserve(Directions.size());
-
-        for (auto d : Directions)
-        {
-            auto newPosition = step(p, d);
-
-            if (!isWalkable(newPosition))
-            {
-                continue;
-            }
-
-            neighbours.push_back(newPosition);
-        }
-
-        return neighbours;
-    }
 }
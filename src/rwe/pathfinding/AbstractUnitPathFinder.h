@@ -5,37 +5,60 @@
 #include "pathfinding_utils.h"
 #include <rwe/DiscreteRect.h>
 #include <rwe/EightWayDirection.h>
-#include <rwe/GameSimulation.h>
 #include <rwe/MovementClassCollisionService.h>
+#include <rwe/OccupiedGrid.h>
 #include <rwe/UnitId.h>
 #include <rwe/pathfinding/AStarPathFinder.h>
 
 namespace rwe
 {
+    template <typename Node>
+    using PathCostOpenList = BucketOpenList<Node, PathCostBucketKey>;
+
     /**
      * Standard unit pathfinder.
+     * Searches the heightmap grid, so the node pool
+     * must have one node for every heightmap cell.
      */
-    class AbstractUnitPathFinder : public AStarPathFinder<Point, PathCost>
+    class AbstractUnitPathFinder : public AStarPathFinder<Point, PathCost, PathCostOpenList>
     {
     private:
-        GameSimulation* const simulation;
-        MovementClassCollisionService* const collisionService;
+        const OccupiedGrid* const occupiedGrid;
+        const MovementClassCollisionService* const collisionService;
         const UnitId self;
+
+        /** The cells occupied by the unit we are finding a path for. */
+        const DiscreteRect selfArea;
+
         const boost::optional<MovementClassId> movementClass;
         const unsigned int footprintX;
         const unsigned int footprintZ;
 
+        /** If set, positions outside this area are treated as unwalkable. */
+        boost::optional<DiscreteRect> searchArea;
+
     public:
         AbstractUnitPathFinder(
-            GameSimulation* simulation,
-            MovementClassCollisionService* collisionService,
+            NodePool* nodePool,
+            const OccupiedGrid* occupiedGrid,
+            const MovementClassCollisionService* collisionService,
             UnitId self,
+            const DiscreteRect& selfArea,
             boost::optional<MovementClassId> movementClass,
             unsigned int footprintX,
             unsigned int footprintZ);
 
+        /**
+         * Confines the search to positions inside the given area.
+         * This bounds the work done by searches for goals
+         * that are known to be nearby.
+         */
+        void setSearchArea(const DiscreteRect& area);
+
     protected:
-        std::vector<VertexInfo> getSuccessors(const VertexInfo& vertex) override;
+        void getSuccessors(const VertexInfo& vertex, std::vector<VertexInfo>& successors) override;
+
+        std::size_t getNodeIndex(const Point& vertex) const override;
 
     private:
         bool isWalkable(const Point& p) const;
@@ -45,8 +68,6 @@ namespace rwe
         bool isRoughTerrain(const Point& p) const;
 
         Point step(const Point& p, Direction d) const;
-
-        std::vector<Point> getNeighbours(const Point& p);
     };
 }
 
@@ -0,0 +1,154 @@
+#include "FlowField.h"
+#include <algorithm>
+#include <rwe/EightWayDirection.h>
+#include <rwe/pathfinding/OctileDistance.h>
+
+namespace rwe
+{
+    static bool isInGrid(const Grid<float>& grid, const Point& p)
+    {
+        return p.x >= 0 && p.y >= 0 && static_cast<std::size_t>(p.x) < grid.getWidth() && static_cast<std::size_t>(p.y) < grid.getHeight();
+    }
+
+    FlowField::FlowField(const Grid<char>& passable, const Point& goal, unsigned int footprintX, unsigned int footprintZ, SearchProgress* progress)
+        : goal(goal),
+          footprintX(footprintX),
+          footprintZ(footprintZ),
+          costs(passable.getWidth(), passable.getHeight(), Unreachable),
+          passable(passable)
+    {
+        if (!isInGrid(costs, goal))
+        {
+            return;
+        }
+
+        struct OpenEntry
+        {
+            float cost;
+            Point position;
+        };
+        auto compare = [](const OpenEntry& a, const OpenEntry& b) {
+            if (a.cost != b.cost)
+            {
+                return a.cost > b.cost;
+            }
+            return a.position.y != b.position.y ? a.position.y > b.position.y : a.position.x > b.position.x;
+        };
+
+        std::vector<OpenEntry> open;
+        costs.set(goal.x, goal.y, 0.0f);
+        open.push_back(OpenEntry{0.0f, goal});
+
+        while (!open.empty())
+        {
+            std::pop_heap(open.begin(), open.end(), compare);
+            auto current = open.back();
+            open.pop_back();
+
+            if (current.cost != costs.get(current.position.x, current.position.y))
+            {
+                // superseded by a cheaper entry
+                continue;
+            }
+
+            if (progress != nullptr)
+            {
+                progress->addExpansion();
+            }
+
+            // Paths step from each neighbour into this cell,
+            // which they can't do unless it is passable.
+            if (!passable.get(current.position.x, current.position.y))
+            {
+                continue;
+            }
+
+            for (auto direction : Directions)
+            {
+                auto neighbour = current.position + directionToPoint(direction);
+                if (!isInGrid(costs, neighbour))
+                {
+                    continue;
+                }
+
+                auto cost = current.cost + (isDiagonal(direction) ? OctileDistance(0, 1) : OctileDistance(1, 0)).asFloat();
+                if (!(cost < costs.get(neighbour.x, neighbour.y)))
+                {
+                    continue;
+                }
+
+                costs.set(neighbour.x, neighbour.y, cost);
+                open.push_back(OpenEntry{cost, neighbour});
+                std::push_heap(open.begin(), open.end(), compare);
+            }
+        }
+    }
+
+    const Point& FlowField::getGoal() const
+    {
+        return goal;
+    }
+
+    unsigned int FlowField::getFootprintX() const
+    {
+        return footprintX;
+    }
+
+    unsigned int FlowField::getFootprintZ() const
+    {
+        return footprintZ;
+    }
+
+    float FlowField::getCost(const Point& p) const
+    {
+        if (!isInGrid(costs, p))
+        {
+            return Unreachable;
+        }
+
+        return costs.get(p.x, p.y);
+    }
+
+    bool FlowField::isReachable(const Point& p) const
+    {
+        return getCost(p) != Unreachable;
+    }
+
+    boost::optional<Point> FlowField::getNextStep(const Point& p) const
+    {
+        boost::optional<Point> best;
+        auto bestCost = getCost(p);
+        for (auto direction : Directions)
+        {
+            auto neighbour = p + directionToPoint(direction);
+            auto cost = getCost(neighbour);
+
+            // Impassable cells have costs so that units on them can leave,
+            // but they must never be stepped into.
+            if (cost < bestCost && passable.get(neighbour.x, neighbour.y))
+            {
+                best = neighbour;
+                bestCost = cost;
+            }
+        }
+
+        return best;
+    }
+
+    Point FlowField::lookAhead(const Point& p, unsigned int maxSteps) const
+    {
+        auto current = p;
+        for (unsigned int i = 0; i < maxSteps; ++i)
+        {
+            auto next = getNextStep(current);
+            if (!next)
+            {
+                break;
+            }
+
+            current = *next;
+        }
+
+        return current;
+    }
+}
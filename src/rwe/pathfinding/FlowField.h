@@ -0,0 +1,72 @@
+#ifndef RWE_FLOWFIELD_H
+#define RWE_FLOWFIELD_H
+
+#include <boost/optional.hpp>
+#include <limits>
+#include <rwe/Grid.h>
+#include <rwe/Point.h>
+#include <rwe/pathfinding/SearchProgress.h>
+
+namespace rwe
+{
+    /**
+     * The cost of the cheapest path to a goal cell from every cell of a grid,
+     * found by a single search outward from the goal.
+     *
+     * Any number of units heading for the same goal can share one field,
+     * each finding its way by repeatedly stepping
+     * to its cheapest neighbouring cell.
+     *
+     * Cells are the top-left cells of a unit's footprint,
+     * so a field is only useful to units with the footprint it was built for.
+     */
+    class FlowField
+    {
+    public:
+        static constexpr float Unreachable = std::numeric_limits<float>::infinity();
+
+    private:
+        Point goal;
+        unsigned int footprintX;
+        unsigned int footprintZ;
+        Grid<float> costs;
+        Grid<char> passable;
+
+    public:
+        /**
+         * Builds the field over the given passability grid.
+         * Every cell entered along a path must be passable,
+         * but the cell a path starts from need not be,
+         * so units that have strayed onto an impassable cell can still leave it.
+         * If progress is given, it is told about every cell the search expands.
+         */
+        FlowField(const Grid<char>& passable, const Point& goal, unsigned int footprintX, unsigned int footprintZ, SearchProgress* progress = nullptr);
+
+        const Point& getGoal() const;
+
+        unsigned int getFootprintX() const;
+
+        unsigned int getFootprintZ() const;
+
+        /** Returns the cost of the path to the goal, or Unreachable if there is none. */
+        float getCost(const Point& p) const;
+
+        bool isReachable(const Point& p) const;
+
+        /**
+         * Returns the passable neighbour of the given cell
+         * that is cheapest to reach the goal from,
+         * or none if no such neighbour is cheaper than the cell itself.
+         * The given cell itself may be impassable.
+         */
+        boost::optional<Point> getNextStep(const Point& p) const;
+
+        /**
+         * Follows the field from the given cell for up to maxSteps steps
+         * and returns the cell it stopped at.
+         */
+        Point lookAhead(const Point& p, unsigned int maxSteps) const;
+    };
+}
+
+#endif
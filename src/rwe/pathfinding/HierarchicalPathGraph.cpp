@@ -0,0 +1,565 @@
+#include "HierarchicalPathGraph.h"
+#include "pathfinding_utils.h"
+#include <algorithm>
+#include <rwe/EightWayDirection.h>
+
+namespace rwe
+{
+    /**
+     * Searches the entrance graph.
+     * The start and goal are usually not entrances themselves,
+     * so their links into the graph are worked out
+     * when the search is set up.
+     */
+    class HierarchicalPathGraphFinder : public AStarPathFinder<Point, OctileDistance>
+    {
+    private:
+        const HierarchicalPathGraph* const graph;
+        const Point start;
+        const Point goal;
+        const Point goalCluster;
+
+        /** Links from the start to the entrances of its cluster, and possibly the goal. */
+        std::vector<HierarchicalPathGraph::Edge> startEdges;
+
+        /** Links from the entrances of the goal's cluster to the goal. */
+        std::vector<HierarchicalPathGraph::Edge> goalEdges;
+
+    public:
+        HierarchicalPathGraphFinder(NodePool* nodePool, const HierarchicalPathGraph* graph, const Point& start, const Point& goal)
+            : AStarPathFinder(nodePool),
+              graph(graph),
+              start(start),
+              goal(goal),
+              goalCluster(graph->getCluster(goal)),
+              startEdges(graph->findEdgesInCluster(start, goal)),
+              goalEdges(graph->findEdgesInCluster(goal, goal))
+        {
+        }
+
+    protected:
+        bool isGoal(const Point& vertex) override
+        {
+            return vertex == goal;
+        }
+
+        OctileDistance estimateCostToGoal(const Point& vertex) override
+        {
+            return octileDistance(vertex, goal);
+        }
+
+        void getSuccessors(const VertexInfo& info, std::vector<VertexInfo>& successors) override
+        {
+            if (info.vertex == start)
+            {
+                for (const auto& edge : startEdges)
+                {
+                    successors.push_back(VertexInfo{info.costToReach + edge.cost, edge.target, &info});
+                }
+            }
+
+            auto cluster = graph->getCluster(info.vertex);
+            const auto& entrances = graph->getEntrances(cluster);
+            auto it = std::find_if(entrances.begin(), entrances.end(), [&info](const auto& e) { return e.position == info.vertex; });
+            if (it == entrances.end())
+            {
+                return;
+            }
+
+            for (const auto& edge : it->edges)
+            {
+                successors.push_back(VertexInfo{info.costToReach + edge.cost, edge.target, &info});
+            }
+
+            if (cluster == goalCluster)
+            {
+                // The search from the goal found paths from the goal to each entrance.
+                // Paths are just as long in either direction,
+                // so these are also the paths from each entrance to the goal.
+                auto goalEdge = std::find_if(goalEdges.begin(), goalEdges.end(), [&info](const auto& e) { return e.target == info.vertex; });
+                if (goalEdge != goalEdges.end())
+                {
+                    successors.push_back(VertexInfo{info.costToReach + goalEdge->cost, goal, &info});
+                }
+            }
+        }
+
+        std::size_t getNodeIndex(const Point& vertex) const override
+        {
+            return static_cast<std::size_t>(vertex.y) * graph->getWidth() + static_cast<std::size_t>(vertex.x);
+        }
+    };
+
+    static std::size_t ceilDivide(std::size_t a, std::size_t b)
+    {
+        return (a + b - 1) / b;
+    }
+
+    HierarchicalPathGraph::HierarchicalPathGraph(Grid<char>&& passable)
+        : passable(std::move(passable)),
+          clusters(ceilDivide(this->passable.getWidth(), ClusterSize), ceilDivide(this->passable.getHeight(), ClusterSize)),
+          dirtyClusters(clusters.getWidth(), clusters.getHeight(), false),
+          components(this->passable.getWidth(), this->passable.getHeight(), NoComponent)
+    {
+        for (std::size_t y = 0; y < clusters.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < clusters.getWidth(); ++x)
+            {
+                rebuildCluster(Point(x, y));
+            }
+        }
+
+        labelComponents();
+    }
+
+    std::size_t HierarchicalPathGraph::getWidth() const
+    {
+        return passable.getWidth();
+    }
+
+    std::size_t HierarchicalPathGraph::getHeight() const
+    {
+        return passable.getHeight();
+    }
+
+    bool HierarchicalPathGraph::isPassable(const Point& p) const
+    {
+        if (p.x < 0 || p.y < 0 || static_cast<std::size_t>(p.x) >= passable.getWidth() || static_cast<std::size_t>(p.y) >= passable.getHeight())
+        {
+            return false;
+        }
+
+        return passable.get(p.x, p.y);
+    }
+
+    const Grid<char>& HierarchicalPathGraph::getPassable() const
+    {
+        return passable;
+    }
+
+    void HierarchicalPathGraph::setPassable(std::size_t x, std::size_t y, bool value)
+    {
+        auto& cell = passable.get(x, y);
+        if (static_cast<bool>(cell) == value)
+        {
+            return;
+        }
+
+        cell = value;
+        dirtyClusters.set(x / ClusterSize, y / ClusterSize, true);
+        anyDirty = true;
+    }
+
+    unsigned int HierarchicalPathGraph::repair()
+    {
+        if (!anyDirty)
+        {
+            return 0;
+        }
+
+        // A changed cell can add or remove entrances on any border of its cluster,
+        // which changes the entrances of the clusters on the other side.
+        Grid<char> toRebuild(clusters.getWidth(), clusters.getHeight(), false);
+        for (std::size_t y = 0; y < clusters.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < clusters.getWidth(); ++x)
+            {
+                if (!dirtyClusters.get(x, y))
+                {
+                    continue;
+                }
+
+                toRebuild.set(x, y, true);
+                if (x > 0)
+                {
+                    toRebuild.set(x - 1, y, true);
+                }
+                if (x + 1 < clusters.getWidth())
+                {
+                    toRebuild.set(x + 1, y, true);
+                }
+                if (y > 0)
+                {
+                    toRebuild.set(x, y - 1, true);
+                }
+                if (y + 1 < clusters.getHeight())
+                {
+                    toRebuild.set(x, y + 1, true);
+                }
+            }
+        }
+
+        unsigned int rebuiltCount = 0;
+        for (std::size_t y = 0; y < clusters.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < clusters.getWidth(); ++x)
+            {
+                if (toRebuild.get(x, y))
+                {
+                    rebuildCluster(Point(x, y));
+                    rebuiltCount += 1;
+                }
+            }
+        }
+
+        dirtyClusters.setArea(0, 0, dirtyClusters.getWidth(), dirtyClusters.getHeight(), false);
+        anyDirty = false;
+
+        // Changes are rare enough that relabelling everything is fine.
+        labelComponents();
+
+        return rebuiltCount;
+    }
+
+    unsigned int HierarchicalPathGraph::getComponent(const Point& p) const
+    {
+        if (p.x < 0 || p.y < 0 || static_cast<std::size_t>(p.x) >= components.getWidth() || static_cast<std::size_t>(p.y) >= components.getHeight())
+        {
+            return NoComponent;
+        }
+
+        return components.get(p.x, p.y);
+    }
+
+    boost::optional<Point> HierarchicalPathGraph::findNearestInComponent(unsigned int component, const Point& target, unsigned int maxRadius) const
+    {
+        if (getComponent(target) == component)
+        {
+            return target;
+        }
+
+        // Search rings of increasing size around the target.
+        // The nearest cell in a ring is not always
+        // the nearest overall, but it is close enough.
+        for (int radius = 1; radius <= static_cast<int>(maxRadius); ++radius)
+        {
+            boost::optional<Point> best;
+            OctileDistance bestDistance;
+            auto consider = [&](const Point& p) {
+                if (getComponent(p) != component)
+                {
+                    return;
+                }
+
+                auto distance = octileDistance(target, p);
+                if (!best || distance < bestDistance)
+                {
+                    best = p;
+                    bestDistance = distance;
+                }
+            };
+
+            for (int dx = -radius; dx <= radius; ++dx)
+            {
+                consider(Point(target.x + dx, target.y - radius));
+                consider(Point(target.x + dx, target.y + radius));
+            }
+            for (int dy = -radius + 1; dy < radius; ++dy)
+            {
+                consider(Point(target.x - radius, target.y + dy));
+                consider(Point(target.x + radius, target.y + dy));
+            }
+
+            if (best)
+            {
+                return best;
+            }
+        }
+
+        return boost::none;
+    }
+
+    void HierarchicalPathGraph::labelComponents()
+    {
+        components.setArea(0, 0, components.getWidth(), components.getHeight(), NoComponent);
+
+        unsigned int nextComponent = NoComponent + 1;
+        std::vector<Point> frontier;
+        for (std::size_t y = 0; y < passable.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < passable.getWidth(); ++x)
+            {
+                if (!passable.get(x, y) || components.get(x, y) != NoComponent)
+                {
+                    continue;
+                }
+
+                // flood fill the new component
+                auto component = nextComponent++;
+                components.set(x, y, component);
+                frontier.emplace_back(x, y);
+                while (!frontier.empty())
+                {
+                    auto current = frontier.back();
+                    frontier.pop_back();
+
+                    for (auto direction : Directions)
+                    {
+                        auto neighbour = current + directionToPoint(direction);
+                        if (!isPassable(neighbour) || components.get(neighbour.x, neighbour.y) != NoComponent)
+                        {
+                            continue;
+                        }
+
+                        components.set(neighbour.x, neighbour.y, component);
+                        frontier.push_back(neighbour);
+                    }
+                }
+            }
+        }
+    }
+
+    Point HierarchicalPathGraph::getCluster(const Point& p) const
+    {
+        return Point(p.x / static_cast<int>(ClusterSize), p.y / static_cast<int>(ClusterSize));
+    }
+
+    DiscreteRect HierarchicalPathGraph::getClusterBounds(const Point& cluster) const
+    {
+        auto x = static_cast<unsigned int>(cluster.x) * ClusterSize;
+        auto y = static_cast<unsigned int>(cluster.y) * ClusterSize;
+        auto width = std::min<std::size_t>(ClusterSize, passable.getWidth() - x);
+        auto height = std::min<std::size_t>(ClusterSize, passable.getHeight() - y);
+        return DiscreteRect(x, y, width, height);
+    }
+
+    DiscreteRect HierarchicalPathGraph::getClusterBounds(const Point& a, const Point& b) const
+    {
+        auto boundsA = getClusterBounds(getCluster(a));
+        auto boundsB = getClusterBounds(getCluster(b));
+        auto left = std::min(boundsA.x, boundsB.x);
+        auto top = std::min(boundsA.y, boundsB.y);
+        auto right = std::max(boundsA.x + static_cast<int>(boundsA.width), boundsB.x + static_cast<int>(boundsB.width));
+        auto bottom = std::max(boundsA.y + static_cast<int>(boundsA.height), boundsB.y + static_cast<int>(boundsB.height));
+        return DiscreteRect(left, top, right - left, bottom - top);
+    }
+
+    bool HierarchicalPathGraph::inNeighbouringClusters(const Point& a, const Point& b) const
+    {
+        auto clusterA = getCluster(a);
+        auto clusterB = getCluster(b);
+        return std::abs(clusterA.x - clusterB.x) <= 1 && std::abs(clusterA.y - clusterB.y) <= 1;
+    }
+
+    const std::vector<HierarchicalPathGraph::Entrance>& HierarchicalPathGraph::getEntrances(const Point& cluster) const
+    {
+        return clusters.get(cluster.x, cluster.y);
+    }
+
+    AStarPathInfo<Point, OctileDistance> HierarchicalPathGraph::findPath(NodePool& nodePool, const Point& start, const Point& goal) const
+    {
+        assert(nodePool.size() >= passable.getWidth() * passable.getHeight());
+        HierarchicalPathGraphFinder pathFinder(&nodePool, this, start, goal);
+        return pathFinder.findPath(start);
+    }
+
+    std::vector<HierarchicalPathGraph::Edge> HierarchicalPathGraph::findEdgesInCluster(const Point& source, const Point& extraTarget) const
+    {
+        auto cluster = getCluster(source);
+        auto bounds = getClusterBounds(cluster);
+
+        std::vector<OctileDistance> costs;
+        std::vector<char> reached;
+        searchArea(source, bounds, costs, reached);
+
+        auto toLocalIndex = [&bounds](const Point& p) {
+            return static_cast<std::size_t>(p.y - bounds.y) * bounds.width + static_cast<std::size_t>(p.x - bounds.x);
+        };
+
+        std::vector<Edge> edges;
+        for (const auto& entrance : clusters.get(cluster.x, cluster.y))
+        {
+            auto index = toLocalIndex(entrance.position);
+            if (entrance.position != source && reached[index])
+            {
+                edges.push_back(Edge{entrance.position, costs[index]});
+            }
+        }
+
+        if (extraTarget != source && getCluster(extraTarget) == cluster)
+        {
+            auto index = toLocalIndex(extraTarget);
+            if (reached[index])
+            {
+                edges.push_back(Edge{extraTarget, costs[index]});
+            }
+        }
+
+        return edges;
+    }
+
+    void HierarchicalPathGraph::rebuildCluster(const Point& cluster)
+    {
+        auto& entrances = clusters.get(cluster.x, cluster.y);
+        entrances.clear();
+
+        auto bounds = getClusterBounds(cluster);
+        auto right = bounds.x + static_cast<int>(bounds.width) - 1;
+        auto bottom = bounds.y + static_cast<int>(bounds.height) - 1;
+
+        // Each border is walked in the same direction from both sides,
+        // so both clusters agree on where its entrances are.
+        if (cluster.y > 0)
+        {
+            addBorderEntrances(entrances, Point(bounds.x, bounds.y), Point(1, 0), Point(0, -1), bounds.width);
+        }
+        if (static_cast<std::size_t>(cluster.y) + 1 < clusters.getHeight())
+        {
+            addBorderEntrances(entrances, Point(bounds.x, bottom), Point(1, 0), Point(0, 1), bounds.width);
+        }
+        if (cluster.x > 0)
+        {
+            addBorderEntrances(entrances, Point(bounds.x, bounds.y), Point(0, 1), Point(-1, 0), bounds.height);
+        }
+        if (static_cast<std::size_t>(cluster.x) + 1 < clusters.getWidth())
+        {
+            addBorderEntrances(entrances, Point(right, bounds.y), Point(0, 1), Point(1, 0), bounds.height);
+        }
+
+        std::vector<OctileDistance> costs;
+        std::vector<char> reached;
+        for (auto& entrance : entrances)
+        {
+            searchArea(entrance.position, bounds, costs, reached);
+            for (const auto& other : entrances)
+            {
+                if (other.position == entrance.position)
+                {
+                    continue;
+                }
+
+                auto index = static_cast<std::size_t>(other.position.y - bounds.y) * bounds.width + static_cast<std::size_t>(other.position.x - bounds.x);
+                if (reached[index])
+                {
+                    entrance.edges.push_back(Edge{other.position, costs[index]});
+                }
+            }
+        }
+    }
+
+    void HierarchicalPathGraph::addBorderEntrances(
+        std::vector<Entrance>& entrances,
+        const Point& first,
+        const Point& along,
+        const Point& across,
+        unsigned int length) const
+    {
+        auto addEntrance = [&](unsigned int offset) {
+            Point position(first.x + (along.x * static_cast<int>(offset)), first.y + (along.y * static_cast<int>(offset)));
+            auto it = std::find_if(entrances.begin(), entrances.end(), [&position](const auto& e) { return e.position == position; });
+            if (it == entrances.end())
+            {
+                entrances.push_back(Entrance{position, std::vector<Edge>()});
+                it = entrances.end() - 1;
+            }
+
+            it->edges.push_back(Edge{position + across, OctileDistance(1, 0)});
+        };
+
+        unsigned int runStart = 0;
+        unsigned int runLength = 0;
+        for (unsigned int i = 0; i <= length; ++i)
+        {
+            if (i < length)
+            {
+                Point cell(first.x + (along.x * static_cast<int>(i)), first.y + (along.y * static_cast<int>(i)));
+                if (isPassable(cell) && isPassable(cell + across))
+                {
+                    if (runLength == 0)
+                    {
+                        runStart = i;
+                    }
+                    runLength += 1;
+                    continue;
+                }
+            }
+
+            if (runLength == 0)
+            {
+                continue;
+            }
+
+            if (runLength >= MinDoubleEntranceLength)
+            {
+                addEntrance(runStart);
+                addEntrance(runStart + runLength - 1);
+            }
+            else
+            {
+                addEntrance(runStart + ((runLength - 1) / 2));
+            }
+
+            runLength = 0;
+        }
+    }
+
+    void HierarchicalPathGraph::searchArea(
+        const Point& source,
+        const DiscreteRect& bounds,
+        std::vector<OctileDistance>& costs,
+        std::vector<char>& reached) const
+    {
+        auto toLocalIndex = [&bounds](const Point& p) {
+            return static_cast<std::size_t>(p.y - bounds.y) * bounds.width + static_cast<std::size_t>(p.x - bounds.x);
+        };
+
+        costs.assign(bounds.width * bounds.height, OctileDistance());
+        reached.assign(bounds.width * bounds.height, false);
+
+        struct OpenEntry
+        {
+            float cost;
+            Point position;
+        };
+        auto compare = [](const OpenEntry& a, const OpenEntry& b) {
+            if (a.cost != b.cost)
+            {
+                return a.cost > b.cost;
+            }
+            return a.position.y != b.position.y ? a.position.y > b.position.y : a.position.x > b.position.x;
+        };
+
+        std::vector<OpenEntry> open;
+        reached[toLocalIndex(source)] = true;
+        open.push_back(OpenEntry{0.0f, source});
+
+        while (!open.empty())
+        {
+            std::pop_heap(open.begin(), open.end(), compare);
+            auto current = open.back();
+            open.pop_back();
+
+            auto currentCost = costs[toLocalIndex(current.position)];
+            if (current.cost != currentCost.asFloat())
+            {
+                // superseded by a cheaper entry
+                continue;
+            }
+
+            for (auto direction : Directions)
+            {
+                auto neighbour = current.position + directionToPoint(direction);
+                if (neighbour.x < bounds.x
+                    || neighbour.y < bounds.y
+                    || neighbour.x >= bounds.x + static_cast<int>(bounds.width)
+                    || neighbour.y >= bounds.y + static_cast<int>(bounds.height)
+                    || !isPassable(neighbour))
+                {
+                    continue;
+                }
+
+                auto cost = currentCost + (isDiagonal(direction) ? OctileDistance(0, 1) : OctileDistance(1, 0));
+                auto index = toLocalIndex(neighbour);
+                if (reached[index] && !(cost < costs[index]))
+                {
+                    continue;
+                }
+
+                reached[index] = true;
+                costs[index] = cost;
+                open.push_back(OpenEntry{cost.asFloat(), neighbour});
+                std::push_heap(open.begin(), open.end(), compare);
+            }
+        }
+    }
+}
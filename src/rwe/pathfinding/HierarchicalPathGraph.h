@@ -0,0 +1,183 @@
+#ifndef RWE_HIERARCHICALPATHGRAPH_H
+#define RWE_HIERARCHICALPATHGRAPH_H
+
+#include <rwe/DiscreteRect.h>
+#include <rwe/Grid.h>
+#include <rwe/Point.h>
+#include <rwe/pathfinding/AStarPathFinder.h>
+#include <rwe/pathfinding/OctileDistance.h>
+#include <vector>
+
+namespace rwe
+{
+    /**
+     * A coarse view of a passability grid, used to plan long paths cheaply.
+     *
+     * The grid is divided into square clusters.
+     * Wherever a run of passable cells crosses the border between two clusters,
+     * an entrance is placed on each side of the border.
+     * Entrances in the same cluster are linked by the length
+     * of the shortest path between them that stays inside the cluster,
+     * and entrances facing each other across a border are linked by a single step.
+     *
+     * Searching this graph gives a sequence of vertices,
+     * each in the same cluster as the last or a neighbouring one,
+     * which can be refined into a full path by grid searches
+     * that are confined to those clusters.
+     *
+     * When cells change passability, only the clusters
+     * containing them and their neighbours are rebuilt.
+     *
+     * The graph also labels the connected components of passable cells,
+     * so that goals that can't be reached at all are caught
+     * before anything is searched.
+     */
+    class HierarchicalPathGraph
+    {
+    public:
+        static constexpr unsigned int ClusterSize = 16;
+
+        /**
+         * Runs of passable cells along a border at least this long
+         * get an entrance at each end, rather than a single one in the middle.
+         */
+        static constexpr unsigned int MinDoubleEntranceLength = 6;
+
+        using NodePool = AStarNodePool<Point, OctileDistance>;
+
+        /** The component label of impassable cells. */
+        static constexpr unsigned int NoComponent = 0;
+
+        struct Edge
+        {
+            Point target;
+            OctileDistance cost;
+        };
+
+        struct Entrance
+        {
+            Point position;
+            std::vector<Edge> edges;
+        };
+
+    private:
+        Grid<char> passable;
+
+        /** The entrances of each cluster. */
+        Grid<std::vector<Entrance>> clusters;
+
+        /** Clusters containing cells that changed since the last repair. */
+        Grid<char> dirtyClusters;
+        bool anyDirty{false};
+
+        /**
+         * For each cell, a label shared by every passable cell reachable from it,
+         * or NoComponent if the cell is impassable.
+         */
+        Grid<unsigned int> components;
+
+    public:
+        explicit HierarchicalPathGraph(Grid<char>&& passable);
+
+        std::size_t getWidth() const;
+
+        std::size_t getHeight() const;
+
+        bool isPassable(const Point& p) const;
+
+        const Grid<char>& getPassable() const;
+
+        /**
+         * Changes whether a cell is passable.
+         * The graph does not reflect the change until repair is called.
+         */
+        void setPassable(std::size_t x, std::size_t y, bool value);
+
+        /**
+         * Rebuilds the clusters affected by calls to setPassable
+         * since the last repair, and relabels the components.
+         * Returns the number of clusters that were rebuilt.
+         */
+        unsigned int repair();
+
+        /**
+         * Returns the component containing the cell,
+         * or NoComponent if it is impassable or outside the grid.
+         * Paths can only join cells in the same component.
+         */
+        unsigned int getComponent(const Point& p) const;
+
+        /**
+         * Returns the cell of the given component nearest to the target,
+         * looking no further than maxRadius cells away in any direction.
+         */
+        boost::optional<Point> findNearestInComponent(unsigned int component, const Point& target, unsigned int maxRadius) const;
+
+        /** Returns the position of the cluster containing the given cell. */
+        Point getCluster(const Point& p) const;
+
+        /** Returns the cells covered by the cluster at the given cluster position. */
+        DiscreteRect getClusterBounds(const Point& cluster) const;
+
+        /**
+         * Returns the smallest rectangle covering
+         * both the cluster containing a and the cluster containing b.
+         */
+        DiscreteRect getClusterBounds(const Point& a, const Point& b) const;
+
+        /**
+         * Returns true if the cells are in the same cluster
+         * or in clusters that touch, including at a corner.
+         */
+        bool inNeighbouringClusters(const Point& a, const Point& b) const;
+
+        const std::vector<Entrance>& getEntrances(const Point& cluster) const;
+
+        /**
+         * Searches the graph for a path from start to goal,
+         * both of which must be inside the grid.
+         * Each vertex of the returned path is in the same cluster
+         * as the one before it, or a neighbouring cluster.
+         *
+         * The start does not have to be passable.
+         * If the goal cannot be reached, the path leads to the vertex
+         * estimated to be closest to it.
+         */
+        AStarPathInfo<Point, OctileDistance> findPath(NodePool& nodePool, const Point& start, const Point& goal) const;
+
+        /**
+         * Returns the cost of the shortest path from the source
+         * to every entrance of the source's cluster,
+         * staying inside the cluster.
+         * Entrances that cannot be reached this way are left out.
+         * If extraTarget is inside the cluster and reachable,
+         * it is included as well.
+         */
+        std::vector<Edge> findEdgesInCluster(const Point& source, const Point& extraTarget) const;
+
+    private:
+        void rebuildCluster(const Point& cluster);
+
+        void labelComponents();
+
+        /**
+         * Walks along one edge of a cluster, starting from the given cell,
+         * and adds an entrance for each run of passable cells
+         * whose neighbours across the border are also passable.
+         */
+        void addBorderEntrances(std::vector<Entrance>& entrances, const Point& first, const Point& along, const Point& across, unsigned int length) const;
+
+        /**
+         * Runs a uniform cost search from the source over the cells within bounds.
+         * Each cell's cost is written to costs, indexed from the top-left of bounds.
+         * Cells that were not reached are marked false in reached.
+         */
+        void searchArea(
+            const Point& source,
+            const DiscreteRect& bounds,
+            std::vector<OctileDistance>& costs,
+            std::vector<char>& reached) const;
+    };
+}
+
+#endif
@@ -51,4 +51,11 @@ namespace rwe
     {
         return PathCost(distance + rhs.distance, turnCount + rhs.turnCount);
     }
+
+    std::size_t PathCostBucketKey::operator()(const PathCost& cost) const
+    {
+        // Costs are ordered by this distance first,
+        // so rounding it down never puts a cheaper cost in a later bucket.
+        return static_cast<std::size_t>(cost.distance.asFloat());
+    }
 }
@@ -2,6 +2,7 @@
 #define RWE_PATHCOST_H
 
 #include "OctileDistance.h"
+#include <cstddef>
 
 namespace rwe
 {
@@ -27,6 +28,15 @@ namespace rwe
 
         PathCost operator+(const PathCost& rhs) const;
     };
+
+    /**
+     * Sorts path costs into buckets by their whole number of grid squares,
+     * for use with BucketOpenList.
+     */
+    struct PathCostBucketKey
+    {
+        std::size_t operator()(const PathCost& cost) const;
+    };
 }
 
 #endif
@@ -2,58 +2,696 @@
 #include "UnitPathFinder.h"
 #include "UnitPerimeterPathFinder.h"
 #include "pathfinding_utils.h"
-#include <future>
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <tuple>
 
 namespace rwe
 {
-    static const unsigned int MaxTasksPerTick = 10;
+    /**
+     * The number of vertex expansions handed out to searches each tick.
+     * A search's path is not delivered until it has been given
+     * as many expansions as it used.
+     */
+    static const unsigned int ExpansionBudgetPerTick = 32768;
 
-    PathFindingService::PathFindingService(GameSimulation* simulation, MovementClassCollisionService* collisionService)
-        : simulation(simulation), collisionService(collisionService)
+    /**
+     * The most of each tick's budget that one search can be given,
+     * so that a hard search can't hold up the rest on its own.
+     * Only budget / share searches can be partway through each tick,
+     * and there are always at least that many workers,
+     * so every search waited on is already running
+     * and waiting for it to use its share never takes long.
+     */
+    static const unsigned int MaxExpansionsPerJobPerTick = ExpansionBudgetPerTick / PathFindingService::MinWorkerCount;
+
+    /** The most jobs that can be scheduled but not yet complete. */
+    static const std::size_t MaxScheduledJobs = 32;
+
+
+    /** The number of units that must share a destination before they are given a flow field. */
+    static const unsigned int MinFlowFieldGroupSize = 4;
+
+    /** The most flow fields to keep around for units sent to the same place later. */
+    static const std::size_t MaxCachedFlowFields = 8;
+
+    /** The most recent paths to keep for units making the same journey. */
+    static const std::size_t MaxCachedPaths = 256;
+
+    /**
+     * The side of the square regions that starts and point goals are rounded to
+     * when looking for a cached path.
+     * A unit starting anywhere in the region can use the path.
+     */
+    static const int PathCacheRegionSize = 4;
+
+    /**
+     * How far from an unreachable goal to look
+     * for the nearest cell that can be reached instead.
+     */
+    static const unsigned int MaxGoalRedirectRadius = 64;
+
+    /**
+     * How far along its old path, in cells, a repaired path
+     * tries to rejoin it.
+     */
+    static const int PathRepairDistance = 16;
+
+    /**
+     * How far beyond the unit and the point it rejoins its old path
+     * a repair may search for a detour.
+     */
+    static const int PathRepairMargin = 8;
+
+    static int floorDiv(int a, int b)
     {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+
+    DiscreteRect boundingRect(const DiscreteRect& a, const DiscreteRect& b)
+    {
+        auto left = std::min(a.x, b.x);
+        auto top = std::min(a.y, b.y);
+        auto right = std::max(a.x + static_cast<int>(a.width), b.x + static_cast<int>(b.width));
+        auto bottom = std::max(a.y + static_cast<int>(a.height), b.y + static_cast<int>(b.height));
+        return DiscreteRect(left, top, right - left, bottom - top);
+    }
+
+    void appendPath(AStarPathInfo<Point, PathCost>& path, AStarPathInfo<Point, PathCost>&& segment)
+    {
+        // the segment starts where the path ends
+        assert(segment.path.front() == path.path.back());
+        path.path.insert(path.path.end(), ++segment.path.begin(), segment.path.end());
+        path.closedVertices.insert(path.closedVertices.end(), segment.closedVertices.begin(), segment.closedVertices.end());
+        if (segment.type == AStarPathType::Partial)
+        {
+            path.type = AStarPathType::Partial;
+        }
+    }
+
+    bool PathFindingService::FlowFieldKey::operator<(const FlowFieldKey& rhs) const
+    {
+        if (movementClass.value != rhs.movementClass.value)
+        {
+            return movementClass.value < rhs.movementClass.value;
+        }
+        if (goal.y != rhs.goal.y)
+        {
+            return goal.y < rhs.goal.y;
+        }
+        return goal.x < rhs.goal.x;
+    }
+
+    bool PathFindingService::PathCacheKey::operator<(const PathCacheKey& rhs) const
+    {
+        auto classValue = [](const boost::optional<MovementClassId>& c) { return c ? static_cast<long long>(c->value) : -1LL; };
+        return std::make_tuple(classValue(movementClass), footprintX, footprintZ, startRegion.y, startRegion.x, goalIsArea, goal.y, goal.x, goal.height, goal.width)
+            < std::make_tuple(classValue(rhs.movementClass), rhs.footprintX, rhs.footprintZ, rhs.startRegion.y, rhs.startRegion.x, rhs.goalIsArea, rhs.goal.y, rhs.goal.x, rhs.goal.height, rhs.goal.width);
+    }
+
+    const GameTimeDelta PathFindingService::PathDeliveryDelay(2);
+
+    PathFindingService::PathFindingService(
+        GameSimulation* simulation,
+        const MovementClassCollisionService* collisionService,
+        unsigned int workerCount)
+        : simulation(simulation),
+          collisionService(collisionService)
+    {
+        if (workerCount == 0)
+        {
+            localScratch = std::make_unique<SearchScratch>(simulation->occupiedGrid.grid.getWidth() * simulation->occupiedGrid.grid.getHeight());
+        }
+        else
+        {
+            // With fewer, a search given its share of the budget could still be queued
+            // behind a hard one, and the tick would wait for the hard one to finish.
+            workerCount = std::max(workerCount, MinWorkerCount);
+        }
+
+        workers.reserve(workerCount);
+        for (unsigned int i = 0; i < workerCount; ++i)
+        {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    PathFindingService::~PathFindingService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shuttingDown = true;
+        }
+        workAvailable.notify_all();
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        // Give the last snapshot back while there is still somewhere to put it.
+        gridSnapshot.reset();
     }
 
     void PathFindingService::update()
+    {
+        applyBlockingFeatureChanges();
+        grantExpansionBudget();
+        deliverPaths();
+        dispatchSearches();
+    }
+
+    std::size_t PathFindingService::getWorkerCount() const
+    {
+        return workers.size();
+    }
+
+    void PathFindingService::grantExpansionBudget()
+    {
+        auto budget = ExpansionBudgetPerTick;
+        auto it = scheduledJobs.begin();
+        while (it != scheduledJobs.end() && budget > 0)
+        {
+            auto& job = **it;
+            if (job.prerequisite && !job.prerequisite->complete)
+            {
+                // The job would only sit waiting for its prerequisite,
+                // and so would the rest of the jobs behind it on the workers.
+                break;
+            }
+
+            auto share = std::min(budget, MaxExpansionsPerJobPerTick);
+
+            // Blocks until the job has finished or used up its share.
+            // Only the number of expansions the job takes decides the outcome,
+            // not how quickly the workers get through them.
+            auto expansions = job.progress->waitFor(job.granted + share);
+            if (expansions)
+            {
+                budget -= *expansions - job.granted;
+                job.granted = *expansions;
+                job.complete = true;
+                it = scheduledJobs.erase(it);
+            }
+            else
+            {
+                budget -= share;
+                job.granted += share;
+                ++it;
+            }
+        }
+    }
+
+    void PathFindingService::deliverPaths()
+    {
+        // Paths are delivered as soon as their searches are complete and due,
+        // so a hard search doesn't hold up the easy ones dispatched after it.
+        auto it = pendingPaths.begin();
+        while (it != pendingPaths.end())
+        {
+            if (it->deliveryTime > simulation->gameTime || (it->job && !it->job->complete))
+            {
+                ++it;
+                continue;
+            }
+
+            auto pending = std::move(*it);
+            it = pendingPaths.erase(it);
+
+            // The search is finished, but its result
+            // may still be on its way from the worker.
+            auto result = pending.result.get();
+            if (pending.cacheKey)
+            {
+                cachePath(*pending.cacheKey, result);
+            }
+            lastPathDebugInfo = std::move(result.debugInfo);
+
+            if (!simulation->unitExists(pending.unitId))
+            {
+                continue;
+            }
+
+            // The unit may have been given somewhere else to go
+            // while the search was running, in which case
+            // the path is no use to it.
+            auto& unit = simulation->getUnit(pending.unitId);
+            auto movingState = boost::get<MovingState>(&unit.behaviourState);
+            if (movingState == nullptr || movingState->destination != pending.destination)
+            {
+                continue;
+            }
+
+            movingState->path = PathFollowingInfo(std::move(result.path), simulation->gameTime);
+            movingState->pathRequested = false;
+        }
+    }
+
+    void PathFindingService::dispatchSearches()
     {
         auto& requests = simulation->pathRequests;
-        unsigned int tasksDone = 0;
-        while (!requests.empty() && tasksDone < MaxTasksPerTick)
+        if (requests.empty())
         {
-            auto& request = requests.front();
+            return;
+        }
+
+        // Every search dispatched this tick shares one snapshot of the grid.
+        auto occupiedGrid = takeGridSnapshot();
 
-            auto& unit = simulation->getUnit(request.unitId);
+        // Count the waiting units headed for each place,
+        // so that groups can be given a flow field to share.
+        std::map<FlowFieldKey, unsigned int> groupSizes;
+        for (const auto& request : requests)
+        {
+            const auto& unit = simulation->getUnit(request.unitId);
+            auto movingState = boost::get<MovingState>(&unit.behaviourState);
+            if (movingState == nullptr)
+            {
+                continue;
+            }
 
-            if (auto movingState = boost::get<MovingState>(&unit.behaviourState); movingState != nullptr)
+            if (auto key = getFlowFieldKey(unit, *movingState); key)
             {
-                UnitPath path = boost::apply_visitor(FindPathVisitor(this, request.unitId), movingState->destination);
-                movingState->path = PathFollowingInfo(std::move(path), simulation->gameTime);
-                movingState->pathRequested = false;
+                groupSizes[*key] += 1;
             }
+        }
 
+        while (!requests.empty() && scheduledJobs.size() < MaxScheduledJobs)
+        {
+            auto request = requests.front();
             requests.pop_front();
-            tasksDone += 1;
+
+            const auto& unit = simulation->getUnit(request.unitId);
+            auto movingState = boost::get<MovingState>(&unit.behaviourState);
+            if (movingState == nullptr)
+            {
+                continue;
+            }
+
+            auto flowField = getFlowField(unit, *movingState, groupSizes);
+
+            const auto& position = simulation->getUnitKinematics(request.unitId).position;
+            PathSearch search{
+                request.unitId,
+                unit.movementClass,
+                unit.footprintX,
+                unit.footprintZ,
+                position,
+                simulation->computeFootprintRegion(position, unit.footprintX, unit.footprintZ),
+                movingState->destination,
+                occupiedGrid,
+                unit.movementClass
+                    ? getPathGraph(*unit.movementClass, unit.footprintX, unit.footprintZ).graph
+                    : std::shared_ptr<const HierarchicalPathGraph>(),
+                flowField ? flowField->field : FlowFieldFuture()};
+
+            // A unit that already has waypoints to follow
+            // only needs a way around whatever is in its way.
+            if (!flowField && movingState->path && !movingState->path->path.flowField)
+            {
+                search.remainingWaypoints.assign(movingState->path->currentWaypoint, movingState->path->path.waypoints.cend());
+            }
+
+            boost::optional<PathCacheKey> cacheKey;
+            if (!flowField)
+            {
+                cacheKey = getPathCacheKey(search);
+                if (auto cachedPath = findCachedPath(search, *cacheKey); cachedPath)
+                {
+                    ++pathCacheHits;
+
+                    // Still held back until the delivery time,
+                    // like any other path.
+                    std::promise<PathSearchResult> cachedResult;
+                    cachedResult.set_value(PathSearchResult{std::move(*cachedPath), AStarPathInfo<Point, PathCost>{AStarPathType::Complete, {}, {}}});
+                    pendingPaths.push_back(PendingPath{
+                        request.unitId,
+                        movingState->destination,
+                        simulation->gameTime + PathDeliveryDelay,
+                        cachedResult.get_future(),
+                        nullptr,
+                        boost::none});
+                    continue;
+                }
+
+                ++pathCacheMisses;
+            }
+
+            auto task = std::make_shared<std::packaged_task<PathSearchResult(SearchScratch&)>>([this, search](SearchScratch& scratch) {
+                auto repairedPath = repairPath(search, scratch);
+                auto result = repairedPath
+                    ? std::move(*repairedPath)
+                    : boost::apply_visitor(FindPathVisitor(this, &search, &scratch), search.destination);
+                if (!search.flowField.valid() && !result.repaired)
+                {
+                    recordEpochs(search, result);
+                }
+                return result;
+            });
+
+            // If there are no workers, the search runs straight away.
+            // The result is still held back until its delivery time.
+            auto result = task->get_future();
+            auto job = schedule(
+                [task](SearchScratch& scratch, SearchProgress&) { (*task)(scratch); },
+                flowField ? flowField->job : nullptr);
+
+            pendingPaths.push_back(PendingPath{
+                request.unitId,
+                movingState->destination,
+                simulation->gameTime + PathDeliveryDelay,
+                std::move(result),
+                std::move(job),
+                cacheKey});
+        }
+    }
+
+    std::shared_ptr<const OccupiedGrid> PathFindingService::takeGridSnapshot()
+    {
+        const auto& occupiedGrid = simulation->occupiedGrid;
+        if (gridSnapshot && gridSnapshot->epochs == occupiedGrid.epochs)
+        {
+            return gridSnapshot;
+        }
+
+        // Searches still using the old snapshot keep it until they finish.
+        gridSnapshot.reset();
+
+        std::unique_ptr<OccupiedGrid> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(freeGridSnapshotsMutex);
+            if (!freeGridSnapshots.empty())
+            {
+                snapshot = std::move(freeGridSnapshots.back());
+                freeGridSnapshots.pop_back();
+            }
+        }
+
+        if (snapshot)
+        {
+            snapshot->copyChangedRegions(occupiedGrid);
+        }
+        else
+        {
+            snapshot = std::make_unique<OccupiedGrid>(occupiedGrid);
+        }
+
+        auto grid = snapshot.release();
+        gridSnapshot = std::shared_ptr<const OccupiedGrid>(grid, [this, grid](const OccupiedGrid*) {
+            std::lock_guard<std::mutex> lock(freeGridSnapshotsMutex);
+            freeGridSnapshots.emplace_back(grid);
+        });
+        return gridSnapshot;
+    }
+
+    void PathFindingService::workerLoop()
+    {
+        SearchScratch scratch(simulation->occupiedGrid.grid.getWidth() * simulation->occupiedGrid.grid.getHeight());
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            workAvailable.wait(lock, [this]() { return shuttingDown || !queuedJobs.empty(); });
+            if (queuedJobs.empty())
+            {
+                // shutting down with nothing left to do
+                return;
+            }
+
+            auto job = std::move(queuedJobs.front());
+            queuedJobs.pop_front();
+
+            lock.unlock();
+            job(scratch);
+            lock.lock();
+        }
+    }
+
+    std::shared_ptr<PathFindingService::ScheduledJob> PathFindingService::schedule(
+        std::function<void(SearchScratch&, SearchProgress&)>&& work,
+        std::shared_ptr<const ScheduledJob> prerequisite)
+    {
+        auto job = std::make_shared<ScheduledJob>();
+        job->progress = std::make_shared<SearchProgress>();
+        job->prerequisite = std::move(prerequisite);
+        scheduledJobs.push_back(job);
+
+        runInBackground([work = std::move(work), progress = job->progress](SearchScratch& scratch) {
+            scratch.nodePool.progress = progress.get();
+            scratch.graphNodePool.progress = progress.get();
+            work(scratch, *progress);
+            scratch.nodePool.progress = nullptr;
+            scratch.graphNodePool.progress = nullptr;
+            progress->finish();
+        });
+
+        return job;
+    }
+
+    void PathFindingService::runInBackground(std::function<void(SearchScratch&)>&& job)
+    {
+        if (workers.empty())
+        {
+            job(*localScratch);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queuedJobs.push_back(std::move(job));
+        }
+        workAvailable.notify_one();
+    }
+
+    boost::optional<PathFindingService::FlowFieldKey> PathFindingService::getFlowFieldKey(const Unit& unit, const MovingState& movingState) const
+    {
+        if (!unit.movementClass)
+        {
+            return boost::none;
+        }
+
+        auto destination = boost::get<Vector3f>(&movingState.destination);
+        if (destination == nullptr)
+        {
+            return boost::none;
+        }
+
+        // A unit that was already following a field and asked again
+        // has bumped into other units, which fields don't account for.
+        if (movingState.path && movingState.path->path.flowField)
+        {
+            return boost::none;
+        }
+
+        auto goal = simulation->computeFootprintRegion(*destination, unit.footprintX, unit.footprintZ);
+        const auto& grid = simulation->occupiedGrid.grid;
+        if (goal.x < 0 || goal.y < 0 || static_cast<std::size_t>(goal.x) >= grid.getWidth() || static_cast<std::size_t>(goal.y) >= grid.getHeight())
+        {
+            return boost::none;
+        }
+
+        return FlowFieldKey{*unit.movementClass, Point(goal.x, goal.y)};
+    }
+
+    boost::optional<PathFindingService::CachedFlowField> PathFindingService::getFlowField(const Unit& unit, const MovingState& movingState, const std::map<FlowFieldKey, unsigned int>& groupSizes)
+    {
+        auto key = getFlowFieldKey(unit, movingState);
+        if (!key)
+        {
+            return boost::none;
+        }
+
+        auto it = flowFields.find(*key);
+        if (it == flowFields.end())
+        {
+            auto groupSize = groupSizes.find(*key);
+            if (groupSize == groupSizes.end() || groupSize->second < MinFlowFieldGroupSize)
+            {
+                return boost::none;
+            }
+
+            auto graph = getPathGraph(key->movementClass, unit.footprintX, unit.footprintZ).graph;
+            auto task = std::make_shared<std::packaged_task<std::shared_ptr<const FlowField>(SearchProgress&)>>([graph, key = *key, footprintX = unit.footprintX, footprintZ = unit.footprintZ](SearchProgress& progress) {
+                return std::make_shared<const FlowField>(graph->getPassable(), key.goal, footprintX, footprintZ, &progress);
+            });
+            FlowFieldFuture field = task->get_future().share();
+
+            // Searches waiting on the field are queued after it,
+            // so a worker will have started it before any of them block.
+            auto job = schedule([task](SearchScratch&, SearchProgress& progress) { (*task)(progress); }, nullptr);
+
+            if (flowFields.size() >= MaxCachedFlowFields)
+            {
+                // Searches already given the evicted field keep their own reference to it.
+                auto oldest = std::min_element(flowFields.begin(), flowFields.end(), [](const auto& a, const auto& b) {
+                    return a.second.lastUsed < b.second.lastUsed;
+                });
+                flowFields.erase(oldest);
+            }
+
+            it = flowFields.emplace(*key, CachedFlowField{std::move(field), std::move(job), simulation->gameTime}).first;
         }
+
+        it->second.lastUsed = simulation->gameTime;
+        return it->second;
     }
 
-    UnitPath PathFindingService::findPath(UnitId unitId, const DiscreteRect& destination)
+    PathFindingService::PathCacheKey PathFindingService::getPathCacheKey(const PathSearch& search) const
     {
-        const auto& unit = simulation->getUnit(unitId);
+        Point startRegion(floorDiv(search.selfArea.x, PathCacheRegionSize), floorDiv(search.selfArea.y, PathCacheRegionSize));
+        PathCacheKey key{search.movementClass, search.footprintX, search.footprintZ, startRegion, false, DiscreteRect(0, 0, 0, 0)};
+
+        if (auto area = boost::get<DiscreteRect>(&search.destination); area)
+        {
+            key.goalIsArea = true;
+            key.goal = *area;
+        }
+        else
+        {
+            auto goal = simulation->computeFootprintRegion(boost::get<Vector3f>(search.destination), search.footprintX, search.footprintZ);
+            key.goal = DiscreteRect(floorDiv(goal.x, PathCacheRegionSize), floorDiv(goal.y, PathCacheRegionSize), 0, 0);
+        }
+
+        return key;
+    }
 
-        auto start = simulation->computeFootprintRegion(unit.position, unit.footprintX, unit.footprintZ);
+    boost::optional<UnitPath> PathFindingService::findCachedPath(const PathSearch& search, const PathCacheKey& key)
+    {
+        auto it = pathCache.find(key);
+        if (it == pathCache.end())
+        {
+            return boost::none;
+        }
+
+        auto& entry = it->second;
+        if (search.occupiedGrid->getFixedEpochs(entry.epochRegions) != entry.epochs)
+        {
+            pathCache.erase(it);
+            return boost::none;
+        }
+
+        entry.lastUsed = simulation->gameTime;
+
+        auto path = entry.path;
+        auto destination = boost::get<Vector3f>(&search.destination);
+        if (destination != nullptr && !entry.redirected)
+        {
+            // The cached path may have been for another point in the same goal region.
+            path.waypoints.back() = *destination;
+        }
+
+        return path;
+    }
+
+    void PathFindingService::cachePath(const PathCacheKey& key, const PathSearchResult& result)
+    {
+        if (result.epochs.empty())
+        {
+            return;
+        }
+
+        auto it = pathCache.find(key);
+        if (it == pathCache.end() && pathCache.size() >= MaxCachedPaths)
+        {
+            auto oldest = std::min_element(pathCache.begin(), pathCache.end(), [](const auto& a, const auto& b) {
+                return a.second.lastUsed < b.second.lastUsed;
+            });
+            pathCache.erase(oldest);
+        }
+
+        pathCache[key] = CachedPath{result.path, result.redirected, result.epochRegions, result.epochs, simulation->gameTime};
+    }
+
+    void PathFindingService::recordEpochs(const PathSearch& search, PathSearchResult& result) const
+    {
+        const auto& debugInfo = result.debugInfo;
+        if (debugInfo.path.size() < 2)
+        {
+            // trivial paths are cheap enough to find again
+            return;
+        }
+
+        auto left = search.selfArea.x;
+        auto top = search.selfArea.y;
+        auto right = search.selfArea.x;
+        auto bottom = search.selfArea.y;
+        auto include = [&](const Point& p) {
+            left = std::min(left, p.x);
+            top = std::min(top, p.y);
+            right = std::max(right, p.x);
+            bottom = std::max(bottom, p.y);
+        };
+        for (const auto& p : debugInfo.path)
+        {
+            include(p);
+        }
+        for (const auto& v : debugInfo.closedVertices)
+        {
+            include(v.vertex);
+        }
+
+        // Each vertex checks the footprint below and to the right of it,
+        // plus a cell all around for the adjacency check.
+        // Units starting anywhere in the start region can reuse the path,
+        // so allow for that too.
+        auto margin = PathCacheRegionSize + 1;
+        DiscreteRect searched(
+            left - margin,
+            top - margin,
+            (right - left) + search.footprintX + (2 * margin),
+            (bottom - top) + search.footprintZ + (2 * margin));
+
+        result.epochRegions = search.occupiedGrid->getEpochRegions(searched);
+        result.epochs = search.occupiedGrid->getFixedEpochs(result.epochRegions);
+    }
+
+    PathFindingService::PathSearchResult PathFindingService::findPath(const PathSearch& search, SearchScratch& scratch, const DiscreteRect& destination) const
+    {
+        const auto& start = search.selfArea;
         // expand the goal rect to take into account our own collision rect
-        auto goal = expandTopLeft(destination, unit.footprintX - 1, unit.footprintZ - 1);
+        auto goal = expandTopLeft(destination, search.footprintX - 1, search.footprintZ - 1);
 
-        UnitPerimeterPathFinder pathFinder(simulation, collisionService, unitId, unit.movementClass, unit.footprintX, unit.footprintZ, goal);
+        UnitPerimeterPathFinder pathFinder(&scratch.nodePool, search.occupiedGrid.get(), collisionService, search.unitId, search.selfArea, search.movementClass, search.footprintX, search.footprintZ, goal);
 
-        auto path = pathFinder.findPath(Point(start.x, start.y));
-        lastPathDebugInfo = AStarPathInfo<Point, PathCost>{path.type, path.path, std::move(path.closedVertices)};
+        // For distant goals, plan the route up to the goal's neighbourhood
+        // through the entrance graph, then finish with a local search.
+        // The graph needs a single goal cell, so aim for the middle of the goal.
+        const auto& grid = search.occupiedGrid->grid;
+        Point goalCenter(
+            std::clamp(goal.x + static_cast<int>(goal.width / 2), 0, static_cast<int>(grid.getWidth()) - 1),
+            std::clamp(goal.y + static_cast<int>(goal.height / 2), 0, static_cast<int>(grid.getHeight()) - 1));
+        Point startCell(start.x, start.y);
+
+        AStarPathInfo<Point, PathCost> path;
+        if (!isAreaReachable(search, startCell, goal))
+        {
+            // Don't waste a search on a goal we can't get to,
+            // make for the nearest place we can instead.
+            path = findPathToCell(search, scratch, startCell, findReachableGoal(search, startCell, goalCenter));
+        }
+        else if (auto longPath = findLongPath(search, scratch, startCell, goalCenter, false); longPath)
+        {
+            path = std::move(*longPath);
+            auto from = path.path.back();
+            pathFinder.setSearchArea(boundingRect(
+                search.graph->getClusterBounds(from, goalCenter),
+                DiscreteRect(goal.x - 1, goal.y - 1, goal.width + 2, goal.height + 2)));
+            appendPath(path, pathFinder.findPath(from));
+        }
+        else
+        {
+            path = pathFinder.findPath(startCell);
+        }
+
+        AStarPathInfo<Point, PathCost> debugInfo{path.type, path.path, std::move(path.closedVertices)};
 
         assert(path.path.size() >= 1);
 
         if (path.path.size() == 1)
         {
             // The path is trivial, we are already at the goal.
-            return UnitPath{std::vector<Vector3f>{unit.position}};
+            return PathSearchResult{UnitPath{std::vector<Vector3f>{search.position}}, std::move(debugInfo)};
         }
 
         auto simplifiedPath = runSimplifyPath(path.path);
@@ -61,35 +699,56 @@ namespace rwe
         std::vector<Vector3f> waypoints;
         for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
         {
-            waypoints.push_back(getWorldCenter(DiscreteRect(it->x, it->y, unit.footprintX, unit.footprintZ)));
+            waypoints.push_back(getWorldCenter(DiscreteRect(it->x, it->y, search.footprintX, search.footprintZ)));
         }
 
-        return UnitPath{std::move(waypoints)};
+        return PathSearchResult{UnitPath{std::move(waypoints)}, std::move(debugInfo)};
     }
 
-    UnitPath PathFindingService::findPath(UnitId unitId, const Vector3f& destination)
+    PathFindingService::PathSearchResult PathFindingService::findPath(const PathSearch& search, SearchScratch& scratch, const Vector3f& destination) const
     {
-        const auto& unit = simulation->getUnit(unitId);
+        const auto& start = search.selfArea;
+
+        if (search.flowField.valid())
+        {
+            // blocks until the field is built
+            const auto& flowField = search.flowField.get();
+            Point startCell(start.x, start.y);
+            if (flowField->isReachable(startCell))
+            {
+                AStarPathInfo<Point, PathCost> debugInfo{AStarPathType::Complete, std::vector<Point>{startCell, flowField->getGoal()}, std::vector<AStarClosedVertex<Point>>()};
+                return PathSearchResult{UnitPath{std::vector<Vector3f>{destination}, flowField}, std::move(debugInfo)};
+            }
 
-        auto start = simulation->computeFootprintRegion(unit.position, unit.footprintX, unit.footprintZ);
-        auto goal = simulation->computeFootprintRegion(destination, unit.footprintX, unit.footprintZ);
+            // The field can't lead us to the goal,
+            // so search for the closest we can get instead.
+        }
+
+        auto goalRect = simulation->computeFootprintRegion(destination, search.footprintX, search.footprintZ);
+        Point startCell(start.x, start.y);
+        Point goalCell(goalRect.x, goalRect.y);
+
+        // Don't waste a search on a goal we can't get to,
+        // make for the nearest place we can instead.
+        auto goal = findReachableGoal(search, startCell, goalCell);
+        auto redirected = goal != goalCell;
 
-        UnitPathFinder pathFinder(simulation, collisionService, unitId, unit.movementClass, unit.footprintX, unit.footprintZ, Point(goal.x, goal.y));
+        auto path = findPathToCell(search, scratch, startCell, goal);
 
-        auto path = pathFinder.findPath(Point(start.x, start.y));
-        lastPathDebugInfo = AStarPathInfo<Point, PathCost>{path.type, path.path, std::move(path.closedVertices)};
+        AStarPathInfo<Point, PathCost> debugInfo{path.type, path.path, std::move(path.closedVertices)};
 
         if (path.type == AStarPathType::Partial)
         {
-            path.path.emplace_back(goal.x, goal.y);
+            path.path.push_back(goal);
         }
 
         assert(path.path.size() >= 1);
 
         if (path.path.size() == 1)
         {
-            // The path is trivial, we are already at the goal.
-            return UnitPath{std::vector<Vector3f>{destination}};
+            // The path is trivial, we are already at the goal,
+            // or as close to it as we can get.
+            return PathSearchResult{UnitPath{std::vector<Vector3f>{redirected ? search.position : destination}}, std::move(debugInfo)};
         }
 
         auto simplifiedPath = runSimplifyPath(path.path);
@@ -97,14 +756,292 @@ namespace rwe
         std::vector<Vector3f> waypoints;
         for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
         {
-            waypoints.push_back(getWorldCenter(DiscreteRect(it->x, it->y, unit.footprintX, unit.footprintZ)));
+            waypoints.push_back(getWorldCenter(DiscreteRect(it->x, it->y, search.footprintX, search.footprintZ)));
+        }
+        if (!redirected)
+        {
+            waypoints.back() = destination;
+        }
+
+        PathSearchResult result{UnitPath{std::move(waypoints)}, std::move(debugInfo)};
+        result.redirected = redirected;
+        return result;
+    }
+
+    boost::optional<PathFindingService::PathSearchResult> PathFindingService::repairPath(const PathSearch& search, SearchScratch& scratch) const
+    {
+        const auto& waypoints = search.remainingWaypoints;
+        if (waypoints.empty())
+        {
+            return boost::none;
+        }
+
+        const auto& start = search.selfArea;
+        Point startCell(start.x, start.y);
+
+        // Rejoin the path at the first waypoint far enough along
+        // to get around whatever is in the way, or at its end.
+        auto rejoin = waypoints.cbegin();
+        Point rejoinCell;
+        for (;; ++rejoin)
+        {
+            auto rejoinRect = simulation->computeFootprintRegion(*rejoin, search.footprintX, search.footprintZ);
+            rejoinCell = Point(rejoinRect.x, rejoinRect.y);
+            auto distance = std::max(std::abs(rejoinCell.x - startCell.x), std::abs(rejoinCell.y - startCell.y));
+            if (distance >= PathRepairDistance || std::next(rejoin) == waypoints.cend())
+            {
+                break;
+            }
+        }
+
+        UnitPathFinder pathFinder(&scratch.nodePool, search.occupiedGrid.get(), collisionService, search.unitId, search.selfArea, search.movementClass, search.footprintX, search.footprintZ, rejoinCell);
+        auto area = boundingRect(
+            DiscreteRect(startCell.x, startCell.y, search.footprintX, search.footprintZ),
+            DiscreteRect(rejoinCell.x, rejoinCell.y, search.footprintX, search.footprintZ));
+        pathFinder.setSearchArea(DiscreteRect(
+            area.x - PathRepairMargin,
+            area.y - PathRepairMargin,
+            area.width + (2 * PathRepairMargin),
+            area.height + (2 * PathRepairMargin)));
+        auto path = pathFinder.findPath(startCell);
+        if (path.type != AStarPathType::Complete)
+        {
+            // The way back is blocked too, so the whole path needs rethinking.
+            return boost::none;
+        }
+
+        std::vector<Vector3f> repairedWaypoints;
+        auto simplifiedPath = runSimplifyPath(path.path);
+        for (auto it = ++simplifiedPath.cbegin(); it != simplifiedPath.cend(); ++it)
+        {
+            repairedWaypoints.push_back(getWorldCenter(DiscreteRect(it->x, it->y, search.footprintX, search.footprintZ)));
+        }
+
+        // The detour ends in the rejoining waypoint's cell,
+        // so aim for the waypoint itself.
+        if (repairedWaypoints.empty())
+        {
+            repairedWaypoints.push_back(*rejoin);
+        }
+        else
+        {
+            repairedWaypoints.back() = *rejoin;
+        }
+        repairedWaypoints.insert(repairedWaypoints.end(), std::next(rejoin), waypoints.cend());
+
+        PathSearchResult result{UnitPath{std::move(repairedWaypoints)}, AStarPathInfo<Point, PathCost>{path.type, std::move(path.path), std::move(path.closedVertices)}};
+        result.repaired = true;
+        return result;
+    }
+
+    Point PathFindingService::findReachableGoal(const PathSearch& search, const Point& start, const Point& goal) const
+    {
+        if (!search.graph)
+        {
+            return goal;
+        }
+
+        const auto& graph = *search.graph;
+        auto startComponent = graph.getComponent(start);
+        if (startComponent == HierarchicalPathGraph::NoComponent)
+        {
+            // We're somewhere we couldn't normally stand,
+            // so there's no telling where we can get to from here.
+            return goal;
+        }
+
+        if (graph.getComponent(goal) == startComponent)
+        {
+            return goal;
+        }
+
+        auto nearest = graph.findNearestInComponent(startComponent, goal, MaxGoalRedirectRadius);
+        return nearest ? *nearest : goal;
+    }
+
+    bool PathFindingService::isAreaReachable(const PathSearch& search, const Point& start, const DiscreteRect& area) const
+    {
+        if (!search.graph)
+        {
+            return true;
+        }
+
+        const auto& graph = *search.graph;
+        auto startComponent = graph.getComponent(start);
+        if (startComponent == HierarchicalPathGraph::NoComponent)
+        {
+            return true;
+        }
+
+        for (int y = area.y; y < area.y + static_cast<int>(area.height); ++y)
+        {
+            for (int x = area.x; x < area.x + static_cast<int>(area.width); ++x)
+            {
+                if (graph.getComponent(Point(x, y)) == startComponent)
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    AStarPathInfo<Point, PathCost> PathFindingService::findPathToCell(const PathSearch& search, SearchScratch& scratch, const Point& start, const Point& goal) const
+    {
+        if (auto longPath = findLongPath(search, scratch, start, goal, true); longPath)
+        {
+            return std::move(*longPath);
+        }
+
+        UnitPathFinder pathFinder(&scratch.nodePool, search.occupiedGrid.get(), collisionService, search.unitId, search.selfArea, search.movementClass, search.footprintX, search.footprintZ, goal);
+        return pathFinder.findPath(start);
+    }
+
+    boost::optional<AStarPathInfo<Point, PathCost>> PathFindingService::findLongPath(
+        const PathSearch& search,
+        SearchScratch& scratch,
+        const Point& start,
+        const Point& goal,
+        bool refineFinalStep) const
+    {
+        if (!search.graph)
+        {
+            return boost::none;
+        }
+
+        const auto& graph = *search.graph;
+        auto isInGrid = [&graph](const Point& p) {
+            return p.x >= 0 && p.y >= 0 && static_cast<std::size_t>(p.x) < graph.getWidth() && static_cast<std::size_t>(p.y) < graph.getHeight();
+        };
+        if (!isInGrid(start) || !isInGrid(goal))
+        {
+            return boost::none;
+        }
+
+        // A plain search already stays within neighbouring clusters
+        // when the goal is this close.
+        if (graph.inNeighbouringClusters(start, goal))
+        {
+            return boost::none;
+        }
+
+        auto abstractPath = graph.findPath(scratch.graphNodePool, start, goal);
+        if (abstractPath.path.size() < 2)
+        {
+            // We can't reach any entrance, the search from here is a local one.
+            return boost::none;
         }
-        waypoints.back() = destination;
 
-        return UnitPath{std::move(waypoints)};
+        auto& waypoints = abstractPath.path;
+        if (abstractPath.type == AStarPathType::Complete && !refineFinalStep)
+        {
+            waypoints.pop_back();
+        }
+
+        AStarPathInfo<Point, PathCost> path{abstractPath.type, std::vector<Point>{start}, std::vector<AStarClosedVertex<Point>>()};
+        for (auto it = ++waypoints.cbegin(); it != waypoints.cend(); ++it)
+        {
+            // Other units may stop a step from reaching its waypoint,
+            // in which case the next step continues from wherever it got to.
+            // Either way, every step is confined to the clusters around it.
+            auto from = path.path.back();
+            UnitPathFinder pathFinder(&scratch.nodePool, search.occupiedGrid.get(), collisionService, search.unitId, search.selfArea, search.movementClass, search.footprintX, search.footprintZ, *it);
+            pathFinder.setSearchArea(graph.getClusterBounds(from, *it));
+            appendPath(path, pathFinder.findPath(from));
+        }
+
+        return path;
+    }
+
+    PathFindingService::MovementClassPathGraph& PathFindingService::getPathGraph(MovementClassId movementClass, unsigned int footprintX, unsigned int footprintZ)
+    {
+        auto it = pathGraphs.find(movementClass);
+        if (it != pathGraphs.end())
+        {
+            return it->second;
+        }
+
+        const auto& grid = simulation->occupiedGrid.grid;
+        Grid<char> passable(grid.getWidth(), grid.getHeight());
+        for (std::size_t y = 0; y < grid.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < grid.getWidth(); ++x)
+            {
+                passable.set(x, y, isPassableIgnoringUnits(movementClass, footprintX, footprintZ, Point(x, y)));
+            }
+        }
+
+        MovementClassPathGraph pathGraph{footprintX, footprintZ, std::make_shared<const HierarchicalPathGraph>(std::move(passable))};
+        return pathGraphs.emplace(movementClass, std::move(pathGraph)).first->second;
+    }
+
+    bool PathFindingService::isPassableIgnoringUnits(MovementClassId movementClass, unsigned int footprintX, unsigned int footprintZ, const Point& position) const
+    {
+        if (!collisionService->isWalkable(movementClass, position))
+        {
+            return false;
+        }
+
+        auto region = simulation->occupiedGrid.grid.tryToRegion(DiscreteRect(position.x, position.y, footprintX, footprintZ));
+        if (!region)
+        {
+            return false;
+        }
+
+        for (std::size_t y = region->y; y < region->y + region->height; ++y)
+        {
+            for (std::size_t x = region->x; x < region->x + region->width; ++x)
+            {
+                if (simulation->occupiedGrid.grid.get(x, y).isFeature())
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void PathFindingService::applyBlockingFeatureChanges()
+    {
+        auto& changes = simulation->blockingFeatureChanges;
+        if (changes.empty())
+        {
+            return;
+        }
+
+        for (auto& entry : pathGraphs)
+        {
+            auto& pathGraph = entry.second;
+            auto graph = std::make_shared<HierarchicalPathGraph>(*pathGraph.graph);
+            for (const auto& region : changes)
+            {
+                // every position whose footprint overlaps the region
+                auto left = std::max(0, static_cast<int>(region.x) - static_cast<int>(pathGraph.footprintX) + 1);
+                auto top = std::max(0, static_cast<int>(region.y) - static_cast<int>(pathGraph.footprintZ) + 1);
+                for (auto y = static_cast<std::size_t>(top); y < region.y + region.height; ++y)
+                {
+                    for (auto x = static_cast<std::size_t>(left); x < region.x + region.width; ++x)
+                    {
+                        auto value = isPassableIgnoringUnits(entry.first, pathGraph.footprintX, pathGraph.footprintZ, Point(x, y));
+                        graph->setPassable(x, y, value);
+                    }
+                }
+            }
+
+            graph->repair();
+            pathGraph.graph = std::move(graph);
+        }
+
+        // Fields and long paths were built from the old graphs.
+        flowFields.clear();
+        pathCache.clear();
+
+        changes.clear();
     }
 
-    Vector3f PathFindingService::getWorldCenter(const DiscreteRect& rect)
+    Vector3f PathFindingService::getWorldCenter(const DiscreteRect& rect) const
     {
         auto corner = simulation->terrain.heightmapIndexToWorldCorner(rect.x, rect.y);
 
@@ -116,7 +1053,7 @@ namespace rwe
         return center;
     }
 
-    DiscreteRect PathFindingService::expandTopLeft(const DiscreteRect& rect, unsigned int width, unsigned int height)
+    DiscreteRect PathFindingService::expandTopLeft(const DiscreteRect& rect, unsigned int width, unsigned int height) const
     {
         return DiscreteRect(
             rect.x - static_cast<int>(width),
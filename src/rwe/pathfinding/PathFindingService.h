@@ -1,60 +1,457 @@
 #ifndef RWE_PATHFINDINGSERVICE_H
 #define RWE_PATHFINDINGSERVICE_H
 
+#include "AbstractUnitPathFinder.h"
 #include "OctileDistance.h"
 #include "UnitPath.h"
 #include "rwe/GameSimulation.h"
 #include "rwe/UnitId.h"
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <rwe/DiscreteRect.h>
 #include <rwe/MovementClassCollisionService.h>
+#include <rwe/OccupiedGrid.h>
 #include <rwe/Point.h>
 #include <rwe/math/Vector3f.h>
 #include <rwe/pathfinding/AStarPathFinder.h>
+#include <rwe/pathfinding/FlowField.h>
+#include <rwe/pathfinding/HierarchicalPathGraph.h>
 #include <rwe/pathfinding/PathCost.h>
+#include <rwe/pathfinding/SearchProgress.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace rwe
 {
+    /**
+     * Finds paths for the units that have requested them.
+     *
+     * Searches run on background worker threads,
+     * against a snapshot of the map's obstacles
+     * taken when each request is dispatched.
+     * Each tick, a budget of vertex expansions is shared between the searches,
+     * and a path is handed back to its unit once its search has been given
+     * as many expansions as it used, and no sooner than a fixed number of ticks
+     * after its request was dispatched.
+     * Hard searches take more ticks to deliver rather than holding up the tick,
+     * and units behave the same no matter how long the searches take in real time.
+     *
+     * When several units of a movement class are sent to the same place,
+     * they share a flow field built by one search outward from the goal
+     * rather than each searching for a path of their own.
+     * The field is kept for a while, so units sent there later can use it too.
+     *
+     * Recent paths are also kept, and handed out again to units
+     * making the same journey for as long as the occupied grid's fixed epochs show
+     * that nothing has changed in the area their search looked at.
+     * Units walking through the area, the one that asked for the path included,
+     * don't count as a change.
+     *
+     * A unit that already has a path and asks for a new one
+     * has usually been held up by other units on the way.
+     * Rather than searching all the way to its destination again,
+     * it first searches for a detour through the area around it
+     * back onto the path a little further along,
+     * and keeps the rest of the path as it was.
+     */
     class PathFindingService
     {
+    public:
+        /**
+         * The fewest workers the service searches in the background with.
+         * Each tick's budget is shared between at most this many searches
+         * that don't finish within it, so each of them has a worker of its own
+         * and waiting for one never means waiting for another to finish.
+         */
+        static constexpr unsigned int MinWorkerCount = 2;
+
+        /** A sensible number of workers to search in the background. */
+        static constexpr unsigned int DefaultWorkerCount = MinWorkerCount;
+
+        /**
+         * The least number of ticks between a search being dispatched
+         * and its path being handed to the unit.
+         * This gives the workers time to finish before anyone has to wait for them.
+         */
+        static const GameTimeDelta PathDeliveryDelay;
+
     private:
-        class FindPathVisitor : public boost::static_visitor<UnitPath>
+        /**
+         * The entrance graph for a movement class,
+         * built over the cells that units of the class could stand on
+         * if no other units were in the way.
+         * Units move too often to be worth including,
+         * so they are left to the grid searches that refine each path.
+         *
+         * In-flight searches may still be reading an old version of the graph,
+         * so changes are made to a copy that then replaces it.
+         */
+        struct MovementClassPathGraph
+        {
+            unsigned int footprintX;
+            unsigned int footprintZ;
+            std::shared_ptr<const HierarchicalPathGraph> graph;
+        };
+
+        /** Identifies the flow field for a movement class heading to a goal cell. */
+        struct FlowFieldKey
+        {
+            MovementClassId movementClass;
+            Point goal;
+
+            bool operator<(const FlowFieldKey& rhs) const;
+        };
+
+        using FlowFieldFuture = std::shared_future<std::shared_ptr<const FlowField>>;
+
+        /**
+         * A job run on the workers, and how much of the expansion budget it has been given.
+         * The job is complete once it has been given as many expansions as it used.
+         */
+        struct ScheduledJob
+        {
+            std::shared_ptr<SearchProgress> progress;
+            unsigned int granted{0};
+            bool complete{false};
+
+            /** A job that must be complete before this one is given any budget. */
+            std::shared_ptr<const ScheduledJob> prerequisite;
+        };
+
+        struct CachedFlowField
+        {
+            FlowFieldFuture field;
+
+            /** The job building the field. */
+            std::shared_ptr<const ScheduledJob> job;
+
+            GameTime lastUsed;
+        };
+
+        /**
+         * Identifies journeys that can share a path:
+         * the same kind of unit, starting near the same place,
+         * heading for the same goal.
+         */
+        struct PathCacheKey
+        {
+            boost::optional<MovementClassId> movementClass;
+            unsigned int footprintX;
+            unsigned int footprintZ;
+            Point startRegion;
+
+            /** If false, goal holds the coarse region of a point goal rather than an area. */
+            bool goalIsArea;
+            DiscreteRect goal;
+
+            bool operator<(const PathCacheKey& rhs) const;
+        };
+
+        struct CachedPath
+        {
+            UnitPath path;
+
+            /** True if the path ends short of an unreachable destination. */
+            bool redirected;
+
+            /** The epoch regions the search looked at, and their fixed epochs when it ran. */
+            GridRegion epochRegions;
+            std::vector<unsigned int> epochs{};
+
+            GameTime lastUsed;
+        };
+
+        /** Everything a search needs to know, captured when it is dispatched. */
+        struct PathSearch
         {
-        private:
-            PathFindingService* svc;
             UnitId unitId;
+            boost::optional<MovementClassId> movementClass;
+            unsigned int footprintX;
+            unsigned int footprintZ;
+            Vector3f position;
+
+            /** The cells the unit occupies, which its path starts from. */
+            DiscreteRect selfArea;
+
+            MovingStateGoal destination;
+            std::shared_ptr<const OccupiedGrid> occupiedGrid;
+            std::shared_ptr<const HierarchicalPathGraph> graph;
+
+            /** The field the unit should follow, if it has been given one. */
+            FlowFieldFuture flowField;
+
+            /**
+             * The waypoints of the unit's current path it has yet to reach,
+             * or empty if the path doesn't need to be repaired.
+             */
+            std::vector<Vector3f> remainingWaypoints{};
+        };
+
+        struct PathSearchResult
+        {
+            UnitPath path;
+            AStarPathInfo<Point, PathCost> debugInfo;
+
+            /** True if the destination couldn't be reached, so the path ends as close to it as it can. */
+            bool redirected{false};
+
+            /**
+             * The epoch regions the search looked at, and their fixed epochs in its snapshot.
+             * Left empty if the path isn't worth caching.
+             */
+            GridRegion epochRegions{0, 0, 0, 0};
+            std::vector<unsigned int> epochs{};
+
+            /** True if the path is a repair of the unit's old path, so it isn't worth caching. */
+            bool repaired{false};
+        };
+
+        /** Node storage for searches, owned by a single thread. */
+        struct SearchScratch
+        {
+            AbstractUnitPathFinder::NodePool nodePool;
+            HierarchicalPathGraph::NodePool graphNodePool;
+
+            explicit SearchScratch(std::size_t size) : nodePool(size), graphNodePool(size)
+            {
+            }
+        };
+
+        /** A search that has been dispatched but not yet delivered. */
+        struct PendingPath
+        {
+            UnitId unitId;
+            MovingStateGoal destination;
+            GameTime deliveryTime;
+            std::future<PathSearchResult> result;
+
+            /** The job running the search, or null if the path was ready straight away. */
+            std::shared_ptr<const ScheduledJob> job;
+
+            /** Where to cache the path once it is delivered, if anywhere. */
+            boost::optional<PathCacheKey> cacheKey;
+        };
+
+        class FindPathVisitor : public boost::static_visitor<PathSearchResult>
+        {
+        private:
+            const PathFindingService* svc;
+            const PathSearch* search;
+            SearchScratch* scratch;
 
         public:
-            FindPathVisitor(PathFindingService* svc, const UnitId& unitId) : svc(svc), unitId(unitId)
+            FindPathVisitor(const PathFindingService* svc, const PathSearch* search, SearchScratch* scratch)
+                : svc(svc), search(search), scratch(scratch)
             {
             }
 
-            UnitPath operator()(const Vector3f& pos) const
+            PathSearchResult operator()(const Vector3f& pos) const
             {
-                return svc->findPath(unitId, pos);
+                return svc->findPath(*search, *scratch, pos);
             }
-            UnitPath operator()(const DiscreteRect& pos) const
+            PathSearchResult operator()(const DiscreteRect& pos) const
             {
-                return svc->findPath(unitId, pos);
+                return svc->findPath(*search, *scratch, pos);
             }
         };
 
         GameSimulation* const simulation;
-        MovementClassCollisionService* const collisionService;
+        const MovementClassCollisionService* const collisionService;
+
+        /** Built the first time a unit of each movement class needs one. */
+        std::unordered_map<MovementClassId, MovementClassPathGraph> pathGraphs;
+
+        /**
+         * Flow fields built recently, including ones still being built.
+         * Ordered so that choosing which to evict is deterministic.
+         */
+        std::map<FlowFieldKey, CachedFlowField> flowFields;
+
+        /** Recently delivered paths, ordered so that choosing which to evict is deterministic. */
+        std::map<PathCacheKey, CachedPath> pathCache;
+
+        /** Dispatched searches that have yet to be delivered, oldest first. */
+        std::deque<PendingPath> pendingPaths;
+
+        /** Jobs that have not yet been given all the expansions they need, oldest first. */
+        std::deque<std::shared_ptr<ScheduledJob>> scheduledJobs;
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::deque<std::function<void(SearchScratch&)>> queuedJobs;
+        bool shuttingDown{false};
+
+        /**
+         * Used when there are no workers,
+         * in which case searches run as soon as they are dispatched.
+         */
+        std::unique_ptr<SearchScratch> localScratch;
+
+        /**
+         * The snapshot of the occupied grid most recently handed to searches,
+         * handed out again for as long as the grid is unchanged.
+         */
+        std::shared_ptr<const OccupiedGrid> gridSnapshot;
+
+        /**
+         * Snapshots no longer used by any search,
+         * kept to be brought up to date rather than copied afresh.
+         * Searches give theirs back from whichever thread ran them.
+         */
+        std::vector<std::unique_ptr<OccupiedGrid>> freeGridSnapshots;
+        std::mutex freeGridSnapshotsMutex;
 
     public:
-        PathFindingService(GameSimulation* simulation, MovementClassCollisionService* collisionService);
+        /**
+         * With no workers, searches run as soon as they are dispatched.
+         * Otherwise at least MinWorkerCount workers are started,
+         * however few were asked for.
+         */
+        PathFindingService(GameSimulation* simulation, const MovementClassCollisionService* collisionService, unsigned int workerCount);
+
+        ~PathFindingService();
+
+        PathFindingService(const PathFindingService&) = delete;
+        PathFindingService& operator=(const PathFindingService&) = delete;
 
         AStarPathInfo<Point, PathCost> lastPathDebugInfo;
 
+        /** The number of requests handed a cached path, and the number that looked for one but had to search. */
+        unsigned int pathCacheHits{0};
+        unsigned int pathCacheMisses{0};
+
+        /**
+         * Hands out this tick's expansion budget,
+         * delivers the paths that are due and complete,
+         * then dispatches searches for waiting requests.
+         */
         void update();
 
+        std::size_t getWorkerCount() const;
+
     private:
-        UnitPath findPath(UnitId unitId, const Vector3f& destination);
-        UnitPath findPath(UnitId unitId, const DiscreteRect& destination);
+        /**
+         * Shares this tick's expansions between the scheduled jobs, oldest first,
+         * waiting for each to either finish or use up its share.
+         */
+        void grantExpansionBudget();
+
+        void deliverPaths();
+
+        void dispatchSearches();
+
+        /**
+         * Returns a snapshot of the occupied grid for searches to run against.
+         * Only the regions that have changed since a free snapshot was taken
+         * are copied into it, and if nothing has changed since the last
+         * snapshot was handed out, that one is shared.
+         */
+        std::shared_ptr<const OccupiedGrid> takeGridSnapshot();
+
+        void workerLoop();
+
+        /**
+         * Hands the job to the workers,
+         * or runs it straight away if there are none.
+         * Jobs are started in the order they are given.
+         */
+        void runInBackground(std::function<void(SearchScratch&)>&& job);
+
+        /**
+         * Runs the work in the background as a job
+         * that counts towards the expansion budget.
+         */
+        std::shared_ptr<ScheduledJob> schedule(
+            std::function<void(SearchScratch&, SearchProgress&)>&& work,
+            std::shared_ptr<const ScheduledJob> prerequisite);
+
+        /**
+         * Returns the key of the flow field the unit could follow to its destination,
+         * or none if it can't follow one.
+         */
+        boost::optional<FlowFieldKey> getFlowFieldKey(const Unit& unit, const MovingState& movingState) const;
+
+        /**
+         * Returns the flow field for the unit's destination,
+         * building it if it isn't cached and the unit is part of a large enough group.
+         * Returns none if the unit should search for a path of its own.
+         */
+        boost::optional<CachedFlowField> getFlowField(const Unit& unit, const MovingState& movingState, const std::map<FlowFieldKey, unsigned int>& groupSizes);
+
+        PathCacheKey getPathCacheKey(const PathSearch& search) const;
+
+        /**
+         * Returns a copy of the cached path for the search's journey,
+         * or none if there isn't one or the area it covers has changed since.
+         */
+        boost::optional<UnitPath> findCachedPath(const PathSearch& search, const PathCacheKey& key);
+
+        void cachePath(const PathCacheKey& key, const PathSearchResult& result);
+
+        /** Records which epoch regions the search looked at in finding the result. */
+        void recordEpochs(const PathSearch& search, PathSearchResult& result) const;
+
+        PathSearchResult findPath(const PathSearch& search, SearchScratch& scratch, const Vector3f& destination) const;
+        PathSearchResult findPath(const PathSearch& search, SearchScratch& scratch, const DiscreteRect& destination) const;
+
+        /**
+         * Searches the area around the unit for a way back onto its remaining waypoints
+         * a little further along, and splices it onto the rest of them.
+         * Returns none if the unit has no path to repair
+         * or there is no way back onto it nearby.
+         */
+        boost::optional<PathSearchResult> repairPath(const PathSearch& search, SearchScratch& scratch) const;
+
+        /**
+         * If the goal is cut off from the start, ignoring other units,
+         * returns the nearest cell to it that isn't.
+         * Otherwise returns the goal as it is.
+         */
+        Point findReachableGoal(const PathSearch& search, const Point& start, const Point& goal) const;
+
+        /** Returns false if every cell of the area is cut off from the start, ignoring other units. */
+        bool isAreaReachable(const PathSearch& search, const Point& start, const DiscreteRect& area) const;
+
+        /** Finds a path to a single cell, through the entrance graph if it's far enough away. */
+        AStarPathInfo<Point, PathCost> findPathToCell(const PathSearch& search, SearchScratch& scratch, const Point& start, const Point& goal) const;
+
+        /**
+         * Finds a path between distant points by searching the entrance graph
+         * of the unit's movement class, then refining each step of that path
+         * with a grid search confined to the clusters it crosses.
+         * If refineFinalStep is false, the path stops at the last entrance before the goal.
+         *
+         * Returns none if the points are too close together for this to help,
+         * or if the unit cannot use an entrance graph.
+         */
+        boost::optional<AStarPathInfo<Point, PathCost>> findLongPath(
+            const PathSearch& search,
+            SearchScratch& scratch,
+            const Point& start,
+            const Point& goal,
+            bool refineFinalStep) const;
+
+        MovementClassPathGraph& getPathGraph(MovementClassId movementClass, unsigned int footprintX, unsigned int footprintZ);
+
+        /**
+         * Returns true if a unit of the given movement class
+         * could stand at the given position, ignoring other units.
+         */
+        bool isPassableIgnoringUnits(MovementClassId movementClass, unsigned int footprintX, unsigned int footprintZ, const Point& position) const;
+
+        /** Brings every entrance graph up to date with changes to the map's features. */
+        void applyBlockingFeatureChanges();
 
-        Vector3f getWorldCenter(const DiscreteRect& discreteRect);
+        Vector3f getWorldCenter(const DiscreteRect& discreteRect) const;
 
-        DiscreteRect expandTopLeft(const DiscreteRect& rect, unsigned int width, unsigned int height);
+        DiscreteRect expandTopLeft(const DiscreteRect& rect, unsigned int width, unsigned int height) const;
     };
 }
 
@@ -0,0 +1,44 @@
+#include "SearchProgress.h"
+#include <cassert>
+
+namespace rwe
+{
+    void SearchProgress::addExpansion()
+    {
+        auto count = expansions.fetch_add(1) + 1;
+        if (count == wakeAt.load())
+        {
+            // Taking the lock ensures the waiter is either
+            // already waiting or has yet to check the count.
+            std::lock_guard<std::mutex> lock(mutex);
+            changed.notify_all();
+        }
+    }
+
+    void SearchProgress::finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = true;
+        }
+        changed.notify_all();
+    }
+
+    boost::optional<unsigned int> SearchProgress::waitFor(unsigned int maxExpansions)
+    {
+        assert(maxExpansions < NoWaiter - 1);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeAt = maxExpansions + 1;
+        changed.wait(lock, [this, maxExpansions]() { return finished || expansions > maxExpansions; });
+        wakeAt = NoWaiter;
+
+        auto count = expansions.load();
+        if (finished && count <= maxExpansions)
+        {
+            return count;
+        }
+
+        return boost::none;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef RWE_SEARCHPROGRESS_H
+#define RWE_SEARCHPROGRESS_H
+
+#include <atomic>
+#include <boost/optional.hpp>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+
+namespace rwe
+{
+    /**
+     * Counts the vertices expanded by a search running on another thread,
+     * so that whoever is waiting for it can tell how far it has got
+     * without having to wait for it to finish.
+     */
+    class SearchProgress
+    {
+    private:
+        static constexpr unsigned int NoWaiter = std::numeric_limits<unsigned int>::max();
+
+        std::atomic<unsigned int> expansions{0};
+        std::atomic<bool> finished{false};
+
+        /** The expansion count that a waiting thread wants to hear about. */
+        std::atomic<unsigned int> wakeAt{NoWaiter};
+
+        std::mutex mutex;
+        std::condition_variable changed;
+
+    public:
+        /** Called by the search each time it expands a vertex. */
+        void addExpansion();
+
+        /** Called by the search once it has finished. */
+        void finish();
+
+        /**
+         * Blocks until the search has either finished
+         * or expanded more than the given number of vertices.
+         * If it finished within that many expansions,
+         * returns the number of expansions it took.
+         * Otherwise returns none.
+         */
+        boost::optional<unsigned int> waitFor(unsigned int maxExpansions);
+    };
+}
+
+#endif
@@ -1,13 +1,21 @@
 #ifndef RWE_UNITPATH_H
 #define RWE_UNITPATH_H
 
+#include <memory>
 #include <rwe/math/Vector3f.h>
+#include <rwe/pathfinding/FlowField.h>
 
 namespace rwe
 {
     struct UnitPath
     {
         std::vector<Vector3f> waypoints;
+
+        /**
+         * If present, the unit is guided to its final waypoint
+         * by this shared field instead of by waypoints of its own.
+         */
+        std::shared_ptr<const FlowField> flowField{};
     };
 }
 
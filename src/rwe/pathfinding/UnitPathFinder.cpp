@@ -3,17 +3,21 @@
 namespace rwe
 {
     UnitPathFinder::UnitPathFinder(
-        GameSimulation* simulation,
-        MovementClassCollisionService* collisionService,
+        NodePool* nodePool,
+        const OccupiedGrid* occupiedGrid,
+        const MovementClassCollisionService* collisionService,
         UnitId self,
+        const DiscreteRect& selfArea,
         boost::optional<MovementClassId> movementClass,
         unsigned int footprintX,
         unsigned int footprintZ,
         const Point& goal)
         : AbstractUnitPathFinder(
-              simulation,
+              nodePool,
+              occupiedGrid,
               collisionService,
               self,
+              selfArea,
               movementClass,
               footprintX,
               footprintZ),
@@ -6,8 +6,8 @@
 #include "pathfinding_utils.h"
 #include <rwe/DiscreteRect.h>
 #include <rwe/EightWayDirection.h>
-#include <rwe/GameSimulation.h>
 #include <rwe/MovementClassCollisionService.h>
+#include <rwe/OccupiedGrid.h>
 #include <rwe/UnitId.h>
 #include <rwe/pathfinding/AStarPathFinder.h>
 
@@ -23,9 +23,11 @@ namespace rwe
 
     public:
         UnitPathFinder(
-            GameSimulation* simulation,
-            MovementClassCollisionService* collisionService,
+            NodePool* nodePool,
+            const OccupiedGrid* occupiedGrid,
+            const MovementClassCollisionService* collisionService,
             UnitId self,
+            const DiscreteRect& selfArea,
             boost::optional<MovementClassId> movementClass,
             unsigned int footprintX,
             unsigned int footprintZ,
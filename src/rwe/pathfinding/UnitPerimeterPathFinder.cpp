@@ -3,16 +3,20 @@
 namespace rwe
 {
     UnitPerimeterPathFinder::UnitPerimeterPathFinder(
-        GameSimulation* simulation,
-        MovementClassCollisionService* collisionService,
+        NodePool* nodePool,
+        const OccupiedGrid* occupiedGrid,
+        const MovementClassCollisionService* collisionService,
         const UnitId& self,
+        const DiscreteRect& selfArea,
         const boost::optional<MovementClassId>& movementClass,
         unsigned int footprintX,
         unsigned int footprintZ,
         const DiscreteRect& goalRect)
-        : AbstractUnitPathFinder(simulation,
+        : AbstractUnitPathFinder(nodePool,
+              occupiedGrid,
               collisionService,
               self,
+              selfArea,
               movementClass,
               footprintX,
               footprintZ),
@@ -18,9 +18,11 @@ namespace rwe
     protected:
     public:
         UnitPerimeterPathFinder(
-            GameSimulation* simulation,
-            MovementClassCollisionService* collisionService,
+            NodePool* nodePool,
+            const OccupiedGrid* occupiedGrid,
+            const MovementClassCollisionService* collisionService,
             const UnitId& self,
+            const DiscreteRect& selfArea,
             const boost::optional<MovementClassId>& movementClass,
             unsigned int footprintX,
             unsigned int footprintZ,
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <array>
+#include <boost/interprocess/streams/bufferstream.hpp>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <rwe/ColorPalette.h>
+#include <rwe/GameSimulation.h>
+#include <rwe/MapFeatureService.h>
+#include <rwe/MeshService.h>
+#include <rwe/SceneManager.h>
+#include <rwe/SimulationStepper.h>
+#include <rwe/UnitBehaviorService.h>
+#include <rwe/UnitFactory.h>
+#include <rwe/WorkerPool.h>
+#include <rwe/cob/CobExecutionService.h>
+#include <rwe/loading_utils.h>
+#include <rwe/ota.h>
+#include <rwe/pathfinding/PathFindingService.h>
+#include <rwe/tdf.h>
+#include <rwe/tnt/TntArchive.h>
+#include <rwe/vfs/CompositeVirtualFileSystem.h>
+#include <string>
+
+namespace rwe
+{
+    struct HeadlessOptions
+    {
+        std::string searchPath;
+        std::string mapName;
+        unsigned int unitCount{100};
+        unsigned int ticks{600};
+        std::string unitType{"ARMPW"};
+        unsigned int workerCount{WorkerPool::defaultWorkerCount()};
+        unsigned int randomSeed{0};
+    };
+
+    OtaRecord loadOta(AbstractVirtualFileSystem& vfs, const std::string& mapName)
+    {
+        auto otaRaw = vfs.readFile("maps/" + mapName + ".ota");
+        if (!otaRaw)
+        {
+            throw std::runtime_error("Failed to read OTA file");
+        }
+
+        std::string otaStr(otaRaw->begin(), otaRaw->end());
+        return parseOta(parseTdfFromString(otaStr));
+    }
+
+    GameSimulation createHeadlessSimulation(
+        AbstractVirtualFileSystem& vfs,
+        MapFeatureService& featureService,
+        const std::string& mapName,
+        const OtaRecord& ota,
+        unsigned int randomSeed)
+    {
+        auto tntBytes = vfs.readFile("maps/" + mapName + ".tnt");
+        if (!tntBytes)
+        {
+            throw std::runtime_error("Failed to load map bytes");
+        }
+
+        boost::interprocess::bufferstream tntStream(tntBytes->data(), tntBytes->size());
+        TntArchive tnt(&tntStream);
+
+        auto dataGrid = getMapData(tnt);
+
+        Grid<TntTileAttributes> mapAttributes(tnt.getHeader().width, tnt.getHeader().height);
+        tnt.readMapAttributes(mapAttributes.getData());
+
+        auto heightGrid = getHeightGrid(mapAttributes);
+
+        // no tile graphics, the terrain is never drawn
+        MapTerrain terrain(
+            std::vector<TextureRegion>(),
+            std::move(dataGrid),
+            std::move(heightGrid),
+            tnt.getHeader().seaLevel);
+
+        GameSimulation simulation(std::move(terrain), randomSeed);
+
+        // add features from the first OTA schema
+        boost::optional<const OtaSchema&> schema;
+        if (!ota.schemas.empty())
+        {
+            schema = ota.schemas.front();
+        }
+
+        // The sprites are left empty since nothing is ever drawn.
+        addMapFeatures(simulation, tnt, mapAttributes, schema, featureService, createMapFeature);
+
+        return simulation;
+    }
+
+    void printPhase(const std::string& name, std::chrono::steady_clock::duration total, unsigned int ticks)
+    {
+        auto totalMs = std::chrono::duration<double, std::milli>(total).count();
+        std::cout << std::left << std::setw(14) << name
+                  << std::right << std::setw(12) << totalMs
+                  << std::setw(14) << (totalMs / ticks) << std::endl;
+    }
+
+    int runHeadless(const HeadlessOptions& options)
+    {
+        auto vfs = constructVfs(options.searchPath);
+
+        auto paletteBytes = vfs.readFile("palettes/PALETTE.PAL");
+        if (!paletteBytes)
+        {
+            throw std::runtime_error("Couldn't find palette");
+        }
+
+        auto palette = readPalette(*paletteBytes);
+        if (!palette)
+        {
+            throw std::runtime_error("Couldn't read palette");
+        }
+
+        MapFeatureService featureService(&vfs);
+        featureService.loadAllFeatureDefinitions();
+
+        auto ota = loadOta(vfs, options.mapName);
+        auto simulation = createHeadlessSimulation(vfs, featureService, options.mapName, ota, options.randomSeed);
+
+        auto unitDatabase = createUnitDatabase(&vfs, nullptr);
+        auto collisionService = createCollisionService(simulation, unitDatabase);
+
+        const auto& fbi = unitDatabase.getUnitInfo(options.unitType);
+        auto footprint = std::max(fbi.footprintX, fbi.footprintZ);
+
+        UnitFactory unitFactory(std::move(unitDatabase), MeshService::createHeadlessMeshService(&vfs, &*palette), &collisionService);
+        PathFindingService pathFindingService(&simulation, &collisionService, std::min(options.workerCount, PathFindingService::DefaultWorkerCount));
+        UnitBehaviorService unitBehaviorService(&simulation, &pathFindingService, &collisionService);
+        CobExecutionService cobExecutionService;
+        SimulationStepper stepper(&simulation, &pathFindingService, &unitBehaviorService, &cobExecutionService, options.workerCount);
+
+        std::array<PlayerId, 2> players{
+            simulation.addPlayer(GamePlayerInfo{0}),
+            simulation.addPlayer(GamePlayerInfo{1})};
+
+        // Spawn the units in a square block in the middle of the map,
+        // with a one tile gap between neighbours,
+        // and order each one to the opposite side of the block
+        // so that every path crosses the middle.
+        const auto& terrain = simulation.terrain;
+        Vector3f center(
+            (terrain.leftInWorldUnits() + terrain.rightCutoffInWorldUnits()) / 2.0f,
+            0.0f,
+            (terrain.topInWorldUnits() + terrain.bottomCutoffInWorldUnits()) / 2.0f);
+        auto spacing = static_cast<float>(footprint + 1) * MapTerrain::HeightTileWidthInWorldUnits;
+        auto columns = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<float>(options.unitCount))));
+        auto blockOffset = (static_cast<float>(columns) - 1.0f) * spacing / 2.0f;
+
+        unsigned int spawnedCount = 0;
+        for (unsigned int i = 0; i < options.unitCount; ++i)
+        {
+            auto column = i % columns;
+            auto row = i / columns;
+            Vector3f position(
+                center.x - blockOffset + (static_cast<float>(column) * spacing),
+                0.0f,
+                center.z - blockOffset + (static_cast<float>(row) * spacing));
+            position.y = terrain.getHeightAt(position.x, position.z);
+
+            auto owner = players[i % players.size()];
+            auto unitId = simulation.units.nextId();
+            auto unit = unitFactory.createUnit(options.unitType, owner, simulation.getPlayer(owner).color);
+            auto kinematics = unitFactory.createUnitKinematics(options.unitType, position);
+            if (!simulation.tryAddUnit(kinematics, std::move(unit)))
+            {
+                continue;
+            }
+
+            auto destination = (center * 2.0f) - position;
+            destination.y = terrain.getHeightAt(destination.x, destination.z);
+            simulation.getUnit(unitId).addOrder(createMoveOrder(destination));
+            ++spawnedCount;
+        }
+
+        std::cout << "Spawned " << spawnedCount << " of " << options.unitCount << " " << options.unitType
+                  << " units on " << options.mapName << " with " << options.workerCount << " workers" << std::endl;
+
+        float secondsElapsed = static_cast<float>(SceneManager::TickInterval) / 1000.0f;
+
+        SimulationPhaseTimings totals;
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < options.ticks; ++i)
+        {
+            stepper.step(secondsElapsed);
+            totals += stepper.getLastTimings();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        auto seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Ran " << options.ticks << " ticks in " << seconds << " s ("
+                  << (options.ticks / seconds) << " ticks/sec)" << std::endl;
+
+        std::cout << std::left << std::setw(14) << "phase"
+                  << std::right << std::setw(12) << "total ms"
+                  << std::setw(14) << "ms/tick" << std::endl;
+        printPhase("pathfinding", totals.pathFinding, options.ticks);
+        printPhase("intent", totals.intent, options.ticks);
+        printPhase("commit", totals.commit, options.ticks);
+        printPhase("animation", totals.animation, options.ticks);
+        printPhase("scripts", totals.scripts, options.ticks);
+        printPhase("total", totals.total(), options.ticks);
+
+        // Runs with the same arguments and data should always agree on this.
+        std::cout << "Final digest: " << std::hex << std::setw(16) << std::setfill('0')
+                  << simulation.getDigest() << std::endl;
+
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: rwe_headless <search path> <map name> [unit count] [ticks] [unit type] [workers] [seed]" << std::endl;
+        return 1;
+    }
+
+    rwe::HeadlessOptions options;
+    options.searchPath = argv[1];
+    options.mapName = argv[2];
+
+    try
+    {
+        if (argc > 3)
+        {
+            options.unitCount = std::stoul(argv[3]);
+        }
+        if (argc > 4)
+        {
+            options.ticks = std::stoul(argv[4]);
+        }
+        if (argc > 5)
+        {
+            options.unitType = argv[5];
+        }
+        if (argc > 6)
+        {
+            options.workerCount = std::stoul(argv[6]);
+        }
+        if (argc > 7)
+        {
+            options.randomSeed = std::stoul(argv[7]);
+        }
+
+        if (options.ticks == 0)
+        {
+            std::cerr << "Tick count must be greater than zero" << std::endl;
+            return 1;
+        }
+
+        return rwe::runHeadless(options);
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    catch (const std::logic_error& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
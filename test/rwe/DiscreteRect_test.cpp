@@ -178,5 +178,24 @@ namespace rwe
                 }
             }
         }
+
+        SECTION("intersects")
+        {
+            SECTION("is true for rects that share a cell")
+            {
+                DiscreteRect r(2, 3, 3, 2);
+                REQUIRE(r.intersects(DiscreteRect(4, 4, 5, 5)));
+                REQUIRE(r.intersects(DiscreteRect(0, 0, 10, 10)));
+                REQUIRE(r.intersects(r));
+            }
+
+            SECTION("is false for rects that only touch")
+            {
+                DiscreteRect r(2, 3, 3, 2);
+                REQUIRE(!r.intersects(DiscreteRect(5, 3, 1, 1)));
+                REQUIRE(!r.intersects(DiscreteRect(2, 5, 3, 2)));
+                REQUIRE(!r.intersects(DiscreteRect(0, 0, 2, 3)));
+            }
+        }
     }
 }
@@ -0,0 +1,72 @@
+#include "simulation_test_utils.h"
+#include <catch.hpp>
+#include <rwe/GameSimulation.h>
+
+namespace rwe
+{
+    TEST_CASE("GameSimulation")
+    {
+        CobScript script;
+        script.staticVariableCount = 0;
+        GameSimulation sim(makeTestTerrain(16, 16), 0);
+        auto position = sim.terrain.heightmapIndexToWorldCenter(Point(4, 4));
+
+        SECTION("folds only marked units into the digest")
+        {
+            auto unitId = addTestUnit(sim, script, position);
+            auto before = sim.getDigest();
+
+            // Stay within the same cell, so only the unit's own state changes.
+            auto moved = position + Vector3f(1.0f, 0.0f, 1.0f);
+            sim.getUnitKinematics(unitId).position = moved;
+            sim.updateStaleUnitDigests();
+            REQUIRE(sim.getDigest() == before);
+
+            sim.markUnitDigestStale(unitId);
+            sim.markUnitDigestStale(unitId);
+            REQUIRE(sim.staleDigestUnits.size() == 1);
+            sim.updateStaleUnitDigests();
+            REQUIRE(sim.staleDigestUnits.empty());
+            REQUIRE(sim.getDigest() != before);
+
+            // The same as if the unit had been there all along.
+            GameSimulation other(makeTestTerrain(16, 16), 0);
+            addTestUnit(other, script, moved);
+            REQUIRE(sim.getDigest() == other.getDigest());
+        }
+
+        SECTION("skips marked units that have since been removed")
+        {
+            auto empty = sim.getDigest();
+            auto unitId = addTestUnit(sim, script, position);
+
+            sim.markUnitDigestStale(unitId);
+            sim.removeUnit(unitId);
+            sim.updateStaleUnitDigests();
+            REQUIRE(sim.staleDigestUnits.empty());
+            REQUIRE(sim.getDigest() == empty);
+        }
+
+        SECTION("prunes removed units from the animating units")
+        {
+            auto startAnimating = [&](UnitId unitId) {
+                auto& mesh = sim.getUnit(unitId).mesh;
+                mesh.pieces.emplace_back();
+                mesh.pieces.back().xMoveOperation = UnitMesh::MoveOperation(1.0f, 1.0f);
+                mesh.markAnimating(0);
+                sim.addAnimatingUnit(unitId);
+            };
+
+            auto first = addTestUnit(sim, script, position);
+            auto second = addTestUnit(sim, script, sim.terrain.heightmapIndexToWorldCenter(Point(8, 8)));
+            auto third = addTestUnit(sim, script, sim.terrain.heightmapIndexToWorldCenter(Point(12, 12)));
+            startAnimating(first);
+            startAnimating(second);
+            startAnimating(third);
+
+            sim.removeUnit(second);
+            sim.pruneAnimatingUnits();
+            REQUIRE(sim.animatingUnits == (std::vector<UnitId>{first, third}));
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <catch.hpp>
+#include <rwe/MovementClassCollisionService.h>
+
+namespace rwe
+{
+    Grid<char> computeWalkableGridByScanning(const Grid<unsigned char>& heights, unsigned int waterLevel, const MovementClass& mc)
+    {
+        Grid<char> grid(heights.getWidth(), heights.getHeight(), false);
+        for (unsigned int y = 0; y < heights.getHeight() - mc.footprintZ - 1; ++y)
+        {
+            for (unsigned int x = 0; x < heights.getWidth() - mc.footprintX - 1; ++x)
+            {
+                auto walkable = !isMaxSlopeGreaterThan(heights, waterLevel, x, y, mc.footprintX, mc.footprintZ, mc.maxSlope, mc.maxWaterSlope)
+                    && isWaterDepthWithinBounds(heights, waterLevel, x, y, mc.footprintX, mc.footprintZ, mc.minWaterDepth, mc.maxWaterDepth);
+                grid.set(x, y, walkable);
+            }
+        }
+
+        return grid;
+    }
+
+    MovementClass makeMovementClass(unsigned int footprint, unsigned int minWaterDepth, unsigned int maxWaterDepth, unsigned int maxSlope, unsigned int maxWaterSlope)
+    {
+        MovementClass mc;
+        mc.footprintX = footprint;
+        mc.footprintZ = footprint;
+        mc.minWaterDepth = minWaterDepth;
+        mc.maxWaterDepth = maxWaterDepth;
+        mc.maxSlope = maxSlope;
+        mc.maxWaterSlope = maxWaterSlope;
+        return mc;
+    }
+
+    TEST_CASE("computeWalkableGrid")
+    {
+        const unsigned int waterLevel = 60;
+
+        // rolling terrain that dips below the water in places
+        Grid<unsigned char> heights(40, 30);
+        for (std::size_t y = 0; y < heights.getHeight(); ++y)
+        {
+            for (std::size_t x = 0; x < heights.getWidth(); ++x)
+            {
+                auto value = 40 + ((x * 13) % 37) + ((y * 7) % 29) + (((x * y) * 31) % 11);
+                heights.set(x, y, static_cast<unsigned char>(value));
+            }
+        }
+
+        auto planes = computeWalkabilityPlanes(heights, waterLevel);
+
+        SECTION("matches scanning each footprint")
+        {
+            std::vector<MovementClass> classes{
+                makeMovementClass(1, 0, 255, 20, 20),
+                makeMovementClass(2, 0, 10, 25, 15),
+                makeMovementClass(3, 5, 255, 30, 40),
+                makeMovementClass(4, 0, 255, 255, 255),
+                makeMovementClass(2, 0, 0, 16, 16),
+            };
+
+            for (const auto& mc : classes)
+            {
+                auto expected = computeWalkableGridByScanning(heights, waterLevel, mc);
+                REQUIRE(computeWalkableGrid(planes, mc) == expected);
+            }
+        }
+
+        SECTION("marks nothing walkable if the footprint doesn't fit")
+        {
+            auto mc = makeMovementClass(40, 0, 255, 255, 255);
+            auto grid = computeWalkableGrid(planes, mc);
+            REQUIRE(grid == Grid<char>(40, 30, false));
+        }
+    }
+}
@@ -0,0 +1,260 @@
+#include <catch.hpp>
+#include <rwe/OccupiedGrid.h>
+
+namespace rwe
+{
+    TEST_CASE("OccupiedType")
+    {
+        SECTION("defaults to empty")
+        {
+            OccupiedType cell;
+            REQUIRE(cell.isNone());
+            REQUIRE(!cell.isFeature());
+            REQUIRE(!cell.getUnit());
+        }
+
+        SECTION("can hold a feature")
+        {
+            OccupiedType cell(OccupiedFeature{});
+            REQUIRE(!cell.isNone());
+            REQUIRE(cell.isFeature());
+            REQUIRE(!cell.getUnit());
+        }
+
+        SECTION("can hold a unit")
+        {
+            OccupiedType cell(OccupiedUnit(UnitId(0)));
+            REQUIRE(!cell.isNone());
+            REQUIRE(!cell.isFeature());
+            REQUIRE(*cell.getUnit() == UnitId(0));
+
+            OccupiedType otherCell(OccupiedUnit(UnitId(12345)));
+            REQUIRE(*otherCell.getUnit() == UnitId(12345));
+            REQUIRE(cell != otherCell);
+        }
+    }
+
+    TEST_CASE("OccupiedGrid")
+    {
+        OccupiedGrid g(16, 8);
+
+        SECTION("isCollisionAt")
+        {
+            SECTION("is false for an empty grid")
+            {
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 0, 16, 8), UnitId(1)));
+            }
+
+            SECTION("is false for an empty region")
+            {
+                g.grid.set(0, 0, OccupiedFeature());
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 0, 0, 0), UnitId(1)));
+            }
+
+            SECTION("detects features")
+            {
+                g.grid.set(9, 3, OccupiedFeature());
+                REQUIRE(g.isCollisionAt(GridRegion(0, 0, 16, 8), UnitId(1)));
+                REQUIRE(g.isCollisionAt(GridRegion(9, 3, 1, 1), UnitId(1)));
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 0, 9, 8), UnitId(1)));
+                REQUIRE(!g.isCollisionAt(GridRegion(10, 0, 6, 8), UnitId(1)));
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 4, 16, 4), UnitId(1)));
+            }
+
+            SECTION("ignores the unit's own cells")
+            {
+                g.grid.setArea(GridRegion(2, 2, 5, 3), OccupiedUnit(UnitId(1)));
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 0, 16, 8), UnitId(1)));
+                REQUIRE(g.isCollisionAt(GridRegion(0, 0, 16, 8), UnitId(2)));
+            }
+
+            SECTION("detects other units in the tail of a row")
+            {
+                g.grid.set(14, 7, OccupiedUnit(UnitId(2)));
+                REQUIRE(g.isCollisionAt(GridRegion(0, 7, 15, 1), UnitId(1)));
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 7, 14, 1), UnitId(1)));
+            }
+
+            SECTION("tells apart units from the same slot in its last generations")
+            {
+                auto last = makeUnitId(UnitIdMaxSlots - 1, UnitIdGenerationMask);
+                auto previous = makeUnitId(UnitIdMaxSlots - 1, UnitIdGenerationMask - 1);
+                g.setArea(GridRegion(2, 2, 3, 3), OccupiedUnit(last));
+                REQUIRE(*g.grid.get(3, 3).getUnit() == last);
+                REQUIRE(!g.grid.get(3, 3).isFeature());
+                REQUIRE(!g.isCollisionAt(GridRegion(0, 0, 16, 8), last));
+                REQUIRE(g.isCollisionAt(GridRegion(0, 0, 16, 8), previous));
+            }
+        }
+
+        SECTION("setArea")
+        {
+            SECTION("keeps the digest in step with the grid contents")
+            {
+                auto empty = g.digest.value();
+
+                g.setArea(GridRegion(1, 1, 3, 2), OccupiedUnit(UnitId(1)));
+                g.setArea(GridRegion(5, 5, 2, 2), OccupiedFeature());
+                auto withBoth = g.digest.value();
+                REQUIRE(withBoth != empty);
+
+                OccupiedGrid other(16, 8);
+                other.setArea(GridRegion(5, 5, 2, 2), OccupiedFeature());
+                other.setArea(GridRegion(1, 1, 3, 2), OccupiedUnit(UnitId(1)));
+                REQUIRE(other.digest.value() == withBoth);
+
+                g.setArea(GridRegion(1, 1, 3, 2), OccupiedNone());
+                g.setArea(GridRegion(5, 5, 2, 2), OccupiedNone());
+                REQUIRE(g.digest.value() == empty);
+            }
+
+            SECTION("distinguishes different units")
+            {
+                OccupiedGrid other(16, 8);
+                g.setArea(GridRegion(1, 1, 1, 1), OccupiedUnit(UnitId(1)));
+                other.setArea(GridRegion(1, 1, 1, 1), OccupiedUnit(UnitId(2)));
+                REQUIRE(g.digest.value() != other.digest.value());
+            }
+        }
+
+        SECTION("clearance")
+        {
+            // Brute force answer for the size of the empty square at (x, y).
+            auto expectedClearance = [&g](std::size_t x, std::size_t y) {
+                unsigned int size = 0;
+                while (size < OccupiedGrid::MaxClearance
+                       && !g.isCollisionAt(DiscreteRect(x, y, size + 1, size + 1), UnitId(0xFFFF)))
+                {
+                    ++size;
+                }
+                return size;
+            };
+
+            auto matchesBruteForce = [&]() {
+                for (std::size_t y = 0; y < g.grid.getHeight(); ++y)
+                {
+                    for (std::size_t x = 0; x < g.grid.getWidth(); ++x)
+                    {
+                        if (g.clearance.get(x, y) != expectedClearance(x, y))
+                        {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            };
+
+            SECTION("is limited by the edges of the grid")
+            {
+                REQUIRE(g.clearance.get(0, 0) == 8);
+                REQUIRE(g.clearance.get(15, 0) == 1);
+                REQUIRE(g.clearance.get(10, 4) == 4);
+                REQUIRE(matchesBruteForce());
+            }
+
+            SECTION("is kept up to date by setArea")
+            {
+                g.setArea(GridRegion(5, 3, 2, 2), OccupiedUnit(UnitId(1)));
+                g.setArea(GridRegion(12, 6, 1, 1), OccupiedFeature());
+                REQUIRE(g.clearance.get(5, 3) == 0);
+                REQUIRE(g.clearance.get(0, 0) == 5);
+                REQUIRE(matchesBruteForce());
+
+                g.setArea(GridRegion(5, 3, 2, 2), OccupiedNone());
+                g.setArea(GridRegion(6, 4, 2, 2), OccupiedUnit(UnitId(1)));
+                REQUIRE(matchesBruteForce());
+            }
+
+            SECTION("answers collision queries like a full scan")
+            {
+                g.setArea(GridRegion(5, 3, 2, 2), OccupiedUnit(UnitId(1)));
+                g.setArea(GridRegion(12, 6, 1, 1), OccupiedFeature());
+
+                DiscreteRect selfArea(5, 3, 2, 2);
+                for (int y = -1; y < 9; ++y)
+                {
+                    for (int x = -1; x < 17; ++x)
+                    {
+                        for (unsigned int size = 1; size <= 3; ++size)
+                        {
+                            DiscreteRect square(x, y, size, size);
+                            DiscreteRect oblong(x, y, size + 2, size);
+                            REQUIRE(g.isCollisionAt(square, UnitId(1), selfArea) == g.isCollisionAt(square, UnitId(1)));
+                            REQUIRE(g.isCollisionAt(oblong, UnitId(1), selfArea) == g.isCollisionAt(oblong, UnitId(1)));
+                            REQUIRE(g.isAdjacentToObstacle(square, UnitId(1), selfArea) == g.isAdjacentToObstacle(square, UnitId(1)));
+                        }
+                    }
+                }
+            }
+        }
+
+        SECTION("epochs")
+        {
+            OccupiedGrid g(20, 10);
+
+            SECTION("cover the grid in square regions")
+            {
+                REQUIRE(g.epochs.getWidth() == 3);
+                REQUIRE(g.epochs.getHeight() == 2);
+
+                auto regions = g.getEpochRegions(DiscreteRect(-2, 7, 11, 10));
+                REQUIRE(regions.x == 0);
+                REQUIRE(regions.y == 0);
+                REQUIRE(regions.width == 2);
+                REQUIRE(regions.height == 2);
+
+                REQUIRE(g.getEpochRegions(DiscreteRect(20, 0, 4, 4)).width == 0);
+            }
+
+            SECTION("are bumped by setArea only where cells change")
+            {
+                auto all = g.getEpochRegions(DiscreteRect(0, 0, 20, 10));
+                auto before = g.getEpochs(all);
+
+                g.setArea(GridRegion(7, 2, 2, 1), OccupiedFeature());
+                auto after = g.getEpochs(all);
+                std::vector<unsigned int> changed{1, 1, 0, 0, 0, 0};
+                for (std::size_t i = 0; i < after.size(); ++i)
+                {
+                    REQUIRE(after[i] - before[i] == changed[i]);
+                }
+
+                g.setArea(GridRegion(7, 2, 2, 1), OccupiedFeature());
+                REQUIRE(g.getEpochs(all) == after);
+                REQUIRE(g.getFixedEpochs(all) == after);
+            }
+
+            SECTION("moveArea leaves the fixed epochs alone")
+            {
+                g.setArea(GridRegion(6, 2, 2, 2), OccupiedUnit(UnitId(1)));
+                auto all = g.getEpochRegions(DiscreteRect(0, 0, 20, 10));
+                auto before = g.getEpochs(all);
+                auto fixedBefore = g.getFixedEpochs(all);
+
+                g.moveArea(GridRegion(6, 2, 2, 2), GridRegion(7, 2, 2, 2), OccupiedUnit(UnitId(1)));
+                REQUIRE(g.grid.get(6, 2).isNone());
+                REQUIRE(g.grid.get(8, 3) == OccupiedType(OccupiedUnit(UnitId(1))));
+                REQUIRE(g.getEpochs(all) != before);
+                REQUIRE(g.getFixedEpochs(all) == fixedBefore);
+            }
+        }
+
+        SECTION("copyChangedRegions brings a copy up to date")
+        {
+            OccupiedGrid source(40, 30);
+            source.setArea(GridRegion(3, 3, 2, 2), OccupiedFeature());
+            OccupiedGrid copy(source);
+
+            source.setArea(GridRegion(3, 3, 2, 2), OccupiedNone());
+            source.setArea(GridRegion(20, 17, 3, 4), OccupiedUnit(UnitId(1)));
+            source.setArea(GridRegion(39, 29, 1, 1), OccupiedFeature());
+
+            copy.copyChangedRegions(source);
+            REQUIRE(copy.grid == source.grid);
+            REQUIRE(copy.clearance == source.clearance);
+            REQUIRE(copy.epochs == source.epochs);
+            REQUIRE(copy.fixedEpochs == source.fixedEpochs);
+            REQUIRE(copy.digest.value() == source.digest.value());
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#include <catch.hpp>
+#include <rwe/PathRequestQueue.h>
+#include <vector>
+
+namespace rwe
+{
+    std::vector<UnitId> queuedUnits(const PathRequestQueue& queue)
+    {
+        std::vector<UnitId> units;
+        for (const auto& request : queue)
+        {
+            units.push_back(request.unitId);
+        }
+        return units;
+    }
+
+    TEST_CASE("PathRequestQueue")
+    {
+        PathRequestQueue queue;
+        queue.push(UnitId(1));
+        queue.push(UnitId(2));
+        queue.push(UnitId(3));
+
+        SECTION("serves requests in the order they were made")
+        {
+            REQUIRE(queue.size() == 3);
+            REQUIRE(queue.front().unitId == UnitId(1));
+            queue.pop_front();
+            REQUIRE(queue.front().unitId == UnitId(2));
+            REQUIRE(!queue.contains(UnitId(1)));
+        }
+
+        SECTION("moves repeated requests to the back")
+        {
+            queue.push(UnitId(1));
+            std::vector<UnitId> expected{UnitId(2), UnitId(3), UnitId(1)};
+            REQUIRE(queuedUnits(queue) == expected);
+        }
+
+        SECTION("removes requests from the middle")
+        {
+            queue.remove(UnitId(2));
+            queue.remove(UnitId(4));
+            std::vector<UnitId> expected{UnitId(1), UnitId(3)};
+            REQUIRE(queuedUnits(queue) == expected);
+            REQUIRE(!queue.contains(UnitId(2)));
+
+            queue.push(UnitId(2));
+            REQUIRE(queue.size() == 3);
+        }
+    }
+}
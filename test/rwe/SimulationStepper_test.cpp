@@ -0,0 +1,101 @@
+#include "simulation_test_utils.h"
+#include <catch.hpp>
+#include <rwe/SimulationStepper.h>
+#include <rwe/cob/CobOpCode.h>
+#include <spdlog/sinks/null_sink.h>
+
+namespace rwe
+{
+    static std::uint32_t cobOp(OpCode opCode)
+    {
+        return static_cast<std::uint32_t>(opCode);
+    }
+
+    /**
+     * A script that turns its only piece to a random angle,
+     * waits for the turn to finish, sleeps for a random time
+     * and starts again.
+     */
+    static CobScript makeRestlessScript()
+    {
+        CobScript script;
+        script.instructions = {
+            cobOp(OpCode::PUSH_CONSTANT), 2000,
+            cobOp(OpCode::PUSH_CONSTANT), 0,
+            cobOp(OpCode::PUSH_CONSTANT), 16384,
+            cobOp(OpCode::RAND),
+            cobOp(OpCode::TURN), 0, 1,
+            cobOp(OpCode::WAIT_FOR_TURN), 0, 1,
+            cobOp(OpCode::PUSH_CONSTANT), 1,
+            cobOp(OpCode::PUSH_CONSTANT), 100,
+            cobOp(OpCode::RAND),
+            cobOp(OpCode::SLEEP),
+            cobOp(OpCode::JUMP), 0};
+        script.code = decodeCobInstructions(script.instructions);
+        script.pieces.push_back("base");
+        script.functions.push_back(CobFunctionInfo{"Create", 0});
+        script.staticVariableCount = 0;
+        indexCobFunctions(script);
+        return script;
+    }
+
+    static void addRestlessUnit(GameSimulation& sim, const CobScript& script, const Point& cell)
+    {
+        UnitMesh mesh;
+        mesh.pieces.emplace_back();
+        mesh.pieces.back().name = "base";
+
+        auto unit = makeTestUnit(script, mesh);
+        unit.cobEnvironment->createThread(CobEntryPoint::Create);
+        addTestUnit(sim, std::move(unit), sim.terrain.heightmapIndexToWorldCenter(cell));
+    }
+
+    /** Runs a field of units with restless scripts, returning the digest after each tick. */
+    static std::vector<std::uint64_t> runRestlessUnits(const CobScript& script, unsigned int workerCount, unsigned int ticks)
+    {
+        GameSimulation sim(makeTestTerrain(64, 64), 0);
+        for (int y = 0; y < 8; ++y)
+        {
+            for (int x = 0; x < 8; ++x)
+            {
+                addRestlessUnit(sim, script, Point(4 + (x * 6), 4 + (y * 6)));
+            }
+        }
+
+        MovementClassCollisionService collisionService;
+        PathFindingService pathFindingService(&sim, &collisionService, 0);
+        UnitBehaviorService unitBehaviorService(&sim, &pathFindingService, &collisionService);
+        CobExecutionService cobExecutionService;
+        SimulationStepper stepper(&sim, &pathFindingService, &unitBehaviorService, &cobExecutionService, workerCount);
+
+        std::vector<std::uint64_t> digests;
+        for (unsigned int i = 0; i < ticks; ++i)
+        {
+            stepper.step(1.0f / 30.0f);
+            digests.push_back(sim.getDigest());
+        }
+
+        return digests;
+    }
+
+    TEST_CASE("SimulationStepper")
+    {
+        if (!spdlog::get("rwe"))
+        {
+            spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+        }
+
+        SECTION("running scripts in parallel gives the same digests as running them serially")
+        {
+            auto script = makeRestlessScript();
+
+            // Enough units that the script and animation phases
+            // are split between the workers.
+            auto serial = runRestlessUnits(script, 0, 90);
+            auto parallel = runRestlessUnits(script, 4, 90);
+
+            REQUIRE(serial.front() != serial.back());
+            REQUIRE(parallel == serial);
+        }
+    }
+}
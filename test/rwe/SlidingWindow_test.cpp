@@ -0,0 +1,108 @@
+#include <catch.hpp>
+#include <rwe/SlidingWindow.h>
+
+namespace rwe
+{
+    TEST_CASE("slidingWindowMin")
+    {
+        // clang-format off
+        Grid<int> grid(4, 3, std::vector<int>{
+            5, 1, 7, 3,
+            2, 8, 6, 4,
+            9, 0, 3, 2,
+        });
+        // clang-format on
+
+        SECTION("computes the minimum of every window")
+        {
+            auto result = slidingWindowMin(grid, 2, 2);
+            // clang-format off
+            Grid<int> expected(3, 2, std::vector<int>{
+                1, 1, 3,
+                0, 0, 2,
+            });
+            // clang-format on
+            REQUIRE(result == expected);
+        }
+
+        SECTION("returns the grid unchanged for a 1x1 window")
+        {
+            auto result = slidingWindowMin(grid, 1, 1);
+            REQUIRE(result == grid);
+        }
+
+        SECTION("handles a window covering the whole grid")
+        {
+            auto result = slidingWindowMin(grid, 4, 3);
+            Grid<int> expected(1, 1, std::vector<int>{0});
+            REQUIRE(result == expected);
+        }
+
+        SECTION("returns an empty grid if the window doesn't fit")
+        {
+            auto result = slidingWindowMin(grid, 5, 1);
+            REQUIRE(result.getWidth() == 0);
+            REQUIRE(result.getHeight() == 0);
+        }
+
+        SECTION("throws for an empty window")
+        {
+            REQUIRE_THROWS(slidingWindowMin(grid, 0, 1));
+        }
+    }
+
+    TEST_CASE("slidingWindowMax")
+    {
+        // clang-format off
+        Grid<int> grid(4, 3, std::vector<int>{
+            5, 1, 7, 3,
+            2, 8, 6, 4,
+            9, 0, 3, 2,
+        });
+        // clang-format on
+
+        SECTION("computes the maximum of every window")
+        {
+            auto result = slidingWindowMax(grid, 3, 1);
+            // clang-format off
+            Grid<int> expected(2, 3, std::vector<int>{
+                7, 7,
+                8, 8,
+                9, 3,
+            });
+            // clang-format on
+            REQUIRE(result == expected);
+        }
+
+        SECTION("agrees with a brute force search")
+        {
+            Grid<int> big(17, 13);
+            for (std::size_t y = 0; y < big.getHeight(); ++y)
+            {
+                for (std::size_t x = 0; x < big.getWidth(); ++x)
+                {
+                    big.set(x, y, static_cast<int>(((x * 7919) + (y * 104729)) % 23));
+                }
+            }
+
+            auto result = slidingWindowMax(big, 4, 3);
+            REQUIRE(result.getWidth() == 14);
+            REQUIRE(result.getHeight() == 11);
+            for (std::size_t y = 0; y < result.getHeight(); ++y)
+            {
+                for (std::size_t x = 0; x < result.getWidth(); ++x)
+                {
+                    int expected = 0;
+                    for (std::size_t dy = 0; dy < 3; ++dy)
+                    {
+                        for (std::size_t dx = 0; dx < 4; ++dx)
+                        {
+                            expected = std::max(expected, big.get(x + dx, y + dy));
+                        }
+                    }
+                    REQUIRE(result.get(x, y) == expected);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include <catch.hpp>
+#include <rwe/StateDigest.h>
+
+namespace rwe
+{
+    TEST_CASE("StateDigest")
+    {
+        SECTION("items can be added in any order")
+        {
+            StateDigest a;
+            a.toggle(1);
+            a.toggle(2);
+            a.toggle(3);
+
+            StateDigest b;
+            b.toggle(3);
+            b.toggle(1);
+            b.toggle(2);
+
+            REQUIRE(a.value() == b.value());
+        }
+
+        SECTION("toggling an item twice removes it")
+        {
+            StateDigest a;
+            a.toggle(hashCombine(1, 2));
+            a.toggle(hashCombine(1, 2));
+
+            REQUIRE(a.value() == StateDigest().value());
+        }
+
+        SECTION("replace matches a digest built from scratch")
+        {
+            StateDigest a;
+            a.toggle(hashCombine(0, 10));
+            a.toggle(hashCombine(1, 20));
+            a.replace(hashCombine(1, 20), hashCombine(1, 30));
+
+            StateDigest b;
+            b.toggle(hashCombine(0, 10));
+            b.toggle(hashCombine(1, 30));
+
+            REQUIRE(a.value() == b.value());
+
+            StateDigest c;
+            c.toggle(hashCombine(0, 10));
+            c.toggle(hashCombine(1, 20));
+            REQUIRE(a.value() != c.value());
+        }
+
+        SECTION("events depend on order")
+        {
+            StateDigest a;
+            a.recordEvent(1);
+            a.recordEvent(2);
+
+            StateDigest b;
+            b.recordEvent(2);
+            b.recordEvent(1);
+
+            REQUIRE(a.value() != b.value());
+        }
+
+        SECTION("events are distinct from state")
+        {
+            StateDigest a;
+            a.recordEvent(1);
+
+            StateDigest b;
+            b.toggle(1);
+
+            REQUIRE(a.value() != b.value());
+        }
+    }
+
+    TEST_CASE("hashString")
+    {
+        SECTION("is stable")
+        {
+            // 64-bit FNV-1a test vector
+            REQUIRE(hashString("a") == 0xaf63dc4c8601ec8cull);
+        }
+    }
+}
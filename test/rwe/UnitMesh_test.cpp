@@ -0,0 +1,95 @@
+#include <catch.hpp>
+#include <rwe/UnitMesh.h>
+
+namespace rwe
+{
+    TEST_CASE("UnitMesh")
+    {
+        UnitMesh mesh;
+        mesh.pieces.resize(3);
+        mesh.pieces[0].name = "base";
+        mesh.pieces[1].name = "turret";
+        mesh.pieces[1].parent = 0;
+        mesh.pieces[2].name = "barrel";
+        mesh.pieces[2].parent = 1;
+
+        SECTION("findPieceIndex")
+        {
+            SECTION("finds pieces by name")
+            {
+                REQUIRE(*mesh.findPieceIndex("turret") == 1u);
+                REQUIRE(*mesh.findPieceIndex("barrel") == 2u);
+            }
+
+            SECTION("returns none for unknown pieces")
+            {
+                REQUIRE(!mesh.findPieceIndex("flare"));
+            }
+        }
+
+        SECTION("update")
+        {
+            SECTION("is not animating initially")
+            {
+                REQUIRE(!mesh.isAnimating());
+            }
+
+            SECTION("advances only marked pieces")
+            {
+                mesh.pieces[1].yMoveOperation = UnitMesh::MoveOperation(10.0f, 4.0f);
+                mesh.markAnimating(1);
+                REQUIRE(mesh.isAnimating());
+
+                mesh.update(1.0f);
+                REQUIRE(mesh.pieces[1].offset.y == 4.0f);
+                REQUIRE(mesh.isAnimating());
+            }
+
+            SECTION("marking a piece twice only lists it once")
+            {
+                mesh.pieces[2].xMoveOperation = UnitMesh::MoveOperation(1.0f, 1.0f);
+                mesh.markAnimating(2);
+                mesh.markAnimating(2);
+                std::vector<unsigned int> expected{2};
+                REQUIRE(mesh.animatingPieces == expected);
+            }
+
+            SECTION("drops pieces once their operations complete")
+            {
+                mesh.pieces[1].yMoveOperation = UnitMesh::MoveOperation(10.0f, 4.0f);
+                mesh.markAnimating(1);
+                mesh.pieces[2].xMoveOperation = UnitMesh::MoveOperation(1.0f, 4.0f);
+                mesh.markAnimating(2);
+
+                mesh.update(1.0f);
+                REQUIRE(mesh.pieces[2].offset.x == 1.0f);
+                REQUIRE(!mesh.pieces[2].animating);
+                std::vector<unsigned int> expected{1};
+                REQUIRE(mesh.animatingPieces == expected);
+
+                mesh.update(1.0f);
+                mesh.update(1.0f);
+                REQUIRE(mesh.pieces[1].offset.y == 10.0f);
+                REQUIRE(!mesh.isAnimating());
+            }
+
+            SECTION("records operations that end")
+            {
+                mesh.pieces[1].yTurnOperation = UnitMesh::TurnOperation(RadiansAngle(1.0f), 0.5f);
+                mesh.pieces[1].xMoveOperation = UnitMesh::MoveOperation(3.0f, 1.0f);
+                mesh.markAnimating(1);
+
+                mesh.update(1.0f);
+                REQUIRE(mesh.endedOperations.empty());
+
+                mesh.update(1.0f);
+                std::vector<PieceOperationKey> expected{PieceOperationKey(1, Axis::Y, PieceOperationKey::Kind::Turn)};
+                REQUIRE(mesh.endedOperations == expected);
+
+                mesh.update(1.0f);
+                expected.emplace_back(1, Axis::X, PieceOperationKey::Kind::Move);
+                REQUIRE(mesh.endedOperations == expected);
+            }
+        }
+    }
+}
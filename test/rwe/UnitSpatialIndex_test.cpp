@@ -0,0 +1,111 @@
+#include <catch.hpp>
+#include <rwe/UnitSpatialIndex.h>
+
+namespace rwe
+{
+    TEST_CASE("UnitSpatialIndex")
+    {
+        UnitSpatialIndex index(-256.0f, -256.0f, 512.0f, 512.0f, 64.0f);
+        index.insert(UnitId(0), Vector3f(0.0f, 0.0f, 0.0f), 10.0f);
+        index.insert(UnitId(1), Vector3f(100.0f, 0.0f, 0.0f), 10.0f);
+        index.insert(UnitId(2), Vector3f(-200.0f, 0.0f, 200.0f), 10.0f);
+        index.insert(UnitId(3), Vector3f(5.0f, 0.0f, 5.0f), 10.0f);
+
+        SECTION("queryCircle")
+        {
+            SECTION("returns units within the radius in ID order")
+            {
+                auto result = index.queryCircle(Vector3f(0.0f, 0.0f, 0.0f), 50.0f);
+                std::vector<UnitId> expected{UnitId(0), UnitId(3)};
+                REQUIRE(result == expected);
+            }
+
+            SECTION("ignores height")
+            {
+                auto result = index.queryCircle(Vector3f(100.0f, 500.0f, 0.0f), 1.0f);
+                std::vector<UnitId> expected{UnitId(1)};
+                REQUIRE(result == expected);
+            }
+
+            SECTION("finds units across many cells")
+            {
+                auto result = index.queryCircle(Vector3f(0.0f, 0.0f, 0.0f), 1000.0f);
+                std::vector<UnitId> expected{UnitId(0), UnitId(1), UnitId(2), UnitId(3)};
+                REQUIRE(result == expected);
+            }
+        }
+
+        SECTION("queryRect")
+        {
+            SECTION("returns units inside the rect")
+            {
+                auto result = index.queryRect(Rectangle2f::fromTopLeft(-250.0f, 150.0f, 100.0f, 100.0f));
+                std::vector<UnitId> expected{UnitId(2)};
+                REQUIRE(result == expected);
+            }
+        }
+
+        SECTION("move")
+        {
+            SECTION("updates the results of later queries")
+            {
+                index.move(UnitId(2), Vector3f(90.0f, 0.0f, 10.0f));
+                REQUIRE(index.queryCircle(Vector3f(-200.0f, 0.0f, 200.0f), 50.0f).empty());
+
+                auto result = index.queryCircle(Vector3f(100.0f, 0.0f, 0.0f), 20.0f);
+                std::vector<UnitId> expected{UnitId(1), UnitId(2)};
+                REQUIRE(result == expected);
+            }
+
+            SECTION("removes units from later queries")
+            {
+                index.remove(UnitId(3));
+                auto result = index.queryCircle(Vector3f(0.0f, 0.0f, 0.0f), 50.0f);
+                std::vector<UnitId> expected{UnitId(0)};
+                REQUIRE(result == expected);
+            }
+
+            SECTION("clamps positions outside the index to the edge cells")
+            {
+                index.move(UnitId(1), Vector3f(1000.0f, 0.0f, 0.0f));
+                auto result = index.queryCircle(Vector3f(1000.0f, 0.0f, 0.0f), 5.0f);
+                std::vector<UnitId> expected{UnitId(1)};
+                REQUIRE(result == expected);
+            }
+        }
+
+        SECTION("queryRay")
+        {
+            SECTION("returns units near a downward diagonal ray")
+            {
+                // passes over (100, 0) at y = 0
+                Ray3f ray(Vector3f(100.0f, 100.0f, -100.0f), Vector3f(0.0f, -1.0f, 1.0f));
+                auto result = index.queryRay(ray, 0.0f, 0.0f);
+                std::vector<UnitId> expected{UnitId(1)};
+                REQUIRE(result == expected);
+            }
+
+            SECTION("returns units near a straight down ray")
+            {
+                Ray3f ray(Vector3f(-195.0f, 100.0f, 195.0f), Vector3f(0.0f, -1.0f, 0.0f));
+                auto result = index.queryRay(ray, 0.0f, 0.0f);
+                std::vector<UnitId> expected{UnitId(2)};
+                REQUIRE(result == expected);
+            }
+
+            SECTION("returns nothing for a ray pointing away")
+            {
+                Ray3f ray(Vector3f(100.0f, 100.0f, -100.0f), Vector3f(0.0f, 1.0f, 1.0f));
+                REQUIRE(index.queryRay(ray, 0.0f, 0.0f).empty());
+            }
+
+            SECTION("handles horizontal rays")
+            {
+                Ray3f ray(Vector3f(-1000.0f, 0.0f, 2.0f), Vector3f(1.0f, 0.0f, 0.0f));
+                auto result = index.queryRay(ray, 0.0f, 0.0f);
+                std::vector<UnitId> expected{UnitId(0), UnitId(1), UnitId(3)};
+                REQUIRE(result == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include <catch.hpp>
+#include <rwe/UnitStore.h>
+
+namespace rwe
+{
+    static Unit makeTestUnit(const CobScript& script)
+    {
+        return Unit(
+            UnitMesh(),
+            std::make_shared<const ScriptPieceMap>(),
+            std::make_unique<CobEnvironment>(&script),
+            SelectionMesh{CollisionMesh(), GlMesh(VaoHandle(), VboHandle(), 0)});
+    }
+
+    static UnitKinematics makeTestKinematics(float x)
+    {
+        UnitKinematics kinematics;
+        kinematics.position = Vector3f(x, 0.0f, 0.0f);
+        return kinematics;
+    }
+
+    TEST_CASE("UnitStore")
+    {
+        CobScript script;
+        script.staticVariableCount = 0;
+        UnitStore store;
+
+        SECTION("adds and looks up units")
+        {
+            auto expectedId = store.nextId();
+            auto a = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+            auto b = store.add(makeTestKinematics(2.0f), makeTestUnit(script));
+
+            REQUIRE(a == expectedId);
+            REQUIRE(a != b);
+            REQUIRE(store.size() == 2);
+            REQUIRE(store.contains(a));
+            REQUIRE(store.contains(b));
+            REQUIRE(store.getKinematics(a).position.x == 1.0f);
+            REQUIRE(store.getKinematics(b).position.x == 2.0f);
+        }
+
+        SECTION("removing a unit keeps the others in place")
+        {
+            auto a = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+            auto b = store.add(makeTestKinematics(2.0f), makeTestUnit(script));
+            auto c = store.add(makeTestKinematics(3.0f), makeTestUnit(script));
+
+            store.remove(a);
+
+            REQUIRE(store.size() == 2);
+            REQUIRE(!store.contains(a));
+            REQUIRE(store.getKinematics(b).position.x == 2.0f);
+            REQUIRE(store.getKinematics(c).position.x == 3.0f);
+            REQUIRE(store.idAt(0) == c);
+            REQUIRE(store.idAt(1) == b);
+        }
+
+        SECTION("stale IDs are not valid")
+        {
+            auto a = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+            store.remove(a);
+
+            REQUIRE(!store.contains(a));
+            REQUIRE_THROWS(store.get(a));
+            REQUIRE_THROWS(store.remove(a));
+
+            // the slot is reused for the next unit, under a new ID
+            auto b = store.add(makeTestKinematics(2.0f), makeTestUnit(script));
+            REQUIRE(getUnitIdSlot(b) == getUnitIdSlot(a));
+            REQUIRE(b != a);
+            REQUIRE(!store.contains(a));
+            REQUIRE(store.contains(b));
+        }
+
+        SECTION("slots are reused in the order they were freed")
+        {
+            auto a = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+            auto b = store.add(makeTestKinematics(2.0f), makeTestUnit(script));
+            store.remove(a);
+            store.remove(b);
+
+            auto c = store.add(makeTestKinematics(3.0f), makeTestUnit(script));
+            auto d = store.add(makeTestKinematics(4.0f), makeTestUnit(script));
+            REQUIRE(getUnitIdSlot(c) == getUnitIdSlot(a));
+            REQUIRE(getUnitIdSlot(d) == getUnitIdSlot(b));
+        }
+
+        SECTION("slots are retired rather than wrapping their generation")
+        {
+            auto first = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+            auto id = first;
+            for (unsigned int i = 0; i < UnitIdGenerationMask; ++i)
+            {
+                store.remove(id);
+                id = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+                REQUIRE(getUnitIdSlot(id) == getUnitIdSlot(first));
+                REQUIRE(!store.contains(first));
+            }
+
+            REQUIRE(getUnitIdGeneration(id) == UnitIdGenerationMask);
+
+            store.remove(id);
+            auto next = store.add(makeTestKinematics(1.0f), makeTestUnit(script));
+            REQUIRE(getUnitIdSlot(next) != getUnitIdSlot(first));
+            REQUIRE(!store.contains(first));
+            REQUIRE(!store.contains(id));
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include <catch.hpp>
+#include <rwe/Unit.h>
+
+namespace rwe
+{
+    /**
+     * Finds a piece the way the model used to be searched
+     * before it was flattened: depth-first through the tree,
+     * checking each piece before its children.
+     */
+    static boost::optional<unsigned int> findPieceInTree(const UnitMesh& mesh, unsigned int pieceIndex, const std::string& name)
+    {
+        if (mesh.pieces[pieceIndex].name == name)
+        {
+            return pieceIndex;
+        }
+
+        for (unsigned int i = 0; i < mesh.pieces.size(); ++i)
+        {
+            if (mesh.pieces[i].parent == pieceIndex)
+            {
+                if (auto found = findPieceInTree(mesh, i, name); found)
+                {
+                    return found;
+                }
+            }
+        }
+
+        return boost::none;
+    }
+
+    static UnitMesh::Piece makePiece(const std::string& name, boost::optional<unsigned int> parent)
+    {
+        UnitMesh::Piece piece;
+        piece.name = name;
+        piece.parent = parent;
+        return piece;
+    }
+
+    TEST_CASE("Unit")
+    {
+        SECTION("script pieces map to the same pieces as a search of the model by name")
+        {
+            // base
+            //   turret
+            //     barrel
+            //       flare
+            //   wake
+            //     flare
+            UnitMesh mesh;
+            mesh.pieces.push_back(makePiece("base", boost::none));
+            mesh.pieces.push_back(makePiece("turret", 0u));
+            mesh.pieces.push_back(makePiece("barrel", 1u));
+            mesh.pieces.push_back(makePiece("flare", 2u));
+            mesh.pieces.push_back(makePiece("wake", 0u));
+            mesh.pieces.push_back(makePiece("flare", 4u));
+
+            std::vector<std::string> scriptPieces{"flare", "base", "missing", "wake", "barrel", "", "turret", "Base"};
+            auto pieceMap = std::make_shared<const ScriptPieceMap>(createScriptPieceMap(scriptPieces, mesh));
+            REQUIRE(pieceMap->size() == scriptPieces.size());
+
+            CobScript script;
+            script.pieces = scriptPieces;
+            script.staticVariableCount = 0;
+            Unit unit(
+                mesh,
+                pieceMap,
+                std::make_unique<CobEnvironment>(&script),
+                SelectionMesh{CollisionMesh(), GlMesh(VaoHandle(), VboHandle(), 0)});
+
+            for (unsigned int i = 0; i < scriptPieces.size(); ++i)
+            {
+                INFO("piece " << scriptPieces[i]);
+                auto expected = findPieceInTree(mesh, 0, scriptPieces[i]);
+                REQUIRE(((*pieceMap)[i] == expected));
+
+                auto piece = unit.findScriptPiece(i);
+                REQUIRE(!!piece == !!expected);
+                if (expected)
+                {
+                    REQUIRE(&*piece == &unit.mesh.pieces[*expected]);
+                    REQUIRE(unit.getScriptPieceIndex(i) == *expected);
+                }
+                else
+                {
+                    REQUIRE_THROWS(unit.getScriptPieceIndex(i));
+                }
+            }
+
+            // The first flare in depth-first order wins.
+            REQUIRE(*(*pieceMap)[0] == 3u);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <atomic>
+#include <catch.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <rwe/WorkerPool.h>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+namespace rwe
+{
+    TEST_CASE("WorkerPool")
+    {
+        SECTION("parallelFor")
+        {
+            SECTION("visits every index exactly once")
+            {
+                WorkerPool pool(3);
+                std::vector<std::atomic<int>> visits(1000);
+
+                pool.parallelFor(visits.size(), [&](std::size_t i) { ++visits[i]; });
+
+                for (const auto& v : visits)
+                {
+                    REQUIRE(v == 1);
+                }
+            }
+
+            SECTION("can be called many times")
+            {
+                WorkerPool pool(2);
+                std::atomic<int> total(0);
+
+                for (int i = 0; i < 50; ++i)
+                {
+                    pool.parallelFor(100, [&](std::size_t) { ++total; });
+                }
+
+                REQUIRE(total == 5000);
+            }
+
+            SECTION("works with no workers")
+            {
+                WorkerPool pool(0);
+                std::vector<int> visits(100);
+
+                pool.parallelFor(visits.size(), [&](std::size_t i) { ++visits[i]; });
+
+                REQUIRE(std::all_of(visits.begin(), visits.end(), [](int v) { return v == 1; }));
+            }
+
+            SECTION("spreads small coarse jobs across threads")
+            {
+                WorkerPool pool(3);
+
+                std::mutex mutex;
+                std::condition_variable cond;
+                std::set<std::thread::id> threads;
+
+                // Each index waits until at least two threads have joined in,
+                // so this only finishes quickly if the job is shared out.
+                pool.parallelFor(8, [&](std::size_t) {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    threads.insert(std::this_thread::get_id());
+                    cond.notify_all();
+                    cond.wait_for(lock, std::chrono::seconds(5), [&]() { return threads.size() >= 2; });
+                }, 1);
+
+                REQUIRE(threads.size() >= 2);
+            }
+
+            SECTION("runs jobs no larger than the grain size serially")
+            {
+                WorkerPool pool(3);
+                std::set<std::thread::id> threads;
+
+                pool.parallelFor(16, [&](std::size_t) { threads.insert(std::this_thread::get_id()); });
+
+                REQUIRE(threads.size() == 1);
+                REQUIRE(*threads.begin() == std::this_thread::get_id());
+            }
+
+            SECTION("rethrows exceptions on the calling thread")
+            {
+                WorkerPool pool(3);
+
+                auto f = [](std::size_t i) {
+                    if (i == 500)
+                    {
+                        throw std::runtime_error("failed");
+                    }
+                };
+                REQUIRE_THROWS(pool.parallelFor(1000, f));
+
+                // the pool is still usable afterwards
+                std::atomic<int> total(0);
+                pool.parallelFor(100, [&](std::size_t) { ++total; });
+                REQUIRE(total == 100);
+            }
+        }
+    }
+}
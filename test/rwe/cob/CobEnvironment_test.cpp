@@ -0,0 +1,182 @@
+#include <catch.hpp>
+#include <rwe/cob/CobEnvironment.h>
+#include <rwe/cob/CobReadyUnits.h>
+
+namespace rwe
+{
+    TEST_CASE("CobEnvironment")
+    {
+        CobScript script;
+        script.functions.push_back(CobFunctionInfo{"Create", 0});
+        script.functions.push_back(CobFunctionInfo{"AimPrimary", 0});
+        script.staticVariableCount = 0;
+        indexCobFunctions(script);
+
+        CobEnvironment env(&script);
+
+        SECTION("starts threads at entry points")
+        {
+            auto thread = env.createThread(CobEntryPoint::AimPrimary, {1, 2});
+            REQUIRE(!!thread);
+            REQUIRE((*thread)->functionId == 1);
+
+            auto byName = env.createThread(internCobFunctionSymbol("AimPrimary"));
+            REQUIRE(!!byName);
+            REQUIRE((*byName)->functionId == 1);
+
+            REQUIRE(!env.createThread(CobEntryPoint::FirePrimary));
+            REQUIRE(!env.createThread(internCobFunctionSymbol("Killed")));
+        }
+
+        SECTION("interns each function name once")
+        {
+            REQUIRE(internCobFunctionSymbol("AimPrimary") == internCobFunctionSymbol("AimPrimary"));
+            REQUIRE(internCobFunctionSymbol("AimPrimary") != internCobFunctionSymbol("Create"));
+            auto create = script.findFunction(internCobFunctionSymbol("Create"));
+            REQUIRE(!!create);
+            REQUIRE(*create == 0);
+        }
+
+        SECTION("reuses deleted threads")
+        {
+            auto thread = env.createThread(1, {10, 20}, 4);
+            REQUIRE(env.isNotCorrupt());
+            REQUIRE(thread->callStack.size() == 1);
+            REQUIRE(thread->locals.size() == 2);
+
+            auto queued = env.readyQueue.front();
+            env.readyQueue.pop_front();
+            env.deleteThread(queued);
+            REQUIRE(env.isNotCorrupt());
+
+            auto reused = env.createThread(0, {}, 0);
+            REQUIRE(reused == thread);
+            REQUIRE(env.threads.size() == 1);
+            REQUIRE(reused->functionId == 0);
+            REQUIRE(reused->signalMask == 0);
+            REQUIRE(reused->locals.size() == 0);
+            REQUIRE(env.isNotCorrupt());
+        }
+
+        SECTION("marks threads killed by signals as dead")
+        {
+            auto masked = env.createThread(0, {}, 2);
+            auto unmasked = env.createThread(1, {}, 1);
+
+            env.sendSignal(2);
+            REQUIRE(masked->dead);
+            REQUIRE(!unmasked->dead);
+
+            // dead threads stay queued until their queue is worked through
+            REQUIRE(env.readyQueue.size() == 2);
+            REQUIRE(env.isNotCorrupt());
+        }
+
+        SECTION("marks its unit ready once until it has run")
+        {
+            CobReadyUnits readyUnits;
+            std::vector<UnitId> taken;
+
+            // threads created before the unit is added are not lost
+            env.createThread(0, {}, 0);
+            env.setReadyUnits(&readyUnits, UnitId(5));
+            env.createThread(1, {}, 0);
+
+            readyUnits.takeAll(taken);
+            std::vector<UnitId> expected{UnitId(5)};
+            REQUIRE(taken == expected);
+
+            taken.clear();
+            env.createThread(1, {}, 0);
+            readyUnits.takeAll(taken);
+            REQUIRE(taken.empty());
+
+            env.clearReady();
+            env.createThread(1, {}, 0);
+            readyUnits.takeAll(taken);
+            REQUIRE(taken == expected);
+        }
+
+        SECTION("files piece waits by operation")
+        {
+            env.createThread(0, {}, 0);
+            env.createThread(1, {}, 0);
+            auto first = env.readyQueue[0];
+            auto second = env.readyQueue[1];
+            env.readyQueue.clear();
+
+            PieceOperationKey turn(2, Axis::Y, PieceOperationKey::Kind::Turn);
+            PieceOperationKey move(2, Axis::Y, PieceOperationKey::Kind::Move);
+            env.addPieceWait(turn, first);
+            env.addPieceWait(move, second);
+            REQUIRE(env.isNotCorrupt());
+
+            std::vector<CobThread*> expectedTurn{first};
+            REQUIRE(*env.findPieceWaiters(turn) == expectedTurn);
+            std::vector<CobThread*> expectedMove{second};
+            REQUIRE(*env.findPieceWaiters(move) == expectedMove);
+
+            REQUIRE(env.findPieceWaiters(PieceOperationKey(7, Axis::Z, PieceOperationKey::Kind::Turn)) == nullptr);
+        }
+
+        SECTION("moves blocked threads killed by signals to the finished queue")
+        {
+            env.createThread(0, {}, 2);
+            env.createThread(1, {}, 2);
+            env.createThread(1, {}, 1);
+            auto sleeping = env.readyQueue[0];
+            auto waiting = env.readyQueue[1];
+            auto survivor = env.readyQueue[2];
+            env.readyQueue.clear();
+
+            PieceOperationKey key(0, Axis::X, PieceOperationKey::Kind::Move);
+            env.sleepingThreads.emplace_back(GameTime(10), sleeping);
+            env.addPieceWait(key, waiting);
+            env.addPieceWait(key, survivor);
+
+            env.sendSignal(2);
+            REQUIRE(sleeping->dead);
+            REQUIRE(waiting->dead);
+            REQUIRE(!survivor->dead);
+
+            REQUIRE(env.sleepingThreads.empty());
+            std::vector<CobThread*> expectedWaiters{survivor};
+            REQUIRE(*env.findPieceWaiters(key) == expectedWaiters);
+            REQUIRE(env.finishedQueue.size() == 2);
+            REQUIRE(env.isNotCorrupt());
+        }
+
+        SECTION("doesn't reap dead threads")
+        {
+            auto thread = env.createThread(0, {}, 2);
+            auto queued = env.readyQueue.front();
+            env.readyQueue.pop_front();
+            env.finishedQueue.push_back(queued);
+            REQUIRE(!!env.tryReapThread(CobThreadHandle(thread)));
+
+            env.sendSignal(2);
+            REQUIRE(!env.tryReapThread(CobThreadHandle(thread)));
+        }
+
+        SECTION("doesn't reap through handles to deleted threads")
+        {
+            auto thread = env.createThread(0, {}, 2);
+            CobThreadHandle handle(thread);
+            env.sendSignal(2);
+
+            auto queued = env.readyQueue.front();
+            env.readyQueue.pop_front();
+            env.deleteThread(queued);
+
+            // the same thread is reused and finishes as something else
+            auto reused = env.createThread(1, {}, 0);
+            REQUIRE(reused == thread);
+            env.readyQueue.pop_front();
+            env.finishedQueue.push_back(queued);
+
+            REQUIRE(!handle.isCurrent());
+            REQUIRE(!env.tryReapThread(handle));
+            REQUIRE(!!env.tryReapThread(CobThreadHandle(reused)));
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch.hpp>
+#include <rwe/cob/CobInstruction.h>
+#include <rwe/cob/CobOpCode.h>
+#include <rwe/util.h>
+
+namespace rwe
+{
+    std::uint32_t op(OpCode opCode)
+    {
+        return static_cast<std::uint32_t>(opCode);
+    }
+
+    TEST_CASE("decodeCobInstructions")
+    {
+        SECTION("decodes operands inline")
+        {
+            std::vector<std::uint32_t> code{op(OpCode::SHOW), 3, op(OpCode::WAIT_FOR_TURN), 4, 2, op(OpCode::RETURN)};
+            auto instructions = decodeCobInstructions(code);
+            REQUIRE(instructions.size() == code.size());
+
+            REQUIRE(instructions[0].op == CobOp::Show);
+            REQUIRE(instructions[0].length == 2);
+            REQUIRE(instructions[0].operands[0] == 3);
+
+            REQUIRE(instructions[2].op == CobOp::WaitForTurn);
+            REQUIRE(instructions[2].length == 3);
+            REQUIRE(instructions[2].operands[0] == 4);
+            REQUIRE(instructions[2].operands[1] == static_cast<std::uint32_t>(Axis::Z));
+
+            REQUIRE(instructions[5].op == CobOp::Return);
+            REQUIRE(instructions[5].length == 1);
+        }
+
+        SECTION("leaves errors to be raised when run")
+        {
+            std::vector<std::uint32_t> code{0x12345678, op(OpCode::TURN_NOW), 1, 7, op(OpCode::PUSH_CONSTANT)};
+            auto instructions = decodeCobInstructions(code);
+
+            REQUIRE(instructions[0].op == CobOp::UnsupportedOpCode);
+            REQUIRE(instructions[0].operands[0] == 0x12345678);
+            REQUIRE(instructions[1].op == CobOp::InvalidAxis);
+            REQUIRE(instructions[1].operands[0] == 7);
+            REQUIRE(instructions[4].op == CobOp::Truncated);
+        }
+
+        SECTION("fuses turns by constants into one instruction")
+        {
+            std::vector<std::uint32_t> code{
+                op(OpCode::PUSH_CONSTANT), 100,
+                op(OpCode::PUSH_CONSTANT), 8192,
+                op(OpCode::TURN), 5, 1,
+                op(OpCode::RETURN)};
+            auto instructions = decodeCobInstructions(code);
+
+            REQUIRE(instructions[0].op == CobOp::TurnConstant);
+            REQUIRE(instructions[0].length == 7);
+            REQUIRE(instructions[0].operands[0] == 5);
+            REQUIRE(instructions[0].operands[1] == static_cast<std::uint32_t>(Axis::Y));
+            REQUIRE(instructions[0].operands[2] == 8192);
+            REQUIRE(instructions[0].operands[3] == 100);
+
+            // A jump into the middle of the run still finds it there as it was.
+            REQUIRE(instructions[2].op == CobOp::PushConstant);
+            REQUIRE(instructions[2].operands[0] == 8192);
+            REQUIRE(instructions[4].op == CobOp::Turn);
+        }
+
+        SECTION("settles jumps on constant conditions")
+        {
+            std::vector<std::uint32_t> code{
+                op(OpCode::PUSH_CONSTANT), 1,
+                op(OpCode::JUMP_NOT_EQUAL), 20,
+                op(OpCode::PUSH_CONSTANT), 0,
+                op(OpCode::JUMP_NOT_EQUAL), 20};
+            auto instructions = decodeCobInstructions(code);
+
+            REQUIRE(instructions[0].op == CobOp::Jump);
+            REQUIRE(instructions[0].length == 4);
+            REQUIRE(instructions[0].operands[0] == 4);
+
+            REQUIRE(instructions[4].op == CobOp::Jump);
+            REQUIRE(instructions[4].operands[0] == 20);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include <catch.hpp>
+#include <rwe/cob/CobTimerWheel.h>
+
+namespace rwe
+{
+    TEST_CASE("CobTimerWheel")
+    {
+        CobTimerWheel wheel(GameTime(10));
+        std::vector<UnitId> due;
+
+        SECTION("wakes units when their time comes")
+        {
+            wheel.schedule(GameTime(12), UnitId(1));
+            wheel.schedule(GameTime(11), UnitId(2));
+            wheel.schedule(GameTime(12), UnitId(3));
+
+            wheel.advance(GameTime(11), due);
+            REQUIRE((due == std::vector<UnitId>{UnitId(2)}));
+
+            due.clear();
+            wheel.advance(GameTime(12), due);
+            REQUIRE((due == std::vector<UnitId>{UnitId(1), UnitId(3)}));
+            REQUIRE(wheel.empty());
+        }
+
+        SECTION("moves past times to the next tick")
+        {
+            wheel.schedule(GameTime(3), UnitId(1));
+
+            wheel.advance(GameTime(11), due);
+            REQUIRE((due == std::vector<UnitId>{UnitId(1)}));
+        }
+
+        SECTION("keeps wake-ups more than a turn away")
+        {
+            auto later = GameTime(11 + CobTimerWheel::SlotCount);
+            wheel.schedule(later, UnitId(1));
+
+            wheel.advance(GameTime(11), due);
+            REQUIRE(due.empty());
+
+            wheel.advance(GameTime(later.value - 1), due);
+            REQUIRE(due.empty());
+
+            wheel.advance(later, due);
+            REQUIRE((due == std::vector<UnitId>{UnitId(1)}));
+        }
+
+        SECTION("catches up when advanced several ticks at once")
+        {
+            wheel.schedule(GameTime(15), UnitId(1));
+            wheel.schedule(GameTime(400), UnitId(2));
+            wheel.schedule(GameTime(1000), UnitId(3));
+
+            wheel.advance(GameTime(500), due);
+            REQUIRE((due == std::vector<UnitId>{UnitId(1), UnitId(2)}));
+            REQUIRE(wheel.getCurrentTime() == GameTime(500));
+            REQUIRE(!wheel.empty());
+        }
+    }
+}
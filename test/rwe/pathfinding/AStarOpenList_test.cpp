@@ -0,0 +1,109 @@
+#include <catch.hpp>
+#include <rwe/pathfinding/AStarOpenList.h>
+
+namespace rwe
+{
+    struct TestOpenListNode
+    {
+        float estimatedTotalCost;
+        std::size_t openListIndex{AStarNotInOpenList};
+    };
+
+    struct TestBucketKey
+    {
+        std::size_t operator()(float cost) const
+        {
+            return static_cast<std::size_t>(cost);
+        }
+    };
+
+    template <typename OpenList>
+    std::vector<float> popAll(OpenList& openList)
+    {
+        std::vector<float> costs;
+        while (!openList.empty())
+        {
+            auto& node = openList.pop();
+            REQUIRE(node.openListIndex == AStarNotInOpenList);
+            costs.push_back(node.estimatedTotalCost);
+        }
+        return costs;
+    }
+
+    TEST_CASE("BinaryOpenList")
+    {
+        std::vector<TestOpenListNode> nodes{{5.0f}, {1.5f}, {3.0f}, {1.0f}, {4.0f}};
+        BinaryOpenList<TestOpenListNode> openList;
+        for (auto& node : nodes)
+        {
+            openList.push(node);
+        }
+
+        SECTION("pops nodes cheapest first")
+        {
+            std::vector<float> expected{1.0f, 1.5f, 3.0f, 4.0f, 5.0f};
+            REQUIRE(popAll(openList) == expected);
+        }
+
+        SECTION("reorders decreased nodes")
+        {
+            openList.decrease(nodes[0], 0.5f);
+            std::vector<float> expected{0.5f, 1.0f, 1.5f, 3.0f, 4.0f};
+            REQUIRE(popAll(openList) == expected);
+        }
+
+        SECTION("removes nodes from the middle")
+        {
+            openList.remove(nodes[2]);
+            REQUIRE(nodes[2].openListIndex == AStarNotInOpenList);
+            std::vector<float> expected{1.0f, 1.5f, 4.0f, 5.0f};
+            REQUIRE(popAll(openList) == expected);
+        }
+    }
+
+    TEST_CASE("BucketOpenList")
+    {
+        std::vector<TestOpenListNode> nodes{{5.0f}, {1.5f}, {3.0f}, {1.0f}, {4.2f}, {4.1f}};
+        BucketOpenList<TestOpenListNode, TestBucketKey> openList;
+        for (auto& node : nodes)
+        {
+            openList.push(node);
+        }
+        REQUIRE(openList.size() == 6);
+
+        SECTION("pops nodes cheapest first, even within a bucket")
+        {
+            std::vector<float> expected{1.0f, 1.5f, 3.0f, 4.1f, 4.2f, 5.0f};
+            REQUIRE(popAll(openList) == expected);
+        }
+
+        SECTION("moves decreased nodes between buckets")
+        {
+            openList.decrease(nodes[0], 4.0f);
+            openList.decrease(nodes[4], 0.5f);
+            std::vector<float> expected{0.5f, 1.0f, 1.5f, 3.0f, 4.0f, 4.1f};
+            REQUIRE(popAll(openList) == expected);
+        }
+
+        SECTION("accepts nodes cheaper than the last one popped")
+        {
+            REQUIRE(openList.pop().estimatedTotalCost == 1.0f);
+            REQUIRE(openList.pop().estimatedTotalCost == 1.5f);
+            TestOpenListNode cheap{0.25f};
+            openList.push(cheap);
+            REQUIRE(openList.pop().estimatedTotalCost == 0.25f);
+            REQUIRE(openList.pop().estimatedTotalCost == 3.0f);
+        }
+
+        SECTION("can be reused after clearing")
+        {
+            openList.pop();
+            openList.clear();
+            REQUIRE(openList.empty());
+            TestOpenListNode node{2.0f};
+            openList.push(node);
+            REQUIRE(openList.pop().estimatedTotalCost == 2.0f);
+            REQUIRE(openList.empty());
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#include <catch.hpp>
+#include <rwe/Grid.h>
+#include <rwe/Point.h>
+#include <rwe/pathfinding/AStarPathFinder.h>
+#include <spdlog/sinks/null_sink.h>
+
+namespace rwe
+{
+    /** Four-way movement over a grid of walls, with unit step costs. */
+    class TestGridPathFinder : public AStarPathFinder<Point, int>
+    {
+    private:
+        const Grid<char>* walls;
+        Point goal;
+
+    public:
+        TestGridPathFinder(NodePool* nodePool, const Grid<char>* walls, const Point& goal)
+            : AStarPathFinder(nodePool), walls(walls), goal(goal)
+        {
+        }
+
+    protected:
+        bool isGoal(const Point& vertex) override
+        {
+            return vertex == goal;
+        }
+
+        int estimateCostToGoal(const Point& vertex) override
+        {
+            return std::abs(goal.x - vertex.x) + std::abs(goal.y - vertex.y);
+        }
+
+        void getSuccessors(const VertexInfo& vertex, std::vector<VertexInfo>& successors) override
+        {
+            const Point steps[]{Point(1, 0), Point(0, 1), Point(-1, 0), Point(0, -1)};
+            for (const auto& step : steps)
+            {
+                auto p = vertex.vertex + step;
+                if (p.x < 0 || p.y < 0 || p.x >= static_cast<int>(walls->getWidth()) || p.y >= static_cast<int>(walls->getHeight()))
+                {
+                    continue;
+                }
+
+                if (walls->get(p.x, p.y))
+                {
+                    continue;
+                }
+
+                successors.push_back(VertexInfo{vertex.costToReach + 1, p, &vertex});
+            }
+        }
+
+        std::size_t getNodeIndex(const Point& vertex) const override
+        {
+            return walls->toIndex(vertex.x, vertex.y);
+        }
+    };
+
+    TEST_CASE("AStarPathFinder")
+    {
+        if (!spdlog::get("rwe"))
+        {
+            spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+        }
+
+        // clang-format off
+        Grid<char> walls(5, 4, std::vector<char>{
+            0, 0, 0, 0, 0,
+            0, 1, 1, 1, 0,
+            0, 1, 0, 0, 0,
+            0, 1, 0, 1, 1,
+        });
+        // clang-format on
+
+        AStarNodePool<Point, int> pool(walls.getWidth() * walls.getHeight());
+
+        SECTION("finds a shortest path around walls")
+        {
+            TestGridPathFinder pathFinder(&pool, &walls, Point(2, 3));
+            auto result = pathFinder.findPath(Point(0, 3));
+            REQUIRE(result.type == AStarPathType::Complete);
+            REQUIRE(result.path.size() == 13);
+            REQUIRE(result.path.front() == Point(0, 3));
+            REQUIRE(result.path.back() == Point(2, 3));
+        }
+
+        SECTION("reports the closed vertices with their predecessors")
+        {
+            TestGridPathFinder pathFinder(&pool, &walls, Point(1, 0));
+            auto result = pathFinder.findPath(Point(0, 0));
+            REQUIRE(result.closedVertices.size() == 2);
+            REQUIRE(result.closedVertices[0].vertex == Point(0, 0));
+            REQUIRE(!result.closedVertices[0].predecessor);
+            REQUIRE(result.closedVertices[1].vertex == Point(1, 0));
+            REQUIRE(*result.closedVertices[1].predecessor == Point(0, 0));
+        }
+
+        SECTION("returns a partial path to the closest point if the goal is unreachable")
+        {
+            walls.set(2, 2, 1);
+            TestGridPathFinder pathFinder(&pool, &walls, Point(2, 3));
+            auto result = pathFinder.findPath(Point(0, 0));
+            REQUIRE(result.type == AStarPathType::Partial);
+            REQUIRE(result.path.back() == Point(0, 3));
+        }
+
+        SECTION("gives the same results when the pool is reused")
+        {
+            TestGridPathFinder first(&pool, &walls, Point(2, 3));
+            auto firstResult = first.findPath(Point(0, 3));
+
+            TestGridPathFinder other(&pool, &walls, Point(4, 0));
+            other.findPath(Point(0, 0));
+
+            TestGridPathFinder again(&pool, &walls, Point(2, 3));
+            auto againResult = again.findPath(Point(0, 3));
+            REQUIRE(againResult.type == AStarPathType::Complete);
+            REQUIRE(againResult.path == firstResult.path);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#include <catch.hpp>
+#include <rwe/pathfinding/FlowField.h>
+
+namespace rwe
+{
+    TEST_CASE("FlowField")
+    {
+        // a wall with a gap at the bottom
+        Grid<char> passable(8, 8, true);
+        for (std::size_t y = 0; y < 6; ++y)
+        {
+            passable.set(4, y, false);
+        }
+
+        FlowField field(passable, Point(6, 0), 1, 1);
+
+        SECTION("costs paths to the goal")
+        {
+            REQUIRE(field.getCost(Point(6, 0)) == 0.0f);
+            REQUIRE(field.getCost(Point(7, 0)) == 1.0f);
+            REQUIRE(field.getCost(Point(5, 0)) == 1.0f);
+        }
+
+        SECTION("goes around obstacles")
+        {
+            // up through the gap and back along the wall
+            REQUIRE(field.getCost(Point(3, 0)) > 6.0f);
+            REQUIRE(field.isReachable(Point(3, 0)));
+        }
+
+        SECTION("reaches impassable cells but doesn't go through them")
+        {
+            REQUIRE(field.isReachable(Point(4, 0)));
+            REQUIRE(field.getCost(Point(4, 0)) == 1.0f + field.getCost(Point(5, 0)));
+        }
+
+        SECTION("units can step out of impassable cells but not into them")
+        {
+            auto out = field.getNextStep(Point(4, 0));
+            REQUIRE(!!out);
+            REQUIRE(*out == Point(5, 0));
+
+            // (4, 1) is cheaper than any passable neighbour of (3, 2)
+            REQUIRE(field.getCost(Point(4, 1)) < field.getCost(Point(3, 2)));
+            auto next = field.getNextStep(Point(3, 2));
+            REQUIRE(!!next);
+            REQUIRE(passable.get(next->x, next->y));
+        }
+
+        SECTION("steps lead around the wall to the goal")
+        {
+            auto cell = Point(0, 0);
+            auto crossedInGap = false;
+            for (unsigned int i = 0; i < 100; ++i)
+            {
+                auto next = field.getNextStep(cell);
+                if (!next)
+                {
+                    break;
+                }
+
+                REQUIRE(passable.get(next->x, next->y));
+                if (next->x == 4)
+                {
+                    crossedInGap = next->y >= 6;
+                    REQUIRE(crossedInGap);
+                }
+
+                cell = *next;
+            }
+
+            REQUIRE(cell == Point(6, 0));
+            REQUIRE(crossedInGap);
+            REQUIRE(field.lookAhead(Point(0, 0), 100) == Point(6, 0));
+
+            auto next = field.getNextStep(Point(3, 0));
+            REQUIRE(!!next);
+            REQUIRE(field.getCost(*next) < field.getCost(Point(3, 0)));
+            REQUIRE(!field.getNextStep(Point(6, 0)));
+        }
+
+        SECTION("cells cut off from the goal are unreachable")
+        {
+            Grid<char> walledIn(8, 8, true);
+            walledIn.set(5, 0, false);
+            walledIn.set(5, 1, false);
+            walledIn.set(6, 1, false);
+            walledIn.set(7, 1, false);
+            FlowField enclosed(walledIn, Point(6, 0), 1, 1);
+
+            REQUIRE(!enclosed.isReachable(Point(0, 7)));
+            REQUIRE(!enclosed.isReachable(Point(-1, 0)));
+            REQUIRE(!enclosed.getNextStep(Point(0, 7)));
+        }
+    }
+}
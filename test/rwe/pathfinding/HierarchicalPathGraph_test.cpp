@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <catch.hpp>
+#include <rwe/pathfinding/HierarchicalPathGraph.h>
+#include <spdlog/sinks/null_sink.h>
+
+namespace rwe
+{
+    bool stepsBetweenNeighbouringClusters(const HierarchicalPathGraph& graph, const std::vector<Point>& path)
+    {
+        for (std::size_t i = 1; i < path.size(); ++i)
+        {
+            if (!graph.inNeighbouringClusters(path[i - 1], path[i]))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    TEST_CASE("HierarchicalPathGraph")
+    {
+        if (!spdlog::get("rwe"))
+        {
+            spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+        }
+
+        // three clusters wide and tall
+        const std::size_t size = HierarchicalPathGraph::ClusterSize * 3;
+        Grid<char> passable(size, size, true);
+
+        // a wall down the middle cluster column, with a gap at the bottom
+        const std::size_t wallX = HierarchicalPathGraph::ClusterSize + 8;
+        for (std::size_t y = 0; y < size - 4; ++y)
+        {
+            passable.set(wallX, y, false);
+        }
+
+        HierarchicalPathGraph graph(std::move(passable));
+        HierarchicalPathGraph::NodePool pool(size * size);
+
+        SECTION("places entrances on both sides of open borders")
+        {
+            const auto& entrances = graph.getEntrances(Point(0, 0));
+            REQUIRE(!entrances.empty());
+            for (const auto& e : entrances)
+            {
+                auto onRight = e.position.x == HierarchicalPathGraph::ClusterSize - 1;
+                auto onBottom = e.position.y == HierarchicalPathGraph::ClusterSize - 1;
+                REQUIRE((onRight || onBottom));
+            }
+        }
+
+        SECTION("finds paths around obstacles")
+        {
+            Point start(2, 2);
+            Point goal(size - 3, 2);
+            auto path = graph.findPath(pool, start, goal);
+            REQUIRE(path.type == AStarPathType::Complete);
+            REQUIRE(path.path.front() == start);
+            REQUIRE(path.path.back() == goal);
+            REQUIRE(stepsBetweenNeighbouringClusters(graph, path.path));
+
+            // the path has to go through the cluster with the gap in the wall
+            auto passesGap = std::any_of(path.path.begin(), path.path.end(), [&](const Point& p) {
+                return graph.getCluster(p) == Point(1, 2);
+            });
+            REQUIRE(passesGap);
+        }
+
+        SECTION("finds paths to a goal in the same cluster")
+        {
+            auto path = graph.findPath(pool, Point(1, 1), Point(10, 12));
+            REQUIRE(path.type == AStarPathType::Complete);
+            std::vector<Point> expected{Point(1, 1), Point(10, 12)};
+            REQUIRE(path.path == expected);
+        }
+
+        SECTION("components")
+        {
+            SECTION("join cells connected by any path")
+            {
+                auto component = graph.getComponent(Point(2, 2));
+                REQUIRE(component != HierarchicalPathGraph::NoComponent);
+                REQUIRE(graph.getComponent(Point(size - 3, 2)) == component);
+                REQUIRE(graph.getComponent(Point(wallX, 2)) == HierarchicalPathGraph::NoComponent);
+            }
+
+            SECTION("are split when the gap is closed")
+            {
+                for (std::size_t y = size - 4; y < size; ++y)
+                {
+                    graph.setPassable(wallX, y, false);
+                }
+                graph.repair();
+
+                auto left = graph.getComponent(Point(2, 2));
+                auto right = graph.getComponent(Point(size - 3, 2));
+                REQUIRE(left != right);
+
+                // the nearest cell on the left to a goal on the right
+                auto nearest = graph.findNearestInComponent(left, Point(wallX + 2, 10), 8);
+                REQUIRE(!!nearest);
+                REQUIRE(*nearest == Point(wallX - 1, 10));
+
+                REQUIRE(!graph.findNearestInComponent(left, Point(size - 3, 2), 4));
+            }
+        }
+
+        SECTION("repair")
+        {
+            SECTION("closes paths through cells that became impassable")
+            {
+                for (std::size_t y = size - 4; y < size; ++y)
+                {
+                    graph.setPassable(wallX, y, false);
+                }
+                REQUIRE(graph.repair() > 0);
+
+                auto path = graph.findPath(pool, Point(2, 2), Point(size - 3, 2));
+                REQUIRE(path.type == AStarPathType::Partial);
+            }
+
+            SECTION("opens paths through cells that became passable")
+            {
+                graph.setPassable(wallX, 5, true);
+                REQUIRE(graph.repair() > 0);
+
+                auto path = graph.findPath(pool, Point(2, 2), Point(size - 3, 2));
+                REQUIRE(path.type == AStarPathType::Complete);
+                auto passesBottomRow = std::any_of(path.path.begin(), path.path.end(), [&](const Point& p) {
+                    return graph.getCluster(p).y == 2;
+                });
+                REQUIRE(!passesBottomRow);
+            }
+
+            SECTION("only rebuilds the changed cluster and its neighbours")
+            {
+                graph.setPassable(0, 0, false);
+                REQUIRE(graph.repair() == 3);
+                REQUIRE(graph.repair() == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,289 @@
+#include "../simulation_test_utils.h"
+#include <catch.hpp>
+#include <rwe/pathfinding/PathFindingService.h>
+#include <spdlog/sinks/null_sink.h>
+
+namespace rwe
+{
+    static UnitId addMovingUnit(GameSimulation& sim, const CobScript& script, const Point& cell, const Point& destination)
+    {
+        auto unit = makeTestUnit(script);
+        unit.behaviourState = MovingState{sim.terrain.heightmapIndexToWorldCenter(destination), boost::none, true};
+        return addTestUnit(sim, std::move(unit), sim.terrain.heightmapIndexToWorldCenter(cell));
+    }
+
+    static const MovingState& getMovingState(const GameSimulation& sim, UnitId unitId)
+    {
+        return boost::get<MovingState>(sim.getUnit(unitId).behaviourState);
+    }
+
+    /** Runs the service for a tick, then moves the simulation on to the next. */
+    static void runTick(GameSimulation& sim, PathFindingService& service)
+    {
+        service.update();
+        sim.gameTime = nextGameTime(sim.gameTime);
+    }
+
+    /** Gives the unit waypoints at the centres of the given cells, and asks for a new path. */
+    static void requestRepair(GameSimulation& sim, UnitId unitId, const std::vector<Point>& cells)
+    {
+        std::vector<Vector3f> waypoints;
+        for (const auto& cell : cells)
+        {
+            waypoints.push_back(sim.terrain.heightmapIndexToWorldCenter(cell));
+        }
+
+        auto& movingState = boost::get<MovingState>(sim.getUnit(unitId).behaviourState);
+        movingState.path = PathFollowingInfo(UnitPath{std::move(waypoints)}, sim.gameTime);
+        movingState.pathRequested = true;
+        sim.requestPath(unitId);
+    }
+
+    static bool contains(const DiscreteRect& rect, const Point& p)
+    {
+        return p.x >= rect.x && p.y >= rect.y && p.x < rect.x + static_cast<int>(rect.width) && p.y < rect.y + static_cast<int>(rect.height);
+    }
+
+    TEST_CASE("PathFindingService")
+    {
+        if (!spdlog::get("rwe"))
+        {
+            spdlog::create<spdlog::sinks::null_sink_mt>("rwe");
+        }
+
+        CobScript script;
+        script.staticVariableCount = 0;
+        MovementClassCollisionService collisionService;
+
+        SECTION("delivers paths a fixed number of ticks after dispatch")
+        {
+            for (auto workerCount : {0u, 1u, PathFindingService::DefaultWorkerCount})
+            {
+                GameSimulation sim(makeTestTerrain(64, 64), 0);
+                auto unitId = addMovingUnit(sim, script, Point(4, 4), Point(40, 30));
+                PathFindingService service(&sim, &collisionService, workerCount);
+
+                sim.requestPath(unitId);
+                auto dispatchTime = sim.gameTime;
+                while (sim.gameTime - dispatchTime < PathFindingService::PathDeliveryDelay)
+                {
+                    runTick(sim, service);
+                    REQUIRE(!getMovingState(sim, unitId).path);
+                }
+
+                REQUIRE(sim.gameTime == dispatchTime + PathFindingService::PathDeliveryDelay);
+                runTick(sim, service);
+                const auto& movingState = getMovingState(sim, unitId);
+                REQUIRE(!!movingState.path);
+                REQUIRE(!movingState.pathRequested);
+                REQUIRE(movingState.path->pathCreationTime == dispatchTime + PathFindingService::PathDeliveryDelay);
+                REQUIRE(movingState.path->path.waypoints.back() == sim.terrain.heightmapIndexToWorldCenter(Point(40, 30)));
+            }
+        }
+
+        SECTION("hard searches take more ticks rather than holding up the tick")
+        {
+            std::vector<std::vector<GameTime>> deliveryTimesByWorkerCount;
+            for (auto workerCount : {0u, 1u, PathFindingService::DefaultWorkerCount})
+            {
+                GameSimulation sim(makeTestTerrain(256, 256), 0);
+                MovementClassCollisionService classCollisionService;
+                auto movementClass = classCollisionService.registerMovementClass("TANKSH2", Grid<char>(256, 256, 1));
+
+                // The easy search goes first, then a group sent to the same place,
+                // who share a flow field that takes more than a tick's budget to build.
+                std::vector<UnitId> unitIds{addMovingUnit(sim, script, Point(4, 4), Point(12, 4))};
+                for (int i = 0; i < 4; ++i)
+                {
+                    auto unitId = addMovingUnit(sim, script, Point(4 + i, 200), Point(240, 20));
+                    sim.getUnit(unitId).movementClass = movementClass;
+                    unitIds.push_back(unitId);
+                }
+
+                // Asking for a single worker still gets enough
+                // that the tick never waits on a search stuck behind another.
+                PathFindingService service(&sim, &classCollisionService, workerCount);
+                REQUIRE(service.getWorkerCount() == (workerCount == 0 ? 0 : std::max(workerCount, PathFindingService::MinWorkerCount)));
+
+                for (auto unitId : unitIds)
+                {
+                    sim.requestPath(unitId);
+                }
+
+                auto dispatchTime = sim.gameTime;
+                std::vector<GameTime> deliveryTimes(unitIds.size(), GameTime(0));
+                while (std::any_of(deliveryTimes.begin(), deliveryTimes.end(), [](const auto& t) { return t == GameTime(0); }))
+                {
+                    REQUIRE(sim.gameTime - dispatchTime < GameTimeDelta(100));
+                    runTick(sim, service);
+                    for (std::size_t i = 0; i < unitIds.size(); ++i)
+                    {
+                        const auto& path = getMovingState(sim, unitIds[i]).path;
+                        if (deliveryTimes[i] == GameTime(0) && path)
+                        {
+                            deliveryTimes[i] = path->pathCreationTime;
+                        }
+                    }
+                }
+
+                REQUIRE(deliveryTimes[0] == dispatchTime + PathFindingService::PathDeliveryDelay);
+                for (std::size_t i = 1; i < unitIds.size(); ++i)
+                {
+                    REQUIRE(deliveryTimes[i] > dispatchTime + PathFindingService::PathDeliveryDelay);
+                }
+                deliveryTimesByWorkerCount.push_back(deliveryTimes);
+            }
+
+            REQUIRE(deliveryTimesByWorkerCount[1] == deliveryTimesByWorkerCount[0]);
+            REQUIRE(deliveryTimesByWorkerCount[2] == deliveryTimesByWorkerCount[0]);
+        }
+
+        SECTION("searches see the grid as it was when they were dispatched")
+        {
+            GameSimulation sim(makeTestTerrain(64, 64), 0);
+            auto unitId = addMovingUnit(sim, script, Point(4, 10), Point(20, 10));
+            PathFindingService service(&sim, &collisionService, PathFindingService::DefaultWorkerCount);
+
+            sim.requestPath(unitId);
+            runTick(sim, service);
+
+            // A wall put up after the search was dispatched
+            // doesn't change the path it finds.
+            sim.occupiedGrid.setArea(GridRegion(12, 0, 1, 30), OccupiedFeature());
+            for (unsigned int i = 0; i < PathFindingService::PathDeliveryDelay.value; ++i)
+            {
+                runTick(sim, service);
+            }
+            REQUIRE(!!getMovingState(sim, unitId).path);
+            auto straightPath = service.lastPathDebugInfo.path;
+            REQUIRE(std::any_of(straightPath.begin(), straightPath.end(), [](const auto& p) { return p.x == 12; }));
+
+            // The next search is given a snapshot with the wall in it.
+            boost::get<MovingState>(sim.getUnit(unitId).behaviourState).path = boost::none;
+            sim.requestPath(unitId);
+            for (unsigned int i = 0; i <= PathFindingService::PathDeliveryDelay.value; ++i)
+            {
+                runTick(sim, service);
+            }
+            for (const auto& p : service.lastPathDebugInfo.path)
+            {
+                REQUIRE(!(p.x == 12 && p.y < 30));
+            }
+            REQUIRE(service.lastPathDebugInfo.path.back() == Point(20, 10));
+        }
+
+        SECTION("hands out cached paths until something in the way changes")
+        {
+            GameSimulation sim(makeTestTerrain(64, 64), 0);
+            auto first = addMovingUnit(sim, script, Point(4, 4), Point(40, 30));
+            auto second = addMovingUnit(sim, script, Point(5, 5), Point(40, 30));
+            PathFindingService service(&sim, &collisionService, PathFindingService::DefaultWorkerCount);
+
+            sim.requestPath(first);
+            for (unsigned int i = 0; i <= PathFindingService::PathDeliveryDelay.value; ++i)
+            {
+                runTick(sim, service);
+            }
+            REQUIRE(!!getMovingState(sim, first).path);
+            REQUIRE(service.pathCacheHits == 0);
+            REQUIRE(service.pathCacheMisses == 1);
+
+            // The first unit setting off along its path
+            // doesn't stop the next one from using it.
+            sim.moveUnitOccupiedArea(DiscreteRect(4, 4, 1, 1), DiscreteRect(5, 4, 1, 1), first);
+            sim.requestPath(second);
+            for (unsigned int i = 0; i <= PathFindingService::PathDeliveryDelay.value; ++i)
+            {
+                runTick(sim, service);
+            }
+            REQUIRE(service.pathCacheHits == 1);
+            REQUIRE(service.pathCacheMisses == 1);
+            REQUIRE(getMovingState(sim, second).path->path.waypoints == getMovingState(sim, first).path->path.waypoints);
+
+            // A wall across the way does.
+            sim.occupiedGrid.setArea(GridRegion(20, 0, 1, 40), OccupiedFeature());
+            boost::get<MovingState>(sim.getUnit(second).behaviourState).path = boost::none;
+            sim.requestPath(second);
+            for (unsigned int i = 0; i <= PathFindingService::PathDeliveryDelay.value; ++i)
+            {
+                runTick(sim, service);
+            }
+            REQUIRE(service.pathCacheHits == 1);
+            REQUIRE(service.pathCacheMisses == 2);
+            const auto& waypoints = getMovingState(sim, second).path->path.waypoints;
+            REQUIRE(waypoints != getMovingState(sim, first).path->path.waypoints);
+            REQUIRE(waypoints.back() == sim.terrain.heightmapIndexToWorldCenter(Point(40, 30)));
+        }
+
+        SECTION("repairing a path")
+        {
+            GameSimulation sim(makeTestTerrain(64, 64), 0);
+            auto unitId = addMovingUnit(sim, script, Point(4, 20), Point(56, 20));
+            PathFindingService service(&sim, &collisionService, PathFindingService::DefaultWorkerCount);
+
+            std::vector<Point> oldPath;
+            for (int x = 8; x <= 56; x += 4)
+            {
+                oldPath.emplace_back(x, 20);
+            }
+
+            // The first waypoint 16 cells along is at x = 20,
+            // and the detour may stray 8 cells beyond the unit and that waypoint.
+            DiscreteRect window(4 - 8, 20 - 8, (20 - 4) + 1 + 16, 1 + 16);
+
+            SECTION("finds a detour within the window")
+            {
+                sim.occupiedGrid.setArea(GridRegion(10, 16, 1, 9), OccupiedFeature());
+                requestRepair(sim, unitId, oldPath);
+                for (unsigned int i = 0; i <= PathFindingService::PathDeliveryDelay.value; ++i)
+                {
+                    runTick(sim, service);
+                }
+
+                const auto& debugInfo = service.lastPathDebugInfo;
+                REQUIRE(debugInfo.type == AStarPathType::Complete);
+                REQUIRE(debugInfo.path.back() == Point(20, 20));
+                for (const auto& p : debugInfo.path)
+                {
+                    REQUIRE(contains(window, p));
+                    REQUIRE(!(p.x == 10 && p.y >= 16 && p.y < 25));
+                }
+                for (const auto& v : debugInfo.closedVertices)
+                {
+                    REQUIRE(contains(window, v.vertex));
+                }
+
+                // The rest of the old path is kept as it was.
+                const auto& movingState = getMovingState(sim, unitId);
+                REQUIRE(!!movingState.path);
+                const auto& waypoints = movingState.path->path.waypoints;
+                std::vector<Vector3f> keptWaypoints;
+                for (int x = 20; x <= 56; x += 4)
+                {
+                    keptWaypoints.push_back(sim.terrain.heightmapIndexToWorldCenter(Point(x, 20)));
+                }
+                REQUIRE(waypoints.size() > keptWaypoints.size());
+                REQUIRE(std::equal(keptWaypoints.begin(), keptWaypoints.end(), waypoints.end() - keptWaypoints.size()));
+            }
+
+            SECTION("searches all the way again when the window is sealed")
+            {
+                sim.occupiedGrid.setArea(GridRegion(10, 0, 1, 40), OccupiedFeature());
+                requestRepair(sim, unitId, oldPath);
+                for (unsigned int i = 0; i <= PathFindingService::PathDeliveryDelay.value; ++i)
+                {
+                    runTick(sim, service);
+                }
+
+                const auto& debugInfo = service.lastPathDebugInfo;
+                REQUIRE(debugInfo.type == AStarPathType::Complete);
+                REQUIRE(debugInfo.path.back() == Point(56, 20));
+                REQUIRE(std::any_of(debugInfo.path.begin(), debugInfo.path.end(), [](const auto& p) { return p.y >= 40; }));
+
+                const auto& movingState = getMovingState(sim, unitId);
+                REQUIRE(!!movingState.path);
+                REQUIRE(movingState.path->path.waypoints.back() == sim.terrain.heightmapIndexToWorldCenter(Point(56, 20)));
+            }
+        }
+    }
+}
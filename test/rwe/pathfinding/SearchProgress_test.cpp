@@ -0,0 +1,45 @@
+#include <catch.hpp>
+#include <rwe/pathfinding/SearchProgress.h>
+#include <thread>
+
+namespace rwe
+{
+    TEST_CASE("SearchProgress")
+    {
+        SearchProgress progress;
+
+        SECTION("reports searches that finish within the limit")
+        {
+            std::thread search([&progress]() {
+                for (int i = 0; i < 100; ++i)
+                {
+                    progress.addExpansion();
+                }
+                progress.finish();
+            });
+
+            auto expansions = progress.waitFor(100);
+            search.join();
+            REQUIRE(!!expansions);
+            REQUIRE(*expansions == 100);
+        }
+
+        SECTION("stops waiting once the limit is passed")
+        {
+            std::thread search([&progress]() {
+                for (int i = 0; i < 1000; ++i)
+                {
+                    progress.addExpansion();
+                }
+                progress.finish();
+            });
+
+            auto expansions = progress.waitFor(99);
+            search.join();
+            REQUIRE(!expansions);
+            auto total = progress.waitFor(1000);
+            REQUIRE(!!total);
+            REQUIRE(*total == 1000);
+        }
+    }
+}
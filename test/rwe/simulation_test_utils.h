@@ -0,0 +1,57 @@
+#ifndef RWE_SIMULATION_TEST_UTILS_H
+#define RWE_SIMULATION_TEST_UTILS_H
+
+#include <catch.hpp>
+#include <memory>
+#include <rwe/GameSimulation.h>
+#include <rwe/Unit.h>
+#include <utility>
+
+namespace rwe
+{
+    /** Makes flat terrain of the given size in heightmap cells. */
+    inline MapTerrain makeTestTerrain(std::size_t width, std::size_t height)
+    {
+        return MapTerrain(
+            std::vector<TextureRegion>(),
+            Grid<std::size_t>(width / 2, height / 2),
+            Grid<unsigned char>(width, height),
+            0.0f);
+    }
+
+    /**
+     * Makes a unit with a one cell footprint that runs the given script.
+     * The script's pieces are looked up in the mesh,
+     * which has no pieces unless one is given.
+     */
+    inline Unit makeTestUnit(const CobScript& script, const UnitMesh& mesh = UnitMesh())
+    {
+        Unit unit(
+            mesh,
+            std::make_shared<const ScriptPieceMap>(createScriptPieceMap(script.pieces, mesh)),
+            std::make_unique<CobEnvironment>(&script),
+            SelectionMesh{CollisionMesh(), GlMesh(VaoHandle(), VboHandle(), 0)});
+        unit.footprintX = 1;
+        unit.footprintZ = 1;
+        return unit;
+    }
+
+    /** Adds the unit to the simulation at the given position, which must be free. */
+    inline UnitId addTestUnit(GameSimulation& sim, Unit unit, const Vector3f& position)
+    {
+        UnitKinematics kinematics;
+        kinematics.position = position;
+
+        auto unitId = sim.units.nextId();
+        REQUIRE(sim.tryAddUnit(kinematics, std::move(unit)));
+        return unitId;
+    }
+
+    /** Adds a unit running the given script to the simulation at the given position. */
+    inline UnitId addTestUnit(GameSimulation& sim, const CobScript& script, const Vector3f& position)
+    {
+        return addTestUnit(sim, makeTestUnit(script), position);
+    }
+}
+
+#endif